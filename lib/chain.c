@@ -0,0 +1,800 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Build binary messages in a chain of chunks (WeeChat -> client) */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+
+#include "weechat-relay.h"
+#include "chain.h"
+#include "decode.h"
+#include "encode.h"
+#include "message.h"
+#include "object.h"
+
+
+/*
+ * Adds a segment in a message chain.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_segment (struct t_weechat_relay_msg_chain *chain,
+                                     const void *buffer, size_t size)
+{
+    struct iovec *new_iov;
+    int new_alloc;
+
+    if (chain->iovcnt >= chain->iov_alloc)
+    {
+        new_alloc = (chain->iov_alloc > 0) ? chain->iov_alloc * 2 : 8;
+        new_iov = realloc (chain->iov, sizeof (*new_iov) * new_alloc);
+        if (!new_iov)
+            return 0;
+        chain->iov = new_iov;
+        chain->iov_alloc = new_alloc;
+    }
+
+    chain->iov[chain->iovcnt].iov_base = (void *)buffer;
+    chain->iov[chain->iovcnt].iov_len = size;
+    chain->iovcnt++;
+
+    return 1;
+}
+
+/*
+ * Builds a new message in a chain of chunks (for sending to client), with
+ * chunks of "chunk_size" bytes (0 = default size).
+ *
+ * Returns pointer to new message, NULL if error.
+ */
+
+struct t_weechat_relay_msg_chain *
+weechat_relay_msg_chain_new (const char *id, size_t chunk_size)
+{
+    struct t_weechat_relay_msg_chain *new_chain;
+    char *ptr;
+
+    new_chain = calloc (1, sizeof (*new_chain));
+    if (!new_chain)
+        return NULL;
+
+    new_chain->chunk_size = (chunk_size > 0) ?
+        chunk_size : WEECHAT_RELAY_MSG_CHAIN_CHUNK_SIZE;
+
+    /* add size and compression flag (they will be set later) */
+    ptr = weechat_relay_msg_chain_reserve (new_chain, 5);
+    if (!ptr)
+    {
+        weechat_relay_msg_chain_free (new_chain);
+        return NULL;
+    }
+    memset (ptr, 0, 5);
+
+    /* add id */
+    if (!weechat_relay_msg_chain_add_string (new_chain, id))
+    {
+        weechat_relay_msg_chain_free (new_chain);
+        return NULL;
+    }
+
+    return new_chain;
+}
+
+/*
+ * Reserves "size" bytes at the end of a message chain: the bytes are
+ * counted in the message and must be written by the caller at the pointer
+ * returned (a new chunk is allocated if the last chunk is full, so data is
+ * never moved).
+ *
+ * Returns pointer to the bytes to write, NULL if error.
+ */
+
+char *
+weechat_relay_msg_chain_reserve (struct t_weechat_relay_msg_chain *chain,
+                                 size_t size)
+{
+    struct iovec *ptr_iov;
+    char **new_chunks, *ptr;
+    size_t alloc;
+
+    if (!chain || (size == 0))
+        return NULL;
+
+    if ((chain->num_chunks == 0)
+        || (chain->chunk_alloc - chain->chunk_used < size))
+    {
+        alloc = (size > chain->chunk_size) ? size : chain->chunk_size;
+        new_chunks = realloc (chain->chunks,
+                              sizeof (*new_chunks) * (chain->num_chunks + 1));
+        if (!new_chunks)
+            return NULL;
+        chain->chunks = new_chunks;
+        chain->chunks[chain->num_chunks] = malloc (alloc);
+        if (!chain->chunks[chain->num_chunks])
+            return NULL;
+        chain->num_chunks++;
+        chain->chunk_alloc = alloc;
+        chain->chunk_used = 0;
+    }
+
+    ptr = chain->chunks[chain->num_chunks - 1] + chain->chunk_used;
+
+    /* extend the last segment if it ends at this position in the chunk */
+    ptr_iov = (chain->iovcnt > 0) ? &chain->iov[chain->iovcnt - 1] : NULL;
+    if (ptr_iov && ((char *)ptr_iov->iov_base + ptr_iov->iov_len == ptr))
+    {
+        ptr_iov->iov_len += size;
+    }
+    else
+    {
+        if (!weechat_relay_msg_chain_add_segment (chain, ptr, size))
+            return NULL;
+    }
+
+    chain->chunk_used += size;
+    chain->size += size;
+
+    return ptr;
+}
+
+/*
+ * Adds some bytes to a message chain (bytes are copied).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_bytes (struct t_weechat_relay_msg_chain *chain,
+                                   const void *buffer, size_t size)
+{
+    char *ptr;
+
+    if (!buffer)
+        return 0;
+
+    ptr = weechat_relay_msg_chain_reserve (chain, size);
+    if (!ptr)
+        return 0;
+
+    memcpy (ptr, buffer, size);
+
+    return 1;
+}
+
+/*
+ * Adds some bytes to a message chain by reference: bytes are not copied,
+ * they are sent in their own segment and must remain valid until the
+ * message is sent.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_ref (struct t_weechat_relay_msg_chain *chain,
+                                 const void *buffer, size_t size)
+{
+    if (!chain || !buffer || (size == 0))
+        return 0;
+
+    if (!weechat_relay_msg_chain_add_segment (chain, buffer, size))
+        return 0;
+
+    chain->size += size;
+
+    return 1;
+}
+
+/*
+ * Adds type to a message chain.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_type (struct t_weechat_relay_msg_chain *chain,
+                                  enum t_weechat_relay_obj_type obj_type)
+{
+    return weechat_relay_msg_chain_add_bytes (
+        chain, weechat_relay_obj_types_str[obj_type], 3);
+}
+
+/*
+ * Adds a char to a message chain.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_char (struct t_weechat_relay_msg_chain *chain,
+                                  char c)
+{
+    char *ptr;
+
+    ptr = weechat_relay_msg_chain_reserve (chain, 1);
+    if (!ptr)
+        return 0;
+
+    *ptr = c;
+
+    return 1;
+}
+
+/*
+ * Adds an integer to a message chain.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_integer (struct t_weechat_relay_msg_chain *chain,
+                                     int value)
+{
+    uint32_t value32;
+    char *ptr;
+
+    ptr = weechat_relay_msg_chain_reserve (chain, 4);
+    if (!ptr)
+        return 0;
+
+    value32 = htonl ((uint32_t)value);
+    memcpy (ptr, &value32, 4);
+
+    return 1;
+}
+
+/*
+ * Adds a long integer to a message chain.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_long (struct t_weechat_relay_msg_chain *chain,
+                                  long value)
+{
+    char *ptr;
+    int length;
+
+    length = weechat_relay_encode_length_decimal (value);
+    ptr = weechat_relay_msg_chain_reserve (chain, 1 + length);
+    if (!ptr)
+        return 0;
+
+    ptr[0] = (char)length;
+    weechat_relay_encode_decimal (ptr + 1, value);
+
+    return 1;
+}
+
+/*
+ * Adds length + string to a message chain (string is copied).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_string (struct t_weechat_relay_msg_chain *chain,
+                                    const char *string)
+{
+    size_t length;
+
+    if (!string)
+        return weechat_relay_msg_chain_add_integer (chain, -1);
+
+    length = strlen (string);
+    if (!weechat_relay_msg_chain_add_integer (chain, length))
+        return 0;
+
+    return (length > 0) ?
+        weechat_relay_msg_chain_add_bytes (chain, string, length) : 1;
+}
+
+/*
+ * Adds length + string to a message chain, with the string added by
+ * reference if it has at least WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE bytes
+ * (a smaller string is copied): the string must remain valid until the
+ * message is sent.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_string_ref (struct t_weechat_relay_msg_chain *chain,
+                                        const char *string)
+{
+    if (!string)
+        return weechat_relay_msg_chain_add_integer (chain, -1);
+
+    return weechat_relay_msg_chain_add_buffer_ref (chain, string,
+                                                   strlen (string));
+}
+
+/*
+ * Adds buffer (length + data) to a message chain, with the data added by
+ * reference if it has at least WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE bytes
+ * (smaller data is copied): the data must remain valid until the message is
+ * sent.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_buffer_ref (struct t_weechat_relay_msg_chain *chain,
+                                        const void *buffer, int length)
+{
+    if (!buffer)
+        return weechat_relay_msg_chain_add_integer (chain, -1);
+
+    if (!weechat_relay_msg_chain_add_integer (chain, length))
+        return 0;
+
+    if (length <= 0)
+        return 1;
+
+    if (length < WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE)
+        return weechat_relay_msg_chain_add_bytes (chain, buffer, length);
+
+    return weechat_relay_msg_chain_add_ref (chain, buffer, length);
+}
+
+/*
+ * Adds a pointer to a message chain.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_pointer (struct t_weechat_relay_msg_chain *chain,
+                                     const void *pointer)
+{
+    char *ptr;
+    int length;
+
+    length = weechat_relay_encode_length_hex ((unsigned long)pointer);
+    ptr = weechat_relay_msg_chain_reserve (chain, 1 + length);
+    if (!ptr)
+        return 0;
+
+    ptr[0] = (char)length;
+    weechat_relay_encode_hex (ptr + 1, (unsigned long)pointer);
+
+    return 1;
+}
+
+/*
+ * Adds a time to a message chain.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_time (struct t_weechat_relay_msg_chain *chain,
+                                  time_t time)
+{
+    char *ptr;
+    int length;
+
+    length = weechat_relay_encode_length_decimal ((long long)time);
+    ptr = weechat_relay_msg_chain_reserve (chain, 1 + length);
+    if (!ptr)
+        return 0;
+
+    ptr[0] = (char)length;
+    weechat_relay_encode_decimal (ptr + 1, (long long)time);
+
+    return 1;
+}
+
+/*
+ * Adds a hashtable to a message chain (the hashtable must have been checked
+ * with weechat_relay_msg_size_hashtable).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_hashtable (struct t_weechat_relay_msg_chain *chain,
+                                       struct t_weechat_relay_obj_hashtable *hashtable)
+{
+    int i;
+
+    if (!weechat_relay_msg_chain_add_type (chain, hashtable->type_keys)
+        || !weechat_relay_msg_chain_add_type (chain, hashtable->type_values)
+        || !weechat_relay_msg_chain_add_integer (chain, hashtable->count))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < hashtable->count; i++)
+    {
+        if (!weechat_relay_msg_chain_add_object_value (chain,
+                                                       hashtable->keys[i])
+            || !weechat_relay_msg_chain_add_object_value (chain,
+                                                          hashtable->values[i]))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Adds a hdata to a message chain (the hdata must have been checked with
+ * weechat_relay_msg_size_hdata).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_hdata (struct t_weechat_relay_msg_chain *chain,
+                                   struct t_weechat_relay_obj_hdata *hdata)
+{
+    int i, j, rc;
+
+    if (!weechat_relay_msg_chain_add_string (chain, hdata->hpath)
+        || !weechat_relay_msg_chain_add_string (chain, hdata->keys)
+        || !weechat_relay_msg_chain_add_integer (chain, hdata->count))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < hdata->count; i++)
+    {
+        for (j = 0; j < hdata->num_hpaths; j++)
+        {
+            if (!weechat_relay_msg_chain_add_pointer (
+                    chain, hdata->ppath[i][j]->value_pointer))
+            {
+                return 0;
+            }
+        }
+        for (j = 0; j < hdata->num_keys; j++)
+        {
+            if (!hdata->values[i][j] && hdata->columns && hdata->columns[j])
+            {
+                rc = (hdata->keys_types[j] == WEECHAT_RELAY_OBJ_TYPE_CHAR) ?
+                    weechat_relay_msg_chain_add_char (
+                        chain, ((char *)hdata->columns[j])[i]) :
+                    weechat_relay_msg_chain_add_integer (
+                        chain, ((int *)hdata->columns[j])[i]);
+            }
+            else
+            {
+                rc = weechat_relay_msg_chain_add_object_value (
+                    chain, hdata->values[i][j]);
+            }
+            if (!rc)
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Adds an infolist to a message chain (the infolist must have been checked
+ * with weechat_relay_msg_size_infolist).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_infolist (struct t_weechat_relay_msg_chain *chain,
+                                      struct t_weechat_relay_obj_infolist *infolist)
+{
+    struct t_weechat_relay_obj_infolist_item *ptr_item;
+    struct t_weechat_relay_obj_infolist_var *ptr_var;
+    struct t_weechat_relay_obj obj_temp, *ptr_obj;
+    int i, j;
+
+    if (!weechat_relay_msg_chain_add_string (chain, infolist->name)
+        || !weechat_relay_msg_chain_add_integer (chain, infolist->count))
+    {
+        return 0;
+    }
+
+    /* columnar infolist: same variables in all items */
+    if (!infolist->items && infolist->schema && infolist->columns)
+    {
+        for (i = 0; i < infolist->count; i++)
+        {
+            if (!weechat_relay_msg_chain_add_integer (chain,
+                                                      infolist->schema->count))
+            {
+                return 0;
+            }
+            for (j = 0; j < infolist->schema->count; j++)
+            {
+                ptr_obj = weechat_relay_obj_infolist_column_view (
+                    infolist, j, i, &obj_temp);
+                if (!weechat_relay_msg_chain_add_string (
+                        chain, infolist->schema->names[j])
+                    || !weechat_relay_msg_chain_add_type (chain, ptr_obj->type)
+                    || !weechat_relay_msg_chain_add_object_value (chain,
+                                                                  ptr_obj))
+                {
+                    return 0;
+                }
+            }
+        }
+        return 1;
+    }
+
+    for (i = 0; i < infolist->count; i++)
+    {
+        ptr_item = infolist->items[i];
+        if (!weechat_relay_msg_chain_add_integer (chain, ptr_item->count))
+            return 0;
+        for (j = 0; j < ptr_item->count; j++)
+        {
+            ptr_var = ptr_item->variables[j];
+            if (!weechat_relay_msg_chain_add_string (chain, ptr_var->name)
+                || !weechat_relay_msg_chain_add_type (chain,
+                                                      ptr_var->value->type)
+                || !weechat_relay_msg_chain_add_object_value (chain,
+                                                              ptr_var->value))
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Adds an array to a message chain (the array must have been checked with
+ * weechat_relay_msg_size_array).
+ *
+ * Native integers are converted to big-endian by blocks of at most one
+ * chunk.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_array (struct t_weechat_relay_msg_chain *chain,
+                                   struct t_weechat_relay_obj_array *array)
+{
+    char *ptr;
+    int i, count;
+
+    if (!weechat_relay_msg_chain_add_type (chain, array->type)
+        || !weechat_relay_msg_chain_add_integer (chain, array->count))
+    {
+        return 0;
+    }
+
+    if (!array->values && array->values_native && (array->count > 0))
+    {
+        if (array->type == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+        {
+            return (array->count < WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE) ?
+                weechat_relay_msg_chain_add_bytes (chain, array->values_native,
+                                                   array->count) :
+                weechat_relay_msg_chain_add_ref (chain, array->values_native,
+                                                 array->count);
+        }
+        for (i = 0; i < array->count; i += count)
+        {
+            count = array->count - i;
+            if ((size_t)count > chain->chunk_size / 4)
+                count = chain->chunk_size / 4;
+            if (count <= 0)
+                count = 1;
+            ptr = weechat_relay_msg_chain_reserve (chain, count * 4);
+            if (!ptr)
+                return 0;
+            weechat_relay_decode_integers (
+                (int *)ptr, (const int *)array->values_native + i, count);
+        }
+        return 1;
+    }
+
+    for (i = 0; i < array->count; i++)
+    {
+        if (!weechat_relay_msg_chain_add_object_value (chain,
+                                                       array->values[i]))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Adds the value of an object (without the object type) to a message chain
+ * (the object must have been checked with
+ * weechat_relay_msg_size_object_value).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_object_value (struct t_weechat_relay_msg_chain *chain,
+                                          struct t_weechat_relay_obj *obj)
+{
+    switch (obj->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            return weechat_relay_msg_chain_add_char (chain, obj->value_char);
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            return weechat_relay_msg_chain_add_integer (chain,
+                                                        obj->value_integer);
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            return weechat_relay_msg_chain_add_long (chain, obj->value_long);
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            return weechat_relay_msg_chain_add_string_ref (chain,
+                                                           obj->value_string);
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            return weechat_relay_msg_chain_add_buffer_ref (
+                chain, obj->value_buffer.buffer, obj->value_buffer.length);
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            return weechat_relay_msg_chain_add_pointer (chain,
+                                                        obj->value_pointer);
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            return weechat_relay_msg_chain_add_time (chain, obj->value_time);
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            return weechat_relay_msg_chain_add_hashtable (
+                chain, &obj->value_hashtable);
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            return weechat_relay_msg_chain_add_hdata (chain, &obj->value_hdata);
+        case WEECHAT_RELAY_OBJ_TYPE_INFO:
+            return weechat_relay_msg_chain_add_string (chain,
+                                                       obj->value_info.name)
+                && weechat_relay_msg_chain_add_string_ref (
+                    chain, obj->value_info.value);
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            return weechat_relay_msg_chain_add_infolist (
+                chain, &obj->value_infolist);
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            return weechat_relay_msg_chain_add_array (chain, &obj->value_array);
+        case WEECHAT_RELAY_NUM_OBJ_TYPES:
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Adds an object (type + value) to a message chain, which can be any type
+ * supported in enum t_weechat_relay_obj_type.
+ *
+ * The object is written element by element, so that a big object spans
+ * multiple chunks (with the same encoding as weechat_relay_msg_add_object);
+ * strings and buffers of at least WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE
+ * bytes are added by reference: the object must remain valid until the
+ * message is sent.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_chain_add_object (struct t_weechat_relay_msg_chain *chain,
+                                    struct t_weechat_relay_obj *obj)
+{
+    struct t_weechat_relay_msg msg;
+
+    if (!chain || !obj)
+        return 0;
+
+    /* check the object (it is added only if it can be added completely) */
+    memset (&msg, 0, sizeof (msg));
+    if (weechat_relay_msg_size_object (&msg, obj) == 0)
+        return 0;
+
+    return weechat_relay_msg_chain_add_type (chain, obj->type)
+        && weechat_relay_msg_chain_add_object_value (chain, obj);
+}
+
+/*
+ * Returns segments of a message chain, to send them with writev (or
+ * weechat_relay_session_send_iov); the size of message is written first.
+ *
+ * Segments are valid until the message chain is modified or freed.
+ *
+ * Returns pointer to segments, NULL if error.
+ */
+
+struct iovec *
+weechat_relay_msg_chain_iovec (struct t_weechat_relay_msg_chain *chain,
+                               int *iovcnt)
+{
+    uint32_t size32;
+
+    if (!chain || !iovcnt || (chain->iovcnt == 0))
+        return NULL;
+
+    /* the first segment is always in the first chunk, with the size */
+    size32 = htonl ((uint32_t)chain->size);
+    memcpy (chain->chunks[0], &size32, 4);
+
+    *iovcnt = chain->iovcnt;
+
+    return chain->iov;
+}
+
+/*
+ * Frees a message chain (data added by reference is not freed).
+ */
+
+void
+weechat_relay_msg_chain_free (struct t_weechat_relay_msg_chain *chain)
+{
+    int i;
+
+    if (!chain)
+        return;
+
+    for (i = 0; i < chain->num_chunks; i++)
+    {
+        free (chain->chunks[i]);
+    }
+    if (chain->chunks)
+        free (chain->chunks);
+    if (chain->iov)
+        free (chain->iov);
+
+    free (chain);
+}
@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_CHAIN_H
+#define WEECHAT_RELAY_CHAIN_H
+
+extern int weechat_relay_msg_chain_add_segment (struct t_weechat_relay_msg_chain *chain,
+                                                const void *buffer,
+                                                size_t size);
+extern int weechat_relay_msg_chain_add_hashtable (struct t_weechat_relay_msg_chain *chain,
+                                                  struct t_weechat_relay_obj_hashtable *hashtable);
+extern int weechat_relay_msg_chain_add_hdata (struct t_weechat_relay_msg_chain *chain,
+                                              struct t_weechat_relay_obj_hdata *hdata);
+extern int weechat_relay_msg_chain_add_infolist (struct t_weechat_relay_msg_chain *chain,
+                                                 struct t_weechat_relay_obj_infolist *infolist);
+extern int weechat_relay_msg_chain_add_array (struct t_weechat_relay_msg_chain *chain,
+                                              struct t_weechat_relay_obj_array *array);
+extern int weechat_relay_msg_chain_add_object_value (struct t_weechat_relay_msg_chain *chain,
+                                                     struct t_weechat_relay_obj *obj);
+
+#endif /* WEECHAT_RELAY_CHAIN_H */
@@ -0,0 +1,176 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/* Decode arrays of fixed-size values (vectorized when the CPU allows it) */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "decode.h"
+
+#ifdef WEECHAT_RELAY_DECODE_X86
+#include <immintrin.h>
+#endif
+
+
+static void (*weechat_relay_decode_integers_func) (int *dest, const void *src,
+                                                   int count) = NULL;
+
+
+/*
+ * Decodes "count" integers (4 bytes, big-endian) from "src" to "dest"
+ * (portable version).
+ *
+ * Buffers "dest" and "src" can be the same (in-place decoding), and they
+ * don't need to be aligned.
+ */
+
+void
+weechat_relay_decode_integers_portable (int *dest, const void *src, int count)
+{
+    const unsigned char *ptr_src;
+    uint32_t value32;
+    int i;
+
+    ptr_src = (const unsigned char *)src;
+
+    for (i = 0; i < count; i++)
+    {
+        memcpy (&value32, ptr_src + (i * 4), 4);
+        value32 = ntohl (value32);
+        memcpy (dest + i, &value32, 4);
+    }
+}
+
+#ifdef WEECHAT_RELAY_DECODE_X86
+
+/*
+ * Decodes "count" integers (4 bytes, big-endian) from "src" to "dest"
+ * (SSSE3 version: 4 integers per iteration).
+ *
+ * Buffers "dest" and "src" can be the same (in-place decoding).
+ */
+
+__attribute__((target("ssse3")))
+void
+weechat_relay_decode_integers_ssse3 (int *dest, const void *src, int count)
+{
+    const unsigned char *ptr_src;
+    __m128i mask, value;
+    int i;
+
+    ptr_src = (const unsigned char *)src;
+
+    mask = _mm_set_epi8 (12, 13, 14, 15, 8, 9, 10, 11,
+                         4, 5, 6, 7, 0, 1, 2, 3);
+
+    for (i = 0; i + 4 <= count; i += 4)
+    {
+        value = _mm_loadu_si128 ((const __m128i *)(ptr_src + (i * 4)));
+        _mm_storeu_si128 ((__m128i *)(dest + i),
+                          _mm_shuffle_epi8 (value, mask));
+    }
+
+    weechat_relay_decode_integers_portable (dest + i, ptr_src + (i * 4),
+                                            count - i);
+}
+
+/*
+ * Decodes "count" integers (4 bytes, big-endian) from "src" to "dest"
+ * (AVX2 version: 8 integers per iteration).
+ *
+ * Buffers "dest" and "src" can be the same (in-place decoding).
+ */
+
+__attribute__((target("avx2")))
+void
+weechat_relay_decode_integers_avx2 (int *dest, const void *src, int count)
+{
+    const unsigned char *ptr_src;
+    __m256i mask, value;
+    int i;
+
+    ptr_src = (const unsigned char *)src;
+
+    /* the shuffle is done in each 128-bit lane */
+    mask = _mm256_set_epi8 (12, 13, 14, 15, 8, 9, 10, 11,
+                            4, 5, 6, 7, 0, 1, 2, 3,
+                            12, 13, 14, 15, 8, 9, 10, 11,
+                            4, 5, 6, 7, 0, 1, 2, 3);
+
+    for (i = 0; i + 8 <= count; i += 8)
+    {
+        value = _mm256_loadu_si256 ((const __m256i *)(ptr_src + (i * 4)));
+        _mm256_storeu_si256 ((__m256i *)(dest + i),
+                             _mm256_shuffle_epi8 (value, mask));
+    }
+
+    weechat_relay_decode_integers_portable (dest + i, ptr_src + (i * 4),
+                                            count - i);
+}
+
+#endif /* WEECHAT_RELAY_DECODE_X86 */
+
+/*
+ * Decodes "count" integers (4 bytes, big-endian) from "src" to "dest",
+ * using the fastest version supported by the CPU (chosen on first call).
+ *
+ * Byte swapping is symmetric, so this function is also used to encode
+ * native integers to big-endian.
+ *
+ * Buffers "dest" and "src" can be the same (in-place decoding).
+ *
+ * The function can be called by many threads: the version is read and
+ * stored atomically (threads racing on first call store the same pointer).
+ */
+
+void
+weechat_relay_decode_integers (int *dest, const void *src, int count)
+{
+    void (*func) (int *dest, const void *src, int count);
+
+    if (!dest || !src || (count <= 0))
+        return;
+
+    func = __atomic_load_n (&weechat_relay_decode_integers_func,
+                            __ATOMIC_ACQUIRE);
+    if (!func)
+    {
+#ifdef WEECHAT_RELAY_DECODE_X86
+        __builtin_cpu_init ();
+        if (__builtin_cpu_supports ("avx2"))
+            func = &weechat_relay_decode_integers_avx2;
+        else if (__builtin_cpu_supports ("ssse3"))
+            func = &weechat_relay_decode_integers_ssse3;
+        else
+            func = &weechat_relay_decode_integers_portable;
+#else
+        func = &weechat_relay_decode_integers_portable;
+#endif
+        __atomic_store_n (&weechat_relay_decode_integers_func, func,
+                          __ATOMIC_RELEASE);
+    }
+
+    (func) (dest, src, count);
+}
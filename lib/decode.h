@@ -0,0 +1,41 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_DECODE_H
+#define WEECHAT_RELAY_DECODE_H
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define WEECHAT_RELAY_DECODE_X86 1
+#endif
+
+extern void weechat_relay_decode_integers_portable (int *dest,
+                                                    const void *src,
+                                                    int count);
+#ifdef WEECHAT_RELAY_DECODE_X86
+extern void weechat_relay_decode_integers_ssse3 (int *dest, const void *src,
+                                                 int count);
+extern void weechat_relay_decode_integers_avx2 (int *dest, const void *src,
+                                                int count);
+#endif
+extern void weechat_relay_decode_integers (int *dest, const void *src,
+                                           int count);
+
+#endif /* WEECHAT_RELAY_DECODE_H */
@@ -0,0 +1,508 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/* Dispatch of parsed messages to handlers, by message id */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "weechat-relay.h"
+#include "dispatch.h"
+
+
+const char *weechat_relay_event_string[WEECHAT_RELAY_NUM_EVENTS] = {
+    "",
+    "_buffer_opened",
+    "_buffer_type_changed",
+    "_buffer_moved",
+    "_buffer_merged",
+    "_buffer_unmerged",
+    "_buffer_hidden",
+    "_buffer_unhidden",
+    "_buffer_renamed",
+    "_buffer_title_changed",
+    "_buffer_localvar_added",
+    "_buffer_localvar_changed",
+    "_buffer_localvar_removed",
+    "_buffer_closing",
+    "_buffer_cleared",
+    "_buffer_line_added",
+    "_nicklist",
+    "_nicklist_diff",
+    "_pong",
+    "_upgrade",
+    "_upgrade_ended",
+};
+
+/*
+ * Perfect hash table of WeeChat events: event for each hash (see function
+ * weechat_relay_dispatch_search_event), WEECHAT_RELAY_EVENT_NONE if no
+ * event has this hash.
+ */
+const unsigned char weechat_relay_dispatch_events_hash[WEECHAT_RELAY_DISPATCH_EVENTS_HASH_SIZE] = {
+    12, 0, 0, 0, 0, 0, 14, 0, 0, 0, 0, 18, 0, 0, 0, 0,
+    0, 0, 0, 8, 0, 20, 0, 0, 0, 0, 0, 0, 13, 0, 6, 0,
+    0, 0, 19, 0, 0, 0, 15, 16, 0, 1, 10, 0, 17, 7, 0, 0,
+    0, 4, 0, 0, 0, 0, 3, 0, 0, 0, 11, 5, 0, 0, 2, 9,
+};
+
+
+/*
+ * Searches a WeeChat event by message id ("length" bytes, the id does not
+ * need to be NUL-terminated), with a perfect hash on the length and two
+ * chars of id: only one comparison is done with the event found.
+ *
+ * Returns the event found, WEECHAT_RELAY_EVENT_NONE if the id is not a
+ * WeeChat event.
+ */
+
+enum t_weechat_relay_event
+weechat_relay_dispatch_search_event (const char *id, int length)
+{
+    const unsigned char *ptr_id;
+    int event;
+
+    if (!id || (length < 5) || (length > 24) || (id[0] != '_'))
+        return WEECHAT_RELAY_EVENT_NONE;
+
+    ptr_id = (const unsigned char *)id;
+
+    event = weechat_relay_dispatch_events_hash[
+        (length
+         + (26 * ptr_id[length - 3])
+         + ((length > 8) ? ptr_id[8] : 0))
+        & (WEECHAT_RELAY_DISPATCH_EVENTS_HASH_SIZE - 1)];
+
+    if ((event == WEECHAT_RELAY_EVENT_NONE)
+        || (strncmp (weechat_relay_event_string[event], id, length) != 0)
+        || weechat_relay_event_string[event][length])
+    {
+        return WEECHAT_RELAY_EVENT_NONE;
+    }
+
+    return (enum t_weechat_relay_event)event;
+}
+
+/*
+ * Interns a custom id (with one reference, for the caller).
+ *
+ * Returns pointer to the string of interned id, NULL if error.
+ */
+
+char *
+weechat_relay_dispatch_id_new (const char *id)
+{
+    struct t_weechat_relay_dispatch_id *new_id;
+    size_t length;
+
+    if (!id)
+        return NULL;
+
+    length = strlen (id);
+
+    new_id = malloc (sizeof (*new_id) + length + 1);
+    if (!new_id)
+        return NULL;
+
+    new_id->refcount = 1;
+    memcpy (new_id->string, id, length + 1);
+
+    return new_id->string;
+}
+
+/*
+ * Adds a reference to an interned custom id.
+ */
+
+void
+weechat_relay_dispatch_id_ref (char *id)
+{
+    struct t_weechat_relay_dispatch_id *ptr_id;
+
+    if (!id)
+        return;
+
+    ptr_id = (struct t_weechat_relay_dispatch_id *)(
+        id - offsetof (struct t_weechat_relay_dispatch_id, string));
+    __atomic_add_fetch (&ptr_id->refcount, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Removes a reference to an interned custom id: it is freed when the last
+ * reference is removed (dispatcher or parsed message, in any thread).
+ */
+
+void
+weechat_relay_dispatch_id_unref (char *id)
+{
+    struct t_weechat_relay_dispatch_id *ptr_id;
+
+    if (!id)
+        return;
+
+    ptr_id = (struct t_weechat_relay_dispatch_id *)(
+        id - offsetof (struct t_weechat_relay_dispatch_id, string));
+    if (__atomic_sub_fetch (&ptr_id->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+        free (ptr_id);
+}
+
+/*
+ * Computes hash of a custom id ("length" bytes, FNV-1a).
+ */
+
+unsigned int
+weechat_relay_dispatch_hash_id (const char *id, int length)
+{
+    uint64_t hash;
+    int i;
+
+    hash = 0xCBF29CE484222325ULL;
+    for (i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)id[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return (unsigned int)(hash ^ (hash >> 32));
+}
+
+/*
+ * Builds the index on custom ids (open addressing with linear probing),
+ * with "index_size" slots (power of 2).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_dispatch_build_index (struct t_weechat_relay_dispatch *dispatch,
+                                    int index_size)
+{
+    int *index, i, slot, mask;
+
+    index = calloc (index_size, sizeof (*index));
+    if (!index)
+        return 0;
+
+    mask = index_size - 1;
+    for (i = 0; i < dispatch->num_ids; i++)
+    {
+        slot = (int)(weechat_relay_dispatch_hash_id (
+                         dispatch->ids[i], dispatch->ids_length[i]) & mask);
+        while (index[slot])
+        {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = i + 1;
+    }
+
+    if (dispatch->index)
+        free (dispatch->index);
+    dispatch->index = index;
+    dispatch->index_size = index_size;
+
+    return 1;
+}
+
+/*
+ * Searches a custom id ("length" bytes, the id does not need to be
+ * NUL-terminated).
+ *
+ * Returns index of id in dispatcher, -1 if not found.
+ */
+
+int
+weechat_relay_dispatch_search_id (struct t_weechat_relay_dispatch *dispatch,
+                                  const char *id, int length)
+{
+    int slot, mask, i;
+
+    if (!dispatch || !id || (length < 0) || !dispatch->index)
+        return -1;
+
+    mask = dispatch->index_size - 1;
+    slot = (int)(weechat_relay_dispatch_hash_id (id, length) & mask);
+    while (dispatch->index[slot])
+    {
+        i = dispatch->index[slot] - 1;
+        if ((dispatch->ids_length[i] == length)
+            && (memcmp (dispatch->ids[i], id, length) == 0))
+        {
+            return i;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return -1;
+}
+
+/*
+ * Creates a dispatcher: it calls a handler for each message, according to
+ * the message id.
+ *
+ * Note: the dispatcher must be freed by weechat_relay_dispatch_free.
+ *
+ * Returns pointer to dispatcher, NULL if error.
+ */
+
+struct t_weechat_relay_dispatch *
+weechat_relay_dispatch_new ()
+{
+    return calloc (1, sizeof (struct t_weechat_relay_dispatch));
+}
+
+/*
+ * Sets the handler of a WeeChat event (callback can be NULL to remove the
+ * handler).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_dispatch_set_event (struct t_weechat_relay_dispatch *dispatch,
+                                  enum t_weechat_relay_event event,
+                                  void (*callback)(void *data,
+                                                   struct t_weechat_relay_parsed_msg *parsed_msg),
+                                  void *callback_data)
+{
+    if (!dispatch
+        || (event <= WEECHAT_RELAY_EVENT_NONE)
+        || (event >= WEECHAT_RELAY_NUM_EVENTS))
+    {
+        return 0;
+    }
+
+    dispatch->events[event].callback = callback;
+    dispatch->events[event].callback_data = callback_data;
+
+    return 1;
+}
+
+/*
+ * Sets the handler of a message id (callback can be NULL to remove the
+ * handler).
+ *
+ * If the id is a WeeChat event, this is the same as
+ * weechat_relay_dispatch_set_event.
+ *
+ * Otherwise the id is interned in dispatcher: messages parsed with this
+ * dispatcher (see weechat_relay_session_buffer_dispatch) point to this
+ * string instead of a copy of the id, and hold a reference on it (so they
+ * can be freed after the dispatcher).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_dispatch_set_id (struct t_weechat_relay_dispatch *dispatch,
+                               const char *id,
+                               void (*callback)(void *data,
+                                                struct t_weechat_relay_parsed_msg *parsed_msg),
+                               void *callback_data)
+{
+    enum t_weechat_relay_event event;
+    char **new_ids;
+    int *new_ids_length, length, index, slot, mask;
+    struct t_weechat_relay_dispatch_handler *new_handlers;
+
+    if (!dispatch || !id)
+        return 0;
+
+    length = strlen (id);
+
+    event = weechat_relay_dispatch_search_event (id, length);
+    if (event != WEECHAT_RELAY_EVENT_NONE)
+    {
+        return weechat_relay_dispatch_set_event (dispatch, event,
+                                                 callback, callback_data);
+    }
+
+    index = weechat_relay_dispatch_search_id (dispatch, id, length);
+    if (index < 0)
+    {
+        /* keep the index less than half full */
+        if ((dispatch->num_ids + 1) * 2 > dispatch->index_size)
+        {
+            if (!weechat_relay_dispatch_build_index (
+                    dispatch,
+                    (dispatch->index_size > 0) ? dispatch->index_size * 2 : 16))
+            {
+                return 0;
+            }
+        }
+
+        new_ids = realloc (dispatch->ids,
+                           (dispatch->num_ids + 1) * sizeof (*dispatch->ids));
+        if (!new_ids)
+            return 0;
+        dispatch->ids = new_ids;
+
+        new_ids_length = realloc (
+            dispatch->ids_length,
+            (dispatch->num_ids + 1) * sizeof (*dispatch->ids_length));
+        if (!new_ids_length)
+            return 0;
+        dispatch->ids_length = new_ids_length;
+
+        new_handlers = realloc (
+            dispatch->ids_handlers,
+            (dispatch->num_ids + 1) * sizeof (*dispatch->ids_handlers));
+        if (!new_handlers)
+            return 0;
+        dispatch->ids_handlers = new_handlers;
+
+        dispatch->ids[dispatch->num_ids] = weechat_relay_dispatch_id_new (id);
+        if (!dispatch->ids[dispatch->num_ids])
+            return 0;
+        dispatch->ids_length[dispatch->num_ids] = length;
+        index = dispatch->num_ids;
+        dispatch->num_ids++;
+
+        /* add id in index */
+        mask = dispatch->index_size - 1;
+        slot = (int)(weechat_relay_dispatch_hash_id (id, length) & mask);
+        while (dispatch->index[slot])
+        {
+            slot = (slot + 1) & mask;
+        }
+        dispatch->index[slot] = index + 1;
+    }
+
+    dispatch->ids_handlers[index].callback = callback;
+    dispatch->ids_handlers[index].callback_data = callback_data;
+
+    return 1;
+}
+
+/*
+ * Sets the handler of messages without handler (callback can be NULL to
+ * ignore these messages).
+ */
+
+void
+weechat_relay_dispatch_set_default (struct t_weechat_relay_dispatch *dispatch,
+                                    void (*callback)(void *data,
+                                                     struct t_weechat_relay_parsed_msg *parsed_msg),
+                                    void *callback_data)
+{
+    if (!dispatch)
+        return;
+
+    dispatch->default_handler.callback = callback;
+    dispatch->default_handler.callback_data = callback_data;
+}
+
+/*
+ * Calls the handler of a parsed message: handler of WeeChat event, handler
+ * of custom id, or default handler.
+ *
+ * The handler is found without string comparison for WeeChat events and
+ * custom ids interned at parse; the id of other messages is searched in
+ * custom ids.
+ *
+ * Returns:
+ *   1: handler called
+ *   0: no handler for this message
+ */
+
+int
+weechat_relay_dispatch_message (struct t_weechat_relay_dispatch *dispatch,
+                                struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_dispatch_handler *ptr_handler;
+    int index;
+
+    if (!dispatch || !parsed_msg)
+        return 0;
+
+    ptr_handler = NULL;
+
+    if (parsed_msg->event != WEECHAT_RELAY_EVENT_NONE)
+    {
+        ptr_handler = &dispatch->events[parsed_msg->event];
+    }
+    else
+    {
+        if ((parsed_msg->id_custom > 0)
+            && (parsed_msg->id_custom <= dispatch->num_ids)
+            && (parsed_msg->id == dispatch->ids[parsed_msg->id_custom - 1]))
+        {
+            index = parsed_msg->id_custom - 1;
+        }
+        else
+        {
+            index = (parsed_msg->id) ?
+                weechat_relay_dispatch_search_id (dispatch, parsed_msg->id,
+                                                  strlen (parsed_msg->id)) : -1;
+        }
+        if (index >= 0)
+            ptr_handler = &dispatch->ids_handlers[index];
+    }
+
+    if (!ptr_handler || !ptr_handler->callback)
+        ptr_handler = &dispatch->default_handler;
+
+    if (!ptr_handler->callback)
+        return 0;
+
+    (ptr_handler->callback) (ptr_handler->callback_data, parsed_msg);
+
+    return 1;
+}
+
+/*
+ * Frees a dispatcher.
+ *
+ * Interned ids still referenced by parsed messages are freed with the last
+ * message.
+ */
+
+void
+weechat_relay_dispatch_free (struct t_weechat_relay_dispatch *dispatch)
+{
+    int i;
+
+    if (!dispatch)
+        return;
+
+    for (i = 0; i < dispatch->num_ids; i++)
+    {
+        weechat_relay_dispatch_id_unref (dispatch->ids[i]);
+    }
+    if (dispatch->ids)
+        free (dispatch->ids);
+    if (dispatch->ids_length)
+        free (dispatch->ids_length);
+    if (dispatch->ids_handlers)
+        free (dispatch->ids_handlers);
+    if (dispatch->index)
+        free (dispatch->index);
+
+    free (dispatch);
+}
@@ -0,0 +1,75 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef WEECHAT_RELAY_DISPATCH_H
+#define WEECHAT_RELAY_DISPATCH_H
+
+/* size of perfect hash table of WeeChat events */
+#define WEECHAT_RELAY_DISPATCH_EVENTS_HASH_SIZE 64
+
+struct t_weechat_relay_dispatch_handler
+{
+    void (*callback)(void *data,
+                     struct t_weechat_relay_parsed_msg *parsed_msg);
+    void *callback_data;
+};
+
+/*
+ * Custom id interned in dispatcher: the string is shared by the dispatcher
+ * and messages parsed with it, each one holds a reference, so that messages
+ * can outlive the dispatcher.
+ */
+struct t_weechat_relay_dispatch_id
+{
+    int refcount;                      /* number of references              */
+    char string[];                     /* id                                */
+};
+
+struct t_weechat_relay_dispatch
+{
+    /* handlers of WeeChat events (index 0 is not used) */
+    struct t_weechat_relay_dispatch_handler events[WEECHAT_RELAY_NUM_EVENTS];
+
+    /* custom ids (interned: shared with parsed messages) */
+    int num_ids;                       /* number of custom ids              */
+    char **ids;                        /* custom ids                        */
+    int *ids_length;                   /* length of each custom id          */
+    struct t_weechat_relay_dispatch_handler *ids_handlers; /* handlers      */
+    int index_size;                    /* size of index (power of 2)        */
+    int *index;                        /* open addressing: id + 1 in each   */
+                                       /* slot (0 = empty slot)             */
+
+    /* handler for messages without handler */
+    struct t_weechat_relay_dispatch_handler default_handler;
+};
+
+extern char *weechat_relay_dispatch_id_new (const char *id);
+extern void weechat_relay_dispatch_id_ref (char *id);
+extern void weechat_relay_dispatch_id_unref (char *id);
+extern unsigned int weechat_relay_dispatch_hash_id (const char *id,
+                                                    int length);
+extern int weechat_relay_dispatch_build_index (
+    struct t_weechat_relay_dispatch *dispatch, int index_size);
+extern int weechat_relay_dispatch_search_id (
+    struct t_weechat_relay_dispatch *dispatch, const char *id, int length);
+
+#endif /* WEECHAT_RELAY_DISPATCH_H */
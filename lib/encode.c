@@ -0,0 +1,193 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Encode integers as text (decimal or hexadecimal) */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "encode.h"
+
+
+/* pairs of decimal digits: "00", "01", ..., "99" */
+static const char weechat_relay_encode_digits2[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char weechat_relay_encode_digits_hex[17] = "0123456789abcdef";
+
+/* powers of 10 (with 0 instead of 1 so that 0 has 1 digit) */
+static const uint64_t weechat_relay_encode_powers10[20] =
+{
+    0ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+
+/*
+ * Returns the number of decimal digits of an unsigned number.
+ *
+ * The number of bits gives an estimate of log10 (1233 / 4096 ~= log10(2)),
+ * corrected with one comparison.
+ */
+
+int
+weechat_relay_encode_digits_decimal (uint64_t number)
+{
+    int length;
+
+    length = ((64 - __builtin_clzll (number | 1)) * 1233) >> 12;
+
+    return length + 1 - (number < weechat_relay_encode_powers10[length]);
+}
+
+/*
+ * Returns the number of chars of a signed number in base 10 (with the sign
+ * if the number is negative).
+ */
+
+int
+weechat_relay_encode_length_decimal (long long value)
+{
+    if (value < 0)
+        return 1 + weechat_relay_encode_digits_decimal (-((uint64_t)value));
+
+    return weechat_relay_encode_digits_decimal (value);
+}
+
+/*
+ * Returns the number of chars of an unsigned number in base 16.
+ */
+
+int
+weechat_relay_encode_length_hex (unsigned long long value)
+{
+    return ((64 - __builtin_clzll (value | 1)) + 3) >> 2;
+}
+
+/*
+ * Writes an unsigned number in base 10, with exactly "length" digits (as
+ * returned by weechat_relay_encode_digits_decimal), two digits at a time.
+ */
+
+void
+weechat_relay_encode_write_decimal (char *dest, uint64_t number, int length)
+{
+    char *ptr;
+    int index;
+
+    ptr = dest + length;
+    while (number >= 100)
+    {
+        index = (int)(number % 100) * 2;
+        number /= 100;
+        *(--ptr) = weechat_relay_encode_digits2[index + 1];
+        *(--ptr) = weechat_relay_encode_digits2[index];
+    }
+    if (number >= 10)
+    {
+        index = (int)number * 2;
+        *(--ptr) = weechat_relay_encode_digits2[index + 1];
+        *(--ptr) = weechat_relay_encode_digits2[index];
+    }
+    else
+    {
+        *(--ptr) = '0' + (char)number;
+    }
+}
+
+/*
+ * Writes a signed number in base 10 (same output as "%lld" with printf,
+ * without the final '\0'); "dest" must have room for 20 chars.
+ *
+ * Returns the number of chars written.
+ */
+
+int
+weechat_relay_encode_decimal (char *dest, long long value)
+{
+    uint64_t number;
+    int length;
+
+    if (value < 0)
+    {
+        *dest = '-';
+        number = -((uint64_t)value);
+        length = weechat_relay_encode_digits_decimal (number);
+        weechat_relay_encode_write_decimal (dest + 1, number, length);
+        return length + 1;
+    }
+
+    length = weechat_relay_encode_digits_decimal (value);
+    weechat_relay_encode_write_decimal (dest, value, length);
+
+    return length;
+}
+
+/*
+ * Writes an unsigned number in base 16 (same output as "%llx" with printf,
+ * without the final '\0'); "dest" must have room for 16 chars.
+ *
+ * Returns the number of chars written.
+ */
+
+int
+weechat_relay_encode_hex (char *dest, unsigned long long value)
+{
+    char *ptr;
+    int length;
+
+    length = weechat_relay_encode_length_hex (value);
+    ptr = dest + length;
+    do
+    {
+        *(--ptr) = weechat_relay_encode_digits_hex[value & 0xF];
+        value >>= 4;
+    } while (ptr > dest);
+
+    return length;
+}
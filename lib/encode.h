@@ -0,0 +1,36 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_ENCODE_H
+#define WEECHAT_RELAY_ENCODE_H
+
+/* max number of chars of an integer encoded: "-9223372036854775808" */
+#define WEECHAT_RELAY_ENCODE_MAX_LENGTH 20
+
+extern int weechat_relay_encode_digits_decimal (uint64_t number);
+extern int weechat_relay_encode_length_decimal (long long value);
+extern int weechat_relay_encode_length_hex (unsigned long long value);
+extern void weechat_relay_encode_write_decimal (char *dest, uint64_t number,
+                                                int length);
+extern int weechat_relay_encode_decimal (char *dest, long long value);
+extern int weechat_relay_encode_hex (char *dest, unsigned long long value);
+
+#endif /* WEECHAT_RELAY_ENCODE_H */
@@ -0,0 +1,248 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/* Filters on message ids, checked before messages are parsed */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "weechat-relay.h"
+#include "filter.h"
+#include "parse.h"
+
+
+/*
+ * Creates a filter: all messages are accepted until ids are added.
+ *
+ * Returns pointer to filter, NULL if error.
+ */
+
+struct t_weechat_relay_filter *
+weechat_relay_filter_new ()
+{
+    struct t_weechat_relay_filter *filter;
+
+    filter = calloc (1, sizeof (*filter));
+    if (!filter)
+        return NULL;
+
+    filter->default_action = WEECHAT_RELAY_FILTER_ACCEPT;
+
+    return filter;
+}
+
+/*
+ * Searches an id in filter (exact string, including the "*" if the id is
+ * a prefix).
+ *
+ * Returns index of id in filter, -1 if not found.
+ */
+
+int
+weechat_relay_filter_search (struct t_weechat_relay_filter *filter,
+                             const char *id)
+{
+    int i;
+
+    if (!filter || !id)
+        return -1;
+
+    for (i = 0; i < filter->num_ids; i++)
+    {
+        if (strcmp (filter->ids[i], id) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+/*
+ * Adds an id in filter, with the action to do on messages with this id.
+ *
+ * If the id ends with "*", it is a prefix: for example "_buffer_*" matches
+ * all messages with an id starting with "_buffer_".
+ *
+ * If the id is already in filter, its action is updated.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_filter_add (struct t_weechat_relay_filter *filter,
+                          const char *id,
+                          enum t_weechat_relay_filter_action action)
+{
+    char **new_ids;
+    enum t_weechat_relay_filter_action *new_actions;
+    int index;
+
+    if (!filter || !id
+        || ((int)action < 0) || (action >= WEECHAT_RELAY_NUM_FILTER_ACTIONS))
+    {
+        return 0;
+    }
+
+    index = weechat_relay_filter_search (filter, id);
+    if (index >= 0)
+    {
+        filter->actions[index] = action;
+        return 1;
+    }
+
+    new_ids = realloc (filter->ids,
+                       (filter->num_ids + 1) * sizeof (*filter->ids));
+    if (!new_ids)
+        return 0;
+    filter->ids = new_ids;
+
+    new_actions = realloc (filter->actions,
+                           (filter->num_ids + 1) * sizeof (*filter->actions));
+    if (!new_actions)
+        return 0;
+    filter->actions = new_actions;
+
+    filter->ids[filter->num_ids] = strdup (id);
+    if (!filter->ids[filter->num_ids])
+        return 0;
+    filter->actions[filter->num_ids] = action;
+    filter->num_ids++;
+
+    return 1;
+}
+
+/*
+ * Removes an id from filter.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (id not found)
+ */
+
+int
+weechat_relay_filter_remove (struct t_weechat_relay_filter *filter,
+                             const char *id)
+{
+    int index;
+
+    index = weechat_relay_filter_search (filter, id);
+    if (index < 0)
+        return 0;
+
+    free (filter->ids[index]);
+    memmove (filter->ids + index, filter->ids + index + 1,
+             (filter->num_ids - index - 1) * sizeof (*filter->ids));
+    memmove (filter->actions + index, filter->actions + index + 1,
+             (filter->num_ids - index - 1) * sizeof (*filter->actions));
+    filter->num_ids--;
+
+    return 1;
+}
+
+/*
+ * Returns the action to do on a message with this id: action of the first
+ * id matching in filter (in order of addition), or the default action if
+ * no id is matching.
+ */
+
+enum t_weechat_relay_filter_action
+weechat_relay_filter_match (struct t_weechat_relay_filter *filter,
+                            const char *id)
+{
+    int i;
+    size_t length;
+
+    if (!filter)
+        return WEECHAT_RELAY_FILTER_ACCEPT;
+
+    if (!id)
+        return filter->default_action;
+
+    for (i = 0; i < filter->num_ids; i++)
+    {
+        length = strlen (filter->ids[i]);
+        if ((length > 0) && (filter->ids[i][length - 1] == '*'))
+        {
+            if (strncmp (filter->ids[i], id, length - 1) == 0)
+                return filter->actions[i];
+        }
+        else if (strcmp (filter->ids[i], id) == 0)
+        {
+            return filter->actions[i];
+        }
+    }
+
+    return filter->default_action;
+}
+
+/*
+ * Returns the action to do on a message, according to its id, which is
+ * peeked without parsing the message (with a parse context, can be NULL).
+ *
+ * A message with an id that can not be peeked (invalid message or id too
+ * long) is accepted, so that the error is reported by the parser.
+ */
+
+enum t_weechat_relay_filter_action
+weechat_relay_filter_check_message (struct t_weechat_relay_filter *filter,
+                                    struct t_weechat_relay_parse_ctx *ctx,
+                                    const void *buffer, size_t size)
+{
+    char id[WEECHAT_RELAY_FILTER_ID_SIZE];
+
+    if (!filter
+        || ((filter->num_ids == 0)
+            && (filter->default_action == WEECHAT_RELAY_FILTER_ACCEPT)))
+    {
+        return WEECHAT_RELAY_FILTER_ACCEPT;
+    }
+
+    if (!weechat_relay_parse_peek_id_ctx (ctx, buffer, size, id, sizeof (id)))
+        return WEECHAT_RELAY_FILTER_ACCEPT;
+
+    return weechat_relay_filter_match (filter, id);
+}
+
+/*
+ * Frees a filter.
+ */
+
+void
+weechat_relay_filter_free (struct t_weechat_relay_filter *filter)
+{
+    int i;
+
+    if (!filter)
+        return;
+
+    for (i = 0; i < filter->num_ids; i++)
+    {
+        free (filter->ids[i]);
+    }
+    if (filter->ids)
+        free (filter->ids);
+    if (filter->actions)
+        free (filter->actions);
+
+    free (filter);
+}
@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef WEECHAT_RELAY_FILTER_H
+#define WEECHAT_RELAY_FILTER_H
+
+/* max size of message id checked by filter (longer ids are not filtered) */
+#define WEECHAT_RELAY_FILTER_ID_SIZE 256
+
+struct t_weechat_relay_parse_ctx;
+
+struct t_weechat_relay_filter
+{
+    int num_ids;                       /* number of ids                     */
+    char **ids;                        /* message ids (if ending with "*":  */
+                                       /* prefix of message ids)            */
+    enum t_weechat_relay_filter_action *actions; /* action for each id      */
+    enum t_weechat_relay_filter_action default_action; /* action if no id   */
+                                       /* is matching                       */
+};
+
+extern struct t_weechat_relay_filter *weechat_relay_filter_new ();
+extern int weechat_relay_filter_search (struct t_weechat_relay_filter *filter,
+                                        const char *id);
+extern int weechat_relay_filter_add (struct t_weechat_relay_filter *filter,
+                                     const char *id,
+                                     enum t_weechat_relay_filter_action action);
+extern int weechat_relay_filter_remove (struct t_weechat_relay_filter *filter,
+                                        const char *id);
+extern enum t_weechat_relay_filter_action weechat_relay_filter_match (
+    struct t_weechat_relay_filter *filter, const char *id);
+extern enum t_weechat_relay_filter_action weechat_relay_filter_check_message (
+    struct t_weechat_relay_filter *filter,
+    struct t_weechat_relay_parse_ctx *ctx,
+    const void *buffer, size_t size);
+extern void weechat_relay_filter_free (struct t_weechat_relay_filter *filter);
+
+#endif /* WEECHAT_RELAY_FILTER_H */
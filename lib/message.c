@@ -34,8 +34,13 @@
 #include <gnutls/gnutls.h>
 #include <zlib.h>
 #include <zstd.h>
+#include <zdict.h>
 
 #include "weechat-relay.h"
+#include "decode.h"
+#include "encode.h"
+#include "message.h"
+#include "object.h"
 
 
 /*
@@ -62,15 +67,104 @@ weechat_relay_msg_new (const char *id)
     }
     new_msg->data_alloc = WEECHAT_RELAY_MSG_INITIAL_ALLOC;
     new_msg->data_size = 0;
+    new_msg->passthrough = 0;
+    new_msg->compression = WEECHAT_RELAY_COMPRESSION_OFF;
+    new_msg->compress_stream = NULL;
+    new_msg->compressed = NULL;
+    new_msg->compressed_alloc = 0;
+    new_msg->compressed_size = 0;
 
     /* add size and compression flag (they will be set later) */
-    weechat_relay_msg_add_integer (new_msg, 0);
-    weechat_relay_msg_add_char (new_msg, 0);
+    weechat_relay_msg_append_integer (new_msg, 0);
+    weechat_relay_msg_append_char (new_msg, 0);
 
     /* add id */
-    weechat_relay_msg_add_string (new_msg, id);
+    weechat_relay_msg_append_string (new_msg, id);
+
+    weechat_relay_msg_update_size (new_msg);
+
+    return new_msg;
+}
+
+/*
+ * Builds a new message compressed while it is built (for sending to client):
+ * bytes added are compressed by chunks of WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE
+ * bytes (an object bigger than a chunk is written element by element), so
+ * that at most one chunk of uncompressed bytes is kept in memory.
+ *
+ * The message must be completed with weechat_relay_msg_finalize: data is then
+ * the compressed message and nothing can be added any more.
+ *
+ * If compression is WEECHAT_RELAY_COMPRESSION_OFF, this is the same as
+ * weechat_relay_msg_new.
+ *
+ * Returns pointer to new message, NULL if error.
+ */
+
+struct t_weechat_relay_msg *
+weechat_relay_msg_new_compress (const char *id,
+                                enum t_weechat_relay_compression compression,
+                                int compression_level)
+{
+    struct t_weechat_relay_msg *new_msg;
+    z_stream *strm;
+    ZSTD_CCtx *cctx;
+
+    if ((compression < 0) || (compression >= WEECHAT_RELAY_NUM_COMPRESSIONS))
+        return NULL;
+
+    new_msg = weechat_relay_msg_new (id);
+    if (!new_msg || (compression == WEECHAT_RELAY_COMPRESSION_OFF))
+        return new_msg;
+
+    new_msg->compressed = malloc (WEECHAT_RELAY_MSG_INITIAL_ALLOC);
+    if (!new_msg->compressed)
+        goto error;
+    new_msg->compressed_alloc = WEECHAT_RELAY_MSG_INITIAL_ALLOC;
+
+    /* size and compression flag are set in weechat_relay_msg_finalize */
+    memset (new_msg->compressed, 0, 5);
+    new_msg->compressed_size = 5;
+
+    new_msg->compression = compression;
+    switch (compression)
+    {
+        case WEECHAT_RELAY_COMPRESSION_ZLIB:
+            strm = calloc (1, sizeof (*strm));
+            if (!strm)
+                goto error;
+            if (deflateInit (strm, compression_level) != Z_OK)
+            {
+                free (strm);
+                goto error;
+            }
+            new_msg->compress_stream = strm;
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZSTD:
+            cctx = ZSTD_createCCtx ();
+            if (!cctx)
+                goto error;
+            new_msg->compress_stream = cctx;
+            if (ZSTD_isError (
+                    ZSTD_CCtx_setParameter (cctx, ZSTD_c_compressionLevel,
+                                            compression_level)))
+            {
+                goto error;
+            }
+            break;
+        default:
+            break;
+    }
+
+    /* only id is kept: it is the first data compressed */
+    memmove (new_msg->data, new_msg->data + 5, new_msg->data_size - 5);
+    new_msg->data_size -= 5;
 
     return new_msg;
+
+error:
+    weechat_relay_msg_free (new_msg);
+    return NULL;
 }
 
 /*
@@ -86,7 +180,8 @@ weechat_relay_msg_set_bytes (struct t_weechat_relay_msg *msg,
                              size_t position, const void *buffer, size_t size)
 {
     if (!msg || !msg->data || !buffer || (size == 0)
-        || (position + size) > msg->data_size)
+        || (position + size) > msg->data_size
+        || (msg->compression != WEECHAT_RELAY_COMPRESSION_OFF))
     {
         return 0;
     }
@@ -97,7 +192,8 @@ weechat_relay_msg_set_bytes (struct t_weechat_relay_msg *msg,
 }
 
 /*
- * Adds some bytes to a message.
+ * Reserves space for "size" more bytes in a message, so that next bytes can
+ * be written with weechat_relay_msg_put_* functions (without any check).
  *
  * Returns:
  *   1: OK
@@ -105,47 +201,56 @@ weechat_relay_msg_set_bytes (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_bytes (struct t_weechat_relay_msg *msg,
-                             const void *buffer, size_t size)
+weechat_relay_msg_reserve (struct t_weechat_relay_msg *msg, size_t size)
 {
     char *ptr;
-    size_t old_data_alloc;
-    uint32_t size32;
+    size_t new_data_alloc;
 
-    if (!msg || !msg->data || !buffer || (size == 0))
+    if (!msg || !msg->data)
         return 0;
 
-    old_data_alloc = msg->data_alloc;
-    while (msg->data_size + size > msg->data_alloc)
+    if (msg->compression != WEECHAT_RELAY_COMPRESSION_OFF)
     {
-        msg->data_alloc *= 2;
-    }
-
-    if (msg->data_alloc != old_data_alloc)
-    {
-        ptr = realloc (msg->data, msg->data_alloc);
-        if (!ptr)
+        /* message already finalized? */
+        if (!msg->compress_stream)
+            return 0;
+        /* compress pending bytes if the chunk would be full */
+        if ((msg->data_size > 0)
+            && (msg->data_size + size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE)
+            && !weechat_relay_msg_compress_stream (msg, 0))
         {
-            free (msg->data);
-            msg->data = NULL;
-            msg->data_alloc = 0;
-            msg->data_size = 0;
             return 0;
         }
-        msg->data = ptr;
     }
 
-    memcpy (msg->data + msg->data_size, buffer, size);
-    msg->data_size += size;
+    if (msg->data_size + size <= msg->data_alloc)
+        return 1;
 
-    size32 = htonl ((uint32_t)msg->data_size);
-    weechat_relay_msg_set_bytes (msg, 0, &size32, 4);
+    new_data_alloc = msg->data_alloc;
+    while (msg->data_size + size > new_data_alloc)
+    {
+        new_data_alloc *= 2;
+    }
+
+    ptr = realloc (msg->data, new_data_alloc);
+    if (!ptr)
+    {
+        free (msg->data);
+        msg->data = NULL;
+        msg->data_alloc = 0;
+        msg->data_size = 0;
+        return 0;
+    }
+    msg->data = ptr;
+    msg->data_alloc = new_data_alloc;
 
     return 1;
 }
 
 /*
- * Adds type to a message.
+ * Writes the size of message in the first 4 bytes (nothing is done if the
+ * message is compressed while it is built: the size is known only in
+ * weechat_relay_msg_finalize).
  *
  * Returns:
  *   1: OK
@@ -153,17 +258,34 @@ weechat_relay_msg_add_bytes (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_type (struct t_weechat_relay_msg *msg,
-                            enum t_weechat_relay_obj_type obj_type)
+weechat_relay_msg_update_size (struct t_weechat_relay_msg *msg)
 {
-    return weechat_relay_msg_add_bytes (
-        msg,
-        weechat_relay_obj_types_str[obj_type],
-        strlen (weechat_relay_obj_types_str[obj_type]));
+    uint32_t size32;
+
+    if (!msg || !msg->data)
+        return 0;
+
+    if (msg->compression != WEECHAT_RELAY_COMPRESSION_OFF)
+        return (msg->compress_stream) ? 1 : 0;
+
+    if (msg->data_size < 5)
+        return 0;
+
+    size32 = htonl ((uint32_t)msg->data_size);
+    memcpy (msg->data, &size32, 4);
+
+    return 1;
 }
 
 /*
- * Adds a char to a message.
+ * Completes a message: writes the size of message in the first 4 bytes; it
+ * must be called when the message is complete, if bytes were written with
+ * functions weechat_relay_msg_put_* (functions weechat_relay_msg_add_* call
+ * it), or if the message is compressed while it is built.
+ *
+ * For a message compressed while it is built (weechat_relay_msg_new_compress),
+ * the pending bytes are compressed, the compression is ended and data is
+ * replaced by the compressed message (with size and compression flag).
  *
  * Returns:
  *   1: OK
@@ -171,31 +293,69 @@ weechat_relay_msg_add_type (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_char (struct t_weechat_relay_msg *msg, char c)
+weechat_relay_msg_finalize (struct t_weechat_relay_msg *msg)
 {
-    return weechat_relay_msg_add_bytes (msg, &c, 1);
+    uint32_t size32;
+
+    if (!msg || !msg->data)
+        return 0;
+
+    if (msg->compression == WEECHAT_RELAY_COMPRESSION_OFF)
+        return weechat_relay_msg_update_size (msg);
+
+    /* message already finalized? */
+    if (!msg->compress_stream)
+        return 1;
+
+    if (!weechat_relay_msg_compress_stream (msg, 1))
+        return 0;
+    weechat_relay_msg_compress_free_stream (msg);
+
+    size32 = htonl ((uint32_t)msg->compressed_size);
+    memcpy (msg->compressed, &size32, 4);
+    msg->compressed[4] = (char)msg->compression;
+
+    free (msg->data);
+    msg->data = msg->compressed;
+    msg->data_alloc = msg->compressed_alloc;
+    msg->data_size = msg->compressed_size;
+    msg->compressed = NULL;
+    msg->compressed_alloc = 0;
+    msg->compressed_size = 0;
+
+    return 1;
 }
 
 /*
- * Adds an integer to a message.
- *
- * Returns:
- *   1: OK
- *   0: error
+ * Writes bytes at the end of a message, without any check: the space must
+ * have been reserved with weechat_relay_msg_reserve.
  */
 
-int
-weechat_relay_msg_add_integer (struct t_weechat_relay_msg *msg, int value)
+void
+weechat_relay_msg_put_bytes (struct t_weechat_relay_msg *msg,
+                             const void *buffer, size_t size)
+{
+    memcpy (msg->data + msg->data_size, buffer, size);
+    msg->data_size += size;
+}
+
+/*
+ * Writes an integer at the end of a message, without any check: the space
+ * must have been reserved with weechat_relay_msg_reserve.
+ */
+
+void
+weechat_relay_msg_put_integer (struct t_weechat_relay_msg *msg, int value)
 {
     uint32_t value32;
 
     value32 = htonl ((uint32_t)value);
-
-    return weechat_relay_msg_add_bytes (msg, &value32, 4);
+    memcpy (msg->data + msg->data_size, &value32, 4);
+    msg->data_size += 4;
 }
 
 /*
- * Adds a long integer to a message.
+ * Appends some bytes to a message (size of message is not updated).
  *
  * Returns:
  *   1: OK
@@ -203,20 +363,25 @@ weechat_relay_msg_add_integer (struct t_weechat_relay_msg *msg, int value)
  */
 
 int
-weechat_relay_msg_add_long (struct t_weechat_relay_msg *msg, long value)
+weechat_relay_msg_append_bytes (struct t_weechat_relay_msg *msg,
+                                const void *buffer, size_t size)
 {
-    char str_long[128];
-    unsigned char length;
+    if (!msg || !buffer || (size == 0))
+        return 0;
+
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
+        return weechat_relay_msg_stream_bytes (msg, buffer, size);
 
-    snprintf (str_long, sizeof (str_long), "%ld", value);
-    length = strlen (str_long);
-    if (!weechat_relay_msg_add_bytes (msg, &length, 1))
+    if (!weechat_relay_msg_reserve (msg, size))
         return 0;
-    return weechat_relay_msg_add_bytes (msg, str_long, length);
+
+    weechat_relay_msg_put_bytes (msg, buffer, size);
+
+    return 1;
 }
 
 /*
- * Adds length + string to a message.
+ * Appends type to a message (size of message is not updated).
  *
  * Returns:
  *   1: OK
@@ -224,29 +389,17 @@ weechat_relay_msg_add_long (struct t_weechat_relay_msg *msg, long value)
  */
 
 int
-weechat_relay_msg_add_string (struct t_weechat_relay_msg *msg,
-                              const char *string)
+weechat_relay_msg_append_type (struct t_weechat_relay_msg *msg,
+                               enum t_weechat_relay_obj_type obj_type)
 {
-    size_t length;
-
-    if (string)
-    {
-        length = strlen (string);
-        if (!weechat_relay_msg_add_integer (msg, length))
-            return 0;
-        if (length > 0)
-            return weechat_relay_msg_add_bytes (msg, string, length);
-        else
-            return 1;
-    }
-    else
-    {
-        return weechat_relay_msg_add_integer (msg, -1);
-    }
+    return weechat_relay_msg_append_bytes (
+        msg,
+        weechat_relay_obj_types_str[obj_type],
+        strlen (weechat_relay_obj_types_str[obj_type]));
 }
 
 /*
- * Adds buffer (length + data) to a message.
+ * Appends a char to a message (size of message is not updated).
  *
  * Returns:
  *   1: OK
@@ -254,27 +407,18 @@ weechat_relay_msg_add_string (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_buffer (struct t_weechat_relay_msg *msg,
-                              struct t_weechat_relay_obj_buffer *buffer)
+weechat_relay_msg_append_char (struct t_weechat_relay_msg *msg, char c)
 {
-    if (!buffer)
+    if (!weechat_relay_msg_reserve (msg, 1))
         return 0;
 
-    if (buffer->buffer)
-    {
-        if (!weechat_relay_msg_add_integer (msg, buffer->length))
-            return 0;
-        return (buffer->length > 0) ?
-            weechat_relay_msg_add_bytes (msg, buffer->buffer, buffer->length) : 1;
-    }
-    else
-    {
-        return weechat_relay_msg_add_integer (msg, -1);
-    }
+    msg->data[msg->data_size++] = c;
+
+    return 1;
 }
 
 /*
- * Adds a pointer to a message.
+ * Appends an integer to a message (size of message is not updated).
  *
  * Returns:
  *   1: OK
@@ -282,22 +426,18 @@ weechat_relay_msg_add_buffer (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_pointer (struct t_weechat_relay_msg *msg,
-                               const void *pointer)
+weechat_relay_msg_append_integer (struct t_weechat_relay_msg *msg, int value)
 {
-    char str_pointer[128];
-    unsigned char length;
-
-    snprintf (str_pointer, sizeof (str_pointer),
-              "%lx", (unsigned long)pointer);
-    length = strlen (str_pointer);
-    if (!weechat_relay_msg_add_bytes (msg, &length, 1))
+    if (!weechat_relay_msg_reserve (msg, 4))
         return 0;
-    return weechat_relay_msg_add_bytes (msg, str_pointer, length);
+
+    weechat_relay_msg_put_integer (msg, value);
+
+    return 1;
 }
 
 /*
- * Adds a time to a message.
+ * Appends a long integer to a message (size of message is not updated).
  *
  * Returns:
  *   1: OK
@@ -305,20 +445,19 @@ weechat_relay_msg_add_pointer (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_time (struct t_weechat_relay_msg *msg, time_t time)
+weechat_relay_msg_append_long (struct t_weechat_relay_msg *msg, long value)
 {
-    char str_time[128];
-    unsigned char length;
-
-    snprintf (str_time, sizeof (str_time), "%lld", (long long)time);
-    length = strlen (str_time);
-    if (!weechat_relay_msg_add_bytes (msg, &length, 1))
+    if (!weechat_relay_msg_reserve (
+            msg, 1 + weechat_relay_msg_length_long (value)))
         return 0;
-    return weechat_relay_msg_add_bytes (msg, str_time, length);
+
+    weechat_relay_msg_put_long (msg, value);
+
+    return 1;
 }
 
 /*
- * Adds a hashtable to a message.
+ * Appends length + string to a message (size of message is not updated).
  *
  * Returns:
  *   1: OK
@@ -326,50 +465,32 @@ weechat_relay_msg_add_time (struct t_weechat_relay_msg *msg, time_t time)
  */
 
 int
-weechat_relay_msg_add_hashtable (struct t_weechat_relay_msg *msg,
-                                 struct t_weechat_relay_obj_hashtable *hashtable)
+weechat_relay_msg_append_string (struct t_weechat_relay_msg *msg,
+                                 const char *string)
 {
-    int i;
-
-    if (!hashtable)
-        return 0;
+    size_t size;
 
-    if ((hashtable->type_keys != WEECHAT_RELAY_OBJ_TYPE_INTEGER)
-        && (hashtable->type_keys != WEECHAT_RELAY_OBJ_TYPE_STRING)
-        && (hashtable->type_keys != WEECHAT_RELAY_OBJ_TYPE_POINTER)
-        && (hashtable->type_keys != WEECHAT_RELAY_OBJ_TYPE_BUFFER)
-        && (hashtable->type_keys != WEECHAT_RELAY_OBJ_TYPE_TIME))
-    {
+    if (!msg)
         return 0;
-    }
 
-    if ((hashtable->type_values != WEECHAT_RELAY_OBJ_TYPE_INTEGER)
-        && (hashtable->type_values != WEECHAT_RELAY_OBJ_TYPE_STRING)
-        && (hashtable->type_values != WEECHAT_RELAY_OBJ_TYPE_POINTER)
-        && (hashtable->type_values != WEECHAT_RELAY_OBJ_TYPE_BUFFER)
-        && (hashtable->type_values != WEECHAT_RELAY_OBJ_TYPE_TIME))
+    size = weechat_relay_msg_size_string (string);
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
     {
-        return 0;
+        return weechat_relay_msg_append_integer (msg, size - 4)
+            && weechat_relay_msg_stream_bytes (msg, string, size - 4);
     }
 
-    if (!weechat_relay_msg_add_type (msg, hashtable->type_keys))
-        return 0;
-    if (!weechat_relay_msg_add_type (msg, hashtable->type_values))
-        return 0;
-    if (!weechat_relay_msg_add_integer (msg, hashtable->count))
+    if (!weechat_relay_msg_reserve (msg, size))
         return 0;
 
-    for (i = 0; i < hashtable->count; i++)
-    {
-        weechat_relay_msg_add_object_value (msg, hashtable->keys[i]);
-        weechat_relay_msg_add_object_value (msg, hashtable->values[i]);
-    }
+    weechat_relay_msg_put_string (msg, string);
 
     return 1;
 }
 
 /*
- * Adds a hdata to a message.
+ * Appends buffer (length + data) to a message (size of message is not
+ * updated).
  *
  * Returns:
  *   1: OK
@@ -377,45 +498,33 @@ weechat_relay_msg_add_hashtable (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_hdata (struct t_weechat_relay_msg *msg,
-                             struct t_weechat_relay_obj_hdata *hdata)
+weechat_relay_msg_append_buffer (struct t_weechat_relay_msg *msg,
+                                 struct t_weechat_relay_obj_buffer *buffer)
 {
-    int i, j;
+    size_t size;
 
-    if (!hdata || !hdata->hpath || (hdata->num_hpaths <= 0) || !hdata->hpaths
-        || !hdata->keys || (hdata->num_keys <= 0) || !hdata->keys_names
-        || !hdata->keys_types || (hdata->count <= 0) || !hdata->ppath
-        || !hdata->values)
-    {
+    if (!msg || !buffer)
         return 0;
+
+    size = 4 + ((buffer->buffer && (buffer->length > 0)) ?
+                (size_t)buffer->length : 0);
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
+    {
+        return weechat_relay_msg_append_integer (msg, buffer->length)
+            && weechat_relay_msg_stream_bytes (msg, buffer->buffer,
+                                               buffer->length);
     }
 
-    if (!weechat_relay_msg_add_string (msg, hdata->hpath))
-        return 0;
-    if (!weechat_relay_msg_add_string (msg, hdata->keys))
-        return 0;
-    if (!weechat_relay_msg_add_integer (msg, hdata->count))
+    if (!weechat_relay_msg_reserve (msg, size))
         return 0;
 
-    for (i = 0; i < hdata->count; i++)
-    {
-        for (j = 0; j < hdata->num_hpaths; j++)
-        {
-            if (!weechat_relay_msg_add_pointer (msg, hdata->ppath[i][j]->value_pointer))
-                return 0;
-        }
-        for (j = 0; j < hdata->num_keys; j++)
-        {
-            if (!weechat_relay_msg_add_object_value (msg, hdata->values[i][j]))
-                return 0;
-        }
-    }
+    weechat_relay_msg_put_buffer (msg, buffer);
 
     return 1;
 }
 
 /*
- * Adds an info to a message.
+ * Appends a pointer to a message (size of message is not updated).
  *
  * Returns:
  *   1: OK
@@ -423,22 +532,20 @@ weechat_relay_msg_add_hdata (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_info (struct t_weechat_relay_msg *msg,
-                            struct t_weechat_relay_obj_info *info)
+weechat_relay_msg_append_pointer (struct t_weechat_relay_msg *msg,
+                                  const void *pointer)
 {
-    if (!info)
+    if (!weechat_relay_msg_reserve (
+            msg, 1 + weechat_relay_msg_length_pointer (pointer)))
         return 0;
 
-    if (!weechat_relay_msg_add_string (msg, info->name))
-        return 0;
-    if (!weechat_relay_msg_add_string (msg, info->value))
-        return 0;
+    weechat_relay_msg_put_pointer (msg, pointer);
 
     return 1;
 }
 
 /*
- * Adds an infolist to a message.
+ * Appends a time to a message (size of message is not updated).
  *
  * Returns:
  *   1: OK
@@ -446,146 +553,2014 @@ weechat_relay_msg_add_info (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_infolist (struct t_weechat_relay_msg *msg,
-                                struct t_weechat_relay_obj_infolist *infolist)
+weechat_relay_msg_append_time (struct t_weechat_relay_msg *msg, time_t time)
 {
-    int i, j;
-    struct t_weechat_relay_obj_infolist_item *ptr_item;
-    struct t_weechat_relay_obj_infolist_var *ptr_var;
-
-    if (!infolist || (infolist->count < 0))
-        return 0;
-
-    if (!weechat_relay_msg_add_string (msg, infolist->name))
-        return 0;
-    if (!weechat_relay_msg_add_integer (msg, infolist->count))
+    if (!weechat_relay_msg_reserve (
+            msg, 1 + weechat_relay_msg_length_time (time)))
         return 0;
 
-    /* loop on items */
-    for (i = 0; i < infolist->count; i++)
-    {
-        ptr_item = infolist->items[i];
-        if (!weechat_relay_msg_add_integer (msg, ptr_item->count))
-            return 0;
-        /* loop on variables in item */
-        for (j = 0; j < ptr_item->count; j++)
-        {
-            ptr_var = ptr_item->variables[j];
-            if (!weechat_relay_msg_add_string (msg, ptr_var->name))
-                return 0;
-            if (!weechat_relay_msg_add_object (msg, ptr_var->value))
-                return 0;
-        }
-    }
+    weechat_relay_msg_put_time (msg, time);
 
     return 1;
 }
 
 /*
- * Adds an array to a message.
- *
- * Returns:
- *   1: OK
- *   0: error
+ * Returns the number of chars of a long integer in a message (in base 10).
  */
 
 int
-weechat_relay_msg_add_array (struct t_weechat_relay_msg *msg,
-                             struct t_weechat_relay_obj_array *array)
+weechat_relay_msg_length_long (long value)
 {
-    int i;
+    return weechat_relay_encode_length_decimal (value);
+}
 
-    if (!array || (array->count < 0))
-        return 0;
+/*
+ * Returns the number of chars of a pointer in a message (in base 16).
+ */
 
-    if (!weechat_relay_msg_add_type (msg, array->type))
-        return 0;
-    if (!weechat_relay_msg_add_integer (msg, array->count))
-        return 0;
+int
+weechat_relay_msg_length_pointer (const void *pointer)
+{
+    return weechat_relay_encode_length_hex ((unsigned long)pointer);
+}
 
-    for (i = 0; i < array->count; i++)
-    {
-        if (!weechat_relay_msg_add_object_value (msg, array->values[i]))
-            return 0;
-    }
+/*
+ * Returns the number of chars of a time in a message (in base 10).
+ */
 
-    return 1;
+int
+weechat_relay_msg_length_time (time_t time)
+{
+    return weechat_relay_encode_length_decimal ((long long)time);
 }
 
 /*
- * Adds the value of an object to a message (without the object type), which
- * can be any type supported in enum t_weechat_relay_obj_type.
+ * Checks if a type can be used for keys or values of a hashtable.
  *
  * Returns:
- *   1: OK
- *   0: error
+ *   1: type OK
+ *   0: type not allowed in hashtable
  */
 
 int
-weechat_relay_msg_add_object_value (struct t_weechat_relay_msg *msg,
-                                    struct t_weechat_relay_obj *obj)
+weechat_relay_msg_hashtable_type_valid (enum t_weechat_relay_obj_type type)
 {
-    switch (obj->type)
-    {
-        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
-            if (!weechat_relay_msg_add_char (msg, obj->value_char))
-                return 0;
-            break;
-        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
-            if (!weechat_relay_msg_add_integer (msg, obj->value_integer))
-                return 0;
-            break;
-        case WEECHAT_RELAY_OBJ_TYPE_LONG:
-            if (!weechat_relay_msg_add_long (msg, obj->value_long))
-                return 0;
-            break;
-        case WEECHAT_RELAY_OBJ_TYPE_STRING:
-            if (!weechat_relay_msg_add_string (msg, obj->value_string))
+    return (type == WEECHAT_RELAY_OBJ_TYPE_INTEGER)
+        || (type == WEECHAT_RELAY_OBJ_TYPE_STRING)
+        || (type == WEECHAT_RELAY_OBJ_TYPE_POINTER)
+        || (type == WEECHAT_RELAY_OBJ_TYPE_BUFFER)
+        || (type == WEECHAT_RELAY_OBJ_TYPE_TIME);
+}
+
+/*
+ * Returns the size of a string in a message (length + string).
+ */
+
+size_t
+weechat_relay_msg_size_string (const char *string)
+{
+    return 4 + ((string) ? strlen (string) : 0);
+}
+
+/*
+ * Returns the size of a hashtable in a message, 0 if the hashtable can not
+ * be added in a message.
+ */
+
+size_t
+weechat_relay_msg_size_hashtable (struct t_weechat_relay_msg *msg,
+                                  struct t_weechat_relay_obj_hashtable *hashtable)
+{
+    size_t size, size_key, size_value;
+    int i;
+
+    if (!hashtable
+        || !weechat_relay_msg_hashtable_type_valid (hashtable->type_keys)
+        || !weechat_relay_msg_hashtable_type_valid (hashtable->type_values))
+    {
+        return 0;
+    }
+
+    size = 3 + 3 + 4;
+    for (i = 0; i < hashtable->count; i++)
+    {
+        size_key = weechat_relay_msg_size_object_value (msg,
+                                                        hashtable->keys[i]);
+        size_value = weechat_relay_msg_size_object_value (msg,
+                                                          hashtable->values[i]);
+        if ((size_key == 0) || (size_value == 0))
+            return 0;
+        size += size_key + size_value;
+    }
+
+    return size;
+}
+
+/*
+ * Returns the size of a hdata in a message, 0 if the hdata can not be added
+ * in a message.
+ */
+
+size_t
+weechat_relay_msg_size_hdata (struct t_weechat_relay_msg *msg,
+                              struct t_weechat_relay_obj_hdata *hdata)
+{
+    size_t size, size_value;
+    int i, j;
+
+    if (!hdata || !hdata->hpath || (hdata->num_hpaths <= 0) || !hdata->hpaths
+        || !hdata->keys || (hdata->num_keys <= 0) || !hdata->keys_names
+        || !hdata->keys_types || (hdata->count <= 0) || !hdata->ppath
+        || !hdata->values)
+    {
+        return 0;
+    }
+
+    size = weechat_relay_msg_size_string (hdata->hpath)
+        + weechat_relay_msg_size_string (hdata->keys)
+        + 4;
+
+    for (i = 0; i < hdata->count; i++)
+    {
+        for (j = 0; j < hdata->num_hpaths; j++)
+        {
+            size += 1 + weechat_relay_msg_length_pointer (
+                hdata->ppath[i][j]->value_pointer);
+        }
+        for (j = 0; j < hdata->num_keys; j++)
+        {
+            if (!hdata->values[i][j] && hdata->columns && hdata->columns[j])
+            {
+                size += (hdata->keys_types[j] == WEECHAT_RELAY_OBJ_TYPE_CHAR) ?
+                    1 : 4;
+                continue;
+            }
+            size_value = weechat_relay_msg_size_object_value (
+                msg, hdata->values[i][j]);
+            if (size_value == 0)
                 return 0;
-            break;
-        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
-            if (!weechat_relay_msg_add_buffer (msg, &obj->value_buffer))
+            size += size_value;
+        }
+    }
+
+    return size;
+}
+
+/*
+ * Returns the size of an infolist in a message, 0 if the infolist can not be
+ * added in a message.
+ */
+
+size_t
+weechat_relay_msg_size_infolist (struct t_weechat_relay_msg *msg,
+                                 struct t_weechat_relay_obj_infolist *infolist)
+{
+    struct t_weechat_relay_obj_infolist_item *ptr_item;
+    struct t_weechat_relay_obj_infolist_var *ptr_var;
+    struct t_weechat_relay_obj obj_temp;
+    size_t size, size_value;
+    int i, j;
+
+    if (!infolist || (infolist->count < 0))
+        return 0;
+
+    size = weechat_relay_msg_size_string (infolist->name) + 4;
+
+    /* columnar infolist: same variables in all items */
+    if (!infolist->items && infolist->schema && infolist->columns)
+    {
+        for (i = 0; i < infolist->count; i++)
+        {
+            size += 4;
+            for (j = 0; j < infolist->schema->count; j++)
+            {
+                size_value = weechat_relay_msg_size_object (
+                    msg,
+                    weechat_relay_obj_infolist_column_view (infolist, j, i,
+                                                            &obj_temp));
+                if (size_value == 0)
+                    return 0;
+                size += weechat_relay_msg_size_string (
+                    infolist->schema->names[j]) + size_value;
+            }
+        }
+        return size;
+    }
+
+    for (i = 0; i < infolist->count; i++)
+    {
+        ptr_item = infolist->items[i];
+        size += 4;
+        for (j = 0; j < ptr_item->count; j++)
+        {
+            ptr_var = ptr_item->variables[j];
+            size_value = weechat_relay_msg_size_object (msg, ptr_var->value);
+            if (size_value == 0)
                 return 0;
-            break;
+            size += weechat_relay_msg_size_string (ptr_var->name) + size_value;
+        }
+    }
+
+    return size;
+}
+
+/*
+ * Returns the size of an array in a message, 0 if the array can not be added
+ * in a message.
+ */
+
+size_t
+weechat_relay_msg_size_array (struct t_weechat_relay_msg *msg,
+                              struct t_weechat_relay_obj_array *array)
+{
+    size_t size, size_value;
+    int i;
+
+    if (!array || (array->count < 0))
+        return 0;
+
+    size = 3 + 4;
+
+    if (!array->values && array->values_native && (array->count > 0))
+    {
+        if (array->type == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+            return size + array->count;
+        if (array->type == WEECHAT_RELAY_OBJ_TYPE_INTEGER)
+            return size + (array->count * 4);
+        return 0;
+    }
+
+    for (i = 0; i < array->count; i++)
+    {
+        size_value = weechat_relay_msg_size_object_value (msg,
+                                                          array->values[i]);
+        if (size_value == 0)
+            return 0;
+        size += size_value;
+    }
+
+    return size;
+}
+
+/*
+ * Returns the size of the value of an object in a message (without the
+ * object type), 0 if the object can not be added in a message.
+ */
+
+size_t
+weechat_relay_msg_size_object_value (struct t_weechat_relay_msg *msg,
+                                     struct t_weechat_relay_obj *obj)
+{
+    if (!obj)
+        return 0;
+
+    if (msg->passthrough && obj->wire && !obj->dirty)
+        return obj->wire_size;
+
+    switch (obj->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            return 1;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            return 4;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            return 1 + weechat_relay_msg_length_long (obj->value_long);
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            return weechat_relay_msg_size_string (obj->value_string);
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            return 4 + ((obj->value_buffer.buffer
+                         && (obj->value_buffer.length > 0)) ?
+                        (size_t)obj->value_buffer.length : 0);
         case WEECHAT_RELAY_OBJ_TYPE_POINTER:
-            if (!weechat_relay_msg_add_pointer (msg, (void *)obj->value_pointer))
-                return 0;
-            break;
+            return 1 + weechat_relay_msg_length_pointer (obj->value_pointer);
         case WEECHAT_RELAY_OBJ_TYPE_TIME:
-            if (!weechat_relay_msg_add_time (msg, obj->value_time))
-                return 0;
-            break;
+            return 1 + weechat_relay_msg_length_time (obj->value_time);
         case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
-            if (!weechat_relay_msg_add_hashtable (msg, &obj->value_hashtable))
-                return 0;
-            break;
+            return weechat_relay_msg_size_hashtable (msg,
+                                                     &obj->value_hashtable);
         case WEECHAT_RELAY_OBJ_TYPE_HDATA:
-            if (!weechat_relay_msg_add_hdata (msg, &obj->value_hdata))
-                return 0;
-            break;
+            return weechat_relay_msg_size_hdata (msg, &obj->value_hdata);
         case WEECHAT_RELAY_OBJ_TYPE_INFO:
-            if (!weechat_relay_msg_add_info (msg, &obj->value_info))
-                return 0;
-            break;
+            return weechat_relay_msg_size_string (obj->value_info.name)
+                + weechat_relay_msg_size_string (obj->value_info.value);
         case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
-            if (!weechat_relay_msg_add_infolist (msg, &obj->value_infolist))
-                return 0;
-            break;
+            return weechat_relay_msg_size_infolist (msg,
+                                                    &obj->value_infolist);
         case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
-            if (!weechat_relay_msg_add_array (msg, &obj->value_array))
-                return 0;
-            break;
+            return weechat_relay_msg_size_array (msg, &obj->value_array);
         case WEECHAT_RELAY_NUM_OBJ_TYPES:
             break;
+    }
+
+    return 0;
+}
+
+/*
+ * Returns the size of an object in a message (type + value), 0 if the object
+ * can not be added in a message.
+ */
+
+size_t
+weechat_relay_msg_size_object (struct t_weechat_relay_msg *msg,
+                               struct t_weechat_relay_obj *obj)
+{
+    size_t size;
+
+    size = weechat_relay_msg_size_object_value (msg, obj);
+
+    return (size > 0) ? 3 + size : 0;
+}
+
+/*
+ * Writes type at the end of a message, without any check.
+ */
+
+void
+weechat_relay_msg_put_type (struct t_weechat_relay_msg *msg,
+                            enum t_weechat_relay_obj_type obj_type)
+{
+    weechat_relay_msg_put_bytes (msg, weechat_relay_obj_types_str[obj_type], 3);
+}
+
+/*
+ * Writes length + string at the end of a message, without any check.
+ */
+
+void
+weechat_relay_msg_put_string (struct t_weechat_relay_msg *msg,
+                              const char *string)
+{
+    size_t length;
+
+    if (!string)
+    {
+        weechat_relay_msg_put_integer (msg, -1);
+        return;
+    }
+
+    length = strlen (string);
+    weechat_relay_msg_put_integer (msg, length);
+    weechat_relay_msg_put_bytes (msg, string, length);
+}
+
+/*
+ * Writes buffer (length + data) at the end of a message, without any check.
+ */
+
+void
+weechat_relay_msg_put_buffer (struct t_weechat_relay_msg *msg,
+                              struct t_weechat_relay_obj_buffer *buffer)
+{
+    if (!buffer->buffer)
+    {
+        weechat_relay_msg_put_integer (msg, -1);
+        return;
+    }
+
+    weechat_relay_msg_put_integer (msg, buffer->length);
+    if (buffer->length > 0)
+        weechat_relay_msg_put_bytes (msg, buffer->buffer, buffer->length);
+}
+
+/*
+ * Writes a long integer at the end of a message, without any check.
+ */
+
+void
+weechat_relay_msg_put_long (struct t_weechat_relay_msg *msg, long value)
+{
+    int length;
+
+    length = weechat_relay_encode_decimal (msg->data + msg->data_size + 1,
+                                           value);
+    msg->data[msg->data_size] = (char)length;
+    msg->data_size += 1 + length;
+}
+
+/*
+ * Writes a pointer at the end of a message, without any check.
+ */
+
+void
+weechat_relay_msg_put_pointer (struct t_weechat_relay_msg *msg,
+                               const void *pointer)
+{
+    int length;
+
+    length = weechat_relay_encode_hex (msg->data + msg->data_size + 1,
+                                       (unsigned long)pointer);
+    msg->data[msg->data_size] = (char)length;
+    msg->data_size += 1 + length;
+}
+
+/*
+ * Writes a time at the end of a message, without any check.
+ */
+
+void
+weechat_relay_msg_put_time (struct t_weechat_relay_msg *msg, time_t time)
+{
+    int length;
+
+    length = weechat_relay_encode_decimal (msg->data + msg->data_size + 1,
+                                           (long long)time);
+    msg->data[msg->data_size] = (char)length;
+    msg->data_size += 1 + length;
+}
+
+/*
+ * Writes a hashtable at the end of a message, without any check (the
+ * hashtable must have been checked with weechat_relay_msg_size_hashtable).
+ */
+
+void
+weechat_relay_msg_put_hashtable (struct t_weechat_relay_msg *msg,
+                                 struct t_weechat_relay_obj_hashtable *hashtable)
+{
+    int i;
+
+    weechat_relay_msg_put_type (msg, hashtable->type_keys);
+    weechat_relay_msg_put_type (msg, hashtable->type_values);
+    weechat_relay_msg_put_integer (msg, hashtable->count);
+
+    for (i = 0; i < hashtable->count; i++)
+    {
+        weechat_relay_msg_put_object_value (msg, hashtable->keys[i]);
+        weechat_relay_msg_put_object_value (msg, hashtable->values[i]);
+    }
+}
+
+/*
+ * Writes a hdata at the end of a message, without any check (the hdata must
+ * have been checked with weechat_relay_msg_size_hdata).
+ */
+
+void
+weechat_relay_msg_put_hdata (struct t_weechat_relay_msg *msg,
+                             struct t_weechat_relay_obj_hdata *hdata)
+{
+    int i, j;
+
+    weechat_relay_msg_put_string (msg, hdata->hpath);
+    weechat_relay_msg_put_string (msg, hdata->keys);
+    weechat_relay_msg_put_integer (msg, hdata->count);
+
+    for (i = 0; i < hdata->count; i++)
+    {
+        for (j = 0; j < hdata->num_hpaths; j++)
+        {
+            weechat_relay_msg_put_pointer (msg,
+                                           hdata->ppath[i][j]->value_pointer);
+        }
+        for (j = 0; j < hdata->num_keys; j++)
+        {
+            if (!hdata->values[i][j] && hdata->columns && hdata->columns[j])
+            {
+                if (hdata->keys_types[j] == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+                {
+                    msg->data[msg->data_size++] =
+                        ((char *)hdata->columns[j])[i];
+                }
+                else
+                {
+                    weechat_relay_msg_put_integer (
+                        msg, ((int *)hdata->columns[j])[i]);
+                }
+                continue;
+            }
+            weechat_relay_msg_put_object_value (msg, hdata->values[i][j]);
+        }
+    }
+}
+
+/*
+ * Writes an infolist at the end of a message, without any check (the
+ * infolist must have been checked with weechat_relay_msg_size_infolist).
+ */
 
+void
+weechat_relay_msg_put_infolist (struct t_weechat_relay_msg *msg,
+                                struct t_weechat_relay_obj_infolist *infolist)
+{
+    struct t_weechat_relay_obj_infolist_item *ptr_item;
+    struct t_weechat_relay_obj_infolist_var *ptr_var;
+    struct t_weechat_relay_obj obj_temp;
+    int i, j;
+
+    weechat_relay_msg_put_string (msg, infolist->name);
+    weechat_relay_msg_put_integer (msg, infolist->count);
+
+    /* columnar infolist: same variables in all items */
+    if (!infolist->items && infolist->schema && infolist->columns)
+    {
+        for (i = 0; i < infolist->count; i++)
+        {
+            weechat_relay_msg_put_integer (msg, infolist->schema->count);
+            for (j = 0; j < infolist->schema->count; j++)
+            {
+                weechat_relay_msg_put_string (msg, infolist->schema->names[j]);
+                weechat_relay_msg_put_object (
+                    msg,
+                    weechat_relay_obj_infolist_column_view (infolist, j, i,
+                                                            &obj_temp));
+            }
+        }
+        return;
+    }
+
+    /* loop on items */
+    for (i = 0; i < infolist->count; i++)
+    {
+        ptr_item = infolist->items[i];
+        weechat_relay_msg_put_integer (msg, ptr_item->count);
+        /* loop on variables in item */
+        for (j = 0; j < ptr_item->count; j++)
+        {
+            ptr_var = ptr_item->variables[j];
+            weechat_relay_msg_put_string (msg, ptr_var->name);
+            weechat_relay_msg_put_object (msg, ptr_var->value);
+        }
+    }
+}
+
+/*
+ * Writes an array at the end of a message, without any check (the array
+ * must have been checked with weechat_relay_msg_size_array).
+ */
+
+void
+weechat_relay_msg_put_array (struct t_weechat_relay_msg *msg,
+                             struct t_weechat_relay_obj_array *array)
+{
+    int i;
+
+    weechat_relay_msg_put_type (msg, array->type);
+    weechat_relay_msg_put_integer (msg, array->count);
+
+    if (!array->values && array->values_native && (array->count > 0))
+    {
+        if (array->type == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+        {
+            weechat_relay_msg_put_bytes (msg, array->values_native,
+                                         array->count);
+            return;
+        }
+        /* convert integers to big-endian, in the message */
+        weechat_relay_decode_integers (
+            (int *)(msg->data + msg->data_size),
+            array->values_native,
+            array->count);
+        msg->data_size += array->count * 4;
+        return;
+    }
+
+    for (i = 0; i < array->count; i++)
+    {
+        weechat_relay_msg_put_object_value (msg, array->values[i]);
+    }
+}
+
+/*
+ * Writes the value of an object at the end of a message (without the object
+ * type), without any check (the object must have been checked with
+ * weechat_relay_msg_size_object_value).
+ *
+ * When building a message with weechat_relay_msg_new_parsed, if the object
+ * has bytes from a message received (parser flag PASSTHROUGH) and is not
+ * marked as modified, these bytes are copied as-is.
+ */
+
+void
+weechat_relay_msg_put_object_value (struct t_weechat_relay_msg *msg,
+                                    struct t_weechat_relay_obj *obj)
+{
+    if (msg->passthrough && obj->wire && !obj->dirty)
+    {
+        weechat_relay_msg_put_bytes (msg, obj->wire, obj->wire_size);
+        return;
+    }
+
+    switch (obj->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            msg->data[msg->data_size++] = obj->value_char;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            weechat_relay_msg_put_integer (msg, obj->value_integer);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            weechat_relay_msg_put_long (msg, obj->value_long);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            weechat_relay_msg_put_string (msg, obj->value_string);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            weechat_relay_msg_put_buffer (msg, &obj->value_buffer);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            weechat_relay_msg_put_pointer (msg, obj->value_pointer);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            weechat_relay_msg_put_time (msg, obj->value_time);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            weechat_relay_msg_put_hashtable (msg, &obj->value_hashtable);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            weechat_relay_msg_put_hdata (msg, &obj->value_hdata);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFO:
+            weechat_relay_msg_put_string (msg, obj->value_info.name);
+            weechat_relay_msg_put_string (msg, obj->value_info.value);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            weechat_relay_msg_put_infolist (msg, &obj->value_infolist);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            weechat_relay_msg_put_array (msg, &obj->value_array);
+            break;
+        case WEECHAT_RELAY_NUM_OBJ_TYPES:
+            break;
+    }
+}
+
+/*
+ * Writes an object (type + value) at the end of a message, without any check
+ * (the object must have been checked with weechat_relay_msg_size_object).
+ */
+
+void
+weechat_relay_msg_put_object (struct t_weechat_relay_msg *msg,
+                              struct t_weechat_relay_obj *obj)
+{
+    weechat_relay_msg_put_type (msg, obj->type);
+    weechat_relay_msg_put_object_value (msg, obj);
+}
+
+/*
+ * Writes some bytes at the end of a message compressed while it is built,
+ * by chunks: pending bytes are compressed each time the chunk is full, so
+ * that at most one chunk of uncompressed bytes is kept in the message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_stream_bytes (struct t_weechat_relay_msg *msg,
+                                const void *buffer, size_t size)
+{
+    const char *ptr_buffer;
+    size_t count;
+
+    ptr_buffer = (const char *)buffer;
+    while (size > 0)
+    {
+        count = (msg->data_size < WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE) ?
+            WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE - msg->data_size :
+            WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE;
+        if (count > size)
+            count = size;
+        if (!weechat_relay_msg_reserve (msg, count))
+            return 0;
+        weechat_relay_msg_put_bytes (msg, ptr_buffer, count);
+        ptr_buffer += count;
+        size -= count;
+    }
+
+    return 1;
+}
+
+/*
+ * Writes a hashtable at the end of a message compressed while it is built,
+ * key by key (the hashtable must have been checked with
+ * weechat_relay_msg_size_hashtable).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_stream_hashtable (struct t_weechat_relay_msg *msg,
+                                    struct t_weechat_relay_obj_hashtable *hashtable)
+{
+    int i;
+
+    if (!weechat_relay_msg_append_type (msg, hashtable->type_keys)
+        || !weechat_relay_msg_append_type (msg, hashtable->type_values)
+        || !weechat_relay_msg_append_integer (msg, hashtable->count))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < hashtable->count; i++)
+    {
+        if (!weechat_relay_msg_append_object_value (msg, hashtable->keys[i])
+            || !weechat_relay_msg_append_object_value (msg,
+                                                       hashtable->values[i]))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Writes a hdata at the end of a message compressed while it is built, value
+ * by value (the hdata must have been checked with
+ * weechat_relay_msg_size_hdata).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_stream_hdata (struct t_weechat_relay_msg *msg,
+                                struct t_weechat_relay_obj_hdata *hdata)
+{
+    int i, j, rc;
+
+    if (!weechat_relay_msg_append_string (msg, hdata->hpath)
+        || !weechat_relay_msg_append_string (msg, hdata->keys)
+        || !weechat_relay_msg_append_integer (msg, hdata->count))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < hdata->count; i++)
+    {
+        for (j = 0; j < hdata->num_hpaths; j++)
+        {
+            if (!weechat_relay_msg_append_pointer (
+                    msg, hdata->ppath[i][j]->value_pointer))
+                return 0;
+        }
+        for (j = 0; j < hdata->num_keys; j++)
+        {
+            if (!hdata->values[i][j] && hdata->columns && hdata->columns[j])
+            {
+                rc = (hdata->keys_types[j] == WEECHAT_RELAY_OBJ_TYPE_CHAR) ?
+                    weechat_relay_msg_append_char (
+                        msg, ((char *)hdata->columns[j])[i]) :
+                    weechat_relay_msg_append_integer (
+                        msg, ((int *)hdata->columns[j])[i]);
+            }
+            else
+            {
+                rc = weechat_relay_msg_append_object_value (
+                    msg, hdata->values[i][j]);
+            }
+            if (!rc)
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Writes an infolist at the end of a message compressed while it is built,
+ * variable by variable (the infolist must have been checked with
+ * weechat_relay_msg_size_infolist).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_stream_infolist (struct t_weechat_relay_msg *msg,
+                                   struct t_weechat_relay_obj_infolist *infolist)
+{
+    struct t_weechat_relay_obj_infolist_item *ptr_item;
+    struct t_weechat_relay_obj_infolist_var *ptr_var;
+    struct t_weechat_relay_obj obj_temp;
+    int i, j;
+
+    if (!weechat_relay_msg_append_string (msg, infolist->name)
+        || !weechat_relay_msg_append_integer (msg, infolist->count))
+    {
+        return 0;
+    }
+
+    /* columnar infolist: same variables in all items */
+    if (!infolist->items && infolist->schema && infolist->columns)
+    {
+        for (i = 0; i < infolist->count; i++)
+        {
+            if (!weechat_relay_msg_append_integer (msg,
+                                                   infolist->schema->count))
+                return 0;
+            for (j = 0; j < infolist->schema->count; j++)
+            {
+                if (!weechat_relay_msg_append_string (
+                        msg, infolist->schema->names[j])
+                    || !weechat_relay_msg_append_object (
+                        msg,
+                        weechat_relay_obj_infolist_column_view (infolist, j, i,
+                                                                &obj_temp)))
+                {
+                    return 0;
+                }
+            }
+        }
+        return 1;
+    }
+
+    for (i = 0; i < infolist->count; i++)
+    {
+        ptr_item = infolist->items[i];
+        if (!weechat_relay_msg_append_integer (msg, ptr_item->count))
+            return 0;
+        for (j = 0; j < ptr_item->count; j++)
+        {
+            ptr_var = ptr_item->variables[j];
+            if (!weechat_relay_msg_append_string (msg, ptr_var->name)
+                || !weechat_relay_msg_append_object (msg, ptr_var->value))
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Writes an array at the end of a message compressed while it is built,
+ * value by value, or by chunks for a native array (the array must have been
+ * checked with weechat_relay_msg_size_array).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_stream_array (struct t_weechat_relay_msg *msg,
+                                struct t_weechat_relay_obj_array *array)
+{
+    int i, count;
+
+    if (!weechat_relay_msg_append_type (msg, array->type)
+        || !weechat_relay_msg_append_integer (msg, array->count))
+    {
+        return 0;
+    }
+
+    if (!array->values && array->values_native && (array->count > 0))
+    {
+        if (array->type == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+        {
+            return weechat_relay_msg_stream_bytes (msg, array->values_native,
+                                                   array->count);
+        }
+        /* convert integers to big-endian, one chunk at a time */
+        for (i = 0; i < array->count; i += count)
+        {
+            count = array->count - i;
+            if (count > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE / 4)
+                count = WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE / 4;
+            if (!weechat_relay_msg_reserve (msg, (size_t)count * 4))
+                return 0;
+            weechat_relay_decode_integers (
+                (int *)(msg->data + msg->data_size),
+                (int *)array->values_native + i,
+                count);
+            msg->data_size += (size_t)count * 4;
+        }
+        return 1;
+    }
+
+    for (i = 0; i < array->count; i++)
+    {
+        if (!weechat_relay_msg_append_object_value (msg, array->values[i]))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Writes the value of an object at the end of a message compressed while it
+ * is built (without the object type), element by element (the object must
+ * have been checked with weechat_relay_msg_size_object_value).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_stream_object_value (struct t_weechat_relay_msg *msg,
+                                       struct t_weechat_relay_obj *obj)
+{
+    if (msg->passthrough && obj->wire && !obj->dirty)
+        return weechat_relay_msg_stream_bytes (msg, obj->wire, obj->wire_size);
+
+    switch (obj->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            return weechat_relay_msg_append_string (msg, obj->value_string);
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            return weechat_relay_msg_append_buffer (msg, &obj->value_buffer);
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            return weechat_relay_msg_stream_hashtable (msg,
+                                                       &obj->value_hashtable);
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            return weechat_relay_msg_stream_hdata (msg, &obj->value_hdata);
+        case WEECHAT_RELAY_OBJ_TYPE_INFO:
+            return weechat_relay_msg_append_info (msg, &obj->value_info);
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            return weechat_relay_msg_stream_infolist (msg,
+                                                      &obj->value_infolist);
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            return weechat_relay_msg_stream_array (msg, &obj->value_array);
+        default:
+            break;
+    }
+
+    /* other types are never bigger than a chunk */
+    if (!weechat_relay_msg_reserve (
+            msg, weechat_relay_msg_size_object_value (msg, obj)))
+        return 0;
+    weechat_relay_msg_put_object_value (msg, obj);
+
+    return 1;
+}
+
+/*
+ * Appends a hashtable to a message (size of message is not updated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_append_hashtable (struct t_weechat_relay_msg *msg,
+                                    struct t_weechat_relay_obj_hashtable *hashtable)
+{
+    size_t size;
+
+    if (!msg)
+        return 0;
+
+    size = weechat_relay_msg_size_hashtable (msg, hashtable);
+    if (size == 0)
+        return 0;
+
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
+        return weechat_relay_msg_stream_hashtable (msg, hashtable);
+
+    if (!weechat_relay_msg_reserve (msg, size))
+        return 0;
+
+    weechat_relay_msg_put_hashtable (msg, hashtable);
+
+    return 1;
+}
+
+/*
+ * Appends a hdata to a message (size of message is not updated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_append_hdata (struct t_weechat_relay_msg *msg,
+                                struct t_weechat_relay_obj_hdata *hdata)
+{
+    size_t size;
+
+    if (!msg)
+        return 0;
+
+    size = weechat_relay_msg_size_hdata (msg, hdata);
+    if (size == 0)
+        return 0;
+
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
+        return weechat_relay_msg_stream_hdata (msg, hdata);
+
+    if (!weechat_relay_msg_reserve (msg, size))
+        return 0;
+
+    weechat_relay_msg_put_hdata (msg, hdata);
+
+    return 1;
+}
+
+/*
+ * Appends an info to a message (size of message is not updated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_append_info (struct t_weechat_relay_msg *msg,
+                               struct t_weechat_relay_obj_info *info)
+{
+    size_t size;
+
+    if (!msg || !info)
+        return 0;
+
+    size = weechat_relay_msg_size_string (info->name)
+        + weechat_relay_msg_size_string (info->value);
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
+    {
+        return weechat_relay_msg_append_string (msg, info->name)
+            && weechat_relay_msg_append_string (msg, info->value);
+    }
+
+    if (!weechat_relay_msg_reserve (msg, size))
+        return 0;
+
+    weechat_relay_msg_put_string (msg, info->name);
+    weechat_relay_msg_put_string (msg, info->value);
+
+    return 1;
+}
+
+/*
+ * Appends an infolist to a message (size of message is not updated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_append_infolist (struct t_weechat_relay_msg *msg,
+                                   struct t_weechat_relay_obj_infolist *infolist)
+{
+    size_t size;
+
+    if (!msg)
+        return 0;
+
+    size = weechat_relay_msg_size_infolist (msg, infolist);
+    if (size == 0)
+        return 0;
+
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
+        return weechat_relay_msg_stream_infolist (msg, infolist);
+
+    if (!weechat_relay_msg_reserve (msg, size))
+        return 0;
+
+    weechat_relay_msg_put_infolist (msg, infolist);
+
+    return 1;
+}
+
+/*
+ * Appends an array to a message (size of message is not updated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_append_array (struct t_weechat_relay_msg *msg,
+                                struct t_weechat_relay_obj_array *array)
+{
+    size_t size;
+
+    if (!msg)
+        return 0;
+
+    size = weechat_relay_msg_size_array (msg, array);
+    if (size == 0)
+        return 0;
+
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
+        return weechat_relay_msg_stream_array (msg, array);
+
+    if (!weechat_relay_msg_reserve (msg, size))
+        return 0;
+
+    weechat_relay_msg_put_array (msg, array);
+
+    return 1;
+}
+
+/*
+ * Appends the value of an object to a message (without the object type),
+ * which can be any type supported in enum t_weechat_relay_obj_type (size of
+ * message is not updated).
+ *
+ * The exact size of the object is computed first, so the message is
+ * reallocated at most once, then the object is written without any check.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_append_object_value (struct t_weechat_relay_msg *msg,
+                                       struct t_weechat_relay_obj *obj)
+{
+    size_t size;
+
+    if (!msg)
+        return 0;
+
+    size = weechat_relay_msg_size_object_value (msg, obj);
+    if (size == 0)
+        return 0;
+
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
+        return weechat_relay_msg_stream_object_value (msg, obj);
+
+    if (!weechat_relay_msg_reserve (msg, size))
+        return 0;
+
+    weechat_relay_msg_put_object_value (msg, obj);
+
+    return 1;
+}
+
+/*
+ * Appends an object to a message, which can be any type supported in
+ * enum t_weechat_relay_obj_type (size of message is not updated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_append_object (struct t_weechat_relay_msg *msg,
+                                 struct t_weechat_relay_obj *obj)
+{
+    size_t size;
+
+    if (!msg)
+        return 0;
+
+    size = weechat_relay_msg_size_object (msg, obj);
+    if (size == 0)
+        return 0;
+
+    if (msg->compress_stream && (size > WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE))
+    {
+        return weechat_relay_msg_append_type (msg, obj->type)
+            && weechat_relay_msg_stream_object_value (msg, obj);
+    }
+
+    if (!weechat_relay_msg_reserve (msg, size))
+        return 0;
+
+    weechat_relay_msg_put_object (msg, obj);
+
+    return 1;
+}
+
+/*
+ * Appends content of a compact value to a message (without the type), which
+ * can be any type supported in enum t_weechat_relay_obj_type (size of
+ * message is not updated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_append_value_content (struct t_weechat_relay_msg *msg,
+                                        const struct t_weechat_relay_value *value)
+{
+    struct t_weechat_relay_obj_buffer buffer;
+    const struct t_weechat_relay_value_hdata *ptr_hdata;
+    const struct t_weechat_relay_value_infolist_item *ptr_item;
+    int i, j;
+
+    if (!value)
+        return 0;
+
+    switch (value->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            return weechat_relay_msg_append_char (msg, value->value_char);
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            return weechat_relay_msg_append_integer (msg, value->value_integer);
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            return weechat_relay_msg_append_long (msg, value->value_long);
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            return weechat_relay_msg_append_string (msg, value->value_string);
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            buffer.buffer = value->value_buffer;
+            buffer.length = value->length;
+            return weechat_relay_msg_append_buffer (msg, &buffer);
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            return weechat_relay_msg_append_pointer (msg, value->value_pointer);
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            return weechat_relay_msg_append_time (msg, value->value_time);
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            if (!value->value_hashtable)
+                return 0;
+            if (!weechat_relay_msg_append_type (msg, value->value_hashtable->type_keys)
+                || !weechat_relay_msg_append_type (msg, value->value_hashtable->type_values)
+                || !weechat_relay_msg_append_integer (msg, value->value_hashtable->count))
+            {
+                return 0;
+            }
+            for (i = 0; i < value->value_hashtable->count; i++)
+            {
+                if (!weechat_relay_msg_append_value_content (
+                        msg, &value->value_hashtable->keys[i])
+                    || !weechat_relay_msg_append_value_content (
+                        msg, &value->value_hashtable->values[i]))
+                {
+                    return 0;
+                }
+            }
+            return 1;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            ptr_hdata = value->value_hdata;
+            if (!ptr_hdata)
+                return 0;
+            if (!weechat_relay_msg_append_string (msg, ptr_hdata->hpath)
+                || !weechat_relay_msg_append_string (msg, ptr_hdata->keys)
+                || !weechat_relay_msg_append_integer (msg, ptr_hdata->count))
+            {
+                return 0;
+            }
+            for (i = 0; i < ptr_hdata->count; i++)
+            {
+                for (j = 0; j < ptr_hdata->num_hpaths; j++)
+                {
+                    if (!weechat_relay_msg_append_pointer (
+                            msg, ptr_hdata->ppath[(i * ptr_hdata->num_hpaths) + j]))
+                        return 0;
+                }
+                for (j = 0; j < ptr_hdata->num_keys; j++)
+                {
+                    if (!weechat_relay_msg_append_value_content (
+                            msg, &ptr_hdata->values[(i * ptr_hdata->num_keys) + j]))
+                        return 0;
+                }
+            }
+            return 1;
+        case WEECHAT_RELAY_OBJ_TYPE_INFO:
+            if (!value->value_info)
+                return 0;
+            return weechat_relay_msg_append_string (msg, value->value_info->name)
+                && weechat_relay_msg_append_string (msg, value->value_info->value);
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            if (!value->value_infolist)
+                return 0;
+            if (!weechat_relay_msg_append_string (msg, value->value_infolist->name)
+                || !weechat_relay_msg_append_integer (msg, value->value_infolist->count))
+            {
+                return 0;
+            }
+            for (i = 0; i < value->value_infolist->count; i++)
+            {
+                ptr_item = &value->value_infolist->items[i];
+                if (!weechat_relay_msg_append_integer (msg, ptr_item->count))
+                    return 0;
+                for (j = 0; j < ptr_item->count; j++)
+                {
+                    if (!weechat_relay_msg_append_string (msg, ptr_item->names[j])
+                        || !weechat_relay_msg_append_value (msg, &ptr_item->values[j]))
+                    {
+                        return 0;
+                    }
+                }
+            }
+            return 1;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            if (!value->value_array)
+                return 0;
+            if (!weechat_relay_msg_append_type (msg, value->value_array->type)
+                || !weechat_relay_msg_append_integer (msg, value->value_array->count))
+            {
+                return 0;
+            }
+            for (i = 0; i < value->value_array->count; i++)
+            {
+                if (!weechat_relay_msg_append_value_content (
+                        msg, &value->value_array->values[i]))
+                    return 0;
+            }
+            return 1;
+        case WEECHAT_RELAY_NUM_OBJ_TYPES:
+            break;
+    }
+
+    return 1;
+}
+
+/*
+ * Appends a compact value (type + content) to a message (size of message is
+ * not updated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_append_value (struct t_weechat_relay_msg *msg,
+                                const struct t_weechat_relay_value *value)
+{
+    if (!value)
+        return 0;
+
+    if (!weechat_relay_msg_append_type (msg, value->type))
+        return 0;
+
+    return weechat_relay_msg_append_value_content (msg, value);
+}
+
+/*
+ * Adds some bytes to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_bytes (struct t_weechat_relay_msg *msg,
+                             const void *buffer, size_t size)
+{
+    return weechat_relay_msg_append_bytes (msg, buffer, size)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds type to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_type (struct t_weechat_relay_msg *msg,
+                            enum t_weechat_relay_obj_type obj_type)
+{
+    return weechat_relay_msg_append_type (msg, obj_type)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds a char to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_char (struct t_weechat_relay_msg *msg, char c)
+{
+    return weechat_relay_msg_append_char (msg, c)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds an integer to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_integer (struct t_weechat_relay_msg *msg, int value)
+{
+    return weechat_relay_msg_append_integer (msg, value)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds a long integer to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_long (struct t_weechat_relay_msg *msg, long value)
+{
+    return weechat_relay_msg_append_long (msg, value)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds length + string to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_string (struct t_weechat_relay_msg *msg,
+                              const char *string)
+{
+    return weechat_relay_msg_append_string (msg, string)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds buffer (length + data) to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_buffer (struct t_weechat_relay_msg *msg,
+                              struct t_weechat_relay_obj_buffer *buffer)
+{
+    return weechat_relay_msg_append_buffer (msg, buffer)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds a pointer to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_pointer (struct t_weechat_relay_msg *msg,
+                               const void *pointer)
+{
+    return weechat_relay_msg_append_pointer (msg, pointer)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds a time to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_time (struct t_weechat_relay_msg *msg, time_t time)
+{
+    return weechat_relay_msg_append_time (msg, time)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds a hashtable to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_hashtable (struct t_weechat_relay_msg *msg,
+                                 struct t_weechat_relay_obj_hashtable *hashtable)
+{
+    return weechat_relay_msg_append_hashtable (msg, hashtable)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds a hdata to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_hdata (struct t_weechat_relay_msg *msg,
+                             struct t_weechat_relay_obj_hdata *hdata)
+{
+    return weechat_relay_msg_append_hdata (msg, hdata)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds an info to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_info (struct t_weechat_relay_msg *msg,
+                            struct t_weechat_relay_obj_info *info)
+{
+    return weechat_relay_msg_append_info (msg, info)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds an infolist to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_infolist (struct t_weechat_relay_msg *msg,
+                                struct t_weechat_relay_obj_infolist *infolist)
+{
+    return weechat_relay_msg_append_infolist (msg, infolist)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds an array to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_array (struct t_weechat_relay_msg *msg,
+                             struct t_weechat_relay_obj_array *array)
+{
+    return weechat_relay_msg_append_array (msg, array)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds the value of an object to a message (without the object type), which
+ * can be any type supported in enum t_weechat_relay_obj_type.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_object_value (struct t_weechat_relay_msg *msg,
+                                    struct t_weechat_relay_obj *obj)
+{
+    return weechat_relay_msg_append_object_value (msg, obj)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds an object to a message, which can be any type supported in
+ * enum t_weechat_relay_obj_type.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_object (struct t_weechat_relay_msg *msg,
+                              struct t_weechat_relay_obj *obj)
+{
+    return weechat_relay_msg_append_object (msg, obj)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds content of a compact value to a message (without the type), which
+ * can be any type supported in enum t_weechat_relay_obj_type.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_value_content (struct t_weechat_relay_msg *msg,
+                                     const struct t_weechat_relay_value *value)
+{
+    return weechat_relay_msg_append_value_content (msg, value)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Adds a compact value (type + content) to a message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_add_value (struct t_weechat_relay_msg *msg,
+                             const struct t_weechat_relay_value *value)
+{
+    return weechat_relay_msg_append_value (msg, value)
+        && weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Compresses a message with zlib.
+ *
+ * The variable "size" is set with the size of buffer returned (in bytes).
+ *
+ * Returns a pointer to the compressed message, NULL if error.
+ */
+
+void *
+weechat_relay_msg_compress_zlib (struct t_weechat_relay_msg *msg,
+                                 int compression_level,
+                                 size_t *size)
+{
+    int rc;
+    Bytef *dest;
+    uLongf dest_size;
+    uint32_t size32;
+
+    if (!msg || !size || (msg->compression != WEECHAT_RELAY_COMPRESSION_OFF))
+        return NULL;
+
+    *size = 0;
+
+    dest_size = compressBound (msg->data_size - 5);
+    dest = malloc (dest_size + 5);
+    if (!dest)
+        return NULL;
+
+    rc = compress2 (dest + 5,
+                    &dest_size,
+                    (Bytef *)(msg->data + 5),
+                    msg->data_size - 5,
+                    compression_level);
+
+    if (rc != Z_OK)
+    {
+        free (dest);
+        return NULL;
+    }
+
+    *size = dest_size + 5;
+
+    /* set size and compression flag */
+    size32 = htonl ((uint32_t)(*size));
+    memcpy (dest, &size32, 4);
+    dest[4] = WEECHAT_RELAY_COMPRESSION_ZLIB;
+
+    return dest;
+}
+
+/*
+ * Compresses a message with zstd.
+ *
+ * The variable "size" is set with the size of buffer returned (in bytes).
+ *
+ * Returns a pointer to the compressed message, NULL if error.
+ */
+
+void *
+weechat_relay_msg_compress_zstd (struct t_weechat_relay_msg *msg,
+                                 int compression_level,
+                                 size_t *size)
+{
+    Bytef *dest;
+    size_t dest_size, comp_size;
+    uint32_t size32;
+
+    if (!msg || !size || (msg->compression != WEECHAT_RELAY_COMPRESSION_OFF))
+        return NULL;
+
+    *size = 0;
+
+    dest_size = ZSTD_compressBound (msg->data_size - 5);
+    dest = malloc (dest_size + 5);
+    if (!dest)
+        return NULL;
+
+    comp_size = ZSTD_compress(
+        dest + 5,
+        dest_size,
+        (void *)(msg->data + 5),
+        msg->data_size - 5,
+        compression_level);
+
+    if (comp_size == 0)
+    {
+        free (dest);
+        return NULL;
+    }
+
+    *size = comp_size + 5;
+
+    /* set size and compression flag */
+    size32 = htonl ((uint32_t)(*size));
+    memcpy (dest, &size32, 4);
+    dest[4] = WEECHAT_RELAY_COMPRESSION_ZSTD;
+
+    return dest;
+}
+
+/*
+ * Compresses a message in place: the message is compressed in the buffer
+ * "compressed" of message (allocated on first call and then reused), which
+ * is swapped with data, so that data is the compressed message (with size and
+ * compression flag) and the uncompressed buffer is kept for the next
+ * compression of this message (see weechat_relay_msg_reset).
+ *
+ * If ctx is not NULL, the message is compressed with this context (see
+ * weechat_relay_msg_compress_zlib_ctx and
+ * weechat_relay_msg_compress_zstd_ctx), then copied in the buffer
+ * "compressed" of message.
+ *
+ * Nothing can be added to the message after compression.
+ * If compression is WEECHAT_RELAY_COMPRESSION_OFF, nothing is done.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (message unchanged)
+ */
+
+int
+weechat_relay_msg_compress (struct t_weechat_relay_msg *msg,
+                            struct t_weechat_relay_msg_compress_ctx *ctx,
+                            enum t_weechat_relay_compression compression,
+                            int compression_level)
+{
+    char *ptr;
+    void *buffer_ctx;
+    size_t bound, comp_size, size_ctx;
+    uLongf dest_size;
+    uint32_t size32;
+
+    if (!msg || !msg->data || (msg->data_size < 5)
+        || (compression < 0) || (compression >= WEECHAT_RELAY_NUM_COMPRESSIONS)
+        || (msg->compression != WEECHAT_RELAY_COMPRESSION_OFF))
+    {
+        return 0;
+    }
+
+    if (compression == WEECHAT_RELAY_COMPRESSION_OFF)
+        return 1;
+
+    if (ctx)
+    {
+        buffer_ctx = (compression == WEECHAT_RELAY_COMPRESSION_ZLIB) ?
+            weechat_relay_msg_compress_zlib_ctx (ctx, msg, compression_level,
+                                                 &size_ctx) :
+            weechat_relay_msg_compress_zstd_ctx (ctx, msg, compression_level,
+                                                 &size_ctx);
+        if (!buffer_ctx)
+            return 0;
+        if (size_ctx > msg->compressed_alloc)
+        {
+            ptr = realloc (msg->compressed, size_ctx);
+            if (!ptr)
+                return 0;
+            msg->compressed = ptr;
+            msg->compressed_alloc = size_ctx;
+        }
+        memcpy (msg->compressed, buffer_ctx, size_ctx);
+        comp_size = size_ctx - 5;
+        goto swap;
+    }
+
+    bound = (compression == WEECHAT_RELAY_COMPRESSION_ZLIB) ?
+        compressBound (msg->data_size - 5) :
+        ZSTD_compressBound (msg->data_size - 5);
+    if (bound + 5 > msg->compressed_alloc)
+    {
+        ptr = realloc (msg->compressed, bound + 5);
+        if (!ptr)
+            return 0;
+        msg->compressed = ptr;
+        msg->compressed_alloc = bound + 5;
+    }
+
+    if (compression == WEECHAT_RELAY_COMPRESSION_ZLIB)
+    {
+        dest_size = msg->compressed_alloc - 5;
+        if (compress2 ((Bytef *)(msg->compressed + 5),
+                       &dest_size,
+                       (Bytef *)(msg->data + 5),
+                       msg->data_size - 5,
+                       compression_level) != Z_OK)
+        {
+            return 0;
+        }
+        comp_size = dest_size;
+    }
+    else
+    {
+        comp_size = ZSTD_compress (msg->compressed + 5,
+                                   msg->compressed_alloc - 5,
+                                   msg->data + 5,
+                                   msg->data_size - 5,
+                                   compression_level);
+        if (ZSTD_isError (comp_size) || (comp_size == 0))
+            return 0;
+    }
+
+    /* set size and compression flag */
+    size32 = htonl ((uint32_t)(comp_size + 5));
+    memcpy (msg->compressed, &size32, 4);
+    msg->compressed[4] = (char)compression;
+
+swap:
+    /* swap buffers: the uncompressed one is kept for next use */
+    ptr = msg->data;
+    bound = msg->data_alloc;
+    msg->data = msg->compressed;
+    msg->data_alloc = msg->compressed_alloc;
+    msg->data_size = comp_size + 5;
+    msg->compressed = ptr;
+    msg->compressed_alloc = bound;
+    msg->compressed_size = 0;
+    msg->compression = compression;
+
+    return 1;
+}
+
+/*
+ * Creates a compression context, to reuse the compressor states and the
+ * output buffer for many messages (typically one context per session).
+ *
+ * Returns pointer to context, NULL if error.
+ */
+
+struct t_weechat_relay_msg_compress_ctx *
+weechat_relay_msg_compress_ctx_new ()
+{
+    return calloc (1, sizeof (struct t_weechat_relay_msg_compress_ctx));
+}
+
+/*
+ * Sets the zstd dictionary used to compress messages with a compression
+ * context (NULL = no dictionary): the peer must decompress the messages with
+ * the same dictionary (see weechat_relay_session_set_dict).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_compress_ctx_set_dict (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                         const void *dict, size_t size)
+{
+    void *new_dict;
+
+    if (!ctx || (dict && (size == 0)))
+        return 0;
+
+    new_dict = NULL;
+    if (dict)
+    {
+        new_dict = malloc (size);
+        if (!new_dict)
+            return 0;
+        memcpy (new_dict, dict, size);
+    }
+
+    if (ctx->zstd_cdict)
+    {
+        ZSTD_freeCDict ((ZSTD_CDict *)ctx->zstd_cdict);
+        ctx->zstd_cdict = NULL;
+    }
+    if (ctx->dict)
+        free (ctx->dict);
+    ctx->dict = new_dict;
+    ctx->dict_size = (new_dict) ? size : 0;
+
+    return 1;
+}
+
+/*
+ * Sets the number of zstd worker threads used to compress messages bigger
+ * than "min_size" bytes (0 = WEECHAT_RELAY_MSG_COMPRESS_WORKERS_MIN_SIZE)
+ * with a compression context; workers == 0 disables worker threads.
+ *
+ * The message is split in jobs compressed in parallel, but the output is
+ * still a single zstd frame.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (zstd built without multi-threading support if workers > 0)
+ */
+
+int
+weechat_relay_msg_compress_ctx_set_workers (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                            int workers, size_t min_size)
+{
+    ZSTD_bounds bounds;
+
+    if (!ctx || (workers < 0))
+        return 0;
+
+    if (workers > 0)
+    {
+        bounds = ZSTD_cParam_getBounds (ZSTD_c_nbWorkers);
+        if (ZSTD_isError (bounds.error) || (bounds.upperBound < 1))
+            return 0;
+        if (workers > bounds.upperBound)
+            workers = bounds.upperBound;
+    }
+
+    if (ctx->zstd_cctx_mt && (workers != ctx->zstd_workers))
+    {
+        /* the worker threads are created again on next compression */
+        ZSTD_freeCCtx ((ZSTD_CCtx *)ctx->zstd_cctx_mt);
+        ctx->zstd_cctx_mt = NULL;
+    }
+    ctx->zstd_workers = workers;
+    ctx->zstd_workers_min_size = (min_size > 0) ?
+        min_size : WEECHAT_RELAY_MSG_COMPRESS_WORKERS_MIN_SIZE;
+
+    return 1;
+}
+
+/*
+ * Compresses data of a message with the zstd worker threads of a compression
+ * context; each worker compresses one job of about the same size.
+ *
+ * Returns size of compressed data (in ctx->buffer + 5), 0 if error.
+ */
+
+size_t
+weechat_relay_msg_compress_zstd_mt (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                    struct t_weechat_relay_msg *msg,
+                                    int compression_level)
+{
+    ZSTD_CCtx *cctx;
+    ZSTD_bounds bounds;
+    size_t job_size, comp_size;
+
+    if (!ctx->zstd_cctx_mt)
+    {
+        ctx->zstd_cctx_mt = ZSTD_createCCtx ();
+        if (!ctx->zstd_cctx_mt)
+            return 0;
+    }
+    cctx = (ZSTD_CCtx *)ctx->zstd_cctx_mt;
+
+    /* only parameters are reset, the worker threads are kept */
+    ZSTD_CCtx_reset (cctx, ZSTD_reset_session_and_parameters);
+
+    job_size = (msg->data_size - 5) / ctx->zstd_workers;
+    bounds = ZSTD_cParam_getBounds (ZSTD_c_jobSize);
+    if (!ZSTD_isError (bounds.error) && (job_size < (size_t)bounds.lowerBound))
+        job_size = bounds.lowerBound;
+    if (!ZSTD_isError (bounds.error) && (job_size > (size_t)bounds.upperBound))
+        job_size = bounds.upperBound;
+
+    if (ZSTD_isError (ZSTD_CCtx_setParameter (cctx, ZSTD_c_nbWorkers,
+                                              ctx->zstd_workers))
+        || ZSTD_isError (ZSTD_CCtx_setParameter (cctx, ZSTD_c_jobSize,
+                                                 (int)job_size)))
+    {
+        return 0;
+    }
+
+    if (ctx->dict)
+    {
+        if (!weechat_relay_msg_compress_ctx_cdict (ctx, compression_level)
+            || ZSTD_isError (ZSTD_CCtx_refCDict (cctx,
+                                                 (ZSTD_CDict *)ctx->zstd_cdict)))
+        {
+            return 0;
+        }
+    }
+    else if (ZSTD_isError (ZSTD_CCtx_setParameter (cctx,
+                                                   ZSTD_c_compressionLevel,
+                                                   compression_level)))
+    {
+        return 0;
     }
 
-    return 1;
+    comp_size = ZSTD_compress2 (cctx,
+                                ctx->buffer + 5,
+                                ctx->buffer_alloc - 5,
+                                msg->data + 5,
+                                msg->data_size - 5);
+
+    return (ZSTD_isError (comp_size)) ? 0 : comp_size;
 }
 
 /*
- * Adds an object to a message, which can be any type supported in
- * enum t_weechat_relay_obj_type.
+ * Digests the zstd dictionary of a compression context for a compression
+ * level (done once, until the level changes).
  *
  * Returns:
  *   1: OK
@@ -593,116 +2568,605 @@ weechat_relay_msg_add_object_value (struct t_weechat_relay_msg *msg,
  */
 
 int
-weechat_relay_msg_add_object (struct t_weechat_relay_msg *msg,
-                              struct t_weechat_relay_obj *obj)
+weechat_relay_msg_compress_ctx_cdict (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                      int compression_level)
 {
-    if (!weechat_relay_msg_add_type (msg, obj->type))
+    if (ctx->zstd_cdict && (ctx->zstd_cdict_level == compression_level))
+        return 1;
+
+    if (ctx->zstd_cdict)
+        ZSTD_freeCDict ((ZSTD_CDict *)ctx->zstd_cdict);
+    ctx->zstd_cdict = ZSTD_createCDict (ctx->dict, ctx->dict_size,
+                                        compression_level);
+    if (!ctx->zstd_cdict)
         return 0;
+    ctx->zstd_cdict_level = compression_level;
+
+    return 1;
+}
+
+/*
+ * Grows the output buffer of a compression context to at least "size" bytes.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_compress_ctx_buffer (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                       size_t size)
+{
+    char *ptr;
 
-    if (!weechat_relay_msg_add_object_value (msg, obj))
+    if (size <= ctx->buffer_alloc)
+        return 1;
+
+    ptr = realloc (ctx->buffer, size);
+    if (!ptr)
         return 0;
+    ctx->buffer = ptr;
+    ctx->buffer_alloc = size;
 
     return 1;
 }
 
 /*
- * Compresses a message with zlib.
+ * Compresses a message with zlib, using a compression context: the zlib
+ * stream is reset instead of being allocated and initialized for each
+ * message.
  *
  * The variable "size" is set with the size of buffer returned (in bytes).
  *
- * Returns a pointer to the compressed message, NULL if error.
+ * Returns a pointer to the compressed message, NULL if error; the buffer
+ * belongs to the context (it must not be freed) and is valid until the next
+ * compression with this context.
  */
 
 void *
-weechat_relay_msg_compress_zlib (struct t_weechat_relay_msg *msg,
-                                 int compression_level,
-                                 size_t *size)
+weechat_relay_msg_compress_zlib_ctx (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                     struct t_weechat_relay_msg *msg,
+                                     int compression_level,
+                                     size_t *size)
 {
-    int rc;
-    Bytef *dest;
-    uLongf dest_size;
+    z_stream *strm;
     uint32_t size32;
+    int rc;
 
-    if (!msg || !size)
+    if (!ctx || !msg || !size
+        || (msg->compression != WEECHAT_RELAY_COMPRESSION_OFF))
+    {
         return NULL;
+    }
 
     *size = 0;
 
-    dest_size = compressBound (msg->data_size - 5);
-    dest = malloc (dest_size + 5);
-    if (!dest)
-        return NULL;
-
-    rc = compress2 (dest + 5,
-                    &dest_size,
-                    (Bytef *)(msg->data + 5),
-                    msg->data_size - 5,
-                    compression_level);
+    strm = (z_stream *)ctx->zlib_strm;
+    if (!strm)
+    {
+        strm = calloc (1, sizeof (*strm));
+        if (!strm)
+            return NULL;
+        if (deflateInit (strm, compression_level) != Z_OK)
+        {
+            free (strm);
+            return NULL;
+        }
+        ctx->zlib_strm = strm;
+        ctx->zlib_level = compression_level;
+    }
+    else
+    {
+        if (deflateReset (strm) != Z_OK)
+            return NULL;
+        if (compression_level != ctx->zlib_level)
+        {
+            if (deflateParams (strm, compression_level,
+                               Z_DEFAULT_STRATEGY) != Z_OK)
+            {
+                return NULL;
+            }
+            ctx->zlib_level = compression_level;
+        }
+    }
 
-    if (rc != Z_OK)
+    if (!weechat_relay_msg_compress_ctx_buffer (
+            ctx, deflateBound (strm, msg->data_size - 5) + 5))
     {
-        free (dest);
         return NULL;
     }
 
-    *size = dest_size + 5;
+    strm->next_in = (Bytef *)(msg->data + 5);
+    strm->avail_in = msg->data_size - 5;
+    strm->next_out = (Bytef *)(ctx->buffer + 5);
+    strm->avail_out = ctx->buffer_alloc - 5;
+    rc = deflate (strm, Z_FINISH);
+    if (rc != Z_STREAM_END)
+        return NULL;
+
+    *size = strm->total_out + 5;
 
     /* set size and compression flag */
     size32 = htonl ((uint32_t)(*size));
-    memcpy (dest, &size32, 4);
-    dest[4] = WEECHAT_RELAY_COMPRESSION_ZLIB;
+    memcpy (ctx->buffer, &size32, 4);
+    ctx->buffer[4] = WEECHAT_RELAY_COMPRESSION_ZLIB;
 
-    return dest;
+    return ctx->buffer;
 }
 
 /*
- * Compresses a message with zstd.
+ * Compresses a message with zstd, using a compression context: the zstd
+ * context (with its tables) is reused for each message, and the dictionary
+ * of context is used if set (see weechat_relay_msg_compress_ctx_set_dict).
  *
  * The variable "size" is set with the size of buffer returned (in bytes).
  *
- * Returns a pointer to the compressed message, NULL if error.
+ * Returns a pointer to the compressed message, NULL if error; the buffer
+ * belongs to the context (it must not be freed) and is valid until the next
+ * compression with this context.
  */
 
 void *
-weechat_relay_msg_compress_zstd (struct t_weechat_relay_msg *msg,
-                                 int compression_level,
-                                 size_t *size)
+weechat_relay_msg_compress_zstd_ctx (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                     struct t_weechat_relay_msg *msg,
+                                     int compression_level,
+                                     size_t *size)
 {
-    Bytef *dest;
-    size_t dest_size, comp_size;
+    size_t comp_size;
     uint32_t size32;
 
-    if (!msg || !size)
+    if (!ctx || !msg || !size
+        || (msg->compression != WEECHAT_RELAY_COMPRESSION_OFF))
+    {
         return NULL;
+    }
 
     *size = 0;
 
-    dest_size = ZSTD_compressBound (msg->data_size - 5);
-    dest = malloc (dest_size + 5);
-    if (!dest)
-        return NULL;
-
-    comp_size = ZSTD_compress(
-        dest + 5,
-        dest_size,
-        (void *)(msg->data + 5),
-        msg->data_size - 5,
-        compression_level);
+    if (!ctx->zstd_cctx)
+    {
+        ctx->zstd_cctx = ZSTD_createCCtx ();
+        if (!ctx->zstd_cctx)
+            return NULL;
+    }
 
-    if (comp_size == 0)
+    if (!weechat_relay_msg_compress_ctx_buffer (
+            ctx, ZSTD_compressBound (msg->data_size - 5) + 5))
     {
-        free (dest);
         return NULL;
     }
 
+    if ((ctx->zstd_workers > 0)
+        && (msg->data_size - 5 >= ctx->zstd_workers_min_size))
+    {
+        comp_size = weechat_relay_msg_compress_zstd_mt (ctx, msg,
+                                                        compression_level);
+    }
+    else if (ctx->dict)
+    {
+        if (!weechat_relay_msg_compress_ctx_cdict (ctx, compression_level))
+            return NULL;
+        comp_size = ZSTD_compress_usingCDict (
+            (ZSTD_CCtx *)ctx->zstd_cctx,
+            ctx->buffer + 5,
+            ctx->buffer_alloc - 5,
+            msg->data + 5,
+            msg->data_size - 5,
+            (ZSTD_CDict *)ctx->zstd_cdict);
+    }
+    else
+    {
+        comp_size = ZSTD_compressCCtx (
+            (ZSTD_CCtx *)ctx->zstd_cctx,
+            ctx->buffer + 5,
+            ctx->buffer_alloc - 5,
+            msg->data + 5,
+            msg->data_size - 5,
+            compression_level);
+    }
+
+    if (ZSTD_isError (comp_size) || (comp_size == 0))
+        return NULL;
+
     *size = comp_size + 5;
 
     /* set size and compression flag */
     size32 = htonl ((uint32_t)(*size));
-    memcpy (dest, &size32, 4);
-    dest[4] = WEECHAT_RELAY_COMPRESSION_ZSTD;
+    memcpy (ctx->buffer, &size32, 4);
+    ctx->buffer[4] = WEECHAT_RELAY_COMPRESSION_ZSTD;
 
-    return dest;
+    return ctx->buffer;
+}
+
+/*
+ * Frees a compression context.
+ */
+
+void
+weechat_relay_msg_compress_ctx_free (struct t_weechat_relay_msg_compress_ctx *ctx)
+{
+    if (!ctx)
+        return;
+
+    if (ctx->zlib_strm)
+    {
+        deflateEnd ((z_stream *)ctx->zlib_strm);
+        free (ctx->zlib_strm);
+    }
+    if (ctx->zstd_cctx)
+        ZSTD_freeCCtx ((ZSTD_CCtx *)ctx->zstd_cctx);
+    if (ctx->zstd_cctx_mt)
+        ZSTD_freeCCtx ((ZSTD_CCtx *)ctx->zstd_cctx_mt);
+    if (ctx->zstd_cdict)
+        ZSTD_freeCDict ((ZSTD_CDict *)ctx->zstd_cdict);
+    if (ctx->dict)
+        free (ctx->dict);
+    if (ctx->buffer)
+        free (ctx->buffer);
+
+    free (ctx);
+}
+
+/*
+ * Trains a zstd dictionary with recorded frames (binary messages as sent or
+ * received, one after the other): each message is a sample (compressed
+ * messages are decompressed), without its size and compression flag.
+ *
+ * The dictionary has at most "dict_max_size" bytes (typically 16 KB to
+ * 112 KB), the variable "dict_size" is set with its size; a few hundred
+ * samples are needed to train a dictionary.
+ *
+ * Returns a pointer to the dictionary (to free after use), NULL if error.
+ */
+
+void *
+weechat_relay_msg_train_dict (const void *frames, size_t size,
+                              size_t dict_max_size, size_t *dict_size)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    const char *ptr_frame, *ptr_sample;
+    char *samples, *dict, *ptr;
+    size_t *samples_sizes, *ptr_sizes, samples_size, samples_alloc;
+    size_t pos, sample_size, rc;
+    uint32_t size32;
+    unsigned int num_samples, num_alloc;
+
+    if (!frames || (size == 0) || (dict_max_size == 0) || !dict_size)
+        return NULL;
+
+    *dict_size = 0;
+
+    samples = NULL;
+    samples_size = 0;
+    samples_alloc = 0;
+    samples_sizes = NULL;
+    num_samples = 0;
+    num_alloc = 0;
+    dict = NULL;
+
+    pos = 0;
+    while (pos + 5 <= size)
+    {
+        ptr_frame = (const char *)frames + pos;
+        memcpy (&size32, ptr_frame, 4);
+        size32 = ntohl (size32);
+        if ((size32 < 5) || (size32 > size - pos))
+            break;
+        pos += size32;
+
+        parsed_msg = NULL;
+        if (ptr_frame[4] == WEECHAT_RELAY_COMPRESSION_OFF)
+        {
+            ptr_sample = ptr_frame + 5;
+            sample_size = size32 - 5;
+        }
+        else
+        {
+            parsed_msg = weechat_relay_parse_message (ptr_frame, size32);
+            ptr_sample = (parsed_msg) ? parsed_msg->data_decompressed : NULL;
+            sample_size = (parsed_msg) ?
+                parsed_msg->length_data_decompressed : 0;
+        }
+
+        if (ptr_sample && (sample_size > 0))
+        {
+            if (num_samples == num_alloc)
+            {
+                num_alloc = (num_alloc > 0) ? num_alloc * 2 : 256;
+                ptr_sizes = realloc (samples_sizes,
+                                     num_alloc * sizeof (*samples_sizes));
+                if (!ptr_sizes)
+                    goto error;
+                samples_sizes = ptr_sizes;
+            }
+            if (samples_size + sample_size > samples_alloc)
+            {
+                samples_alloc = (samples_alloc > 0) ? samples_alloc : size;
+                while (samples_size + sample_size > samples_alloc)
+                {
+                    samples_alloc *= 2;
+                }
+                ptr = realloc (samples, samples_alloc);
+                if (!ptr)
+                    goto error;
+                samples = ptr;
+            }
+            memcpy (samples + samples_size, ptr_sample, sample_size);
+            samples_size += sample_size;
+            samples_sizes[num_samples++] = sample_size;
+        }
+        weechat_relay_parse_msg_free (parsed_msg);
+    }
+
+    if (num_samples == 0)
+        goto end;
+
+    dict = malloc (dict_max_size);
+    if (!dict)
+        goto end;
+
+    rc = ZDICT_trainFromBuffer (dict, dict_max_size, samples, samples_sizes,
+                                num_samples);
+    if (ZDICT_isError (rc))
+    {
+        free (dict);
+        dict = NULL;
+        goto end;
+    }
+
+    *dict_size = rc;
+    if (rc < dict_max_size)
+    {
+        ptr = realloc (dict, rc);
+        if (ptr)
+            dict = ptr;
+    }
+    goto end;
+
+error:
+    weechat_relay_parse_msg_free (parsed_msg);
+
+end:
+    if (samples)
+        free (samples);
+    if (samples_sizes)
+        free (samples_sizes);
+    return dict;
+}
+
+/*
+ * Grows the buffer with compressed data of a message if it is full.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_compress_grow (struct t_weechat_relay_msg *msg)
+{
+    char *ptr;
+
+    if (msg->compressed_size < msg->compressed_alloc)
+        return 1;
+
+    ptr = realloc (msg->compressed, msg->compressed_alloc * 2);
+    if (!ptr)
+        return 0;
+    msg->compressed = ptr;
+    msg->compressed_alloc *= 2;
+
+    return 1;
+}
+
+/*
+ * Compresses the pending bytes of a message compressed while it is built
+ * (if "end" is 1, the compression is ended).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_compress_stream (struct t_weechat_relay_msg *msg, int end)
+{
+    z_stream *strm;
+    ZSTD_inBuffer input_buf;
+    ZSTD_outBuffer output_buf;
+    size_t remaining;
+    int rc;
+
+    switch (msg->compression)
+    {
+        case WEECHAT_RELAY_COMPRESSION_ZLIB:
+            strm = (z_stream *)msg->compress_stream;
+            strm->next_in = (Bytef *)msg->data;
+            strm->avail_in = msg->data_size;
+            do
+            {
+                if (!weechat_relay_msg_compress_grow (msg))
+                    return 0;
+                strm->next_out = (Bytef *)(msg->compressed
+                                           + msg->compressed_size);
+                strm->avail_out = msg->compressed_alloc
+                    - msg->compressed_size;
+                rc = deflate (strm, (end) ? Z_FINISH : Z_NO_FLUSH);
+                if (rc == Z_STREAM_ERROR)
+                    return 0;
+                msg->compressed_size = msg->compressed_alloc
+                    - strm->avail_out;
+            } while ((end) ? (rc != Z_STREAM_END) : (strm->avail_in > 0));
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZSTD:
+            input_buf.src = msg->data;
+            input_buf.size = msg->data_size;
+            input_buf.pos = 0;
+            do
+            {
+                if (!weechat_relay_msg_compress_grow (msg))
+                    return 0;
+                output_buf.dst = msg->compressed;
+                output_buf.size = msg->compressed_alloc;
+                output_buf.pos = msg->compressed_size;
+                remaining = ZSTD_compressStream2 (
+                    (ZSTD_CCtx *)msg->compress_stream,
+                    &output_buf, &input_buf,
+                    (end) ? ZSTD_e_end : ZSTD_e_continue);
+                if (ZSTD_isError (remaining))
+                    return 0;
+                msg->compressed_size = output_buf.pos;
+            } while ((end) ?
+                     (remaining != 0) : (input_buf.pos < input_buf.size));
+            break;
+        default:
+            return 0;
+    }
+
+    msg->data_size = 0;
+
+    return 1;
+}
+
+/*
+ * Frees the compression stream of a message.
+ */
+
+void
+weechat_relay_msg_compress_free_stream (struct t_weechat_relay_msg *msg)
+{
+    if (!msg->compress_stream)
+        return;
+
+    switch (msg->compression)
+    {
+        case WEECHAT_RELAY_COMPRESSION_ZLIB:
+            deflateEnd ((z_stream *)msg->compress_stream);
+            free (msg->compress_stream);
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZSTD:
+            ZSTD_freeCCtx ((ZSTD_CCtx *)msg->compress_stream);
+            break;
+        default:
+            break;
+    }
+    msg->compress_stream = NULL;
+}
+
+/*
+ * Resets a message to build a new message with another id, keeping the
+ * allocated buffers (a message can then be reused for many messages, whether
+ * it was compressed or not).
+ *
+ * If the message was compressed in place (weechat_relay_msg_compress), the
+ * uncompressed buffer is used again for data.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_reset (struct t_weechat_relay_msg *msg, const char *id)
+{
+    char *ptr;
+    size_t alloc;
+
+    if (!msg)
+        return 0;
+
+    weechat_relay_msg_compress_free_stream (msg);
+
+    /* use the biggest buffer for data */
+    if (msg->compressed && (msg->compressed_alloc > msg->data_alloc))
+    {
+        ptr = msg->data;
+        alloc = msg->data_alloc;
+        msg->data = msg->compressed;
+        msg->data_alloc = msg->compressed_alloc;
+        msg->compressed = ptr;
+        msg->compressed_alloc = (ptr) ? alloc : 0;
+    }
+    if (!msg->data)
+    {
+        msg->data = malloc (WEECHAT_RELAY_MSG_INITIAL_ALLOC);
+        if (!msg->data)
+            return 0;
+        msg->data_alloc = WEECHAT_RELAY_MSG_INITIAL_ALLOC;
+    }
+
+    if (msg->id)
+        free (msg->id);
+    msg->id = (id) ? strdup (id) : NULL;
+    msg->data_size = 0;
+    msg->passthrough = 0;
+    msg->compression = WEECHAT_RELAY_COMPRESSION_OFF;
+    msg->compressed_size = 0;
+
+    /* add size and compression flag (they will be set later), then id */
+    if (!weechat_relay_msg_append_integer (msg, 0)
+        || !weechat_relay_msg_append_char (msg, 0)
+        || !weechat_relay_msg_append_string (msg, id))
+    {
+        return 0;
+    }
+
+    return weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Builds a new message with id and objects of a parsed message.
+ *
+ * If the message was parsed with flag WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH,
+ * objects not marked as modified (see weechat_relay_parse_msg_set_dirty) are
+ * copied as-is from the message received, so the data is the same as the
+ * message received (decompressed) if nothing was modified.
+ *
+ * Returns pointer to new message, NULL if error.
+ */
+
+struct t_weechat_relay_msg *
+weechat_relay_msg_new_parsed (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_msg *msg;
+    size_t size, size_object;
+    int i;
+
+    if (!parsed_msg)
+        return NULL;
+
+    msg = weechat_relay_msg_new (parsed_msg->id);
+    if (!msg)
+        return NULL;
+
+    /* compute size of all objects, to allocate the message only once */
+    msg->passthrough = 1;
+    size = 0;
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        size_object = weechat_relay_msg_size_object (msg,
+                                                     parsed_msg->objects[i]);
+        if (size_object == 0)
+        {
+            weechat_relay_msg_free (msg);
+            return NULL;
+        }
+        size += size_object;
+    }
+    if (!weechat_relay_msg_reserve (msg, size))
+    {
+        weechat_relay_msg_free (msg);
+        return NULL;
+    }
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        weechat_relay_msg_put_object (msg, parsed_msg->objects[i]);
+    }
+    msg->passthrough = 0;
+
+    weechat_relay_msg_update_size (msg);
+
+    return msg;
 }
 
 /*
@@ -719,6 +3183,9 @@ weechat_relay_msg_free (struct t_weechat_relay_msg *msg)
         free (msg->id);
     if (msg->data)
         free (msg->data);
+    weechat_relay_msg_compress_free_stream (msg);
+    if (msg->compressed)
+        free (msg->compressed);
 
     free (msg);
 }
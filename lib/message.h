@@ -0,0 +1,144 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_MESSAGE_H
+#define WEECHAT_RELAY_MESSAGE_H
+
+struct t_weechat_relay_msg_compress_ctx
+{
+    void *zlib_strm;                   /* zlib stream (z_stream)            */
+    int zlib_level;                    /* compression level of zlib_strm    */
+    void *zstd_cctx;                   /* zstd compression context          */
+    void *dict;                        /* zstd dictionary (NULL if none)    */
+    size_t dict_size;                  /* size of dictionary                */
+    void *zstd_cdict;                  /* dictionary digested for zstd      */
+    int zstd_cdict_level;              /* compression level of zstd_cdict   */
+    int zstd_workers;                  /* zstd worker threads (0 = none)    */
+    size_t zstd_workers_min_size;      /* min size to use worker threads    */
+    void *zstd_cctx_mt;                /* zstd context with worker threads  */
+    char *buffer;                      /* compressed message (returned by   */
+                                       /* compress functions)               */
+    size_t buffer_alloc;               /* allocated size for buffer         */
+};
+
+extern int weechat_relay_msg_update_size (struct t_weechat_relay_msg *msg);
+extern int weechat_relay_msg_append_bytes (struct t_weechat_relay_msg *msg,
+                                           const void *buffer, size_t size);
+extern int weechat_relay_msg_append_type (struct t_weechat_relay_msg *msg,
+                                          enum t_weechat_relay_obj_type obj_type);
+extern int weechat_relay_msg_append_char (struct t_weechat_relay_msg *msg,
+                                          char c);
+extern int weechat_relay_msg_append_integer (struct t_weechat_relay_msg *msg,
+                                             int value);
+extern int weechat_relay_msg_append_long (struct t_weechat_relay_msg *msg,
+                                          long value);
+extern int weechat_relay_msg_append_string (struct t_weechat_relay_msg *msg,
+                                            const char *string);
+extern int weechat_relay_msg_append_buffer (struct t_weechat_relay_msg *msg,
+                                            struct t_weechat_relay_obj_buffer *buffer);
+extern int weechat_relay_msg_append_pointer (struct t_weechat_relay_msg *msg,
+                                             const void *pointer);
+extern int weechat_relay_msg_append_time (struct t_weechat_relay_msg *msg,
+                                          time_t time);
+extern int weechat_relay_msg_length_long (long value);
+extern int weechat_relay_msg_length_pointer (const void *pointer);
+extern int weechat_relay_msg_length_time (time_t time);
+extern int weechat_relay_msg_hashtable_type_valid (enum t_weechat_relay_obj_type type);
+extern size_t weechat_relay_msg_size_string (const char *string);
+extern size_t weechat_relay_msg_size_hashtable (struct t_weechat_relay_msg *msg,
+                                                struct t_weechat_relay_obj_hashtable *hashtable);
+extern size_t weechat_relay_msg_size_hdata (struct t_weechat_relay_msg *msg,
+                                            struct t_weechat_relay_obj_hdata *hdata);
+extern size_t weechat_relay_msg_size_infolist (struct t_weechat_relay_msg *msg,
+                                               struct t_weechat_relay_obj_infolist *infolist);
+extern size_t weechat_relay_msg_size_array (struct t_weechat_relay_msg *msg,
+                                            struct t_weechat_relay_obj_array *array);
+extern size_t weechat_relay_msg_size_object_value (struct t_weechat_relay_msg *msg,
+                                                   struct t_weechat_relay_obj *obj);
+extern size_t weechat_relay_msg_size_object (struct t_weechat_relay_msg *msg,
+                                             struct t_weechat_relay_obj *obj);
+extern void weechat_relay_msg_put_type (struct t_weechat_relay_msg *msg,
+                                        enum t_weechat_relay_obj_type obj_type);
+extern void weechat_relay_msg_put_string (struct t_weechat_relay_msg *msg,
+                                          const char *string);
+extern void weechat_relay_msg_put_buffer (struct t_weechat_relay_msg *msg,
+                                          struct t_weechat_relay_obj_buffer *buffer);
+extern void weechat_relay_msg_put_long (struct t_weechat_relay_msg *msg,
+                                        long value);
+extern void weechat_relay_msg_put_pointer (struct t_weechat_relay_msg *msg,
+                                           const void *pointer);
+extern void weechat_relay_msg_put_time (struct t_weechat_relay_msg *msg,
+                                        time_t time);
+extern void weechat_relay_msg_put_hashtable (struct t_weechat_relay_msg *msg,
+                                             struct t_weechat_relay_obj_hashtable *hashtable);
+extern void weechat_relay_msg_put_hdata (struct t_weechat_relay_msg *msg,
+                                         struct t_weechat_relay_obj_hdata *hdata);
+extern void weechat_relay_msg_put_infolist (struct t_weechat_relay_msg *msg,
+                                            struct t_weechat_relay_obj_infolist *infolist);
+extern void weechat_relay_msg_put_array (struct t_weechat_relay_msg *msg,
+                                         struct t_weechat_relay_obj_array *array);
+extern void weechat_relay_msg_put_object_value (struct t_weechat_relay_msg *msg,
+                                                struct t_weechat_relay_obj *obj);
+extern void weechat_relay_msg_put_object (struct t_weechat_relay_msg *msg,
+                                          struct t_weechat_relay_obj *obj);
+extern int weechat_relay_msg_stream_bytes (struct t_weechat_relay_msg *msg,
+                                           const void *buffer, size_t size);
+extern int weechat_relay_msg_stream_hashtable (struct t_weechat_relay_msg *msg,
+                                               struct t_weechat_relay_obj_hashtable *hashtable);
+extern int weechat_relay_msg_stream_hdata (struct t_weechat_relay_msg *msg,
+                                           struct t_weechat_relay_obj_hdata *hdata);
+extern int weechat_relay_msg_stream_infolist (struct t_weechat_relay_msg *msg,
+                                              struct t_weechat_relay_obj_infolist *infolist);
+extern int weechat_relay_msg_stream_array (struct t_weechat_relay_msg *msg,
+                                           struct t_weechat_relay_obj_array *array);
+extern int weechat_relay_msg_stream_object_value (struct t_weechat_relay_msg *msg,
+                                                  struct t_weechat_relay_obj *obj);
+extern int weechat_relay_msg_append_hashtable (struct t_weechat_relay_msg *msg,
+                                               struct t_weechat_relay_obj_hashtable *hashtable);
+extern int weechat_relay_msg_append_hdata (struct t_weechat_relay_msg *msg,
+                                           struct t_weechat_relay_obj_hdata *hdata);
+extern int weechat_relay_msg_append_info (struct t_weechat_relay_msg *msg,
+                                          struct t_weechat_relay_obj_info *info);
+extern int weechat_relay_msg_append_infolist (struct t_weechat_relay_msg *msg,
+                                              struct t_weechat_relay_obj_infolist *infolist);
+extern int weechat_relay_msg_append_array (struct t_weechat_relay_msg *msg,
+                                           struct t_weechat_relay_obj_array *array);
+extern int weechat_relay_msg_append_object_value (struct t_weechat_relay_msg *msg,
+                                                  struct t_weechat_relay_obj *obj);
+extern int weechat_relay_msg_append_object (struct t_weechat_relay_msg *msg,
+                                            struct t_weechat_relay_obj *obj);
+extern int weechat_relay_msg_append_value_content (struct t_weechat_relay_msg *msg,
+                                                   const struct t_weechat_relay_value *value);
+extern int weechat_relay_msg_append_value (struct t_weechat_relay_msg *msg,
+                                           const struct t_weechat_relay_value *value);
+extern int weechat_relay_msg_compress_grow (struct t_weechat_relay_msg *msg);
+extern int weechat_relay_msg_compress_stream (struct t_weechat_relay_msg *msg,
+                                              int end);
+extern void weechat_relay_msg_compress_free_stream (struct t_weechat_relay_msg *msg);
+extern size_t weechat_relay_msg_compress_zstd_mt (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                                 struct t_weechat_relay_msg *msg,
+                                                 int compression_level);
+extern int weechat_relay_msg_compress_ctx_cdict (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                                 int compression_level);
+extern int weechat_relay_msg_compress_ctx_buffer (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                                  size_t size);
+
+#endif /* WEECHAT_RELAY_MESSAGE_H */
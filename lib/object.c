@@ -22,6 +22,7 @@
 /* Create objects for messages sent to client and parsed messages */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "weechat-relay.h"
@@ -78,6 +79,701 @@ weechat_relay_obj_alloc (enum t_weechat_relay_obj_type type)
     return obj;
 }
 
+/*
+ * Mixes bits of an integer (finalizer of SplitMix64).
+ */
+
+uint64_t
+weechat_relay_obj_hash_integer (uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    value ^= value >> 31;
+
+    return value;
+}
+
+/*
+ * Computes hash of a hashtable key: string (FNV-1a), or number
+ * (char, integer, long, pointer, time).
+ *
+ * Returns the hash of key, 0 for other types.
+ */
+
+uint64_t
+weechat_relay_obj_hash_key (const struct t_weechat_relay_obj *key)
+{
+    const unsigned char *ptr_string;
+    uint64_t hash;
+
+    if (!key)
+        return 0;
+
+    switch (key->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            hash = 0xCBF29CE484222325ULL;
+            if (key->value_string)
+            {
+                for (ptr_string = (const unsigned char *)key->value_string;
+                     *ptr_string; ptr_string++)
+                {
+                    hash ^= *ptr_string;
+                    hash *= 0x100000001B3ULL;
+                }
+            }
+            return hash;
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            return weechat_relay_obj_hash_integer ((uint64_t)key->value_char);
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            return weechat_relay_obj_hash_integer ((uint64_t)key->value_integer);
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            return weechat_relay_obj_hash_integer ((uint64_t)key->value_long);
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            return weechat_relay_obj_hash_integer ((uint64_t)(uintptr_t)key->value_pointer);
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            return weechat_relay_obj_hash_integer ((uint64_t)key->value_time);
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Checks if two hashtable keys are equal (types supported: char, integer,
+ * long, string, pointer, time).
+ *
+ * Returns:
+ *   1: keys are equal
+ *   0: keys are different (or type not supported)
+ */
+
+int
+weechat_relay_obj_key_equal (const struct t_weechat_relay_obj *key1,
+                             const struct t_weechat_relay_obj *key2)
+{
+    if (!key1 || !key2 || (key1->type != key2->type))
+        return 0;
+
+    switch (key1->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            return (key1->value_char == key2->value_char) ? 1 : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            return (key1->value_integer == key2->value_integer) ? 1 : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            return (key1->value_long == key2->value_long) ? 1 : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            if (!key1->value_string || !key2->value_string)
+                return (key1->value_string == key2->value_string) ? 1 : 0;
+            return (strcmp (key1->value_string, key2->value_string) == 0) ?
+                1 : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            return (key1->value_pointer == key2->value_pointer) ? 1 : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            return (key1->value_time == key2->value_time) ? 1 : 0;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Builds the hash index on keys of a hashtable (open addressing with linear
+ * probing, load factor <= 0.5).
+ *
+ * If a key is present multiple times, the first entry is used, like a
+ * linear search.
+ *
+ * Returns:
+ *   1: OK (or index already built)
+ *   0: error (type of keys not supported or not enough memory)
+ */
+
+int
+weechat_relay_obj_hashtable_build_index (struct t_weechat_relay_obj_hashtable *hashtable)
+{
+    int *index, *ptr_index, index_size, i, slot, mask;
+
+    if (!hashtable || (hashtable->count < 0))
+        return 0;
+
+    if (__atomic_load_n (&hashtable->index, __ATOMIC_ACQUIRE))
+        return 1;
+
+    switch (hashtable->type_keys)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            break;
+        default:
+            return 0;
+    }
+
+    index_size = 8;
+    while (index_size < hashtable->count * 2)
+    {
+        if (index_size > (1 << 29))
+            return 0;
+        index_size *= 2;
+    }
+
+    index = calloc (index_size, sizeof (*index));
+    if (!index)
+        return 0;
+
+    mask = index_size - 1;
+    for (i = 0; i < hashtable->count; i++)
+    {
+        slot = (int)(weechat_relay_obj_hash_key (hashtable->keys[i]) & mask);
+        while (index[slot]
+               && !weechat_relay_obj_key_equal (hashtable->keys[index[slot] - 1],
+                                                hashtable->keys[i]))
+        {
+            slot = (slot + 1) & mask;
+        }
+        if (!index[slot])
+            index[slot] = i + 1;
+    }
+
+    /*
+     * publish the index: the hashtable can be shared by threads (parsed
+     * message retained by multiple consumers), so if another thread built
+     * the index at the same time, its index is kept and ours is freed
+     * (both have the same size)
+     */
+    __atomic_store_n (&hashtable->index_size, index_size, __ATOMIC_RELAXED);
+    ptr_index = NULL;
+    if (!__atomic_compare_exchange_n (&hashtable->index, &ptr_index, index,
+                                      0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+    {
+        free (index);
+    }
+
+    return 1;
+}
+
+/*
+ * Searches a key in a hashtable: with the hash index if the hashtable has
+ * enough keys (the index is built on first search), otherwise with a linear
+ * search.
+ *
+ * Returns index of entry found, -1 if key is not found.
+ */
+
+int
+weechat_relay_obj_hashtable_search (struct t_weechat_relay_obj_hashtable *hashtable,
+                                    const struct t_weechat_relay_obj *key)
+{
+    int *ptr_index, i, slot, mask;
+
+    if (!hashtable || !key || (key->type != hashtable->type_keys))
+        return -1;
+
+    ptr_index = __atomic_load_n (&hashtable->index, __ATOMIC_ACQUIRE);
+    if (!ptr_index
+        && (hashtable->count >= WEECHAT_RELAY_OBJ_HASHTABLE_INDEX_MIN_COUNT)
+        && weechat_relay_obj_hashtable_build_index (hashtable))
+    {
+        ptr_index = __atomic_load_n (&hashtable->index, __ATOMIC_ACQUIRE);
+    }
+
+    if (ptr_index)
+    {
+        mask = __atomic_load_n (&hashtable->index_size, __ATOMIC_RELAXED) - 1;
+        slot = (int)(weechat_relay_obj_hash_key (key) & mask);
+        while (ptr_index[slot])
+        {
+            if (weechat_relay_obj_key_equal (
+                    hashtable->keys[ptr_index[slot] - 1], key))
+            {
+                return ptr_index[slot] - 1;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return -1;
+    }
+
+    for (i = 0; i < hashtable->count; i++)
+    {
+        if (weechat_relay_obj_key_equal (hashtable->keys[i], key))
+            return i;
+    }
+
+    return -1;
+}
+
+/*
+ * Gets value of a key in a hashtable (keys of type char, integer, long,
+ * string, pointer or time).
+ *
+ * Returns the value object, NULL if key is not found.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_obj_hashtable_get (struct t_weechat_relay_obj_hashtable *hashtable,
+                                 const struct t_weechat_relay_obj *key)
+{
+    int i;
+
+    i = weechat_relay_obj_hashtable_search (hashtable, key);
+
+    return (i >= 0) ? hashtable->values[i] : NULL;
+}
+
+/*
+ * Gets value of a string key in a hashtable.
+ *
+ * Returns the value object, NULL if key is not found.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_obj_hashtable_get_string (struct t_weechat_relay_obj_hashtable *hashtable,
+                                        const char *key)
+{
+    struct t_weechat_relay_obj obj_key;
+
+    if (!key)
+        return NULL;
+
+    obj_key.type = WEECHAT_RELAY_OBJ_TYPE_STRING;
+    obj_key.value_string = (char *)key;
+
+    return weechat_relay_obj_hashtable_get (hashtable, &obj_key);
+}
+
+/*
+ * Returns the size of a value in a native column of a columnar infolist,
+ * 0 if values of this type can not be stored in a column.
+ */
+
+size_t
+weechat_relay_obj_infolist_column_size (enum t_weechat_relay_obj_type type)
+{
+    switch (type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            return sizeof (char);
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            return sizeof (int);
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            return sizeof (long);
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            return sizeof (char *);
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            return sizeof (struct t_weechat_relay_obj_buffer);
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            return sizeof (const void *);
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            return sizeof (time_t);
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Returns the value of a variable in an item of a columnar infolist: the
+ * object built for this value if there is one, otherwise "obj_temp", set
+ * with the native value.
+ *
+ * Strings and buffers are not copied in "obj_temp": it must not be freed and
+ * it is valid as long as the infolist.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_obj_infolist_column_view (const struct t_weechat_relay_obj_infolist *infolist,
+                                        int variable, int item,
+                                        struct t_weechat_relay_obj *obj_temp)
+{
+    struct t_weechat_relay_obj **ptr_objects, *ptr_obj;
+    const void *column;
+
+    ptr_objects = __atomic_load_n (&infolist->objects, __ATOMIC_ACQUIRE);
+    if (ptr_objects)
+    {
+        ptr_obj = __atomic_load_n (
+            &ptr_objects[((size_t)variable * infolist->count) + item],
+            __ATOMIC_ACQUIRE);
+        if (ptr_obj)
+            return ptr_obj;
+    }
+
+    memset (obj_temp, 0, sizeof (*obj_temp));
+    obj_temp->type = infolist->schema->types[variable];
+    column = infolist->columns[variable];
+    switch (obj_temp->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            obj_temp->value_char = ((const char *)column)[item];
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            obj_temp->value_integer = ((const int *)column)[item];
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            obj_temp->value_long = ((const long *)column)[item];
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            obj_temp->value_string = ((char * const *)column)[item];
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            obj_temp->value_buffer =
+                ((const struct t_weechat_relay_obj_buffer *)column)[item];
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            obj_temp->value_pointer = ((const void * const *)column)[item];
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            obj_temp->value_time = ((const time_t *)column)[item];
+            break;
+        default:
+            break;
+    }
+
+    return obj_temp;
+}
+
+/*
+ * Returns the object for a variable in an item of a columnar infolist: it
+ * is built with the native value on first call, then kept in the infolist.
+ *
+ * Returns the value object, NULL if error.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_obj_infolist_column_get (struct t_weechat_relay_obj_infolist *infolist,
+                                       int variable, int item)
+{
+    struct t_weechat_relay_obj **objects, **ptr_objects, *obj, *ptr_obj;
+    struct t_weechat_relay_obj obj_temp;
+    void *buffer;
+
+    ptr_objects = __atomic_load_n (&infolist->objects, __ATOMIC_ACQUIRE);
+    if (!ptr_objects)
+    {
+        objects = calloc ((size_t)infolist->schema->count * infolist->count,
+                          sizeof (*objects));
+        if (!objects)
+            return NULL;
+        /*
+         * publish the array: the infolist can be shared by threads (parsed
+         * message retained by multiple consumers), so if another thread
+         * allocated it at the same time, its array is kept
+         */
+        if (__atomic_compare_exchange_n (&infolist->objects, &ptr_objects,
+                                         objects, 0, __ATOMIC_RELEASE,
+                                         __ATOMIC_ACQUIRE))
+        {
+            ptr_objects = objects;
+        }
+        else
+        {
+            free (objects);
+        }
+    }
+
+    ptr_obj = weechat_relay_obj_infolist_column_view (infolist, variable,
+                                                      item, &obj_temp);
+    if (ptr_obj != &obj_temp)
+        return ptr_obj;
+
+    obj = weechat_relay_obj_alloc (obj_temp.type);
+    if (!obj)
+        return NULL;
+    *obj = obj_temp;
+    if ((obj->type == WEECHAT_RELAY_OBJ_TYPE_STRING) && obj_temp.value_string)
+    {
+        obj->value_string = strdup (obj_temp.value_string);
+        if (!obj->value_string)
+        {
+            free (obj);
+            return NULL;
+        }
+    }
+    else if ((obj->type == WEECHAT_RELAY_OBJ_TYPE_BUFFER)
+             && obj_temp.value_buffer.buffer)
+    {
+        buffer = malloc (obj_temp.value_buffer.length);
+        if (!buffer)
+        {
+            free (obj);
+            return NULL;
+        }
+        memcpy (buffer, obj_temp.value_buffer.buffer,
+                obj_temp.value_buffer.length);
+        obj->value_buffer.buffer = buffer;
+    }
+
+    /* same as the array: the object built by another thread is kept */
+    ptr_obj = NULL;
+    if (!__atomic_compare_exchange_n (
+            &ptr_objects[((size_t)variable * infolist->count) + item],
+            &ptr_obj, obj, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+    {
+        weechat_relay_obj_free (obj);
+        return ptr_obj;
+    }
+
+    return obj;
+}
+
+/*
+ * Gets value of a variable in an infolist item (classic or columnar
+ * infolist).
+ *
+ * Returns the value object, NULL if not found.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_obj_infolist_get (struct t_weechat_relay_obj_infolist *infolist,
+                                int item, const char *name)
+{
+    struct t_weechat_relay_obj_infolist_item *ptr_item;
+    int i;
+
+    if (!infolist || !name || (item < 0) || (item >= infolist->count))
+        return NULL;
+
+    if (!infolist->items)
+    {
+        if (!infolist->schema || !infolist->columns)
+            return NULL;
+        for (i = 0; i < infolist->schema->count; i++)
+        {
+            if (strcmp (infolist->schema->names[i], name) == 0)
+                return weechat_relay_obj_infolist_column_get (infolist, i,
+                                                              item);
+        }
+        return NULL;
+    }
+
+    ptr_item = infolist->items[item];
+    if (!ptr_item)
+        return NULL;
+    for (i = 0; i < ptr_item->count; i++)
+    {
+        if (ptr_item->variables[i]
+            && ptr_item->variables[i]->name
+            && (strcmp (ptr_item->variables[i]->name, name) == 0))
+        {
+            return ptr_item->variables[i]->value;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Marks an object as modified, searching it in "root" and its children:
+ * "root" and all objects between "root" and "obj" are marked as modified
+ * too, so that they are built again in a message instead of being copied.
+ *
+ * The flags are not atomic: "root" must not be shared with other threads
+ * (see weechat_relay_parse_msg_set_dirty).
+ *
+ * Returns:
+ *   1: object found (and marked as modified)
+ *   0: object not found
+ */
+
+int
+weechat_relay_obj_set_dirty (struct t_weechat_relay_obj *root,
+                             struct t_weechat_relay_obj *obj)
+{
+    struct t_weechat_relay_obj_infolist_item *ptr_item;
+    int i, j, found;
+
+    if (!root || !obj)
+        return 0;
+
+    found = (root == obj);
+
+    switch (root->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            for (i = 0; !found && (i < root->value_hashtable.count); i++)
+            {
+                found = weechat_relay_obj_set_dirty (
+                    root->value_hashtable.keys[i], obj)
+                    || weechat_relay_obj_set_dirty (
+                        root->value_hashtable.values[i], obj);
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            for (i = 0; !found && (i < root->value_hdata.count); i++)
+            {
+                for (j = 0; !found && (j < root->value_hdata.num_hpaths); j++)
+                {
+                    if (root->value_hdata.ppath && root->value_hdata.ppath[i])
+                    {
+                        found = weechat_relay_obj_set_dirty (
+                            root->value_hdata.ppath[i][j], obj);
+                    }
+                }
+                for (j = 0; !found && (j < root->value_hdata.num_keys); j++)
+                {
+                    if (root->value_hdata.values && root->value_hdata.values[i])
+                    {
+                        found = weechat_relay_obj_set_dirty (
+                            root->value_hdata.values[i][j], obj);
+                    }
+                }
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            for (i = 0; !found && (i < root->value_infolist.count); i++)
+            {
+                if (root->value_infolist.items)
+                {
+                    ptr_item = root->value_infolist.items[i];
+                    for (j = 0; !found && ptr_item && (j < ptr_item->count); j++)
+                    {
+                        found = weechat_relay_obj_set_dirty (
+                            ptr_item->variables[j]->value, obj);
+                    }
+                }
+                else if (root->value_infolist.schema
+                         && root->value_infolist.objects)
+                {
+                    /* only objects built can be modified */
+                    for (j = 0;
+                         !found && (j < root->value_infolist.schema->count);
+                         j++)
+                    {
+                        found = weechat_relay_obj_set_dirty (
+                            root->value_infolist.objects[
+                                ((size_t)j * root->value_infolist.count) + i],
+                            obj);
+                    }
+                }
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            for (i = 0;
+                 !found && root->value_array.values
+                     && (i < root->value_array.count);
+                 i++)
+            {
+                found = weechat_relay_obj_set_dirty (
+                    root->value_array.values[i], obj);
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (found)
+        root->dirty = 1;
+
+    return found;
+}
+
+/*
+ * Frees an item of a classic infolist.
+ */
+
+void
+weechat_relay_obj_infolist_item_free (struct t_weechat_relay_obj_infolist_item *item)
+{
+    int i;
+
+    if (!item)
+        return;
+
+    if (item->variables)
+    {
+        for (i = 0; i < item->count; i++)
+        {
+            if (item->variables[i])
+            {
+                if (item->variables[i]->name)
+                    free (item->variables[i]->name);
+                weechat_relay_obj_free (item->variables[i]->value);
+                free (item->variables[i]);
+            }
+        }
+        free (item->variables);
+    }
+
+    free (item);
+}
+
+/*
+ * Frees schema and columns of a columnar infolist.
+ */
+
+void
+weechat_relay_obj_infolist_free_columns (struct t_weechat_relay_obj_infolist *infolist)
+{
+    int i, j, num_columns;
+
+    if (!infolist)
+        return;
+
+    num_columns = (infolist->schema) ? infolist->schema->count : 0;
+
+    if (infolist->objects)
+    {
+        for (i = 0; i < num_columns * infolist->count; i++)
+        {
+            weechat_relay_obj_free (infolist->objects[i]);
+        }
+        free (infolist->objects);
+        infolist->objects = NULL;
+    }
+
+    if (infolist->columns)
+    {
+        for (i = 0; i < num_columns; i++)
+        {
+            if (!infolist->columns[i])
+                continue;
+            for (j = 0; j < infolist->count; j++)
+            {
+                if (infolist->schema->types[i] == WEECHAT_RELAY_OBJ_TYPE_STRING)
+                {
+                    free (((char **)infolist->columns[i])[j]);
+                }
+                else if (infolist->schema->types[i]
+                         == WEECHAT_RELAY_OBJ_TYPE_BUFFER)
+                {
+                    free (((struct t_weechat_relay_obj_buffer *)
+                           infolist->columns[i])[j].buffer);
+                }
+            }
+            free (infolist->columns[i]);
+        }
+        free (infolist->columns);
+        infolist->columns = NULL;
+    }
+
+    if (infolist->schema)
+    {
+        if (infolist->schema->names)
+        {
+            for (i = 0; i < num_columns; i++)
+            {
+                if (infolist->schema->names[i])
+                    free (infolist->schema->names[i]);
+            }
+            free (infolist->schema->names);
+        }
+        if (infolist->schema->types)
+            free (infolist->schema->types);
+        free (infolist->schema);
+        infolist->schema = NULL;
+    }
+}
+
 /*
  * Frees an object.
  */
@@ -122,6 +818,8 @@ weechat_relay_obj_free (struct t_weechat_relay_obj *obj)
                 free (obj->value_hashtable.keys);
             if (obj->value_hashtable.values)
                 free (obj->value_hashtable.values);
+            if (obj->value_hashtable.index)
+                free (obj->value_hashtable.index);
             break;
         case WEECHAT_RELAY_OBJ_TYPE_HDATA:
             if (obj->value_hdata.hpath)
@@ -171,6 +869,15 @@ weechat_relay_obj_free (struct t_weechat_relay_obj *obj)
                 free (obj->value_hdata.ppath);
             if (obj->value_hdata.values)
                 free (obj->value_hdata.values);
+            if (obj->value_hdata.columns)
+            {
+                for (i = 0; i < obj->value_hdata.num_keys; i++)
+                {
+                    if (obj->value_hdata.columns[i])
+                        free (obj->value_hdata.columns[i]);
+                }
+                free (obj->value_hdata.columns);
+            }
             break;
         case WEECHAT_RELAY_OBJ_TYPE_INFO:
             if (obj->value_info.name)
@@ -185,27 +892,12 @@ weechat_relay_obj_free (struct t_weechat_relay_obj *obj)
             {
                 for (i = 0; i < obj->value_infolist.count; i++)
                 {
-                    if (obj->value_infolist.items[i])
-                    {
-                        if (obj->value_infolist.items[i]->variables)
-                        {
-                            for (j = 0; j < obj->value_infolist.items[i]->count; j++)
-                            {
-                                if (obj->value_infolist.items[i]->variables[j])
-                                {
-                                    if (obj->value_infolist.items[i]->variables[j]->name)
-                                        free (obj->value_infolist.items[i]->variables[j]->name);
-                                    weechat_relay_obj_free (obj->value_infolist.items[i]->variables[j]->value);
-                                    free (obj->value_infolist.items[i]->variables[j]);
-                                }
-                            }
-                            free (obj->value_infolist.items[i]->variables);
-                        }
-                        free (obj->value_infolist.items[i]);
-                    }
+                    weechat_relay_obj_infolist_item_free (
+                        obj->value_infolist.items[i]);
                 }
                 free (obj->value_infolist.items);
             }
+            weechat_relay_obj_infolist_free_columns (&obj->value_infolist);
             break;
         case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
             if (obj->value_array.values)
@@ -217,6 +909,8 @@ weechat_relay_obj_free (struct t_weechat_relay_obj *obj)
                 }
                 free (obj->value_array.values);
             }
+            if (obj->value_array.values_native)
+                free (obj->value_array.values_native);
             break;
         case WEECHAT_RELAY_NUM_OBJ_TYPES:
             break;
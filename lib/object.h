@@ -22,8 +22,28 @@
 #ifndef WEECHAT_RELAY_OBJECT_H
 #define WEECHAT_RELAY_OBJECT_H
 
+/* minimum number of keys to use a hash index in a hashtable */
+#define WEECHAT_RELAY_OBJ_HASHTABLE_INDEX_MIN_COUNT 8
+
 extern int weechat_relay_obj_search_type (const char *obj_type);
 extern struct t_weechat_relay_obj *weechat_relay_obj_alloc (enum t_weechat_relay_obj_type type);
+extern uint64_t weechat_relay_obj_hash_integer (uint64_t value);
+extern uint64_t weechat_relay_obj_hash_key (const struct t_weechat_relay_obj *key);
+extern int weechat_relay_obj_key_equal (const struct t_weechat_relay_obj *key1,
+                                        const struct t_weechat_relay_obj *key2);
+extern int weechat_relay_obj_hashtable_build_index (struct t_weechat_relay_obj_hashtable *hashtable);
+extern int weechat_relay_obj_hashtable_search (struct t_weechat_relay_obj_hashtable *hashtable,
+                                               const struct t_weechat_relay_obj *key);
+extern int weechat_relay_obj_set_dirty (struct t_weechat_relay_obj *root,
+                                        struct t_weechat_relay_obj *obj);
+extern size_t weechat_relay_obj_infolist_column_size (enum t_weechat_relay_obj_type type);
+extern struct t_weechat_relay_obj *weechat_relay_obj_infolist_column_view (const struct t_weechat_relay_obj_infolist *infolist,
+                                                                           int variable, int item,
+                                                                           struct t_weechat_relay_obj *obj_temp);
+extern struct t_weechat_relay_obj *weechat_relay_obj_infolist_column_get (struct t_weechat_relay_obj_infolist *infolist,
+                                                                          int variable, int item);
+extern void weechat_relay_obj_infolist_item_free (struct t_weechat_relay_obj_infolist_item *item);
+extern void weechat_relay_obj_infolist_free_columns (struct t_weechat_relay_obj_infolist *infolist);
 extern void weechat_relay_obj_free (struct t_weechat_relay_obj *obj);
 
 #endif /* WEECHAT_RELAY_OBJECT_H */
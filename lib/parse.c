@@ -25,18 +25,142 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 #include <arpa/inet.h>
 
 #include <zlib.h>
 #include <zstd.h>
 
 #include "weechat-relay.h"
+#include "decode.h"
+#include "dispatch.h"
 #include "object.h"
 #include "parse.h"
+#include "value.h"
 
 
 /*
- * Reads bytes in message.
+ * Returns the total size of segments (in bytes).
+ */
+
+size_t
+weechat_relay_parse_iov_size (const struct iovec *iov, int iovcnt)
+{
+    size_t size;
+    int i;
+
+    if (!iov)
+        return 0;
+
+    size = 0;
+    for (i = 0; i < iovcnt; i++)
+    {
+        size += iov[i].iov_len;
+    }
+
+    return size;
+}
+
+/*
+ * Searches the segment which contains the byte at "offset", starting with
+ * segment "*index" which begins at "*start" (both are updated, so that
+ * successive reads do not scan the segments from the beginning).
+ *
+ * Returns:
+ *   1: OK
+ *   0: offset is after the last segment
+ */
+
+int
+weechat_relay_parse_iov_seek (const struct iovec *iov, int iovcnt,
+                              int *index, size_t *start, size_t offset)
+{
+    if (offset < *start)
+    {
+        *index = 0;
+        *start = 0;
+    }
+
+    while ((*index < iovcnt) && (offset >= *start + iov[*index].iov_len))
+    {
+        *start += iov[*index].iov_len;
+        (*index)++;
+    }
+
+    return (*index < iovcnt) ? 1 : 0;
+}
+
+/*
+ * Copies "count" bytes at "offset" in segments to "output" (the bytes can
+ * be split between multiple segments); "*index" and "*start" are the
+ * current segment and its position (see weechat_relay_parse_iov_seek).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough bytes in segments)
+ */
+
+int
+weechat_relay_parse_iov_copy (const struct iovec *iov, int iovcnt,
+                              int *index, size_t *start, size_t offset,
+                              void *output, size_t count)
+{
+    size_t offset_segment, length;
+
+    while (count > 0)
+    {
+        if (!weechat_relay_parse_iov_seek (iov, iovcnt, index, start, offset))
+            return 0;
+        offset_segment = offset - *start;
+        length = iov[*index].iov_len - offset_segment;
+        if (length > count)
+            length = count;
+        memcpy (output, (const char *)iov[*index].iov_base + offset_segment,
+                length);
+        output = (char *)output + length;
+        offset += length;
+        count -= length;
+    }
+
+    return 1;
+}
+
+/*
+ * Returns a pointer to "count" contiguous bytes at current position in
+ * message, without moving the position, NULL if bytes are split between
+ * segments (message parsed from segments).
+ *
+ * Note: the caller must check that there are enough bytes remaining in
+ * message.
+ */
+
+const void *
+weechat_relay_parse_get_bytes (struct t_weechat_relay_parsed_msg *parsed_msg,
+                               size_t count)
+{
+    size_t offset_segment;
+
+    if (!parsed_msg->iov)
+        return (const char *)parsed_msg->buffer + parsed_msg->position;
+
+    if (!weechat_relay_parse_iov_seek (parsed_msg->iov, parsed_msg->iovcnt,
+                                       &parsed_msg->iov_index,
+                                       &parsed_msg->iov_start,
+                                       parsed_msg->position))
+    {
+        return NULL;
+    }
+
+    offset_segment = parsed_msg->position - parsed_msg->iov_start;
+    if (offset_segment + count > parsed_msg->iov[parsed_msg->iov_index].iov_len)
+        return NULL;
+
+    return (const char *)parsed_msg->iov[parsed_msg->iov_index].iov_base
+        + offset_segment;
+}
+
+/*
+ * Reads bytes in message, without moving the position.
  *
  * Returns:
  *   1: OK
@@ -44,7 +168,7 @@
  */
 
 int
-weechat_relay_parse_read_bytes (struct t_weechat_relay_parsed_msg *parsed_msg,
+weechat_relay_parse_peek_bytes (struct t_weechat_relay_parsed_msg *parsed_msg,
                                 void *output, size_t count)
 {
     if (!parsed_msg || !output)
@@ -56,12 +180,38 @@ weechat_relay_parse_read_bytes (struct t_weechat_relay_parsed_msg *parsed_msg,
     if (parsed_msg->position + count > parsed_msg->size)
         return 0;
 
-    if (count > 0)
+    if (parsed_msg->iov)
     {
-        memcpy (output, parsed_msg->buffer + parsed_msg->position, count);
-        parsed_msg->position += count;
+        return weechat_relay_parse_iov_copy (parsed_msg->iov,
+                                             parsed_msg->iovcnt,
+                                             &parsed_msg->iov_index,
+                                             &parsed_msg->iov_start,
+                                             parsed_msg->position,
+                                             output, count);
     }
 
+    memcpy (output, parsed_msg->buffer + parsed_msg->position, count);
+
+    return 1;
+}
+
+/*
+ * Reads bytes in message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough bytes remaining in buffer)
+ */
+
+int
+weechat_relay_parse_read_bytes (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                void *output, size_t count)
+{
+    if (!weechat_relay_parse_peek_bytes (parsed_msg, output, count))
+        return 0;
+
+    parsed_msg->position += count;
+
     return 1;
 }
 
@@ -166,6 +316,94 @@ error:
     return 0;
 }
 
+/*
+ * Reads id of message (4 bytes + content), with a parse context (can be
+ * NULL).
+ *
+ * The id of a WeeChat event is not allocated: it points to a static string
+ * (and field "event" is set); a custom id interned in the dispatcher of
+ * parse context points to the string of dispatcher, with a reference held
+ * by the message (and field "id_custom" is set); any other id is allocated.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough bytes remaining in buffer)
+ */
+
+int
+weechat_relay_parse_read_id (struct t_weechat_relay_parse_ctx *ctx,
+                             struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    const char *ptr_id;
+    char *id_copy;
+    int length, index;
+
+    if (!parsed_msg)
+        return 0;
+
+    if (!weechat_relay_parse_read_integer (parsed_msg, &length))
+        return 0;
+    if (length < 0)
+        return 1;
+
+    if (parsed_msg->position + length > parsed_msg->size)
+        return 0;
+
+    id_copy = NULL;
+    ptr_id = weechat_relay_parse_get_bytes (parsed_msg, length);
+    if (!ptr_id)
+    {
+        /* id is split between segments */
+        id_copy = malloc (length + 1);
+        if (!id_copy)
+            return 0;
+        if (!weechat_relay_parse_peek_bytes (parsed_msg, id_copy, length))
+        {
+            free (id_copy);
+            return 0;
+        }
+        id_copy[length] = '\0';
+        ptr_id = id_copy;
+    }
+
+    parsed_msg->event = weechat_relay_dispatch_search_event (ptr_id, length);
+    if (parsed_msg->event != WEECHAT_RELAY_EVENT_NONE)
+    {
+        parsed_msg->id = (char *)weechat_relay_event_string[parsed_msg->event];
+    }
+    else
+    {
+        index = (ctx) ?
+            weechat_relay_dispatch_search_id (ctx->dispatch, ptr_id, length) : -1;
+        if (index >= 0)
+        {
+            parsed_msg->id = ctx->dispatch->ids[index];
+            parsed_msg->id_custom = index + 1;
+            weechat_relay_dispatch_id_ref (parsed_msg->id);
+        }
+        else if (id_copy)
+        {
+            parsed_msg->id = id_copy;
+            id_copy = NULL;
+        }
+        else
+        {
+            parsed_msg->id = malloc (length + 1);
+            if (!parsed_msg->id)
+                return 0;
+            memcpy (parsed_msg->id, ptr_id, length);
+            parsed_msg->id[length] = '\0';
+        }
+    }
+
+    if (id_copy)
+        free (id_copy);
+
+    parsed_msg->position += length;
+
+    return 1;
+}
+
 /*
  * Reads buffer in message (4 bytes + content).
  *
@@ -242,6 +480,77 @@ weechat_relay_parse_read_pointer (struct t_weechat_relay_parsed_msg *parsed_msg,
     return 0;
 }
 
+/*
+ * Reads a long integer in message (1 byte + content).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough bytes remaining in buffer or invalid number)
+ */
+
+int
+weechat_relay_parse_read_long (struct t_weechat_relay_parsed_msg *parsed_msg,
+                               long *value)
+{
+    unsigned char length;
+    char str_long[256];
+    int rc;
+
+    if (!parsed_msg || !value)
+        return 0;
+
+    if (!weechat_relay_parse_read_bytes (parsed_msg, &length, 1))
+        return 0;
+
+    if (!weechat_relay_parse_read_bytes (parsed_msg, str_long, length))
+        return 0;
+
+    str_long[length] = '\0';
+
+    rc = sscanf (str_long, "%ld", value);
+    if ((rc == EOF) || (rc == 0))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * Reads a time in message (1 byte + content).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough bytes remaining in buffer or invalid number)
+ */
+
+int
+weechat_relay_parse_read_time (struct t_weechat_relay_parsed_msg *parsed_msg,
+                               time_t *time)
+{
+    unsigned char length;
+    char str_time[256];
+    unsigned long value;
+    int rc;
+
+    if (!parsed_msg || !time)
+        return 0;
+
+    if (!weechat_relay_parse_read_bytes (parsed_msg, &length, 1))
+        return 0;
+
+    if (!weechat_relay_parse_read_bytes (parsed_msg, str_time, length))
+        return 0;
+
+    str_time[length] = '\0';
+
+    rc = sscanf (str_time, "%lu", &value);
+    if ((rc == EOF) || (rc == 0))
+        return 0;
+
+    *time = value;
+
+    return 1;
+}
+
 /*
  * Reads a char object in message (1 byte).
  *
@@ -310,10 +619,6 @@ struct t_weechat_relay_obj *
 weechat_relay_parse_obj_long (struct t_weechat_relay_parsed_msg *parsed_msg)
 {
     struct t_weechat_relay_obj *obj;
-    unsigned char length;
-    char str_long[256];
-    long value;
-    int rc;
 
     if (!parsed_msg)
         return NULL;
@@ -322,20 +627,9 @@ weechat_relay_parse_obj_long (struct t_weechat_relay_parsed_msg *parsed_msg)
     if (!obj)
         goto error;
 
-    if (!weechat_relay_parse_read_bytes (parsed_msg, &length, 1))
-        goto error;
-
-    if (!weechat_relay_parse_read_bytes (parsed_msg, str_long, length))
-        goto error;
-
-    str_long[length] = '\0';
-
-    rc = sscanf (str_long, "%ld", &value);
-    if ((rc == EOF) || (rc == 0))
+    if (!weechat_relay_parse_read_long (parsed_msg, &obj->value_long))
         goto error;
 
-    obj->value_long = value;
-
     return obj;
 
 error:
@@ -445,10 +739,6 @@ struct t_weechat_relay_obj *
 weechat_relay_parse_obj_time (struct t_weechat_relay_parsed_msg *parsed_msg)
 {
     struct t_weechat_relay_obj *obj;
-    unsigned char length;
-    char str_time[256];
-    unsigned long value;
-    int rc;
 
     if (!parsed_msg)
         return NULL;
@@ -457,20 +747,9 @@ weechat_relay_parse_obj_time (struct t_weechat_relay_parsed_msg *parsed_msg)
     if (!obj)
         goto error;
 
-    if (!weechat_relay_parse_read_bytes (parsed_msg, &length, 1))
-        goto error;
-
-    if (!weechat_relay_parse_read_bytes (parsed_msg, str_time, length))
-        goto error;
-
-    str_time[length] = '\0';
-
-    rc = sscanf (str_time, "%lu", &value);
-    if ((rc == EOF) || (rc == 0))
+    if (!weechat_relay_parse_read_time (parsed_msg, &obj->value_time))
         goto error;
 
-    obj->value_time = value;
-
     return obj;
 
 error:
@@ -480,16 +759,17 @@ error:
 }
 
 /*
- * Reads a hashtable object in message (variable length).
+ * Reads the beginning of a hashtable object in message: types of keys and
+ * values, count; entries are allocated but not read (see
+ * weechat_relay_parse_hashtable_items).
  *
  * Returns the hashtable object, NULL if error.
  */
 
 struct t_weechat_relay_obj *
-weechat_relay_parse_obj_hashtable (struct t_weechat_relay_parsed_msg *parsed_msg)
+weechat_relay_parse_hashtable_start (struct t_weechat_relay_parsed_msg *parsed_msg)
 {
     struct t_weechat_relay_obj *obj;
-    int i;
 
     if (!parsed_msg)
         return NULL;
@@ -519,18 +799,6 @@ weechat_relay_parse_obj_hashtable (struct t_weechat_relay_parsed_msg *parsed_msg
     if (!obj->value_hashtable.values)
         goto error;
 
-    for (i = 0; i < obj->value_hashtable.count; i++)
-    {
-        obj->value_hashtable.keys[i] = weechat_relay_parse_read_object (
-            parsed_msg, obj->value_hashtable.type_keys);
-        if (!obj->value_hashtable.keys[i])
-            goto error;
-        obj->value_hashtable.values[i] = weechat_relay_parse_read_object (
-            parsed_msg, obj->value_hashtable.type_values);
-        if (!obj->value_hashtable.values[i])
-            goto error;
-    }
-
     return obj;
 
 error:
@@ -540,7 +808,11 @@ error:
 }
 
 /*
- * Splits hpath in a hdata object.
+ * Reads "count" entries of a hashtable object in message, starting at entry
+ * "start" (entries must be read in order).
+ *
+ * On error, the entry being read is cleared (the entries before are kept),
+ * so that it can be read again.
  *
  * Returns:
  *   1: OK
@@ -548,39 +820,31 @@ error:
  */
 
 int
-weechat_relay_parse_hdata_split_hpath (const char *hpath,
-                                       char ***hpaths, int *num_hpaths)
+weechat_relay_parse_hashtable_items (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                     struct t_weechat_relay_obj_hashtable *hashtable,
+                                     int start, int count)
 {
-    const char *ptr_hpath, *pos_slash;
     int i;
 
-    if (!hpath || !hpaths || !num_hpaths)
-        return 0;
-
-    *num_hpaths = 1;
-    for (i = 0; hpath[i]; i++)
+    if (!parsed_msg || !hashtable || (start < 0) || (count < 0)
+        || (start + count > hashtable->count))
     {
-        if (hpath[i] == '/')
-            (*num_hpaths)++;
-    }
-
-    *hpaths = calloc (*num_hpaths, sizeof (char *));
-    if (!*hpaths)
         return 0;
+    }
 
-    ptr_hpath = hpath;
-    for (i = 0; i < *num_hpaths; i++)
+    for (i = start; i < start + count; i++)
     {
-        pos_slash = strchr (ptr_hpath, '/');
-        if (pos_slash)
+        hashtable->keys[i] = weechat_relay_parse_read_object (
+            parsed_msg, hashtable->type_keys);
+        if (!hashtable->keys[i])
+            return 0;
+        hashtable->values[i] = weechat_relay_parse_read_object (
+            parsed_msg, hashtable->type_values);
+        if (!hashtable->values[i])
         {
-            (*hpaths)[i] = strndup (ptr_hpath, pos_slash - ptr_hpath);
-            ptr_hpath = pos_slash + 1;
-        }
-        else
-        {
-            (*hpaths)[i] = strdup (ptr_hpath);
-            ptr_hpath += strlen (ptr_hpath);
+            weechat_relay_obj_free (hashtable->keys[i]);
+            hashtable->keys[i] = NULL;
+            return 0;
         }
     }
 
@@ -588,17 +852,109 @@ weechat_relay_parse_hdata_split_hpath (const char *hpath,
 }
 
 /*
- * Splits keys in a hdata object.
- *
- * Returns:
- *   1: OK
- *   0: error
+ * Ends the read of a hashtable object, after all entries have been read:
+ * builds the hash index (parser flag HASHTABLE_INDEX).
  */
 
-int
-weechat_relay_parse_hdata_split_keys (const char *keys,
-                                      char ***keys_names,
-                                      enum t_weechat_relay_obj_type **keys_types,
+void
+weechat_relay_parse_hashtable_end (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                   struct t_weechat_relay_obj_hashtable *hashtable)
+{
+    /* index is optional: if it can not be built, keys are searched linearly */
+    if ((parsed_msg->flags & WEECHAT_RELAY_PARSE_FLAG_HASHTABLE_INDEX)
+        && (hashtable->count >= WEECHAT_RELAY_OBJ_HASHTABLE_INDEX_MIN_COUNT))
+    {
+        weechat_relay_obj_hashtable_build_index (hashtable);
+    }
+}
+
+/*
+ * Reads a hashtable object in message (variable length).
+ *
+ * Returns the hashtable object, NULL if error.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_parse_obj_hashtable (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_obj *obj;
+
+    obj = weechat_relay_parse_hashtable_start (parsed_msg);
+    if (!obj)
+        return NULL;
+
+    if (!weechat_relay_parse_hashtable_items (parsed_msg, &obj->value_hashtable,
+                                              0, obj->value_hashtable.count))
+    {
+        weechat_relay_obj_free (obj);
+        return NULL;
+    }
+
+    weechat_relay_parse_hashtable_end (parsed_msg, &obj->value_hashtable);
+
+    return obj;
+}
+
+/*
+ * Splits hpath in a hdata object.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_parse_hdata_split_hpath (const char *hpath,
+                                       char ***hpaths, int *num_hpaths)
+{
+    const char *ptr_hpath, *pos_slash;
+    int i;
+
+    if (!hpath || !hpaths || !num_hpaths)
+        return 0;
+
+    *num_hpaths = 1;
+    for (i = 0; hpath[i]; i++)
+    {
+        if (hpath[i] == '/')
+            (*num_hpaths)++;
+    }
+
+    *hpaths = calloc (*num_hpaths, sizeof (char *));
+    if (!*hpaths)
+        return 0;
+
+    ptr_hpath = hpath;
+    for (i = 0; i < *num_hpaths; i++)
+    {
+        pos_slash = strchr (ptr_hpath, '/');
+        if (pos_slash)
+        {
+            (*hpaths)[i] = strndup (ptr_hpath, pos_slash - ptr_hpath);
+            ptr_hpath = pos_slash + 1;
+        }
+        else
+        {
+            (*hpaths)[i] = strdup (ptr_hpath);
+            ptr_hpath += strlen (ptr_hpath);
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Splits keys in a hdata object.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_parse_hdata_split_keys (const char *keys,
+                                      char ***keys_names,
+                                      enum t_weechat_relay_obj_type **keys_types,
                                       int *num_keys)
 {
     const char *ptr_keys, *pos_comma, *pos_colon;
@@ -688,16 +1044,73 @@ error:
 }
 
 /*
- * Reads a hdata object in message (variable length).
+ * Allocates native columns in a hdata for keys of type "int" and "chr"
+ * (hdata keys and count must be set).
+ *
+ * Returns:
+ *   1: OK, columns allocated
+ *   0: no native column (no key of type "int" or "chr", or no object)
+ *  -1: error
+ */
+
+int
+weechat_relay_parse_hdata_alloc_columns (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                         struct t_weechat_relay_obj_hdata *hdata)
+{
+    int i, num_columns;
+
+    if (!parsed_msg || !hdata)
+        return -1;
+
+    if (hdata->count <= 0)
+        return 0;
+
+    num_columns = 0;
+    for (i = 0; i < hdata->num_keys; i++)
+    {
+        if ((hdata->keys_types[i] == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+            || (hdata->keys_types[i] == WEECHAT_RELAY_OBJ_TYPE_INTEGER))
+        {
+            num_columns++;
+        }
+    }
+    if (num_columns == 0)
+        return 0;
+
+    /* each row has at least one byte per native column */
+    if ((size_t)hdata->count * num_columns > parsed_msg->size - parsed_msg->position)
+        return -1;
+
+    hdata->columns = calloc (hdata->num_keys, sizeof (*hdata->columns));
+    if (!hdata->columns)
+        return -1;
+
+    for (i = 0; i < hdata->num_keys; i++)
+    {
+        if (hdata->keys_types[i] == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+            hdata->columns[i] = malloc (hdata->count);
+        else if (hdata->keys_types[i] == WEECHAT_RELAY_OBJ_TYPE_INTEGER)
+            hdata->columns[i] = malloc (hdata->count * sizeof (int));
+        else
+            continue;
+        if (!hdata->columns[i])
+            return -1;
+    }
+
+    return 1;
+}
+
+/*
+ * Reads the beginning of a hdata object in message: hpath, keys and count;
+ * rows are allocated but not read (see weechat_relay_parse_hdata_rows).
  *
  * Returns the hdata object, NULL if error.
  */
 
 struct t_weechat_relay_obj *
-weechat_relay_parse_obj_hdata (struct t_weechat_relay_parsed_msg *parsed_msg)
+weechat_relay_parse_hdata_start (struct t_weechat_relay_parsed_msg *parsed_msg)
 {
-    struct t_weechat_relay_obj *obj, *obj2;
-    int i, j;
+    struct t_weechat_relay_obj *obj;
 
     if (!parsed_msg)
         return NULL;
@@ -738,43 +1151,163 @@ weechat_relay_parse_obj_hdata (struct t_weechat_relay_parsed_msg *parsed_msg)
     if (!obj->value_hdata.values)
         goto error;
 
-    for (i = 0; i < obj->value_hdata.count; i++)
+    if ((parsed_msg->flags & WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS)
+        && (weechat_relay_parse_hdata_alloc_columns (parsed_msg,
+                                                     &obj->value_hdata) < 0))
+    {
+        goto error;
+    }
+
+    return obj;
+
+error:
+    if (obj)
+        weechat_relay_obj_free (obj);
+    return NULL;
+}
+
+/*
+ * Reads "count" rows of a hdata object in message, starting at row "start"
+ * (rows must be read in order).
+ *
+ * On error, the row being read is cleared (the rows before are kept), so
+ * that it can be read again.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_parse_hdata_rows (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                struct t_weechat_relay_obj_hdata *hdata,
+                                int start, int count)
+{
+    struct t_weechat_relay_obj *obj2;
+    size_t size_value;
+    int i, j;
+
+    if (!parsed_msg || !hdata || (start < 0) || (count < 0)
+        || (start + count > hdata->count))
+    {
+        return 0;
+    }
+
+    for (i = start; i < start + count; i++)
     {
-        obj->value_hdata.ppath[i] = calloc (
-            obj->value_hdata.num_hpaths,
-            sizeof (*(obj->value_hdata.ppath[i])));
-        if (!obj->value_hdata.ppath[i])
+        hdata->ppath[i] = calloc (hdata->num_hpaths,
+                                  sizeof (*(hdata->ppath[i])));
+        if (!hdata->ppath[i])
             goto error;
-        for (j = 0; j < obj->value_hdata.num_hpaths; j++)
+        for (j = 0; j < hdata->num_hpaths; j++)
         {
             obj2 = weechat_relay_parse_read_object (parsed_msg,
                                                     WEECHAT_RELAY_OBJ_TYPE_POINTER);
             if (!obj2)
                 goto error;
-            obj->value_hdata.ppath[i][j] = obj2;
+            hdata->ppath[i][j] = obj2;
         }
 
-        obj->value_hdata.values[i] = calloc (
-            obj->value_hdata.num_keys,
-            sizeof (*(obj->value_hdata.values[i])));
-        if (!obj->value_hdata.values[i])
+        hdata->values[i] = calloc (hdata->num_keys,
+                                   sizeof (*(hdata->values[i])));
+        if (!hdata->values[i])
             goto error;
-        for (j = 0; j < obj->value_hdata.num_keys; j++)
+        for (j = 0; j < hdata->num_keys; j++)
         {
+            if (hdata->columns && hdata->columns[j])
+            {
+                /* raw copy, integers are decoded at the end */
+                size_value = (hdata->keys_types[j] == WEECHAT_RELAY_OBJ_TYPE_CHAR) ?
+                    1 : 4;
+                if (!weechat_relay_parse_read_bytes (
+                        parsed_msg,
+                        (char *)hdata->columns[j] + (i * size_value),
+                        size_value))
+                    goto error;
+                continue;
+            }
             obj2 = weechat_relay_parse_read_object (parsed_msg,
-                                                    obj->value_hdata.keys_types[j]);
+                                                    hdata->keys_types[j]);
             if (!obj2)
                 goto error;
-            obj->value_hdata.values[i][j] = obj2;
+            hdata->values[i][j] = obj2;
         }
     }
 
-    return obj;
+    return 1;
 
 error:
-    if (obj)
+    if (hdata->ppath[i])
+    {
+        for (j = 0; j < hdata->num_hpaths; j++)
+        {
+            weechat_relay_obj_free (hdata->ppath[i][j]);
+        }
+        free (hdata->ppath[i]);
+        hdata->ppath[i] = NULL;
+    }
+    if (hdata->values[i])
+    {
+        for (j = 0; j < hdata->num_keys; j++)
+        {
+            weechat_relay_obj_free (hdata->values[i][j]);
+        }
+        free (hdata->values[i]);
+        hdata->values[i] = NULL;
+    }
+    return 0;
+}
+
+/*
+ * Ends the read of a hdata object, after all rows have been read: decodes
+ * the integers in native columns.
+ */
+
+void
+weechat_relay_parse_hdata_end (struct t_weechat_relay_obj_hdata *hdata)
+{
+    int j;
+
+    if (!hdata || !hdata->columns)
+        return;
+
+    for (j = 0; j < hdata->num_keys; j++)
+    {
+        if (hdata->columns[j]
+            && (hdata->keys_types[j] == WEECHAT_RELAY_OBJ_TYPE_INTEGER))
+        {
+            weechat_relay_decode_integers (hdata->columns[j],
+                                           hdata->columns[j],
+                                           hdata->count);
+        }
+    }
+}
+
+/*
+ * Reads a hdata object in message (variable length).
+ *
+ * Returns the hdata object, NULL if error.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_parse_obj_hdata (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_obj *obj;
+
+    obj = weechat_relay_parse_hdata_start (parsed_msg);
+    if (!obj)
+        return NULL;
+
+    if (!weechat_relay_parse_hdata_rows (parsed_msg, &obj->value_hdata,
+                                         0, obj->value_hdata.count))
+    {
         weechat_relay_obj_free (obj);
-    return NULL;
+        return NULL;
+    }
+
+    weechat_relay_parse_hdata_end (&obj->value_hdata);
+
+    return obj;
 }
 
 /*
@@ -809,545 +1342,3214 @@ error:
 }
 
 /*
- * Reads an infolist object in message (variable length).
+ * Reads a string in message and compares it with "string", without
+ * allocating the string read.
  *
- * Returns the infolist object, NULL if error.
+ * Returns:
+ *   1: string read is equal to "string"
+ *   0: strings are different or error (not enough bytes remaining in buffer)
  */
 
-struct t_weechat_relay_obj *
-weechat_relay_parse_obj_infolist (struct t_weechat_relay_parsed_msg *parsed_msg)
+int
+weechat_relay_parse_match_string (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                  const char *string)
 {
-    struct t_weechat_relay_obj *obj;
-    enum t_weechat_relay_obj_type type;
-    int i, j;
+    const void *ptr_string;
+    void *string_copy;
+    int length, rc;
 
-    if (!parsed_msg)
-        return NULL;
-
-    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INFOLIST);
-    if (!obj)
-        goto error;
-
-    if (!weechat_relay_parse_read_string (parsed_msg, &obj->value_infolist.name))
-        goto error;
-    if (!weechat_relay_parse_read_integer (parsed_msg, &obj->value_infolist.count))
-        goto error;
-    if (obj->value_infolist.count < 0)
-        goto error;
+    if (!parsed_msg || !string)
+        return 0;
 
-    obj->value_infolist.items = calloc (obj->value_infolist.count,
-                                        sizeof (*obj->value_infolist.items));
-    if (!obj->value_infolist.items)
-        goto error;
+    if (!weechat_relay_parse_read_integer (parsed_msg, &length))
+        return 0;
+    if ((length < 0) || ((size_t)length != strlen (string)))
+        return 0;
+    if (parsed_msg->position + length > parsed_msg->size)
+        return 0;
 
-    for (i = 0; i < obj->value_infolist.count; i++)
+    ptr_string = weechat_relay_parse_get_bytes (parsed_msg, length);
+    if (ptr_string)
     {
-        obj->value_infolist.items[i] = calloc (1, sizeof (*(obj->value_infolist.items[i])));
-        if (!obj->value_infolist.items[i])
-            goto error;
-        if (!weechat_relay_parse_read_integer (parsed_msg, &obj->value_infolist.items[i]->count))
-            goto error;
-        if (obj->value_infolist.items[i]->count < 0)
-            goto error;
-        obj->value_infolist.items[i]->variables = calloc (
-            obj->value_infolist.items[i]->count,
-            sizeof (*(obj->value_infolist.items[i]->variables)));
-        for (j = 0; j < obj->value_infolist.items[i]->count; j++)
-        {
-            obj->value_infolist.items[i]->variables[j] = calloc (
-                1,
-                sizeof (*obj->value_infolist.items[i]->variables[j]));
-            if (!obj->value_infolist.items[i]->variables[j])
-                goto error;
-            if (!weechat_relay_parse_read_string (parsed_msg, &obj->value_infolist.items[i]->variables[j]->name))
-                goto error;
-            if (!weechat_relay_parse_read_type (parsed_msg, &type))
-                goto error;
-            obj->value_infolist.items[i]->variables[j]->value = weechat_relay_parse_read_object (parsed_msg, type);
-        }
+        rc = (memcmp (ptr_string, string, length) == 0);
     }
+    else
+    {
+        /* string is split between segments */
+        string_copy = malloc (length);
+        if (!string_copy)
+            return 0;
+        rc = weechat_relay_parse_peek_bytes (parsed_msg, string_copy, length)
+            && (memcmp (string_copy, string, length) == 0);
+        free (string_copy);
+    }
+    if (!rc)
+        return 0;
+    parsed_msg->position += length;
 
-    return obj;
-
-error:
-    if (obj)
-        weechat_relay_obj_free (obj);
-    return NULL;
+    return 1;
 }
 
 /*
- * Reads an array object in message (variable length).
+ * Reads a value of a variable in a native column of infolist.
  *
- * Returns the array object, NULL if error.
+ * Returns:
+ *   1: OK
+ *   0: error
  */
 
-struct t_weechat_relay_obj *
-weechat_relay_parse_obj_array (struct t_weechat_relay_parsed_msg *parsed_msg)
+int
+weechat_relay_parse_infolist_column_value (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                           enum t_weechat_relay_obj_type type,
+                                           void *column, int item)
 {
-    struct t_weechat_relay_obj *obj;
-    int i;
-
-    if (!parsed_msg)
-        return NULL;
-
-    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_ARRAY);
-    if (!obj)
-        goto error;
-
-    if (!weechat_relay_parse_read_type (parsed_msg, &obj->value_array.type))
-        goto error;
-
-    if (!weechat_relay_parse_read_integer (parsed_msg, &obj->value_array.count))
-        goto error;
-    if (obj->value_array.count < 0)
-        goto error;
-
-    obj->value_array.values = calloc (obj->value_array.count,
-                                      sizeof (*obj->value_array.values));
-    if (!obj->value_array.values)
-        goto error;
-
-    for (i = 0; i < obj->value_array.count; i++)
-    {
-        obj->value_array.values[i] = weechat_relay_parse_read_object (
-            parsed_msg,
-            obj->value_array.type);
-        if (!obj->value_array.values[i])
-            goto error;
-    }
-
-    return obj;
-
-error:
-    if (obj)
-        weechat_relay_obj_free (obj);
-    return NULL;
-}
-
-/*
- * Reads an object in a message.
- *
- * Returns the object, NULL if error.
- */
-
-struct t_weechat_relay_obj *
-weechat_relay_parse_read_object (struct t_weechat_relay_parsed_msg *parsed_msg,
-                                 enum t_weechat_relay_obj_type type)
-{
-    struct t_weechat_relay_obj *obj;
-
-    if (!parsed_msg)
-        return NULL;
-
-    obj = NULL;
+    struct t_weechat_relay_obj_buffer *ptr_buffer;
 
     switch (type)
     {
         case WEECHAT_RELAY_OBJ_TYPE_CHAR:
-            obj = weechat_relay_parse_obj_char (parsed_msg);
-            break;
+            return weechat_relay_parse_read_bytes (parsed_msg,
+                                                   (char *)column + item, 1);
         case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
-            obj = weechat_relay_parse_obj_integer (parsed_msg);
-            break;
+            return weechat_relay_parse_read_integer (parsed_msg,
+                                                     (int *)column + item);
         case WEECHAT_RELAY_OBJ_TYPE_LONG:
-            obj = weechat_relay_parse_obj_long (parsed_msg);
-            break;
+            return weechat_relay_parse_read_long (parsed_msg,
+                                                  (long *)column + item);
         case WEECHAT_RELAY_OBJ_TYPE_STRING:
-            obj = weechat_relay_parse_obj_string (parsed_msg);
-            break;
+            return weechat_relay_parse_read_string (parsed_msg,
+                                                    (char **)column + item);
         case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
-            obj = weechat_relay_parse_obj_buffer (parsed_msg);
-            break;
+            ptr_buffer = (struct t_weechat_relay_obj_buffer *)column + item;
+            return weechat_relay_parse_read_buffer (parsed_msg,
+                                                    &ptr_buffer->buffer,
+                                                    &ptr_buffer->length);
         case WEECHAT_RELAY_OBJ_TYPE_POINTER:
-            obj = weechat_relay_parse_obj_pointer (parsed_msg);
-            break;
+            return weechat_relay_parse_read_pointer (
+                parsed_msg, (const void **)column + item);
         case WEECHAT_RELAY_OBJ_TYPE_TIME:
-            obj = weechat_relay_parse_obj_time (parsed_msg);
-            break;
-        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
-            obj = weechat_relay_parse_obj_hashtable (parsed_msg);
-            break;
-        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
-            obj = weechat_relay_parse_obj_hdata (parsed_msg);
-            break;
-        case WEECHAT_RELAY_OBJ_TYPE_INFO:
-            obj = weechat_relay_parse_obj_info (parsed_msg);
-            break;
-        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
-            obj = weechat_relay_parse_obj_infolist (parsed_msg);
-            break;
-        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
-            obj = weechat_relay_parse_obj_array (parsed_msg);
-            break;
-        case WEECHAT_RELAY_NUM_OBJ_TYPES:
+            return weechat_relay_parse_read_time (parsed_msg,
+                                                  (time_t *)column + item);
+        default:
             break;
     }
 
-    return obj;
+    return 0;
 }
 
 /*
- * Decompresses data with zlib.
+ * Reads "count" items of an infolist in columns, starting at item "start"
+ * (items must be read in order); the schema and columns are built with the
+ * first item.
  *
- * The variable "size_decompressed" is set with the size of decompressed
- * buffer returned (in bytes).
+ * Values are stored in native columns: no object is allocated for them.
  *
- * The initial output size must be set to an estimate output size, but the
- * output buffer size ("size_decompressed") can be higher.
- * A typical value here could be 10 * size if we estimate zlib can compress
- * data with a 90% ratio (which is excellent).
+ * On error, the values of the item being read are cleared (the items before
+ * are kept), so that it can be read again (or the infolist read with the
+ * classic representation, after weechat_relay_obj_infolist_free_columns).
  *
- * Returns a pointer to the decompressed message, NULL if error.
+ * Returns:
+ *   1: OK
+ *   0: error (or item with other variables than the first one)
  */
 
-void *
-weechat_relay_parse_decompress_zlib (const void *data, size_t size,
-                                     size_t initial_output_size,
-                                     size_t *size_decompressed)
+int
+weechat_relay_parse_infolist_columns_items (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                            struct t_weechat_relay_obj_infolist *infolist,
+                                            int start, int count)
 {
-    int rc;
-    Bytef *dest, *dest2;
-    uLongf dest_size, dest_size_alloc, source_size, pct_used, pct_to_add;
-    uLongf size_to_add;
+    struct t_weechat_relay_obj_infolist_schema *schema;
+    enum t_weechat_relay_obj_type type;
+    size_t size_value;
+    int i, j, num_vars;
 
-    if (!data || (size == 0) || (initial_output_size == 0)
-        || !size_decompressed)
+    if (!parsed_msg || !infolist || (start < 0) || (count < 0)
+        || (start + count > infolist->count)
+        || ((start > 0) && !infolist->schema))
     {
-        return NULL;
+        return 0;
     }
 
-    dest = NULL;
-
-    *size_decompressed = 0;
-
-    /* estimate the decompressed size, by default 10 * size */
-    dest_size_alloc = initial_output_size;
-
-    dest = malloc (dest_size_alloc);
-    if (!dest)
-        goto error;
-
-    /* loop until we manage to decompress whole data in dest */
-    while (1)
+    for (i = start; i < start + count; i++)
     {
-        dest_size = dest_size_alloc;
-        source_size = size;
-
-        rc = uncompress2 (dest,
-                          &dest_size,
-                          (Bytef *)data,
-                          &source_size);
-
-        if (rc == Z_OK)
+        if (!weechat_relay_parse_read_integer (parsed_msg, &num_vars))
+            goto error;
+        if (i == 0)
         {
-            /* data successfully decompressed */
-            if (dest_size < dest_size_alloc)
-            {
-                dest2 = realloc (dest, dest_size);
-                if (dest2)
-                    dest = dest2;
-            }
-            *size_decompressed = dest_size;
-            break;
+            /* the schema is built with variables of first item */
+            if (num_vars <= 0)
+                goto error;
+            schema = calloc (1, sizeof (*schema));
+            if (!schema)
+                goto error;
+            infolist->schema = schema;
+            schema->names = calloc (num_vars, sizeof (*schema->names));
+            if (!schema->names)
+                goto error;
+            schema->types = calloc (num_vars, sizeof (*schema->types));
+            if (!schema->types)
+                goto error;
+            infolist->columns = calloc (num_vars, sizeof (*infolist->columns));
+            if (!infolist->columns)
+                goto error;
+            schema->count = num_vars;
         }
-        if (rc == Z_BUF_ERROR)
+        else
         {
-            /* not enough space in dest, compute new estimated size */
-            if ((source_size > 0) && (source_size < size))
+            schema = infolist->schema;
+            if (num_vars != schema->count)
+                goto error;
+        }
+        for (j = 0; j < schema->count; j++)
+        {
+            if (i == 0)
             {
-                /* estimate new size needed, according to the bytes used */
-                pct_used = (source_size * 100) / size;
-                /* we add 10% extra margin */
-                pct_to_add = (100 - pct_used) + 10;
-                size_to_add = (size * pct_to_add) / 100;
-                dest_size_alloc = (size_to_add > 0) ?
-                    dest_size_alloc + size_to_add : dest_size_alloc * 2;
+                if (!weechat_relay_parse_read_string (parsed_msg,
+                                                      &schema->names[j])
+                    || !schema->names[j])
+                {
+                    goto error;
+                }
+                if (!weechat_relay_parse_read_type (parsed_msg,
+                                                    &schema->types[j]))
+                    goto error;
+                size_value = weechat_relay_obj_infolist_column_size (
+                    schema->types[j]);
+                if (size_value == 0)
+                    goto error;
+                infolist->columns[j] = calloc (infolist->count, size_value);
+                if (!infolist->columns[j])
+                    goto error;
             }
             else
             {
-                /* double the output buffer */
-                dest_size_alloc *= 2;
+                if (!weechat_relay_parse_match_string (parsed_msg,
+                                                       schema->names[j]))
+                    goto error;
+                if (!weechat_relay_parse_read_type (parsed_msg, &type)
+                    || (type != schema->types[j]))
+                {
+                    goto error;
+                }
             }
-            dest2 = realloc (dest, dest_size_alloc);
-            if (!dest2)
+            if (!weechat_relay_parse_infolist_column_value (
+                    parsed_msg, schema->types[j], infolist->columns[j], i))
+            {
                 goto error;
-            dest = dest2;
-        }
-        else
-        {
-            /* any other error like Z_MEM_ERROR or Z_DATA_ERROR is fatal */
-            goto error;
+            }
         }
     }
 
-    return dest;
+    return 1;
 
 error:
-    if (dest)
-        free (dest);
-    return NULL;
+    if (i == 0)
+    {
+        weechat_relay_obj_infolist_free_columns (infolist);
+        return 0;
+    }
+    for (j = 0; j < infolist->schema->count; j++)
+    {
+        if (infolist->schema->types[j] == WEECHAT_RELAY_OBJ_TYPE_STRING)
+        {
+            free (((char **)infolist->columns[j])[i]);
+            ((char **)infolist->columns[j])[i] = NULL;
+        }
+        else if (infolist->schema->types[j] == WEECHAT_RELAY_OBJ_TYPE_BUFFER)
+        {
+            free (((struct t_weechat_relay_obj_buffer *)infolist->columns[j])[i].buffer);
+            ((struct t_weechat_relay_obj_buffer *)infolist->columns[j])[i].buffer = NULL;
+            ((struct t_weechat_relay_obj_buffer *)infolist->columns[j])[i].length = 0;
+        }
+    }
+    return 0;
 }
 
 /*
- * Decompresses data with zstd.
- *
- * The variable "size_decompressed" is set with the size of decompressed
- * buffer returned (in bytes).
+ * Reads items of an infolist in columns, if all items have the same
+ * variables and all variables have a scalar type (infolist count must be
+ * set).
  *
- * The initial output size must be set to an estimate output size, but the
- * output buffer size ("size_decompressed") can be higher.
- * A typical value here could be 10 * size if we estimate zstd can compress
- * data with a 90% ratio (which is excellent).
+ * If items have different variables or if an error occurs, the position in
+ * message is restored, so that items can be read again with the classic
+ * representation.
  *
- * Returns a pointer to the decompressed message, NULL if error.
+ * Returns:
+ *   1: OK, items read in columns
+ *   0: items can not be read in columns
  */
 
-void *
-weechat_relay_parse_decompress_zstd (const void *data, size_t size,
-                                     size_t initial_output_size,
-                                     size_t *size_decompressed)
+int
+weechat_relay_parse_infolist_columns (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                      struct t_weechat_relay_obj_infolist *infolist)
 {
-    int rc;
-    void *dest, *dest2, *dest_buf;
-    size_t rc_decompress, dest_size_alloc, dest_pos, dest_buf_size;
-    ZSTD_DCtx* dctx;
-    ZSTD_inBuffer input_buf;
-    ZSTD_outBuffer output_buf;
+    size_t start;
 
-    if (!data || (size == 0) || (initial_output_size == 0)
-        || !size_decompressed)
+    if (!parsed_msg || !infolist || (infolist->count <= 0))
+        return 0;
+
+    start = parsed_msg->position;
+
+    /* each item has at least its number of variables (4 bytes) */
+    if ((size_t)infolist->count * 4 > parsed_msg->size - parsed_msg->position)
+        return 0;
+
+    if (!weechat_relay_parse_infolist_columns_items (parsed_msg, infolist,
+                                                     0, infolist->count))
     {
-        return NULL;
+        weechat_relay_obj_infolist_free_columns (infolist);
+        parsed_msg->position = start;
+        return 0;
     }
 
-    dest = NULL;
-    dest_buf = NULL;
-    dctx = NULL;
+    return 1;
+}
 
-    *size_decompressed = 0;
+/*
+ * Reads the beginning of an infolist object in message: name and count;
+ * items are not read (see weechat_relay_parse_infolist_items and
+ * weechat_relay_parse_infolist_columns_items).
+ *
+ * Returns the infolist object, NULL if error.
+ */
 
-    /* estimate the decompressed size, by default 10 * size */
-    dest_size_alloc = initial_output_size;
-    dest_pos = 0;
-    dest = malloc (dest_size_alloc);
-    if (!dest)
-        goto error;
+struct t_weechat_relay_obj *
+weechat_relay_parse_infolist_start (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_obj *obj;
 
-    dest_buf_size = ZSTD_DStreamOutSize();
-    dest_buf = malloc (dest_buf_size);
-    if (!dest_buf)
+    if (!parsed_msg)
+        return NULL;
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INFOLIST);
+    if (!obj)
         goto error;
 
-    dctx = ZSTD_createDCtx();
-    if (!dctx)
+    if (!weechat_relay_parse_read_string (parsed_msg, &obj->value_infolist.name))
+        goto error;
+    if (!weechat_relay_parse_read_integer (parsed_msg, &obj->value_infolist.count))
+        goto error;
+    if (obj->value_infolist.count < 0)
         goto error;
 
-    input_buf.src = data;
-    input_buf.size = size;
-    input_buf.pos = 0;
+    return obj;
 
-    while (input_buf.pos < input_buf.size)
+error:
+    if (obj)
+        weechat_relay_obj_free (obj);
+    return NULL;
+}
+
+/*
+ * Reads "count" items of a classic infolist in message, starting at item
+ * "start" (items must be read in order).
+ *
+ * On error, the item being read is freed (the items before are kept), so
+ * that it can be read again.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_parse_infolist_items (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                    struct t_weechat_relay_obj_infolist *infolist,
+                                    int start, int count)
+{
+    struct t_weechat_relay_obj_infolist_item *ptr_item;
+    enum t_weechat_relay_obj_type type;
+    int i, j;
+
+    if (!parsed_msg || !infolist || (start < 0) || (count < 0)
+        || (start + count > infolist->count))
+    {
+        return 0;
+    }
+
+    if (!infolist->items)
+    {
+        infolist->items = calloc (infolist->count, sizeof (*infolist->items));
+        if (!infolist->items)
+            return 0;
+    }
+
+    for (i = start; i < start + count; i++)
+    {
+        ptr_item = calloc (1, sizeof (*ptr_item));
+        if (!ptr_item)
+            return 0;
+        infolist->items[i] = ptr_item;
+        if (!weechat_relay_parse_read_integer (parsed_msg, &ptr_item->count))
+            goto error;
+        if (ptr_item->count < 0)
+            goto error;
+        ptr_item->variables = calloc (ptr_item->count,
+                                      sizeof (*ptr_item->variables));
+        if (!ptr_item->variables && (ptr_item->count > 0))
+            goto error;
+        for (j = 0; j < ptr_item->count; j++)
+        {
+            ptr_item->variables[j] = calloc (1, sizeof (*ptr_item->variables[j]));
+            if (!ptr_item->variables[j])
+                goto error;
+            if (!weechat_relay_parse_read_string (parsed_msg,
+                                                  &ptr_item->variables[j]->name))
+                goto error;
+            if (!weechat_relay_parse_read_type (parsed_msg, &type))
+                goto error;
+            ptr_item->variables[j]->value = weechat_relay_parse_read_object (
+                parsed_msg, type);
+            if (!ptr_item->variables[j]->value)
+                goto error;
+        }
+    }
+
+    return 1;
+
+error:
+    weechat_relay_obj_infolist_item_free (infolist->items[i]);
+    infolist->items[i] = NULL;
+    return 0;
+}
+
+/*
+ * Reads an infolist object in message (variable length).
+ *
+ * Returns the infolist object, NULL if error.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_parse_obj_infolist (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_obj *obj;
+
+    obj = weechat_relay_parse_infolist_start (parsed_msg);
+    if (!obj)
+        return NULL;
+
+    if ((parsed_msg->flags & WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS)
+        && weechat_relay_parse_infolist_columns (parsed_msg,
+                                                 &obj->value_infolist))
+    {
+        return obj;
+    }
+
+    if (!weechat_relay_parse_infolist_items (parsed_msg, &obj->value_infolist,
+                                             0, obj->value_infolist.count))
+    {
+        weechat_relay_obj_free (obj);
+        return NULL;
+    }
+
+    return obj;
+}
+
+/*
+ * Reads values of an array of "int" or "chr" in a native C array
+ * (array type and count must be set, the native array can be allocated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_parse_array_native (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                  struct t_weechat_relay_obj_array *array)
+{
+    const void *ptr_values;
+    size_t size;
+
+    if (!parsed_msg || !array || (array->count < 0))
+        return 0;
+
+    size = (array->type == WEECHAT_RELAY_OBJ_TYPE_INTEGER) ? 4 : 1;
+
+    if ((size_t)array->count * size > parsed_msg->size - parsed_msg->position)
+        return 0;
+
+    if (array->count == 0)
+        return 1;
+
+    if (!array->values_native)
+    {
+        array->values_native = malloc (array->count * size);
+        if (!array->values_native)
+            return 0;
+    }
+
+    ptr_values = weechat_relay_parse_get_bytes (parsed_msg,
+                                                array->count * size);
+    if (!ptr_values)
+    {
+        /* values are split between segments: copy them, decode in place */
+        if (!weechat_relay_parse_peek_bytes (parsed_msg, array->values_native,
+                                             array->count * size))
+        {
+            return 0;
+        }
+        ptr_values = array->values_native;
+    }
+
+    if (array->type == WEECHAT_RELAY_OBJ_TYPE_INTEGER)
+    {
+        weechat_relay_decode_integers (array->values_native, ptr_values,
+                                       array->count);
+    }
+    else if (ptr_values != array->values_native)
+    {
+        memcpy (array->values_native, ptr_values, array->count);
+    }
+    parsed_msg->position += array->count * size;
+
+    return 1;
+}
+
+/*
+ * Reads the beginning of an array object in message: type and count;
+ * elements are allocated (in a native C array for "int" and "chr" with
+ * parser flag NATIVE_ARRAYS) but not read (see
+ * weechat_relay_parse_array_items).
+ *
+ * Returns the array object, NULL if error.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_parse_array_start (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_obj *obj;
+    size_t size;
+
+    if (!parsed_msg)
+        return NULL;
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_ARRAY);
+    if (!obj)
+        goto error;
+
+    if (!weechat_relay_parse_read_type (parsed_msg, &obj->value_array.type))
+        goto error;
+
+    if (!weechat_relay_parse_read_integer (parsed_msg, &obj->value_array.count))
+        goto error;
+    if (obj->value_array.count < 0)
+        goto error;
+
+    if ((parsed_msg->flags & WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS)
+        && ((obj->value_array.type == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+            || (obj->value_array.type == WEECHAT_RELAY_OBJ_TYPE_INTEGER)))
+    {
+        size = (obj->value_array.type == WEECHAT_RELAY_OBJ_TYPE_INTEGER) ?
+            4 : 1;
+        if ((size_t)obj->value_array.count * size
+            > parsed_msg->size - parsed_msg->position)
+        {
+            goto error;
+        }
+        if (obj->value_array.count > 0)
+        {
+            obj->value_array.values_native = malloc (
+                obj->value_array.count * size);
+            if (!obj->value_array.values_native)
+                goto error;
+        }
+        return obj;
+    }
+
+    obj->value_array.values = calloc (obj->value_array.count,
+                                      sizeof (*obj->value_array.values));
+    if (!obj->value_array.values)
+        goto error;
+
+    return obj;
+
+error:
+    if (obj)
+        weechat_relay_obj_free (obj);
+    return NULL;
+}
+
+/*
+ * Reads "count" elements of an array object in message, starting at
+ * element "start" (elements must be read in order); integers of a native
+ * array are copied raw and decoded by weechat_relay_parse_array_end.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (the element being read is not set)
+ */
+
+int
+weechat_relay_parse_array_items (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                 struct t_weechat_relay_obj_array *array,
+                                 int start, int count)
+{
+    size_t size;
+    int i;
+
+    if (!parsed_msg || !array || (start < 0) || (count < 0)
+        || (start + count > array->count))
+    {
+        return 0;
+    }
+
+    if (!array->values)
+    {
+        if (count == 0)
+            return 1;
+        size = (array->type == WEECHAT_RELAY_OBJ_TYPE_INTEGER) ? 4 : 1;
+        return weechat_relay_parse_read_bytes (
+            parsed_msg, (char *)array->values_native + (start * size),
+            count * size);
+    }
+
+    for (i = start; i < start + count; i++)
+    {
+        array->values[i] = weechat_relay_parse_read_object (parsed_msg,
+                                                            array->type);
+        if (!array->values[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Ends the read of an array object with weechat_relay_parse_array_items,
+ * after all elements have been read: decodes the integers of native array.
+ */
+
+void
+weechat_relay_parse_array_end (struct t_weechat_relay_obj_array *array)
+{
+    if (!array || array->values || !array->values_native
+        || (array->type != WEECHAT_RELAY_OBJ_TYPE_INTEGER))
+    {
+        return;
+    }
+
+    weechat_relay_decode_integers (array->values_native, array->values_native,
+                                   array->count);
+}
+
+/*
+ * Reads an array object in message (variable length).
+ *
+ * Returns the array object, NULL if error.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_parse_obj_array (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_obj *obj;
+
+    obj = weechat_relay_parse_array_start (parsed_msg);
+    if (!obj)
+        return NULL;
+
+    if (!obj->value_array.values)
+    {
+        /* native array: values are decoded directly from message */
+        if (!weechat_relay_parse_array_native (parsed_msg, &obj->value_array))
+            goto error;
+        return obj;
+    }
+
+    if (!weechat_relay_parse_array_items (parsed_msg, &obj->value_array,
+                                          0, obj->value_array.count))
+        goto error;
+
+    return obj;
+
+error:
+    weechat_relay_obj_free (obj);
+    return NULL;
+}
+
+/*
+ * Sets the bytes of an object in the message received, read from "start" up
+ * to the current position (only with parser flag PASSTHROUGH and if the
+ * message is not parsed from segments).
+ */
+
+void
+weechat_relay_parse_set_wire (struct t_weechat_relay_parsed_msg *parsed_msg,
+                              struct t_weechat_relay_obj *obj,
+                              size_t start)
+{
+    if (!obj
+        || !(parsed_msg->flags & WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH)
+        || !parsed_msg->buffer
+        || (parsed_msg->position < start))
+    {
+        return;
+    }
+
+    obj->wire = (const char *)parsed_msg->buffer + start;
+    obj->wire_size = parsed_msg->position - start;
+}
+
+/*
+ * Reads an object in a message.
+ *
+ * Returns the object, NULL if error.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_parse_read_object (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                 enum t_weechat_relay_obj_type type)
+{
+    struct t_weechat_relay_obj *obj;
+    size_t start;
+
+    if (!parsed_msg)
+        return NULL;
+
+    obj = NULL;
+    start = parsed_msg->position;
+
+    switch (type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            obj = weechat_relay_parse_obj_char (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            obj = weechat_relay_parse_obj_integer (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            obj = weechat_relay_parse_obj_long (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            obj = weechat_relay_parse_obj_string (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            obj = weechat_relay_parse_obj_buffer (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            obj = weechat_relay_parse_obj_pointer (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            obj = weechat_relay_parse_obj_time (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            obj = weechat_relay_parse_obj_hashtable (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            obj = weechat_relay_parse_obj_hdata (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFO:
+            obj = weechat_relay_parse_obj_info (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            obj = weechat_relay_parse_obj_infolist (parsed_msg);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            obj = weechat_relay_parse_obj_array (parsed_msg);
+            break;
+        case WEECHAT_RELAY_NUM_OBJ_TYPES:
+            break;
+    }
+
+    weechat_relay_parse_set_wire (parsed_msg, obj, start);
+
+    return obj;
+}
+
+/*
+ * Reads a hdata value in message (variable length).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_parse_read_value_hdata (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                      struct t_weechat_relay_value_hdata *hdata)
+{
+    char **hpaths;
+    int i, j, count, num_hpaths;
+
+    if (!weechat_relay_parse_read_string (parsed_msg, &hdata->hpath)
+        || !hdata->hpath)
+    {
+        return 0;
+    }
+    if (!weechat_relay_parse_hdata_split_hpath (hdata->hpath,
+                                                &hpaths, &num_hpaths))
+        return 0;
+    for (i = 0; i < num_hpaths; i++)
+    {
+        if (hpaths[i])
+            free (hpaths[i]);
+    }
+    free (hpaths);
+    hdata->num_hpaths = num_hpaths;
+
+    if (!weechat_relay_parse_read_string (parsed_msg, &hdata->keys)
+        || !hdata->keys)
+    {
+        return 0;
+    }
+    if (!weechat_relay_parse_hdata_split_keys (hdata->keys,
+                                               &hdata->keys_names,
+                                               &hdata->keys_types,
+                                               &hdata->num_keys))
+        return 0;
+
+    if (!weechat_relay_parse_read_integer (parsed_msg, &count) || (count < 0))
+        return 0;
+    if (count == 0)
+        return 1;
+
+    /* each pointer and each value has at least one byte */
+    if ((size_t)count * (hdata->num_hpaths + hdata->num_keys)
+        > parsed_msg->size - parsed_msg->position)
+    {
+        return 0;
+    }
+
+    hdata->ppath = calloc ((size_t)count * hdata->num_hpaths,
+                           sizeof (*hdata->ppath));
+    if (!hdata->ppath)
+        return 0;
+    hdata->values = calloc ((size_t)count * hdata->num_keys,
+                            sizeof (*hdata->values));
+    if (!hdata->values)
+        return 0;
+    hdata->count = count;
+
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < hdata->num_hpaths; j++)
+        {
+            if (!weechat_relay_parse_read_pointer (
+                    parsed_msg, &hdata->ppath[(i * hdata->num_hpaths) + j]))
+                return 0;
+        }
+        for (j = 0; j < hdata->num_keys; j++)
+        {
+            if (!weechat_relay_parse_read_value (
+                    parsed_msg, hdata->keys_types[j],
+                    &hdata->values[(i * hdata->num_keys) + j]))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Reads an infolist value in message (variable length).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_parse_read_value_infolist (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                         struct t_weechat_relay_value_infolist *infolist)
+{
+    struct t_weechat_relay_value_infolist_item *ptr_item;
+    enum t_weechat_relay_obj_type type;
+    int i, j, count;
+
+    if (!weechat_relay_parse_read_string (parsed_msg, &infolist->name))
+        return 0;
+    if (!weechat_relay_parse_read_integer (parsed_msg, &count) || (count < 0))
+        return 0;
+    if (count == 0)
+        return 1;
+
+    /* each item has at least its number of variables (4 bytes) */
+    if ((size_t)count * 4 > parsed_msg->size - parsed_msg->position)
+        return 0;
+
+    infolist->items = calloc (count, sizeof (*infolist->items));
+    if (!infolist->items)
+        return 0;
+    infolist->count = count;
+
+    for (i = 0; i < infolist->count; i++)
+    {
+        ptr_item = &infolist->items[i];
+        if (!weechat_relay_parse_read_integer (parsed_msg, &count)
+            || (count < 0))
+        {
+            return 0;
+        }
+        if (count == 0)
+            continue;
+        /* each variable has at least a name and a type (7 bytes) */
+        if ((size_t)count * 7 > parsed_msg->size - parsed_msg->position)
+            return 0;
+        ptr_item->names = calloc (count, sizeof (*ptr_item->names));
+        if (!ptr_item->names)
+            return 0;
+        ptr_item->values = calloc (count, sizeof (*ptr_item->values));
+        if (!ptr_item->values)
+            return 0;
+        ptr_item->count = count;
+        for (j = 0; j < ptr_item->count; j++)
+        {
+            if (!weechat_relay_parse_read_string (parsed_msg,
+                                                  &ptr_item->names[j]))
+                return 0;
+            if (!weechat_relay_parse_read_type (parsed_msg, &type))
+                return 0;
+            if (!weechat_relay_parse_read_value (parsed_msg, type,
+                                                 &ptr_item->values[j]))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Reads a value in message (compact value, see struct
+ * t_weechat_relay_value).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (the value is then cleared)
+ */
+
+int
+weechat_relay_parse_read_value (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                enum t_weechat_relay_obj_type type,
+                                struct t_weechat_relay_value *value)
+{
+    enum t_weechat_relay_obj_type type_keys, type_values;
+    int i, count;
+
+    if (!value)
+        return 0;
+
+    memset (value, 0, sizeof (*value));
+    value->type = type;
+
+    if (!parsed_msg)
+        return 0;
+
+    switch (type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            if (!weechat_relay_parse_read_bytes (parsed_msg,
+                                                 &value->value_char, 1))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            if (!weechat_relay_parse_read_integer (parsed_msg,
+                                                   &value->value_integer))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            if (!weechat_relay_parse_read_long (parsed_msg,
+                                                &value->value_long))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            if (!weechat_relay_parse_read_string (parsed_msg,
+                                                  &value->value_string))
+                goto error;
+            value->length = (value->value_string) ?
+                (int)strlen (value->value_string) : -1;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            if (!weechat_relay_parse_read_buffer (parsed_msg,
+                                                  &value->value_buffer,
+                                                  &value->length))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            if (!weechat_relay_parse_read_pointer (parsed_msg,
+                                                   &value->value_pointer))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            if (!weechat_relay_parse_read_time (parsed_msg,
+                                                &value->value_time))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            if (!weechat_relay_parse_read_type (parsed_msg, &type_keys)
+                || !weechat_relay_parse_read_type (parsed_msg, &type_values)
+                || !weechat_relay_parse_read_integer (parsed_msg, &count)
+                || (count < 0))
+            {
+                goto error;
+            }
+            /* each key and value has at least one byte */
+            if ((size_t)count * 2 > parsed_msg->size - parsed_msg->position)
+                goto error;
+            value->value_hashtable = weechat_relay_value_hashtable_alloc (count);
+            if (!value->value_hashtable)
+                goto error;
+            value->value_hashtable->type_keys = type_keys;
+            value->value_hashtable->type_values = type_values;
+            for (i = 0; i < count; i++)
+            {
+                if (!weechat_relay_parse_read_value (
+                        parsed_msg, type_keys,
+                        &value->value_hashtable->keys[i])
+                    || !weechat_relay_parse_read_value (
+                        parsed_msg, type_values,
+                        &value->value_hashtable->values[i]))
+                {
+                    goto error;
+                }
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            value->value_hdata = calloc (1, sizeof (*value->value_hdata));
+            if (!value->value_hdata)
+                goto error;
+            if (!weechat_relay_parse_read_value_hdata (parsed_msg,
+                                                       value->value_hdata))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFO:
+            value->value_info = calloc (1, sizeof (*value->value_info));
+            if (!value->value_info)
+                goto error;
+            if (!weechat_relay_parse_read_string (parsed_msg,
+                                                  &value->value_info->name)
+                || !weechat_relay_parse_read_string (parsed_msg,
+                                                     &value->value_info->value))
+            {
+                goto error;
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            value->value_infolist = calloc (1, sizeof (*value->value_infolist));
+            if (!value->value_infolist)
+                goto error;
+            if (!weechat_relay_parse_read_value_infolist (parsed_msg,
+                                                          value->value_infolist))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            if (!weechat_relay_parse_read_type (parsed_msg, &type_values)
+                || !weechat_relay_parse_read_integer (parsed_msg, &count)
+                || (count < 0))
+            {
+                goto error;
+            }
+            /* each element has at least one byte */
+            if ((size_t)count > parsed_msg->size - parsed_msg->position)
+                goto error;
+            value->value_array = weechat_relay_value_array_alloc (count);
+            if (!value->value_array)
+                goto error;
+            value->value_array->type = type_values;
+            for (i = 0; i < count; i++)
+            {
+                if (!weechat_relay_parse_read_value (
+                        parsed_msg, type_values,
+                        &value->value_array->values[i]))
+                    goto error;
+            }
+            break;
+        case WEECHAT_RELAY_NUM_OBJ_TYPES:
+            goto error;
+    }
+
+    return 1;
+
+error:
+    weechat_relay_value_clear (value);
+    return 0;
+}
+
+/*
+ * Decompresses data with zlib.
+ *
+ * The variable "size_decompressed" is set with the size of decompressed
+ * buffer returned (in bytes).
+ *
+ * The initial output size must be set to an estimate output size, but the
+ * output buffer size ("size_decompressed") can be higher.
+ * A typical value here could be 10 * size if we estimate zlib can compress
+ * data with a 90% ratio (which is excellent).
+ *
+ * Returns a pointer to the decompressed message, NULL if error.
+ */
+
+void *
+weechat_relay_parse_decompress_zlib (const void *data, size_t size,
+                                     size_t initial_output_size,
+                                     size_t *size_decompressed)
+{
+    int rc;
+    Bytef *dest, *dest2;
+    uLongf dest_size, dest_size_alloc, source_size, pct_used, pct_to_add;
+    uLongf size_to_add;
+
+    if (!data || (size == 0) || (initial_output_size == 0)
+        || !size_decompressed)
+    {
+        return NULL;
+    }
+
+    dest = NULL;
+
+    *size_decompressed = 0;
+
+    /* estimate the decompressed size, by default 10 * size */
+    dest_size_alloc = initial_output_size;
+
+    dest = malloc (dest_size_alloc);
+    if (!dest)
+        goto error;
+
+    /* loop until we manage to decompress whole data in dest */
+    while (1)
+    {
+        dest_size = dest_size_alloc;
+        source_size = size;
+
+        rc = uncompress2 (dest,
+                          &dest_size,
+                          (Bytef *)data,
+                          &source_size);
+
+        if (rc == Z_OK)
+        {
+            /* data successfully decompressed */
+            if (dest_size < dest_size_alloc)
+            {
+                dest2 = realloc (dest, dest_size);
+                if (dest2)
+                    dest = dest2;
+            }
+            *size_decompressed = dest_size;
+            break;
+        }
+        if (rc == Z_BUF_ERROR)
+        {
+            /* not enough space in dest, compute new estimated size */
+            if ((source_size > 0) && (source_size < size))
+            {
+                /* estimate new size needed, according to the bytes used */
+                pct_used = (source_size * 100) / size;
+                /* we add 10% extra margin */
+                pct_to_add = (100 - pct_used) + 10;
+                size_to_add = (size * pct_to_add) / 100;
+                dest_size_alloc = (size_to_add > 0) ?
+                    dest_size_alloc + size_to_add : dest_size_alloc * 2;
+            }
+            else
+            {
+                /* double the output buffer */
+                dest_size_alloc *= 2;
+            }
+            dest2 = realloc (dest, dest_size_alloc);
+            if (!dest2)
+                goto error;
+            dest = dest2;
+        }
+        else
+        {
+            /* any other error like Z_MEM_ERROR or Z_DATA_ERROR is fatal */
+            goto error;
+        }
+    }
+
+    return dest;
+
+error:
+    if (dest)
+        free (dest);
+    return NULL;
+}
+
+/*
+ * Decompresses data with zstd, using the zstd context of the parse context
+ * "ctx" (if not NULL, the context is created on first use, then reused),
+ * or a temporary zstd context (if ctx is NULL).
+ *
+ * The variable "size_decompressed" is set with the size of decompressed
+ * buffer returned (in bytes).
+ *
+ * If the decompressed size is in the frame header, the initial output size
+ * is ignored and the output buffer has exactly this size.
+ *
+ * Returns a pointer to the decompressed message, NULL if error.
+ */
+
+void *
+weechat_relay_parse_decompress_zstd_ctx (struct t_weechat_relay_parse_ctx *ctx,
+                                         const void *data, size_t size,
+                                         size_t initial_output_size,
+                                         size_t *size_decompressed)
+{
+    int rc;
+    void *dest, *dest2, *dest_buf;
+    size_t rc_decompress, dest_size_alloc, dest_pos, dest_buf_size;
+    unsigned long long content_size;
+    ZSTD_DCtx* dctx;
+    ZSTD_inBuffer input_buf;
+    ZSTD_outBuffer output_buf;
+
+    if (!data || (size == 0) || (initial_output_size == 0)
+        || !size_decompressed)
+    {
+        return NULL;
+    }
+
+    dest = NULL;
+    dest_buf = NULL;
+    dctx = NULL;
+
+    *size_decompressed = 0;
+
+    if (ctx)
+    {
+        if (!ctx->zstd_dctx)
+        {
+            ctx->zstd_dctx = ZSTD_createDCtx();
+            if (!ctx->zstd_dctx)
+                goto error;
+        }
+        dctx = ctx->zstd_dctx;
+        ZSTD_DCtx_reset (dctx, ZSTD_reset_session_only);
+        if (ctx->zstd_ddict)
+            ZSTD_DCtx_refDDict (dctx, ctx->zstd_ddict);
+    }
+    else
+    {
+        dctx = ZSTD_createDCtx();
+        if (!dctx)
+            goto error;
+    }
+
+    /*
+     * if the decompressed size is in the frame header (and is not
+     * unreasonably large), decompress directly in a buffer of this size
+     */
+    content_size = ZSTD_getFrameContentSize (data, size);
+    if ((content_size != ZSTD_CONTENTSIZE_UNKNOWN)
+        && (content_size != ZSTD_CONTENTSIZE_ERROR)
+        && (content_size > 0)
+        && (content_size <= (unsigned long long)size
+            * WEECHAT_RELAY_PARSE_ZSTD_MAX_RATIO))
+    {
+        dest = malloc (content_size);
+        if (!dest)
+            goto error;
+        rc_decompress = ZSTD_decompressDCtx (dctx, dest, content_size,
+                                             data, size);
+        if (!ZSTD_isError(rc_decompress) && (rc_decompress == content_size))
+        {
+            *size_decompressed = content_size;
+            if (!ctx)
+                ZSTD_freeDCtx(dctx);
+            return dest;
+        }
+        /* fallback to streaming decompression (for example multiple frames) */
+        free (dest);
+        dest = NULL;
+        ZSTD_DCtx_reset (dctx, ZSTD_reset_session_only);
+    }
+
+    /* estimate the decompressed size, by default 10 * size */
+    dest_size_alloc = initial_output_size;
+    dest_pos = 0;
+    dest = malloc (dest_size_alloc);
+    if (!dest)
+        goto error;
+
+    dest_buf_size = ZSTD_DStreamOutSize();
+    dest_buf = malloc (dest_buf_size);
+    if (!dest_buf)
+        goto error;
+
+    rc = 0;
+
+    input_buf.src = data;
+    input_buf.size = size;
+    input_buf.pos = 0;
+
+    while (input_buf.pos < input_buf.size)
+    {
+        output_buf.dst = dest_buf;
+        output_buf.size = dest_buf_size;
+        output_buf.pos = 0;
+
+        rc_decompress = ZSTD_decompressStream (dctx, &output_buf, &input_buf);
+
+        if (ZSTD_isError(rc_decompress))
+            goto error;
+
+        if (output_buf.pos > 0)
+        {
+            if (dest_pos + output_buf.pos > dest_size_alloc)
+            {
+                dest_size_alloc = dest_pos + output_buf.pos;
+                dest2 = realloc (dest, dest_size_alloc);
+                if (!dest2)
+                    goto error;
+                dest = dest2;
+            }
+            memcpy (dest + dest_pos, dest_buf, output_buf.pos);
+            dest_pos += output_buf.pos;
+        }
+        rc = rc_decompress;
+    }
+
+    if (rc != 0)
+        goto error;
+
+    *size_decompressed = dest_pos;
+
+    free (dest_buf);
+    if (!ctx)
+        ZSTD_freeDCtx(dctx);
+
+    return dest;
+
+error:
+    if (dest)
+        free (dest);
+    if (dest_buf)
+        free (dest_buf);
+    if (dctx && !ctx)
+        ZSTD_freeDCtx(dctx);
+    return NULL;
+}
+
+/*
+ * Decompresses data with zstd.
+ *
+ * The variable "size_decompressed" is set with the size of decompressed
+ * buffer returned (in bytes).
+ *
+ * The initial output size must be set to an estimate output size, but the
+ * output buffer size ("size_decompressed") can be higher.
+ * A typical value here could be 10 * size if we estimate zstd can compress
+ * data with a 90% ratio (which is excellent).
+ *
+ * Returns a pointer to the decompressed message, NULL if error.
+ */
+
+void *
+weechat_relay_parse_decompress_zstd (const void *data, size_t size,
+                                     size_t initial_output_size,
+                                     size_t *size_decompressed)
+{
+    return weechat_relay_parse_decompress_zstd_ctx (NULL, data, size,
+                                                    initial_output_size,
+                                                    size_decompressed);
+}
+
+/*
+ * Decompresses data split in segments with zlib (data is not copied in a
+ * contiguous buffer before decompression).
+ *
+ * The variable "size_decompressed" is set with the size of decompressed
+ * buffer returned (in bytes).
+ *
+ * The initial output size is an estimate output size, the output buffer
+ * is doubled as needed.
+ *
+ * Returns a pointer to the decompressed message, NULL if error.
+ */
+
+void *
+weechat_relay_parse_decompress_zlib_iov (const struct iovec *iov, int iovcnt,
+                                         size_t initial_output_size,
+                                         size_t *size_decompressed)
+{
+    z_stream strm;
+    void *dest, *dest2;
+    size_t dest_size_alloc;
+    int rc, i;
+
+    if (!iov || (iovcnt <= 0) || (initial_output_size == 0)
+        || !size_decompressed)
+    {
+        return NULL;
+    }
+
+    *size_decompressed = 0;
+
+    memset (&strm, 0, sizeof (strm));
+    if (inflateInit (&strm) != Z_OK)
+        return NULL;
+
+    dest_size_alloc = initial_output_size;
+    dest = malloc (dest_size_alloc);
+    if (!dest)
+        goto error;
+
+    strm.next_out = dest;
+    strm.avail_out = dest_size_alloc;
+
+    i = 0;
+    while (1)
+    {
+        if (strm.avail_out == 0)
+        {
+            /* double the output buffer */
+            dest2 = realloc (dest, dest_size_alloc * 2);
+            if (!dest2)
+                goto error;
+            dest = dest2;
+            strm.next_out = (Bytef *)dest + dest_size_alloc;
+            strm.avail_out = dest_size_alloc;
+            dest_size_alloc *= 2;
+        }
+        while ((strm.avail_in == 0) && (i < iovcnt))
+        {
+            strm.next_in = iov[i].iov_base;
+            strm.avail_in = iov[i].iov_len;
+            i++;
+        }
+        rc = inflate (&strm, Z_NO_FLUSH);
+        if (rc == Z_STREAM_END)
+            break;
+        if (rc == Z_BUF_ERROR)
+        {
+            /* no progress possible: error if there is no more data */
+            if (strm.avail_out > 0)
+                goto error;
+        }
+        else if (rc != Z_OK)
+        {
+            goto error;
+        }
+    }
+
+    *size_decompressed = strm.total_out;
+
+    inflateEnd (&strm);
+
+    return dest;
+
+error:
+    if (dest)
+        free (dest);
+    inflateEnd (&strm);
+    return NULL;
+}
+
+/*
+ * Decompresses data split in segments with zstd (data is not copied in a
+ * contiguous buffer before decompression), using the zstd context of the
+ * parse context "ctx" (if not NULL), or a temporary zstd context (if ctx is
+ * NULL).
+ *
+ * The variable "size_decompressed" is set with the size of decompressed
+ * buffer returned (in bytes).
+ *
+ * If the decompressed size is in the frame header, the initial output size
+ * is ignored and the output buffer has exactly this size, otherwise the
+ * output buffer is doubled as needed.
+ *
+ * Returns a pointer to the decompressed message, NULL if error.
+ */
+
+void *
+weechat_relay_parse_decompress_zstd_iov (struct t_weechat_relay_parse_ctx *ctx,
+                                         const struct iovec *iov, int iovcnt,
+                                         size_t initial_output_size,
+                                         size_t *size_decompressed)
+{
+    ZSTD_DCtx *dctx;
+    ZSTD_inBuffer input_buf;
+    ZSTD_outBuffer output_buf;
+    char header[WEECHAT_RELAY_PARSE_ZSTD_FRAME_HEADER_MAX];
+    void *dest, *dest2;
+    size_t size, header_size, rc, previous_pos_in, previous_pos_out;
+    unsigned long long content_size;
+    int i, index;
+
+    if (!iov || (iovcnt <= 0) || (initial_output_size == 0)
+        || !size_decompressed)
+    {
+        return NULL;
+    }
+
+    *size_decompressed = 0;
+
+    dest = NULL;
+
+    if (ctx)
+    {
+        if (!ctx->zstd_dctx)
+        {
+            ctx->zstd_dctx = ZSTD_createDCtx();
+            if (!ctx->zstd_dctx)
+                return NULL;
+        }
+        dctx = ctx->zstd_dctx;
+        ZSTD_DCtx_reset (dctx, ZSTD_reset_session_only);
+        if (ctx->zstd_ddict)
+            ZSTD_DCtx_refDDict (dctx, ctx->zstd_ddict);
+    }
+    else
+    {
+        dctx = ZSTD_createDCtx();
+        if (!dctx)
+            return NULL;
+    }
+
+    /* if the decompressed size is in the frame header, use it */
+    size = weechat_relay_parse_iov_size (iov, iovcnt);
+    header_size = (size < sizeof (header)) ? size : sizeof (header);
+    index = 0;
+    previous_pos_in = 0;
+    if (weechat_relay_parse_iov_copy (iov, iovcnt, &index, &previous_pos_in,
+                                      0, header, header_size))
+    {
+        content_size = ZSTD_getFrameContentSize (header, header_size);
+        if ((content_size != ZSTD_CONTENTSIZE_UNKNOWN)
+            && (content_size != ZSTD_CONTENTSIZE_ERROR)
+            && (content_size > 0)
+            && (content_size <= (unsigned long long)size
+                * WEECHAT_RELAY_PARSE_ZSTD_MAX_RATIO))
+        {
+            initial_output_size = content_size;
+        }
+    }
+
+    dest = malloc (initial_output_size);
+    if (!dest)
+        goto error;
+
+    output_buf.dst = dest;
+    output_buf.size = initial_output_size;
+    output_buf.pos = 0;
+
+    input_buf.src = NULL;
+    input_buf.size = 0;
+    input_buf.pos = 0;
+
+    i = 0;
+    while (1)
+    {
+        if (output_buf.pos == output_buf.size)
+        {
+            /* double the output buffer */
+            dest2 = realloc (dest, output_buf.size * 2);
+            if (!dest2)
+                goto error;
+            dest = dest2;
+            output_buf.dst = dest;
+            output_buf.size *= 2;
+        }
+        while ((input_buf.pos == input_buf.size) && (i < iovcnt))
+        {
+            input_buf.src = iov[i].iov_base;
+            input_buf.size = iov[i].iov_len;
+            input_buf.pos = 0;
+            i++;
+        }
+        previous_pos_in = input_buf.pos;
+        previous_pos_out = output_buf.pos;
+        rc = ZSTD_decompressStream (dctx, &output_buf, &input_buf);
+        if (ZSTD_isError(rc))
+            goto error;
+        if ((rc == 0) && (input_buf.pos == input_buf.size) && (i >= iovcnt))
+            break;
+        if ((input_buf.pos == previous_pos_in)
+            && (output_buf.pos == previous_pos_out)
+            && (output_buf.pos < output_buf.size))
+        {
+            /* no progress: truncated data */
+            goto error;
+        }
+    }
+
+    *size_decompressed = output_buf.pos;
+
+    if (!ctx)
+        ZSTD_freeDCtx(dctx);
+
+    return dest;
+
+error:
+    if (dest)
+        free (dest);
+    if (!ctx)
+        ZSTD_freeDCtx(dctx);
+    return NULL;
+}
+
+/*
+ * Creates a parse context, to share resources (like the zstd decompression
+ * context) between messages parsed in a batch.
+ *
+ * Returns pointer to context, NULL if error.
+ */
+
+struct t_weechat_relay_parse_ctx *
+weechat_relay_parse_ctx_new ()
+{
+    return calloc (1, sizeof (struct t_weechat_relay_parse_ctx));
+}
+
+/*
+ * Sets the zstd dictionary used to decompress messages with a parse context
+ * (NULL = no dictionary): the dictionary is digested once and the messages
+ * compressed with this dictionary can then be decompressed.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_parse_ctx_set_dict (struct t_weechat_relay_parse_ctx *ctx,
+                                  const void *dict, size_t size)
+{
+    ZSTD_DDict *ddict;
+
+    if (!ctx || (dict && (size == 0)))
+        return 0;
+
+    ddict = NULL;
+    if (dict)
+    {
+        ddict = ZSTD_createDDict (dict, size);
+        if (!ddict)
+            return 0;
+    }
+
+    /* the dictionary must not be referenced any more by the zstd context */
+    if (ctx->zstd_dctx)
+        ZSTD_DCtx_reset (ctx->zstd_dctx, ZSTD_reset_session_and_parameters);
+    if (ctx->zstd_ddict)
+        ZSTD_freeDDict (ctx->zstd_ddict);
+    ctx->zstd_ddict = ddict;
+
+    return 1;
+}
+
+/*
+ * Frees a parse context.
+ */
+
+void
+weechat_relay_parse_ctx_free (struct t_weechat_relay_parse_ctx *ctx)
+{
+    if (!ctx)
+        return;
+
+    if (ctx->zstd_dctx)
+        ZSTD_freeDCtx(ctx->zstd_dctx);
+    if (ctx->zstd_ddict)
+        ZSTD_freeDDict (ctx->zstd_ddict);
+
+    free (ctx);
+}
+
+/*
+ * Reads bytes from zlib compressed data, without decompressing the data
+ * after these bytes.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (invalid data or not enough bytes in decompressed data)
+ */
+
+int
+weechat_relay_parse_peek_read_zlib (void *strm, void *output, size_t count)
+{
+    z_stream *ptr_strm;
+    int rc;
+
+    ptr_strm = (z_stream *)strm;
+
+    ptr_strm->next_out = (Bytef *)output;
+    ptr_strm->avail_out = count;
+
+    while (ptr_strm->avail_out > 0)
+    {
+        rc = inflate (ptr_strm, Z_NO_FLUSH);
+        if (rc == Z_STREAM_END)
+            break;
+        if (rc != Z_OK)
+            return 0;
+    }
+
+    return (ptr_strm->avail_out == 0) ? 1 : 0;
+}
+
+/*
+ * Reads bytes from zstd compressed data, without decompressing the data
+ * after these bytes (zstd decompresses at most the current block).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (invalid data or not enough bytes in decompressed data)
+ */
+
+int
+weechat_relay_parse_peek_read_zstd (void *dctx, void *input,
+                                    void *output, size_t count)
+{
+    ZSTD_inBuffer *ptr_input;
+    ZSTD_outBuffer output_buf;
+    size_t rc, previous_pos_in, previous_pos_out;
+
+    ptr_input = (ZSTD_inBuffer *)input;
+
+    output_buf.dst = output;
+    output_buf.size = count;
+    output_buf.pos = 0;
+
+    while (output_buf.pos < output_buf.size)
+    {
+        previous_pos_in = ptr_input->pos;
+        previous_pos_out = output_buf.pos;
+        rc = ZSTD_decompressStream ((ZSTD_DCtx *)dctx, &output_buf, ptr_input);
+        if (ZSTD_isError(rc))
+            return 0;
+        if ((ptr_input->pos == previous_pos_in)
+            && (output_buf.pos == previous_pos_out))
+        {
+            /* no progress: end of data */
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Checks the length of id read in message (integer in network byte order)
+ * and converts it to host byte order.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (id too long for a buffer of "id_size" bytes)
+ */
+
+int
+weechat_relay_parse_peek_id_length (uint32_t length32, size_t id_size,
+                                    int *length)
+{
+    *length = (int) ntohl (length32);
+    if (*length < 0)
+    {
+        /* NULL id, returned as empty string */
+        *length = 0;
+    }
+
+    return ((size_t)*length < id_size) ? 1 : 0;
+}
+
+/*
+ * Peeks the id of a message, with a parse context (can be NULL), without
+ * parsing objects: if the message is compressed, data is decompressed only
+ * until the id is complete.
+ *
+ * The id is copied in "id", which is a buffer of "id_size" bytes (including
+ * the final '\0'); an id NULL in message is returned as empty string.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (invalid message or id too long for "id")
+ */
+
+int
+weechat_relay_parse_peek_id_ctx (struct t_weechat_relay_parse_ctx *ctx,
+                                 const void *buffer, size_t size,
+                                 char *id, size_t id_size)
+{
+    uint32_t msg_size, length32;
+    int rc, length;
+    z_stream strm;
+    ZSTD_DCtx *dctx;
+    ZSTD_inBuffer input_buf;
+
+    if (!buffer || (size < 6) || !id || (id_size == 0))
+        return 0;
+
+    memcpy (&msg_size, buffer, 4);
+    msg_size = ntohl (msg_size);
+    if (msg_size != size)
+        return 0;
+
+    rc = 0;
+    length = 0;
+
+    switch (((const char *)buffer)[4])
+    {
+        case WEECHAT_RELAY_COMPRESSION_OFF:
+            if (size < 9)
+                return 0;
+            memcpy (&length32, buffer + 5, 4);
+            if (!weechat_relay_parse_peek_id_length (length32, id_size,
+                                                     &length)
+                || (9 + (size_t)length > size))
+            {
+                return 0;
+            }
+            memcpy (id, buffer + 9, length);
+            rc = 1;
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZLIB:
+            memset (&strm, 0, sizeof (strm));
+            if (inflateInit (&strm) != Z_OK)
+                return 0;
+            strm.next_in = (Bytef *)buffer + 5;
+            strm.avail_in = size - 5;
+            rc = weechat_relay_parse_peek_read_zlib (&strm, &length32, 4)
+                && weechat_relay_parse_peek_id_length (length32, id_size,
+                                                       &length)
+                && weechat_relay_parse_peek_read_zlib (&strm, id, length);
+            inflateEnd (&strm);
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZSTD:
+            if (ctx)
+            {
+                if (!ctx->zstd_dctx)
+                {
+                    ctx->zstd_dctx = ZSTD_createDCtx();
+                    if (!ctx->zstd_dctx)
+                        return 0;
+                }
+                dctx = ctx->zstd_dctx;
+                ZSTD_DCtx_reset (dctx, ZSTD_reset_session_only);
+                if (ctx->zstd_ddict)
+                    ZSTD_DCtx_refDDict (dctx, ctx->zstd_ddict);
+            }
+            else
+            {
+                dctx = ZSTD_createDCtx();
+                if (!dctx)
+                    return 0;
+            }
+            input_buf.src = buffer + 5;
+            input_buf.size = size - 5;
+            input_buf.pos = 0;
+            rc = weechat_relay_parse_peek_read_zstd (dctx, &input_buf,
+                                                     &length32, 4)
+                && weechat_relay_parse_peek_id_length (length32, id_size,
+                                                       &length)
+                && weechat_relay_parse_peek_read_zstd (dctx, &input_buf,
+                                                       id, length);
+            if (!ctx)
+                ZSTD_freeDCtx(dctx);
+            break;
+        default:
+            return 0;
+    }
+
+    if (!rc)
+        return 0;
+
+    id[length] = '\0';
+
+    return 1;
+}
+
+/*
+ * Peeks the id of a message, without parsing objects: if the message is
+ * compressed, data is decompressed only until the id is complete.
+ *
+ * The id is copied in "id", which is a buffer of "id_size" bytes (including
+ * the final '\0'); an id NULL in message is returned as empty string.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (invalid message or id too long for "id")
+ */
+
+int
+weechat_relay_parse_peek_id (const void *buffer, size_t size,
+                             char *id, size_t id_size)
+{
+    return weechat_relay_parse_peek_id_ctx (NULL, buffer, size, id, id_size);
+}
+
+/*
+ * Allocates a message structure, using a parse context (can be NULL).
+ *
+ * Returns the new message, NULL if error.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_msg_alloc_ctx (struct t_weechat_relay_parse_ctx *ctx,
+                                   const void *buffer, size_t size)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    uint32_t msg_size;
+
+    if (!buffer || (size < 6))
+        return NULL;
+
+    parsed_msg = calloc (1, sizeof (*parsed_msg));
+    if (!parsed_msg)
+        return NULL;
+
+    memcpy (&msg_size, buffer, 4);
+    msg_size = ntohl (msg_size);
+
+    if (msg_size != size)
+        goto error;
+
+    parsed_msg->message = malloc (size);
+    if (!parsed_msg->message)
+        goto error;
+
+    memcpy (parsed_msg->message, buffer, size);
+    parsed_msg->refcount = 1;
+    parsed_msg->length = size;
+    parsed_msg->length_data = size - 5;
+
+    parsed_msg->compression = ((const char *)buffer)[4];
+
+    parsed_msg->position = 0;
+
+    switch (parsed_msg->compression)
+    {
+        case WEECHAT_RELAY_COMPRESSION_OFF:
+            parsed_msg->data_decompressed = NULL;
+            parsed_msg->length_data_decompressed = size - 5;
+            parsed_msg->buffer = (const char *)parsed_msg->message + 5;
+            parsed_msg->size = size - 5;
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZLIB:
+            parsed_msg->data_decompressed = weechat_relay_parse_decompress_zlib (
+                buffer + 5,
+                size - 5,
+                10 * (size - 5),
+                &parsed_msg->length_data_decompressed);
+            if (!parsed_msg->data_decompressed)
+                goto error;
+            parsed_msg->buffer = parsed_msg->data_decompressed;
+            parsed_msg->size = parsed_msg->length_data_decompressed;
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZSTD:
+            parsed_msg->data_decompressed = weechat_relay_parse_decompress_zstd_ctx (
+                ctx,
+                buffer + 5,
+                size - 5,
+                10 * (size - 5),
+                &parsed_msg->length_data_decompressed);
+            if (!parsed_msg->data_decompressed)
+                goto error;
+            parsed_msg->buffer = parsed_msg->data_decompressed;
+            parsed_msg->size = parsed_msg->length_data_decompressed;
+            break;
+        case WEECHAT_RELAY_NUM_COMPRESSIONS:
+            break;
+    }
+
+    if (!weechat_relay_parse_read_id (ctx, parsed_msg))
+        goto error;
+
+    return parsed_msg;
+
+error:
+    weechat_relay_parse_msg_destroy (parsed_msg);
+    return NULL;
+}
+
+/*
+ * Allocates a message structure.
+ *
+ * Returns the new message, NULL if error.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_msg_alloc (const void *buffer, size_t size)
+{
+    return weechat_relay_parse_msg_alloc_ctx (NULL, buffer, size);
+}
+
+/*
+ * Allocates a message structure from a message split in segments, using a
+ * parse context (can be NULL).
+ *
+ * The message is not copied: if it is not compressed, the segments are
+ * read directly during parse (they must not be modified or freed until
+ * the parse is done), and if it is compressed, the segments are
+ * decompressed one after the other.
+ *
+ * Returns the new message, NULL if error.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_msg_alloc_iov_ctx (struct t_weechat_relay_parse_ctx *ctx,
+                                       const struct iovec *iov, int iovcnt)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    unsigned char header[5];
+    uint32_t msg_size;
+    size_t size, start, offset_segment;
+    int i, index, count;
+
+    if (!iov || (iovcnt <= 0))
+        return NULL;
+
+    size = weechat_relay_parse_iov_size (iov, iovcnt);
+    if (size < 6)
+        return NULL;
+
+    index = 0;
+    start = 0;
+    if (!weechat_relay_parse_iov_copy (iov, iovcnt, &index, &start, 0,
+                                       header, sizeof (header)))
+    {
+        return NULL;
+    }
+
+    memcpy (&msg_size, header, 4);
+    msg_size = ntohl (msg_size);
+    if (msg_size != size)
+        return NULL;
+
+    parsed_msg = calloc (1, sizeof (*parsed_msg));
+    if (!parsed_msg)
+        return NULL;
+
+    /* segments after the 5 first bytes (index/start are on byte 5) */
+    weechat_relay_parse_iov_seek (iov, iovcnt, &index, &start, 5);
+    parsed_msg->iovcnt = iovcnt - index;
+    parsed_msg->iov = malloc (sizeof (*parsed_msg->iov) * parsed_msg->iovcnt);
+    if (!parsed_msg->iov)
+        goto error;
+    offset_segment = 5 - start;
+    count = 0;
+    for (i = index; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len <= offset_segment)
+        {
+            offset_segment = 0;
+            continue;
+        }
+        parsed_msg->iov[count].iov_base = (char *)iov[i].iov_base
+            + offset_segment;
+        parsed_msg->iov[count].iov_len = iov[i].iov_len - offset_segment;
+        offset_segment = 0;
+        count++;
+    }
+    parsed_msg->iovcnt = count;
+    parsed_msg->iov_index = 0;
+    parsed_msg->iov_start = 0;
+
+    parsed_msg->message = NULL;
+    parsed_msg->refcount = 1;
+    parsed_msg->length = size;
+    parsed_msg->length_data = size - 5;
+
+    parsed_msg->compression = header[4];
+
+    parsed_msg->position = 0;
+
+    switch (parsed_msg->compression)
+    {
+        case WEECHAT_RELAY_COMPRESSION_OFF:
+            parsed_msg->data_decompressed = NULL;
+            parsed_msg->length_data_decompressed = size - 5;
+            parsed_msg->buffer = NULL;
+            parsed_msg->size = size - 5;
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZLIB:
+            parsed_msg->data_decompressed = weechat_relay_parse_decompress_zlib_iov (
+                parsed_msg->iov,
+                parsed_msg->iovcnt,
+                10 * (size - 5),
+                &parsed_msg->length_data_decompressed);
+            if (!parsed_msg->data_decompressed)
+                goto error;
+            parsed_msg->buffer = parsed_msg->data_decompressed;
+            parsed_msg->size = parsed_msg->length_data_decompressed;
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZSTD:
+            parsed_msg->data_decompressed = weechat_relay_parse_decompress_zstd_iov (
+                ctx,
+                parsed_msg->iov,
+                parsed_msg->iovcnt,
+                10 * (size - 5),
+                &parsed_msg->length_data_decompressed);
+            if (!parsed_msg->data_decompressed)
+                goto error;
+            parsed_msg->buffer = parsed_msg->data_decompressed;
+            parsed_msg->size = parsed_msg->length_data_decompressed;
+            break;
+        default:
+            goto error;
+    }
+
+    if (parsed_msg->data_decompressed)
+    {
+        /* decompressed data is contiguous: segments are not used anymore */
+        free (parsed_msg->iov);
+        parsed_msg->iov = NULL;
+        parsed_msg->iovcnt = 0;
+    }
+
+    if (!weechat_relay_parse_read_id (ctx, parsed_msg))
+        goto error;
+
+    return parsed_msg;
+
+error:
+    weechat_relay_parse_msg_destroy (parsed_msg);
+    return NULL;
+}
+
+/*
+ * Frees a message (whatever the number of references).
+ */
+
+void
+weechat_relay_parse_msg_destroy (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    int i;
+
+    if (!parsed_msg)
+        return;
+
+    if (parsed_msg->message)
+        free (parsed_msg->message);
+    if (parsed_msg->data_decompressed)
+        free (parsed_msg->data_decompressed);
+    if (parsed_msg->iov)
+        free (parsed_msg->iov);
+
+    if (parsed_msg->id && (parsed_msg->event == WEECHAT_RELAY_EVENT_NONE))
+    {
+        if (parsed_msg->id_custom > 0)
+            weechat_relay_dispatch_id_unref (parsed_msg->id);
+        else
+            free (parsed_msg->id);
+    }
+
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        weechat_relay_obj_free (parsed_msg->objects[i]);
+    }
+    if (parsed_msg->objects)
+        free (parsed_msg->objects);
+
+    for (i = 0; i < parsed_msg->num_values; i++)
+    {
+        weechat_relay_value_clear (&parsed_msg->values[i]);
+    }
+    if (parsed_msg->values)
+        free (parsed_msg->values);
+
+    free (parsed_msg);
+}
+
+/*
+ * Adds a reference to a parsed message.
+ *
+ * A parsed message can be shared by multiple consumers in different
+ * threads: each one retains the message and releases it when done.
+ * The only changes after parse are:
+ *   - the hash index of hashtables (weechat_relay_obj_hashtable_build_index)
+ *     and the objects built for the values of columnar infolists
+ *     (weechat_relay_obj_infolist_column_get): they are built on first use
+ *     and published atomically, any thread can call these functions;
+ *   - the dirty flags of objects (weechat_relay_parse_msg_set_dirty): only
+ *     allowed when the caller owns the only reference;
+ *   - the reference count (atomic) and the link to the next message in the
+ *     reclaimer (weechat_relay_reclaim_release), set when the last reference
+ *     is released.
+ * Any other change of objects must be synchronized by the caller.
+ *
+ * Returns the parsed message.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_msg_retain (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    if (parsed_msg)
+        __atomic_add_fetch (&parsed_msg->refcount, 1, __ATOMIC_RELAXED);
+
+    return parsed_msg;
+}
+
+/*
+ * Removes a reference to a parsed message, and frees it if this was the
+ * last reference.
+ */
+
+void
+weechat_relay_parse_msg_release (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    if (!parsed_msg)
+        return;
+
+    if (__atomic_sub_fetch (&parsed_msg->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+        weechat_relay_parse_msg_destroy (parsed_msg);
+}
+
+/*
+ * Frees a message: same as weechat_relay_parse_msg_release (the message is
+ * freed only when there is no other reference on it).
+ */
+
+void
+weechat_relay_parse_msg_free (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    weechat_relay_parse_msg_release (parsed_msg);
+}
+
+/*
+ * Marks an object of a parsed message as modified (it can be a top-level
+ * object or any object inside): the object and all objects containing it are
+ * built again when the message is built with weechat_relay_msg_new_parsed,
+ * other objects are copied as-is from the message received.
+ *
+ * The caller must own the only reference on the message: objects can not be
+ * modified while the message is shared (see weechat_relay_parse_msg_retain),
+ * since another thread could build a message with them at the same time.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (message shared, or object not found in message)
+ */
+
+int
+weechat_relay_parse_msg_set_dirty (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                   struct t_weechat_relay_obj *obj)
+{
+    int i;
+
+    if (!parsed_msg || !obj
+        || (__atomic_load_n (&parsed_msg->refcount, __ATOMIC_ACQUIRE) != 1))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        if (weechat_relay_obj_set_dirty (parsed_msg->objects[i], obj))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Adds an object to the list of objects in parsed message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (the object is not added)
+ */
+
+int
+weechat_relay_parse_add_object (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                struct t_weechat_relay_obj *obj)
+{
+    struct t_weechat_relay_obj **objects;
+
+    objects = realloc (parsed_msg->objects,
+                       sizeof (*parsed_msg->objects) * (parsed_msg->num_objects + 1));
+    if (!objects)
+        return 0;
+    parsed_msg->objects = objects;
+    parsed_msg->objects[parsed_msg->num_objects] = obj;
+    parsed_msg->num_objects++;
+
+    return 1;
+}
+
+/*
+ * Parses an object of type "type" (already read in message) and adds it to
+ * the parsed message (as a value with flag WEECHAT_RELAY_PARSE_FLAG_VALUES).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_parse_next_object (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                 enum t_weechat_relay_obj_type type)
+{
+    struct t_weechat_relay_obj *obj;
+    struct t_weechat_relay_value *values;
+
+    if (parsed_msg->flags & WEECHAT_RELAY_PARSE_FLAG_VALUES)
     {
-        output_buf.dst = dest_buf;
-        output_buf.size = dest_buf_size;
-        output_buf.pos = 0;
+        /* add value to the array of values in parsed message */
+        values = realloc (parsed_msg->values,
+                          sizeof (*parsed_msg->values) * (parsed_msg->num_values + 1));
+        if (!values)
+            return 0;
+        parsed_msg->values = values;
+        if (!weechat_relay_parse_read_value (
+                parsed_msg, type,
+                &parsed_msg->values[parsed_msg->num_values]))
+            return 0;
+        parsed_msg->num_values++;
+        return 1;
+    }
 
-        rc_decompress = ZSTD_decompressStream (dctx, &output_buf, &input_buf);
+    obj = weechat_relay_parse_read_object (parsed_msg, type);
+    if (!obj)
+        return 0;
 
-        if (ZSTD_isError(rc_decompress))
-            goto error;
+    if (!weechat_relay_parse_add_object (parsed_msg, obj))
+    {
+        weechat_relay_obj_free (obj);
+        return 0;
+    }
 
-        if (output_buf.pos > 0)
+    return 1;
+}
+
+/*
+ * Parses objects (or values) of a message, after the id, with flags
+ * (combination of WEECHAT_RELAY_PARSE_FLAG_XXX).
+ *
+ * Parse stops at first error: the objects parsed before are kept in
+ * message.
+ */
+
+void
+weechat_relay_parse_objects (struct t_weechat_relay_parsed_msg *parsed_msg,
+                             int flags)
+{
+    enum t_weechat_relay_obj_type type;
+
+    parsed_msg->flags = flags;
+
+    while (parsed_msg->position < parsed_msg->size)
+    {
+        if (!weechat_relay_parse_read_type (parsed_msg, &type))
+            break;
+        if (!weechat_relay_parse_next_object (parsed_msg, type))
+            break;
+    }
+}
+
+/*
+ * Parses a WeeChat binary message, with a parse context (can be NULL) and
+ * flags (combination of WEECHAT_RELAY_PARSE_FLAG_XXX).
+ *
+ * Returns the parsed message, NULL if error.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_message_ctx (struct t_weechat_relay_parse_ctx *ctx,
+                                 const void *buffer, size_t size, int flags)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+
+    parsed_msg = weechat_relay_parse_msg_alloc_ctx (ctx, buffer, size);
+    if (!parsed_msg)
+        return NULL;
+
+    weechat_relay_parse_objects (parsed_msg, flags);
+
+    return parsed_msg;
+}
+
+/*
+ * Copies the segments of a message not compressed in a contiguous buffer
+ * (the message), so that objects can keep their bytes received (parser flag
+ * PASSTHROUGH): the segments belong to the caller and are not used after
+ * parse.
+ *
+ * Returns:
+ *   1: OK (or nothing to copy)
+ *   0: error
+ */
+
+int
+weechat_relay_parse_iov_flatten (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    uint32_t msg_size;
+    size_t pos;
+    int i;
+
+    if (!parsed_msg->iov)
+        return 1;
+
+    parsed_msg->message = malloc (parsed_msg->length);
+    if (!parsed_msg->message)
+        return 0;
+
+    msg_size = htonl ((uint32_t)parsed_msg->length);
+    memcpy (parsed_msg->message, &msg_size, 4);
+    ((char *)parsed_msg->message)[4] = (char)parsed_msg->compression;
+    pos = 5;
+    for (i = 0; i < parsed_msg->iovcnt; i++)
+    {
+        memcpy ((char *)parsed_msg->message + pos,
+                parsed_msg->iov[i].iov_base, parsed_msg->iov[i].iov_len);
+        pos += parsed_msg->iov[i].iov_len;
+    }
+
+    parsed_msg->buffer = (const char *)parsed_msg->message + 5;
+    free (parsed_msg->iov);
+    parsed_msg->iov = NULL;
+    parsed_msg->iovcnt = 0;
+    parsed_msg->iov_index = 0;
+    parsed_msg->iov_start = 0;
+
+    return 1;
+}
+
+/*
+ * Parses a WeeChat binary message split in segments (for example received
+ * with readv or in multiple network reads), with a parse context (can be
+ * NULL) and flags (combination of WEECHAT_RELAY_PARSE_FLAG_XXX).
+ *
+ * Segments are not coalesced in a contiguous buffer: only the values split
+ * between two segments are copied; segments can be freed after the call.
+ *
+ * Returns the parsed message, NULL if error.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_message_iov_ctx (struct t_weechat_relay_parse_ctx *ctx,
+                                     const struct iovec *iov, int iovcnt,
+                                     int flags)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+
+    parsed_msg = weechat_relay_parse_msg_alloc_iov_ctx (ctx, iov, iovcnt);
+    if (!parsed_msg)
+        return NULL;
+
+    if ((flags & WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH)
+        && !weechat_relay_parse_iov_flatten (parsed_msg))
+    {
+        weechat_relay_parse_msg_free (parsed_msg);
+        return NULL;
+    }
+
+    weechat_relay_parse_objects (parsed_msg, flags);
+
+    /* segments belong to the caller: they must not be used after parse */
+    if (parsed_msg->iov)
+    {
+        free (parsed_msg->iov);
+        parsed_msg->iov = NULL;
+        parsed_msg->iovcnt = 0;
+        parsed_msg->iov_index = 0;
+        parsed_msg->iov_start = 0;
+    }
+
+    return parsed_msg;
+}
+
+/*
+ * Parses a WeeChat binary message, with flags (combination of
+ * WEECHAT_RELAY_PARSE_FLAG_XXX).
+ *
+ * Returns the parsed message, NULL if error.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_message_flags (const void *buffer, size_t size, int flags)
+{
+    return weechat_relay_parse_message_ctx (NULL, buffer, size, flags);
+}
+
+/*
+ * Parses a WeeChat binary message.
+ *
+ * Returns the parsed message, NULL if error.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_message (const void *buffer, size_t size)
+{
+    return weechat_relay_parse_message_flags (buffer, size, 0);
+}
+
+/*
+ * Parses a WeeChat binary message split in segments, with flags
+ * (combination of WEECHAT_RELAY_PARSE_FLAG_XXX).
+ *
+ * Returns the parsed message, NULL if error.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_message_iov (const struct iovec *iov, int iovcnt,
+                                 int flags)
+{
+    return weechat_relay_parse_message_iov_ctx (NULL, iov, iovcnt, flags);
+}
+
+/*
+ * Returns the current time (monotonic clock), in microseconds.
+ */
+
+long long
+weechat_relay_parse_time_usec ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ((long long)ts.tv_sec * 1000000LL) + (ts.tv_nsec / 1000);
+}
+
+/*
+ * Converts the bytes of objects in the message received (parser flag
+ * PASSTHROUGH) to offsets from "base" (if "to_offset" is 1), or converts
+ * these offsets back to pointers in "base" (if "to_offset" is 0).
+ *
+ * This is used to move the decompressed data without reading the old
+ * pointer after it is reallocated (an object never starts at offset 0: the
+ * message id is first).
+ */
+
+void
+weechat_relay_parse_rebase_wire (struct t_weechat_relay_obj *obj,
+                                 const char *base, int to_offset)
+{
+    struct t_weechat_relay_obj_infolist_item *ptr_item;
+    int i, j;
+
+    if (!obj)
+        return;
+
+    if (obj->wire)
+    {
+        obj->wire = (to_offset) ?
+            (const char *)((uintptr_t)obj->wire - (uintptr_t)base) :
+            base + (uintptr_t)obj->wire;
+    }
+
+    switch (obj->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            for (i = 0; i < obj->value_hashtable.count; i++)
+            {
+                weechat_relay_parse_rebase_wire (obj->value_hashtable.keys[i],
+                                                 base, to_offset);
+                weechat_relay_parse_rebase_wire (obj->value_hashtable.values[i],
+                                                 base, to_offset);
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            for (i = 0; i < obj->value_hdata.count; i++)
+            {
+                for (j = 0; obj->value_hdata.ppath[i]
+                         && (j < obj->value_hdata.num_hpaths); j++)
+                {
+                    weechat_relay_parse_rebase_wire (
+                        obj->value_hdata.ppath[i][j], base, to_offset);
+                }
+                for (j = 0; obj->value_hdata.values[i]
+                         && (j < obj->value_hdata.num_keys); j++)
+                {
+                    weechat_relay_parse_rebase_wire (
+                        obj->value_hdata.values[i][j], base, to_offset);
+                }
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            for (i = 0; obj->value_infolist.items
+                     && (i < obj->value_infolist.count); i++)
+            {
+                ptr_item = obj->value_infolist.items[i];
+                for (j = 0; ptr_item && (j < ptr_item->count); j++)
+                {
+                    weechat_relay_parse_rebase_wire (
+                        ptr_item->variables[j]->value, base, to_offset);
+                }
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            for (i = 0; obj->value_array.values
+                     && (i < obj->value_array.count); i++)
+            {
+                weechat_relay_parse_rebase_wire (obj->value_array.values[i],
+                                                 base, to_offset);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Converts the bytes of objects already parsed in handle (parser flag
+ * PASSTHROUGH) to offsets from "base", or back to pointers in "base" (see
+ * weechat_relay_parse_rebase_wire).
+ */
+
+void
+weechat_relay_parse_handle_rebase_wire (struct t_weechat_relay_parse_handle *handle,
+                                        const char *base, int to_offset)
+{
+    int i;
+
+    for (i = 0; i < handle->parsed_msg->num_objects; i++)
+    {
+        weechat_relay_parse_rebase_wire (handle->parsed_msg->objects[i],
+                                         base, to_offset);
+    }
+    weechat_relay_parse_rebase_wire (handle->container, base, to_offset);
+}
+
+/*
+ * Ends the decompression of message in handle: the streams are freed.
+ */
+
+void
+weechat_relay_parse_handle_decompress_end (struct t_weechat_relay_parse_handle *handle)
+{
+    handle->decompress_done = 1;
+
+    if (handle->zlib_stream)
+    {
+        inflateEnd (handle->zlib_stream);
+        free (handle->zlib_stream);
+        handle->zlib_stream = NULL;
+    }
+    if (handle->zstd_stream)
+    {
+        ZSTD_freeDStream (handle->zstd_stream);
+        handle->zstd_stream = NULL;
+    }
+}
+
+/*
+ * Decompresses the next bytes of message in handle (at most
+ * handle->decompress_size bytes): they are added at the end of the
+ * decompressed data, which can be read by the parser.
+ *
+ * If the buffer must be enlarged, it is moved (with the bytes of objects
+ * already parsed, parser flag PASSTHROUGH).
+ *
+ * Returns:
+ *   1: OK (or all data decompressed)
+ *   0: error (invalid or truncated data, decompression is ended)
+ */
+
+int
+weechat_relay_parse_handle_decompress (struct t_weechat_relay_parse_handle *handle)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    z_stream *strm;
+    ZSTD_inBuffer input_buf;
+    ZSTD_outBuffer output_buf;
+    const char *input;
+    char *new_buffer;
+    size_t input_size, output_size, new_alloc, rc_zstd;
+    int rc, rebase;
+
+    if (handle->decompress_done)
+        return 1;
+
+    parsed_msg = handle->parsed_msg;
+
+    /* enlarge the buffer if it is full */
+    if (parsed_msg->size >= handle->output_alloc)
+    {
+        new_alloc = (handle->output_alloc > 0) ?
+            handle->output_alloc * 2 : WEECHAT_RELAY_PARSE_STEP_DECOMPRESS_SIZE;
+        rebase = (parsed_msg->data_decompressed
+                  && (parsed_msg->flags & WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH));
+        if (rebase)
         {
-            if (dest_pos + output_buf.pos > dest_size_alloc)
+            weechat_relay_parse_handle_rebase_wire (
+                handle, parsed_msg->data_decompressed, 1);
+        }
+        new_buffer = realloc (parsed_msg->data_decompressed, new_alloc);
+        if (!new_buffer)
+        {
+            /* buffer unchanged */
+            if (rebase)
             {
-                dest_size_alloc = dest_pos + output_buf.pos;
-                dest2 = realloc (dest, dest_size_alloc);
-                if (!dest2)
-                    goto error;
-                dest = dest2;
+                weechat_relay_parse_handle_rebase_wire (
+                    handle, parsed_msg->data_decompressed, 0);
             }
-            memcpy (dest + dest_pos, dest_buf, output_buf.pos);
-            dest_pos += output_buf.pos;
+            goto error;
+        }
+        if (rebase)
+            weechat_relay_parse_handle_rebase_wire (handle, new_buffer, 0);
+        parsed_msg->data_decompressed = new_buffer;
+        parsed_msg->buffer = new_buffer;
+        handle->output_alloc = new_alloc;
+    }
+
+    input = (const char *)parsed_msg->message + 5 + handle->input_position;
+    input_size = parsed_msg->length_data - handle->input_position;
+    output_size = handle->output_alloc - parsed_msg->size;
+    if (output_size > handle->decompress_size)
+        output_size = handle->decompress_size;
+
+    if (handle->zlib_stream)
+    {
+        strm = handle->zlib_stream;
+        strm->next_in = (Bytef *)input;
+        strm->avail_in = input_size;
+        strm->next_out = (Bytef *)parsed_msg->data_decompressed
+            + parsed_msg->size;
+        strm->avail_out = output_size;
+        rc = inflate (strm, Z_NO_FLUSH);
+        handle->input_position += input_size - strm->avail_in;
+        parsed_msg->size += output_size - strm->avail_out;
+        if (rc == Z_STREAM_END)
+        {
+            weechat_relay_parse_handle_decompress_end (handle);
+        }
+        else if (((rc != Z_OK) && (rc != Z_BUF_ERROR))
+                 || (strm->avail_out == output_size))
+        {
+            /* error, or no progress (truncated data) */
+            goto error;
+        }
+    }
+    else if (handle->zstd_stream)
+    {
+        input_buf.src = input;
+        input_buf.size = input_size;
+        input_buf.pos = 0;
+        output_buf.dst = (char *)parsed_msg->data_decompressed
+            + parsed_msg->size;
+        output_buf.size = output_size;
+        output_buf.pos = 0;
+        rc_zstd = ZSTD_decompressStream (handle->zstd_stream, &output_buf,
+                                         &input_buf);
+        if (ZSTD_isError(rc_zstd))
+            goto error;
+        handle->input_position += input_buf.pos;
+        parsed_msg->size += output_buf.pos;
+        if (rc_zstd == 0)
+        {
+            /* frame complete */
+            weechat_relay_parse_handle_decompress_end (handle);
+        }
+        else if ((output_buf.pos == 0) && (input_buf.pos == 0))
+        {
+            /* no progress (truncated data) */
+            goto error;
         }
-        rc = rc_decompress;
+    }
+    else
+    {
+        weechat_relay_parse_handle_decompress_end (handle);
     }
 
-    if (rc != 0)
-        goto error;
-
-    *size_decompressed = dest_pos;
-
-    free (dest_buf);
-    ZSTD_freeDCtx(dctx);
+    parsed_msg->length_data_decompressed = parsed_msg->size;
 
-    return dest;
+    return 1;
 
 error:
-    if (dest)
-        free (dest);
-    if (dest_buf)
-        free (dest_buf);
-    if (dctx)
-        ZSTD_freeDCtx(dctx);
-    return NULL;
+    parsed_msg->length_data_decompressed = parsed_msg->size;
+    weechat_relay_parse_handle_decompress_end (handle);
+    return 0;
 }
 
 /*
- * Allocates a message structure.
+ * Creates a handle to parse a WeeChat binary message in multiple steps, with
+ * flags (combination of WEECHAT_RELAY_PARSE_FLAG_XXX): the message header and
+ * id are read immediately, objects are read by weechat_relay_parse_handle_step.
  *
- * Returns the new message, NULL if error.
+ * A compressed message is decompressed by steps too: only the bytes needed
+ * to read the id are decompressed here.
+ *
+ * The buffer is copied, so it can be freed after the call.
+ *
+ * Returns the parse handle, NULL if error (invalid message).
  */
 
-struct t_weechat_relay_parsed_msg *
-weechat_relay_parse_msg_alloc (const void *buffer, size_t size)
+struct t_weechat_relay_parse_handle *
+weechat_relay_parse_handle_new (const void *buffer, size_t size, int flags)
 {
+    struct t_weechat_relay_parse_handle *handle;
     struct t_weechat_relay_parsed_msg *parsed_msg;
+    unsigned long long content_size;
     uint32_t msg_size;
 
     if (!buffer || (size < 6))
         return NULL;
 
-    parsed_msg = calloc (1, sizeof (*parsed_msg));
-    if (!parsed_msg)
-        return NULL;
+    if (((const char *)buffer)[4] == WEECHAT_RELAY_COMPRESSION_OFF)
+    {
+        parsed_msg = weechat_relay_parse_msg_alloc (buffer, size);
+        if (!parsed_msg)
+            return NULL;
+        handle = calloc (1, sizeof (*handle));
+        if (!handle)
+        {
+            weechat_relay_parse_msg_destroy (parsed_msg);
+            return NULL;
+        }
+        handle->parsed_msg = parsed_msg;
+        handle->decompress_done = 1;
+        parsed_msg->flags = flags;
+        return handle;
+    }
 
     memcpy (&msg_size, buffer, 4);
     msg_size = ntohl (msg_size);
-
     if (msg_size != size)
+        return NULL;
+
+    handle = calloc (1, sizeof (*handle));
+    if (!handle)
+        return NULL;
+
+    parsed_msg = calloc (1, sizeof (*parsed_msg));
+    if (!parsed_msg)
         goto error;
+    handle->parsed_msg = parsed_msg;
 
     parsed_msg->message = malloc (size);
     if (!parsed_msg->message)
         goto error;
-
     memcpy (parsed_msg->message, buffer, size);
+    parsed_msg->refcount = 1;
     parsed_msg->length = size;
     parsed_msg->length_data = size - 5;
-
     parsed_msg->compression = ((const char *)buffer)[4];
+    parsed_msg->flags = flags;
 
-    parsed_msg->position = 0;
-
+    /* decompressed data: frame size if known (zstd), otherwise estimated */
+    handle->output_alloc = 4 * (size - 5);
     switch (parsed_msg->compression)
     {
-        case WEECHAT_RELAY_COMPRESSION_OFF:
-            parsed_msg->data_decompressed = NULL;
-            parsed_msg->length_data_decompressed = size - 5;
-            parsed_msg->buffer = buffer + 5;
-            parsed_msg->size = size - 5;
-            break;
         case WEECHAT_RELAY_COMPRESSION_ZLIB:
-            parsed_msg->data_decompressed = weechat_relay_parse_decompress_zlib (
-                buffer + 5,
-                size - 5,
-                10 * (size - 5),
-                &parsed_msg->length_data_decompressed);
-            if (!parsed_msg->data_decompressed)
+            handle->zlib_stream = calloc (1, sizeof (z_stream));
+            if (!handle->zlib_stream)
                 goto error;
-            parsed_msg->buffer = parsed_msg->data_decompressed;
-            parsed_msg->size = parsed_msg->length_data_decompressed;
+            if (inflateInit (handle->zlib_stream) != Z_OK)
+            {
+                free (handle->zlib_stream);
+                handle->zlib_stream = NULL;
+                goto error;
+            }
             break;
         case WEECHAT_RELAY_COMPRESSION_ZSTD:
-            parsed_msg->data_decompressed = weechat_relay_parse_decompress_zstd (
-                buffer + 5,
-                size - 5,
-                10 * (size - 5),
-                &parsed_msg->length_data_decompressed);
-            if (!parsed_msg->data_decompressed)
+            handle->zstd_stream = ZSTD_createDStream ();
+            if (!handle->zstd_stream)
                 goto error;
-            parsed_msg->buffer = parsed_msg->data_decompressed;
-            parsed_msg->size = parsed_msg->length_data_decompressed;
-            break;
-        case WEECHAT_RELAY_NUM_COMPRESSIONS:
+            ZSTD_initDStream (handle->zstd_stream);
+            content_size = ZSTD_getFrameContentSize (
+                (const char *)parsed_msg->message + 5, size - 5);
+            if ((content_size != ZSTD_CONTENTSIZE_UNKNOWN)
+                && (content_size != ZSTD_CONTENTSIZE_ERROR)
+                && (content_size > 0)
+                && (content_size <= (unsigned long long)(size - 5)
+                    * WEECHAT_RELAY_PARSE_ZSTD_MAX_RATIO))
+            {
+                handle->output_alloc = content_size;
+            }
             break;
+        default:
+            goto error;
     }
-
-    if (!weechat_relay_parse_read_string (parsed_msg, &parsed_msg->id))
+    parsed_msg->data_decompressed = malloc (handle->output_alloc);
+    if (!parsed_msg->data_decompressed)
         goto error;
+    parsed_msg->buffer = parsed_msg->data_decompressed;
+    parsed_msg->size = 0;
+    handle->decompress_size = WEECHAT_RELAY_PARSE_STEP_DECOMPRESS_SIZE;
 
-    return parsed_msg;
+    /* decompress until the id is complete */
+    while (1)
+    {
+        parsed_msg->position = 0;
+        if (weechat_relay_parse_read_id (NULL, parsed_msg))
+            break;
+        if (handle->decompress_done
+            || !weechat_relay_parse_handle_decompress (handle))
+        {
+            goto error;
+        }
+    }
+
+    return handle;
 
 error:
-    weechat_relay_parse_msg_free (parsed_msg);
+    weechat_relay_parse_handle_free (handle);
     return NULL;
 }
 
 /*
- * Frees a message.
+ * Ends the container (all elements are read) and adds it to the message.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (container is freed)
  */
 
-void
-weechat_relay_parse_msg_free (struct t_weechat_relay_parsed_msg *parsed_msg)
+int
+weechat_relay_parse_handle_container_end (struct t_weechat_relay_parse_handle *handle)
 {
-    int i;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj *obj;
 
-    if (!parsed_msg)
-        return;
+    parsed_msg = handle->parsed_msg;
+    obj = handle->container;
+    handle->container = NULL;
 
-    if (parsed_msg->message)
-        free (parsed_msg->message);
-    if (parsed_msg->data_decompressed)
-        free (parsed_msg->data_decompressed);
+    switch (obj->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            weechat_relay_parse_hashtable_end (parsed_msg,
+                                               &obj->value_hashtable);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            weechat_relay_parse_hdata_end (&obj->value_hdata);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            /* empty infolist: classic representation */
+            if (!obj->value_infolist.items && !obj->value_infolist.schema
+                && !weechat_relay_parse_infolist_items (
+                    parsed_msg, &obj->value_infolist, 0, 0))
+            {
+                goto error;
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            weechat_relay_parse_array_end (&obj->value_array);
+            break;
+        default:
+            break;
+    }
 
-    if (parsed_msg->id)
-        free (parsed_msg->id);
+    weechat_relay_parse_set_wire (parsed_msg, obj, handle->container_position);
+    if (!weechat_relay_parse_add_object (parsed_msg, obj))
+        goto error;
 
-    for (i = 0; i < parsed_msg->num_objects; i++)
+    return 1;
+
+error:
+    weechat_relay_obj_free (obj);
+    return 0;
+}
+
+/*
+ * Reads at most "count" elements of the container in handle; elements are
+ * read one by one, so that on error the position is restored at the
+ * beginning of the element not read.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough decompressed data or invalid element)
+ */
+
+int
+weechat_relay_parse_handle_elements (struct t_weechat_relay_parse_handle *handle,
+                                     int count, int *num_read)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj *obj;
+    size_t position;
+    int i, total, rc;
+
+    parsed_msg = handle->parsed_msg;
+    obj = handle->container;
+
+    for (i = 0; handle->container && (i < count); i++)
     {
-        weechat_relay_obj_free (parsed_msg->objects[i]);
+        switch (obj->type)
+        {
+            case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+                total = obj->value_hashtable.count;
+                break;
+            case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+                total = obj->value_hdata.count;
+                break;
+            case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+                total = obj->value_infolist.count;
+                break;
+            case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+                total = obj->value_array.count;
+                break;
+            default:
+                total = 0;
+                break;
+        }
+        if (handle->container_index >= total)
+            return weechat_relay_parse_handle_container_end (handle);
+
+        position = parsed_msg->position;
+        switch (obj->type)
+        {
+            case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+                rc = weechat_relay_parse_hashtable_items (
+                    parsed_msg, &obj->value_hashtable,
+                    handle->container_index, 1);
+                break;
+            case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+                rc = weechat_relay_parse_hdata_rows (
+                    parsed_msg, &obj->value_hdata,
+                    handle->container_index, 1);
+                break;
+            case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+                if ((parsed_msg->flags & WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS)
+                    && !handle->columns_failed)
+                {
+                    rc = weechat_relay_parse_infolist_columns_items (
+                        parsed_msg, &obj->value_infolist,
+                        handle->container_index, 1);
+                    if (!rc && handle->decompress_done)
+                    {
+                        /*
+                         * items can not be read in columns: they are read
+                         * again with the classic representation
+                         */
+                        weechat_relay_obj_infolist_free_columns (
+                            &obj->value_infolist);
+                        parsed_msg->position = handle->container_elements;
+                        handle->container_index = 0;
+                        handle->columns_failed = 1;
+                        continue;
+                    }
+                }
+                else
+                {
+                    rc = weechat_relay_parse_infolist_items (
+                        parsed_msg, &obj->value_infolist,
+                        handle->container_index, 1);
+                }
+                break;
+            case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+                rc = weechat_relay_parse_array_items (
+                    parsed_msg, &obj->value_array,
+                    handle->container_index, 1);
+                break;
+            default:
+                rc = 0;
+                break;
+        }
+        if (!rc)
+        {
+            parsed_msg->position = position;
+            return 0;
+        }
+        handle->container_index++;
+        (*num_read)++;
     }
-    if (parsed_msg->objects)
-        free (parsed_msg->objects);
 
-    free (parsed_msg);
+    return 1;
 }
 
 /*
- * Parses a WeeChat binary message.
+ * Reads the next object of message in handle: a container (hdata,
+ * hashtable, infolist or array) is started, its elements are read by
+ * weechat_relay_parse_handle_elements.
  *
- * Returns the parsed message, NULL if error.
+ * Returns:
+ *   1: OK
+ *   0: error (not enough decompressed data or invalid object), the
+ *      position is restored
  */
 
-struct t_weechat_relay_parsed_msg *
-weechat_relay_parse_message (const void *buffer, size_t size)
+int
+weechat_relay_parse_handle_object (struct t_weechat_relay_parse_handle *handle,
+                                   int *num_read)
 {
     struct t_weechat_relay_parsed_msg *parsed_msg;
-    struct t_weechat_relay_obj *obj, **objects;
+    struct t_weechat_relay_obj *obj;
     enum t_weechat_relay_obj_type type;
+    size_t position;
 
-    parsed_msg = weechat_relay_parse_msg_alloc (buffer, size);
-    if (!parsed_msg)
-        return NULL;
+    parsed_msg = handle->parsed_msg;
+    position = parsed_msg->position;
 
-    while (parsed_msg->position < parsed_msg->size)
-    {
-        if (!weechat_relay_parse_read_type (parsed_msg, &type))
-            break;
+    if (!weechat_relay_parse_read_type (parsed_msg, &type))
+        goto error;
 
-        obj = weechat_relay_parse_read_object (parsed_msg, type);
+    if (!(parsed_msg->flags & WEECHAT_RELAY_PARSE_FLAG_VALUES)
+        && ((type == WEECHAT_RELAY_OBJ_TYPE_HASHTABLE)
+            || (type == WEECHAT_RELAY_OBJ_TYPE_HDATA)
+            || (type == WEECHAT_RELAY_OBJ_TYPE_INFOLIST)
+            || (type == WEECHAT_RELAY_OBJ_TYPE_ARRAY)))
+    {
+        /* container: elements are read in next iterations */
+        switch (type)
+        {
+            case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+                obj = weechat_relay_parse_hashtable_start (parsed_msg);
+                break;
+            case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+                obj = weechat_relay_parse_hdata_start (parsed_msg);
+                break;
+            case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+                obj = weechat_relay_parse_infolist_start (parsed_msg);
+                break;
+            default:
+                obj = weechat_relay_parse_array_start (parsed_msg);
+                break;
+        }
         if (!obj)
+            goto error;
+        handle->container = obj;
+        handle->container_index = 0;
+        handle->container_position = position + 3;
+        handle->container_elements = parsed_msg->position;
+        handle->columns_failed = 0;
+        return 1;
+    }
+
+    if (!weechat_relay_parse_next_object (parsed_msg, type))
+        goto error;
+
+    (*num_read)++;
+
+    return 1;
+
+error:
+    parsed_msg->position = position;
+    return 0;
+}
+
+/*
+ * Parses objects of message in handle, until one of the limits is reached:
+ *   - max_objects: max number of objects read (an element of a container
+ *     (hdata row, hashtable entry, infolist item, array element) counts as
+ *     one object, so that a single huge container is read in multiple
+ *     steps), 0 = no limit
+ *   - max_usec: max time spent in this function (in microseconds), checked
+ *     after each object, after a few elements of container or after each
+ *     decompression of data, 0 = no limit.
+ *
+ * A compressed message is decompressed by steps: when an object (or an
+ * element) can not be read, the next bytes are decompressed and it is read
+ * again (the number of bytes decompressed is doubled each time, so that a
+ * big object is read in a few tries).
+ *
+ * At least one object (or a few elements, or some bytes decompressed) is
+ * read by each call, so that the parse always progresses.
+ *
+ * As with weechat_relay_parse_message, the parse stops at first error and
+ * the objects read before are kept in message.
+ *
+ * Returns:
+ *   1: parse is not complete (function must be called again)
+ *   0: parse is complete
+ *  -1: error (invalid handle)
+ */
+
+int
+weechat_relay_parse_handle_step (struct t_weechat_relay_parse_handle *handle,
+                                 int max_objects, long max_usec)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    long long time_start;
+    int count, num_read, rc;
+
+    if (!handle || !handle->parsed_msg)
+        return -1;
+
+    if (handle->done)
+        return 0;
+
+    parsed_msg = handle->parsed_msg;
+    time_start = (max_usec > 0) ? weechat_relay_parse_time_usec () : 0;
+    num_read = 0;
+
+    while (1)
+    {
+        if (handle->container)
+        {
+            count = WEECHAT_RELAY_PARSE_STEP_ELEMENTS;
+            if ((max_objects > 0) && (count > max_objects - num_read))
+                count = max_objects - num_read;
+            rc = weechat_relay_parse_handle_elements (handle, count,
+                                                      &num_read);
+        }
+        else if (parsed_msg->position < parsed_msg->size)
+        {
+            rc = weechat_relay_parse_handle_object (handle, &num_read);
+        }
+        else if (handle->decompress_done)
+        {
+            /* nothing left to read: parse is complete */
+            handle->done = 1;
             break;
+        }
+        else
+        {
+            rc = 0;
+        }
 
-        /* add object to the list of objects in parsed message */
-        parsed_msg->num_objects++;
-        if (parsed_msg->objects)
+        if (rc)
         {
-            objects = realloc (parsed_msg->objects,
-                               sizeof (*parsed_msg->objects) * parsed_msg->num_objects);
-            if (!objects)
-                break;
-            parsed_msg->objects = objects;
+            handle->decompress_size = WEECHAT_RELAY_PARSE_STEP_DECOMPRESS_SIZE;
+        }
+        else if (!handle->decompress_done)
+        {
+            /* not enough data: decompress more bytes, then read again */
+            weechat_relay_parse_handle_decompress (handle);
+            handle->decompress_size *= 2;
         }
         else
         {
-            parsed_msg->objects = malloc (sizeof (*parsed_msg->objects) * parsed_msg->num_objects);
-            if (!parsed_msg->objects)
-                break;
+            if (handle->container)
+            {
+                weechat_relay_obj_free (handle->container);
+                handle->container = NULL;
+            }
+            handle->done = 1;
+            break;
+        }
+
+        if ((max_objects > 0) && (num_read >= max_objects))
+            break;
+        if ((max_usec > 0)
+            && (weechat_relay_parse_time_usec () - time_start >= max_usec))
+        {
+            break;
         }
-        parsed_msg->objects[parsed_msg->num_objects - 1] = obj;
     }
 
+    if (!handle->done && !handle->container && handle->decompress_done
+        && (parsed_msg->position >= parsed_msg->size))
+    {
+        /* nothing left to read: parse is complete */
+        handle->done = 1;
+    }
+
+    return (handle->done) ? 0 : 1;
+}
+
+/*
+ * Completes the parse of message (if needed) and frees the handle.
+ *
+ * Returns the parsed message (the caller must free it), NULL if error.
+ */
+
+struct t_weechat_relay_parsed_msg *
+weechat_relay_parse_handle_finish (struct t_weechat_relay_parse_handle *handle)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+
+    if (!handle)
+        return NULL;
+
+    weechat_relay_parse_handle_step (handle, 0, 0);
+
+    parsed_msg = handle->parsed_msg;
+    handle->parsed_msg = NULL;
+
+    weechat_relay_parse_handle_free (handle);
+
     return parsed_msg;
 }
+
+/*
+ * Frees a parse handle (the parse is aborted if not complete: the message
+ * is freed).
+ */
+
+void
+weechat_relay_parse_handle_free (struct t_weechat_relay_parse_handle *handle)
+{
+    if (!handle)
+        return;
+
+    if (handle->container)
+        weechat_relay_obj_free (handle->container);
+    weechat_relay_parse_handle_decompress_end (handle);
+    if (handle->parsed_msg)
+        weechat_relay_parse_msg_release (handle->parsed_msg);
+
+    free (handle);
+}
@@ -22,6 +22,65 @@
 #ifndef WEECHAT_RELAY_PARSE_H
 #define WEECHAT_RELAY_PARSE_H
 
+/* max ratio decompressed/compressed size to trust the zstd frame header */
+#define WEECHAT_RELAY_PARSE_ZSTD_MAX_RATIO 1024
+
+/* max size of a zstd frame header (ZSTD_FRAMEHEADERSIZE_MAX) */
+#define WEECHAT_RELAY_PARSE_ZSTD_FRAME_HEADER_MAX 18
+
+/*
+ * max number of elements (hdata rows, hashtable entries, infolist items,
+ * array elements) read between two time checks (parse handle)
+ */
+#define WEECHAT_RELAY_PARSE_STEP_ELEMENTS 32
+
+/* bytes decompressed by a parse handle before trying to read again */
+#define WEECHAT_RELAY_PARSE_STEP_DECOMPRESS_SIZE (64 * 1024)
+
+struct t_weechat_relay_parse_ctx
+{
+    void *zstd_dctx;                   /* zstd decompression context        */
+    void *zstd_ddict;                  /* zstd dictionary (NULL if none)    */
+    struct t_weechat_relay_dispatch *dispatch; /* custom ids interned in    */
+                                       /* this dispatcher (not freed)       */
+};
+
+struct t_weechat_relay_parse_handle
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg; /* message being parsed  */
+    struct t_weechat_relay_obj *container; /* hdata, hashtable, infolist or */
+                                       /* array being read (added to        */
+                                       /* message when all elements are     */
+                                       /* read)                             */
+    int container_index;               /* next element to read in container */
+    size_t container_position;         /* position of container in message  */
+    size_t container_elements;         /* position of first element         */
+    int columns_failed;                /* infolist items not readable in    */
+                                       /* columns: classic representation   */
+    void *zlib_stream;                 /* zlib stream (z_stream)            */
+    void *zstd_stream;                 /* zstd stream (ZSTD_DStream)        */
+    size_t input_position;             /* compressed bytes decompressed     */
+    size_t output_alloc;               /* size allocated for decompressed   */
+                                       /* data                              */
+    size_t decompress_size;            /* max bytes decompressed by next    */
+                                       /* call (doubled if still not enough)*/
+    int decompress_done;               /* 1 if all data is decompressed     */
+    int done;                          /* 1 if parse is complete            */
+};
+
+extern size_t weechat_relay_parse_iov_size (const struct iovec *iov,
+                                            int iovcnt);
+extern int weechat_relay_parse_iov_seek (const struct iovec *iov, int iovcnt,
+                                         int *index, size_t *start,
+                                         size_t offset);
+extern int weechat_relay_parse_iov_copy (const struct iovec *iov, int iovcnt,
+                                         int *index, size_t *start,
+                                         size_t offset, void *output,
+                                         size_t count);
+extern const void *weechat_relay_parse_get_bytes (
+    struct t_weechat_relay_parsed_msg *parsed_msg, size_t count);
+extern int weechat_relay_parse_peek_bytes (
+    struct t_weechat_relay_parsed_msg *parsed_msg, void *output, size_t count);
 extern int weechat_relay_parse_read_bytes (
     struct t_weechat_relay_parsed_msg *parsed_msg, void *output, size_t count);
 extern int weechat_relay_parse_read_type (
@@ -31,10 +90,17 @@ extern int weechat_relay_parse_read_integer (
     struct t_weechat_relay_parsed_msg *parsed_msg, int *value);
 extern int weechat_relay_parse_read_string (
     struct t_weechat_relay_parsed_msg *parsed_msg, char **string);
+extern int weechat_relay_parse_read_id (
+    struct t_weechat_relay_parse_ctx *ctx,
+    struct t_weechat_relay_parsed_msg *parsed_msg);
 extern int weechat_relay_parse_read_buffer (
     struct t_weechat_relay_parsed_msg *parsed_msg, void **buffer, int *length);
 extern int weechat_relay_parse_read_pointer (
     struct t_weechat_relay_parsed_msg *parsed_msg, const void **pointer);
+extern int weechat_relay_parse_read_long (
+    struct t_weechat_relay_parsed_msg *parsed_msg, long *value);
+extern int weechat_relay_parse_read_time (
+    struct t_weechat_relay_parsed_msg *parsed_msg, time_t *time);
 extern struct t_weechat_relay_obj *weechat_relay_parse_obj_char (
     struct t_weechat_relay_parsed_msg *parsed_msg);
 extern struct t_weechat_relay_obj *weechat_relay_parse_obj_integer (
@@ -56,28 +122,149 @@ extern int weechat_relay_parse_hdata_split_hpath (
 extern int weechat_relay_parse_hdata_split_keys (
     const char *keys, char ***keys_names,
     enum t_weechat_relay_obj_type **keys_types, int *num_keys);
+extern int weechat_relay_parse_hdata_alloc_columns (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj_hdata *hdata);
+extern struct t_weechat_relay_obj *weechat_relay_parse_hdata_start (
+    struct t_weechat_relay_parsed_msg *parsed_msg);
+extern struct t_weechat_relay_obj *weechat_relay_parse_hashtable_start (
+    struct t_weechat_relay_parsed_msg *parsed_msg);
+extern int weechat_relay_parse_hashtable_items (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj_hashtable *hashtable, int start, int count);
+extern void weechat_relay_parse_hashtable_end (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj_hashtable *hashtable);
+extern int weechat_relay_parse_hdata_rows (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj_hdata *hdata, int start, int count);
+extern void weechat_relay_parse_hdata_end (
+    struct t_weechat_relay_obj_hdata *hdata);
 extern struct t_weechat_relay_obj *weechat_relay_parse_obj_hdata (
     struct t_weechat_relay_parsed_msg *parsed_msg);
 extern struct t_weechat_relay_obj *weechat_relay_parse_obj_info (
     struct t_weechat_relay_parsed_msg *parsed_msg);
+extern int weechat_relay_parse_match_string (
+    struct t_weechat_relay_parsed_msg *parsed_msg, const char *string);
+extern int weechat_relay_parse_infolist_column_value (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    enum t_weechat_relay_obj_type type, void *column, int item);
+extern int weechat_relay_parse_infolist_columns_items (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj_infolist *infolist, int start, int count);
+extern int weechat_relay_parse_infolist_columns (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj_infolist *infolist);
+extern struct t_weechat_relay_obj *weechat_relay_parse_infolist_start (
+    struct t_weechat_relay_parsed_msg *parsed_msg);
+extern int weechat_relay_parse_infolist_items (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj_infolist *infolist, int start, int count);
 extern struct t_weechat_relay_obj *weechat_relay_parse_obj_infolist (
     struct t_weechat_relay_parsed_msg *parsed_msg);
+extern int weechat_relay_parse_array_native (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj_array *array);
+extern struct t_weechat_relay_obj *weechat_relay_parse_array_start (
+    struct t_weechat_relay_parsed_msg *parsed_msg);
+extern int weechat_relay_parse_array_items (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj_array *array, int start, int count);
+extern void weechat_relay_parse_array_end (
+    struct t_weechat_relay_obj_array *array);
 extern struct t_weechat_relay_obj *weechat_relay_parse_obj_array (
     struct t_weechat_relay_parsed_msg *parsed_msg);
+extern void weechat_relay_parse_set_wire (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj *obj, size_t start);
 extern struct t_weechat_relay_obj *weechat_relay_parse_read_object (
     struct t_weechat_relay_parsed_msg *parsed_msg,
     enum t_weechat_relay_obj_type type);
+extern int weechat_relay_parse_read_value_hdata (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_value_hdata *hdata);
+extern int weechat_relay_parse_read_value_infolist (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_value_infolist *infolist);
+extern int weechat_relay_parse_read_value (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    enum t_weechat_relay_obj_type type,
+    struct t_weechat_relay_value *value);
 extern void *weechat_relay_parse_decompress_zlib (const void *data,
                                                   size_t size,
                                                   size_t initial_output_size,
                                                   size_t *size_decompressed);
+extern void *weechat_relay_parse_decompress_zstd_ctx (
+    struct t_weechat_relay_parse_ctx *ctx, const void *data, size_t size,
+    size_t initial_output_size, size_t *size_decompressed);
 extern void *weechat_relay_parse_decompress_zstd (const void *data,
                                                   size_t size,
                                                   size_t initial_output_size,
                                                   size_t *size_decompressed);
+extern void *weechat_relay_parse_decompress_zlib_iov (
+    const struct iovec *iov, int iovcnt, size_t initial_output_size,
+    size_t *size_decompressed);
+extern void *weechat_relay_parse_decompress_zstd_iov (
+    struct t_weechat_relay_parse_ctx *ctx, const struct iovec *iov,
+    int iovcnt, size_t initial_output_size, size_t *size_decompressed);
+extern struct t_weechat_relay_parse_ctx *weechat_relay_parse_ctx_new ();
+extern int weechat_relay_parse_ctx_set_dict (struct t_weechat_relay_parse_ctx *ctx,
+                                             const void *dict, size_t size);
+extern void weechat_relay_parse_ctx_free (struct t_weechat_relay_parse_ctx *ctx);
+extern int weechat_relay_parse_peek_read_zlib (void *strm, void *output,
+                                               size_t count);
+extern int weechat_relay_parse_peek_read_zstd (void *dctx, void *input,
+                                               void *output, size_t count);
+extern int weechat_relay_parse_peek_id_length (uint32_t length32,
+                                               size_t id_size, int *length);
+extern int weechat_relay_parse_peek_id_ctx (
+    struct t_weechat_relay_parse_ctx *ctx, const void *buffer, size_t size,
+    char *id, size_t id_size);
+extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_msg_alloc_ctx (
+    struct t_weechat_relay_parse_ctx *ctx, const void *buffer, size_t size);
 extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_msg_alloc (
     const void *buffer, size_t size);
+extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_msg_alloc_iov_ctx (
+    struct t_weechat_relay_parse_ctx *ctx, const struct iovec *iov,
+    int iovcnt);
+extern void weechat_relay_parse_msg_destroy (
+    struct t_weechat_relay_parsed_msg *parsed_msg);
+extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_msg_retain (
+    struct t_weechat_relay_parsed_msg *parsed_msg);
+extern void weechat_relay_parse_msg_release (
+    struct t_weechat_relay_parsed_msg *parsed_msg);
 extern void weechat_relay_parse_msg_free (
     struct t_weechat_relay_parsed_msg *parsed_msg);
+extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_message_ctx (
+    struct t_weechat_relay_parse_ctx *ctx, const void *buffer, size_t size,
+    int flags);
+extern int weechat_relay_parse_add_object (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    struct t_weechat_relay_obj *obj);
+extern int weechat_relay_parse_next_object (
+    struct t_weechat_relay_parsed_msg *parsed_msg,
+    enum t_weechat_relay_obj_type type);
+extern void weechat_relay_parse_objects (
+    struct t_weechat_relay_parsed_msg *parsed_msg, int flags);
+extern int weechat_relay_parse_iov_flatten (struct t_weechat_relay_parsed_msg *parsed_msg);
+extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_message_iov_ctx (
+    struct t_weechat_relay_parse_ctx *ctx, const struct iovec *iov,
+    int iovcnt, int flags);
+extern long long weechat_relay_parse_time_usec ();
+extern void weechat_relay_parse_rebase_wire (struct t_weechat_relay_obj *obj,
+                                             const char *base, int to_offset);
+extern void weechat_relay_parse_handle_rebase_wire (
+    struct t_weechat_relay_parse_handle *handle, const char *base,
+    int to_offset);
+extern void weechat_relay_parse_handle_decompress_end (
+    struct t_weechat_relay_parse_handle *handle);
+extern int weechat_relay_parse_handle_decompress (
+    struct t_weechat_relay_parse_handle *handle);
+extern int weechat_relay_parse_handle_container_end (
+    struct t_weechat_relay_parse_handle *handle);
+extern int weechat_relay_parse_handle_elements (
+    struct t_weechat_relay_parse_handle *handle, int count, int *num_read);
+extern int weechat_relay_parse_handle_object (
+    struct t_weechat_relay_parse_handle *handle, int *num_read);
 
 #endif /* WEECHAT_RELAY_PARSE_H */
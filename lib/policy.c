@@ -0,0 +1,330 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Policy to compress messages (WeeChat -> client) */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "weechat-relay.h"
+#include "policy.h"
+
+
+/*
+ * Creates a policy to compress messages with zlib or zstd, with default
+ * settings for this codec.
+ *
+ * Returns pointer to new policy, NULL if error.
+ */
+
+struct t_weechat_relay_policy *
+weechat_relay_policy_new (enum t_weechat_relay_compression compression)
+{
+    struct t_weechat_relay_policy *new_policy;
+
+    if ((compression < 0) || (compression >= WEECHAT_RELAY_NUM_COMPRESSIONS))
+        return NULL;
+
+    new_policy = calloc (1, sizeof (*new_policy));
+    if (!new_policy)
+        return NULL;
+
+    new_policy->compression = compression;
+    switch (compression)
+    {
+        case WEECHAT_RELAY_COMPRESSION_ZLIB:
+            new_policy->level = 6;
+            new_policy->level_fast = 1;
+            new_policy->level_big = 9;
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZSTD:
+            new_policy->level = 3;
+            new_policy->level_fast = 1;
+            new_policy->level_big = 9;
+            break;
+        default:
+            break;
+    }
+    new_policy->min_size = WEECHAT_RELAY_POLICY_MIN_SIZE;
+    new_policy->big_size = WEECHAT_RELAY_POLICY_BIG_SIZE;
+    new_policy->max_ratio = WEECHAT_RELAY_POLICY_MAX_RATIO;
+    new_policy->probe_interval = WEECHAT_RELAY_POLICY_PROBE_INTERVAL;
+    new_policy->cpu_budget = WEECHAT_RELAY_POLICY_CPU_BUDGET;
+
+    return new_policy;
+}
+
+/*
+ * Returns current time of monotonic clock, in nanoseconds.
+ */
+
+long long
+weechat_relay_policy_time ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ((long long)ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+/*
+ * Chooses how to compress a message of "size" bytes, at time "now" (in
+ * microseconds):
+ *   - small messages are not compressed
+ *   - if the average ratio is bad, messages are not compressed, except one
+ *     message out of "probe_interval", compressed with the fast level to
+ *     measure the ratio again
+ *   - if the CPU budget of the current second is spent, messages are not
+ *     compressed; if the estimated time of compression (average speed)
+ *     exceeds the budget left, the fast level is used
+ *   - big messages are compressed with the level for big messages.
+ *
+ * The variable "level" is set with the compression level (0 if the message
+ * is not compressed).
+ *
+ * Returns compression to use (WEECHAT_RELAY_COMPRESSION_OFF if the message
+ * must not be compressed).
+ */
+
+enum t_weechat_relay_compression
+weechat_relay_policy_choose_time (struct t_weechat_relay_policy *policy,
+                                  size_t size, long long now, int *level)
+{
+    double estimated;
+    int probe;
+
+    if (level)
+        *level = 0;
+
+    if (!policy || !level
+        || (policy->compression == WEECHAT_RELAY_COMPRESSION_OFF))
+    {
+        return WEECHAT_RELAY_COMPRESSION_OFF;
+    }
+
+    if (size < policy->min_size)
+    {
+        policy->count_small++;
+        return WEECHAT_RELAY_COMPRESSION_OFF;
+    }
+
+    if (now - policy->budget_start >= 1000000)
+    {
+        policy->budget_start = now;
+        policy->budget_used = 0;
+    }
+
+    probe = 0;
+    if (policy->avg_ratio > policy->max_ratio)
+    {
+        if (policy->probe_countdown > 0)
+        {
+            policy->probe_countdown--;
+            policy->count_ratio++;
+            return WEECHAT_RELAY_COMPRESSION_OFF;
+        }
+        probe = 1;
+    }
+
+    if (policy->cpu_budget > 0)
+    {
+        if (policy->budget_used >= policy->cpu_budget)
+        {
+            policy->count_budget++;
+            return WEECHAT_RELAY_COMPRESSION_OFF;
+        }
+        estimated = (policy->avg_speed > 0) ?
+            (double)size / policy->avg_speed : 0;
+        if (policy->budget_used + estimated > policy->cpu_budget)
+        {
+            *level = policy->level_fast;
+            policy->count_fast++;
+            return policy->compression;
+        }
+    }
+
+    if (probe)
+    {
+        *level = policy->level_fast;
+        policy->count_probe++;
+    }
+    else if (size >= policy->big_size)
+    {
+        *level = policy->level_big;
+        policy->count_big++;
+    }
+    else
+    {
+        *level = policy->level;
+        policy->count_level++;
+    }
+
+    return policy->compression;
+}
+
+/*
+ * Chooses how to compress a message of "size" bytes now (see function
+ * weechat_relay_policy_choose_time).
+ *
+ * The variable "level" is set with the compression level (0 if the message
+ * is not compressed).
+ *
+ * Returns compression to use (WEECHAT_RELAY_COMPRESSION_OFF if the message
+ * must not be compressed).
+ */
+
+enum t_weechat_relay_compression
+weechat_relay_policy_choose (struct t_weechat_relay_policy *policy,
+                             size_t size, int *level)
+{
+    return weechat_relay_policy_choose_time (
+        policy, size, weechat_relay_policy_time () / 1000, level);
+}
+
+/*
+ * Updates the statistics of a policy after the compression of a message of
+ * "size" bytes in "compressed_size" bytes, which took "time_compress"
+ * microseconds.
+ */
+
+void
+weechat_relay_policy_update (struct t_weechat_relay_policy *policy,
+                             size_t size, size_t compressed_size,
+                             long time_compress)
+{
+    double ratio, speed;
+
+    if (!policy || (size == 0))
+        return;
+
+    if (time_compress < 0)
+        time_compress = 0;
+
+    ratio = (double)compressed_size / size;
+    speed = (double)size / ((time_compress > 0) ? time_compress : 1);
+
+    if (policy->avg_speed > 0)
+    {
+        policy->avg_ratio += (ratio - policy->avg_ratio)
+            * WEECHAT_RELAY_POLICY_AVG_WEIGHT;
+        policy->avg_speed += (speed - policy->avg_speed)
+            * WEECHAT_RELAY_POLICY_AVG_WEIGHT;
+    }
+    else
+    {
+        /* first message compressed */
+        policy->avg_ratio = ratio;
+        policy->avg_speed = speed;
+    }
+
+    policy->budget_used += time_compress;
+    policy->time_compress += time_compress;
+
+    if (policy->avg_ratio > policy->max_ratio)
+        policy->probe_countdown = policy->probe_interval;
+}
+
+/*
+ * Compresses a message according to a policy, with a compression context
+ * (see weechat_relay_msg_compress_ctx_new), and updates the statistics of
+ * policy.
+ *
+ * The variable "size" is set with the size of buffer returned (in bytes).
+ *
+ * Returns a pointer to the message to send: the compressed message (which
+ * belongs to the compression context) or the message itself if it is not
+ * compressed (or if the compressed message is bigger); NULL if error.
+ */
+
+const void *
+weechat_relay_policy_compress (struct t_weechat_relay_policy *policy,
+                               struct t_weechat_relay_msg_compress_ctx *ctx,
+                               struct t_weechat_relay_msg *msg,
+                               size_t *size)
+{
+    enum t_weechat_relay_compression compression;
+    long long time_start, time_end;
+    void *buffer;
+    size_t compressed_size;
+    int level;
+
+    if (!policy || !ctx || !msg || !size
+        || (msg->compression != WEECHAT_RELAY_COMPRESSION_OFF))
+    {
+        return NULL;
+    }
+
+    *size = msg->data_size;
+    policy->bytes_in += msg->data_size;
+
+    compression = weechat_relay_policy_choose (policy, msg->data_size,
+                                               &level);
+    buffer = NULL;
+    compressed_size = 0;
+    time_start = weechat_relay_policy_time ();
+    switch (compression)
+    {
+        case WEECHAT_RELAY_COMPRESSION_ZLIB:
+            buffer = weechat_relay_msg_compress_zlib_ctx (ctx, msg, level,
+                                                          &compressed_size);
+            break;
+        case WEECHAT_RELAY_COMPRESSION_ZSTD:
+            buffer = weechat_relay_msg_compress_zstd_ctx (ctx, msg, level,
+                                                          &compressed_size);
+            break;
+        default:
+            break;
+    }
+
+    if (buffer)
+    {
+        time_end = weechat_relay_policy_time ();
+        /* time rounded up to the next microsecond */
+        weechat_relay_policy_update (policy, msg->data_size, compressed_size,
+                                     (long)((time_end - time_start + 999)
+                                            / 1000));
+        if (compressed_size < msg->data_size)
+        {
+            *size = compressed_size;
+            policy->bytes_out += compressed_size;
+            return buffer;
+        }
+        policy->count_bigger++;
+    }
+
+    policy->bytes_out += msg->data_size;
+
+    return msg->data;
+}
+
+/*
+ * Frees a policy.
+ */
+
+void
+weechat_relay_policy_free (struct t_weechat_relay_policy *policy)
+{
+    if (!policy)
+        return;
+
+    free (policy);
+}
@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_POLICY_H
+#define WEECHAT_RELAY_POLICY_H
+
+/* weight of a new value in moving averages (ratio and speed) */
+#define WEECHAT_RELAY_POLICY_AVG_WEIGHT 0.125
+
+extern long long weechat_relay_policy_time ();
+extern enum t_weechat_relay_compression weechat_relay_policy_choose_time (struct t_weechat_relay_policy *policy,
+                                                                          size_t size,
+                                                                          long long now,
+                                                                          int *level);
+
+#endif /* WEECHAT_RELAY_POLICY_H */
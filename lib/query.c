@@ -0,0 +1,935 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Compiled path queries on parsed messages */
+
+/*
+ * A path is a list of steps separated by "/", evaluated from the list of
+ * objects in the parsed message:
+ *
+ *   N        index: object in message, row in hdata, item in infolist,
+ *            element in array/hashtable, key in hdata row,
+ *            variable in infolist item
+ *   *        all objects/rows/items/elements (each one is a result)
+ *   hda      check of object type (any type name: "chr", "int", "htb", ...)
+ *   name     key in hdata row, variable in infolist item,
+ *            string key in hashtable
+ *   [key]    key in hashtable (string, integer or pointer key),
+ *            can be a suffix of another step, for example: "htb[nick]";
+ *            the key can contain "/", for example: "htb[irc/libera]"
+ *
+ * If the path does not start with an index or "*", the first object in
+ * message is used.
+ *
+ * Examples:
+ *
+ *   0/hda/2/message       key "message" of third row in first hdata
+ *                         (with "*" instead of "2": key "message" of all rows)
+ *   htb[nick]             value of key "nick" in first hashtable
+ *   1/inl/0/name          variable "name" of first item in second infolist
+ *
+ * The resolved indexes (hdata column, infolist variable, hashtable entry)
+ * are cached in a state given by the caller (struct
+ * t_weechat_relay_query_state), so evaluating the same query on many
+ * messages with same shape costs a few pointer hops per step; the compiled
+ * query is read-only and can be shared by threads, each one with its own
+ * state.
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+
+#include "weechat-relay.h"
+#include "object.h"
+#include "query.h"
+
+
+/*
+ * Checks if a string is a valid index (only digits).
+ *
+ * Returns:
+ *   1: string is an index
+ *   0: string is not an index
+ */
+
+int
+weechat_relay_query_is_index (const char *string)
+{
+    int i;
+
+    if (!string || !string[0])
+        return 0;
+
+    for (i = 0; string[i]; i++)
+    {
+        if ((string[i] < '0') || (string[i] > '9'))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Adds a step to a query.
+ *
+ * Returns pointer to new step, NULL if error.
+ */
+
+struct t_weechat_relay_query_step *
+weechat_relay_query_add_step (struct t_weechat_relay_query *query,
+                              enum t_weechat_relay_query_step_type type)
+{
+    struct t_weechat_relay_query_step *new_steps, *ptr_step;
+
+    new_steps = realloc (query->steps,
+                         sizeof (*query->steps) * (query->num_steps + 1));
+    if (!new_steps)
+        return NULL;
+    query->steps = new_steps;
+
+    ptr_step = &query->steps[query->num_steps];
+    memset (ptr_step, 0, sizeof (*ptr_step));
+    ptr_step->type = type;
+
+    query->num_steps++;
+
+    return ptr_step;
+}
+
+/*
+ * Compiles one step of a path (string between two "/"); the step can
+ * produce two compiled steps, for example "htb[nick]" is a check of type
+ * followed by a key.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_query_compile_step (struct t_weechat_relay_query *query,
+                                  const char *step)
+{
+    struct t_weechat_relay_query_step *ptr_step;
+    const char *pos_bracket;
+    char *name;
+    int type, length;
+
+    if (!step || !step[0])
+        return 0;
+
+    if (strcmp (step, "*") == 0)
+    {
+        return (weechat_relay_query_add_step (
+                    query, WEECHAT_RELAY_QUERY_STEP_ALL)) ? 1 : 0;
+    }
+
+    if (weechat_relay_query_is_index (step))
+    {
+        ptr_step = weechat_relay_query_add_step (
+            query, WEECHAT_RELAY_QUERY_STEP_INDEX);
+        if (!ptr_step)
+            return 0;
+        ptr_step->index = atoi (step);
+        return 1;
+    }
+
+    pos_bracket = strchr (step, '[');
+    length = (pos_bracket) ? pos_bracket - step : (int)strlen (step);
+
+    /* name or type before the optional "[key]" */
+    if (length > 0)
+    {
+        name = strndup (step, length);
+        if (!name)
+            return 0;
+        type = weechat_relay_obj_search_type (name);
+        if (type >= 0)
+        {
+            free (name);
+            ptr_step = weechat_relay_query_add_step (
+                query, WEECHAT_RELAY_QUERY_STEP_TYPE);
+            if (!ptr_step)
+                return 0;
+            ptr_step->obj_type = (enum t_weechat_relay_obj_type)type;
+        }
+        else
+        {
+            ptr_step = weechat_relay_query_add_step (
+                query, WEECHAT_RELAY_QUERY_STEP_NAME);
+            if (!ptr_step)
+            {
+                free (name);
+                return 0;
+            }
+            ptr_step->name = name;
+        }
+    }
+
+    /* hashtable key: "[key]" */
+    if (pos_bracket)
+    {
+        length = strlen (pos_bracket + 1);
+        if ((length < 2) || (pos_bracket[length] != ']'))
+            return 0;
+        ptr_step = weechat_relay_query_add_step (
+            query, WEECHAT_RELAY_QUERY_STEP_KEY);
+        if (!ptr_step)
+            return 0;
+        ptr_step->name = strndup (pos_bracket + 1, length - 1);
+        if (!ptr_step->name)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Compiles a path into a query.
+ *
+ * Note: the query must be freed by weechat_relay_query_free.
+ *
+ * Returns pointer to new query, NULL if error (invalid path).
+ */
+
+struct t_weechat_relay_query *
+weechat_relay_query_compile (const char *path)
+{
+    struct t_weechat_relay_query *new_query;
+    const char *ptr_path, *pos_slash;
+    char *step;
+    int rc, in_key;
+
+    if (!path || !path[0])
+        return NULL;
+
+    new_query = calloc (1, sizeof (*new_query));
+    if (!new_query)
+        return NULL;
+
+    new_query->path = strdup (path);
+    if (!new_query->path)
+        goto error;
+
+    ptr_path = path;
+    while (1)
+    {
+        /* a "/" in a key "[...]" does not end the step */
+        pos_slash = ptr_path;
+        in_key = 0;
+        while (pos_slash[0] && (in_key || (pos_slash[0] != '/')))
+        {
+            if (pos_slash[0] == '[')
+                in_key = 1;
+            else if (pos_slash[0] == ']')
+                in_key = 0;
+            pos_slash++;
+        }
+        step = strndup (ptr_path, pos_slash - ptr_path);
+        if (!step)
+            goto error;
+        rc = weechat_relay_query_compile_step (new_query, step);
+        free (step);
+        if (!rc)
+            goto error;
+        if (!pos_slash[0])
+            break;
+        ptr_path = pos_slash + 1;
+    }
+
+    return new_query;
+
+error:
+    weechat_relay_query_free (new_query);
+    return NULL;
+}
+
+/*
+ * Initializes a query state (no index cached).
+ */
+
+void
+weechat_relay_query_state_init (struct t_weechat_relay_query_state *state)
+{
+    int i;
+
+    if (!state)
+        return;
+
+    for (i = 0; i < WEECHAT_RELAY_QUERY_STATE_MAX_STEPS; i++)
+    {
+        state->cached_index[i] = -1;
+    }
+    memset (&state->value_native, 0, sizeof (state->value_native));
+}
+
+/*
+ * Checks if a hashtable key matches a key in a query (always given as
+ * string in the query).
+ *
+ * Returns:
+ *   1: key matches
+ *   0: key does not match
+ */
+
+int
+weechat_relay_query_key_match (struct t_weechat_relay_obj *key,
+                               const char *name)
+{
+    char *error;
+    long number;
+    unsigned long pointer;
+
+    if (!key)
+        return 0;
+
+    switch (key->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            return (key->value_string
+                    && (strcmp (key->value_string, name) == 0)) ? 1 : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            error = NULL;
+            number = strtol (name, &error, 10);
+            return (error && !error[0]
+                    && (number == key->value_integer)) ? 1 : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            error = NULL;
+            number = strtol (name, &error, 10);
+            return (error && !error[0]
+                    && (number == key->value_long)) ? 1 : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            error = NULL;
+            pointer = strtoul (name, &error, 16);
+            return (error && !error[0]
+                    && (pointer == (unsigned long)key->value_pointer)) ? 1 : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            error = NULL;
+            number = strtol (name, &error, 10);
+            return (error && !error[0]
+                    && (number == (long)key->value_time)) ? 1 : 0;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Converts a key in a query (always given as string in the query) to a key
+ * object with the given type.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (invalid key or type not supported)
+ */
+
+int
+weechat_relay_query_key_to_obj (const char *name,
+                                enum t_weechat_relay_obj_type type,
+                                struct t_weechat_relay_obj *key)
+{
+    char *error;
+    long number;
+    unsigned long pointer;
+
+    key->type = type;
+
+    switch (type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            key->value_string = (char *)name;
+            return 1;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            error = NULL;
+            number = strtol (name, &error, 10);
+            if (!error || error[0])
+                return 0;
+            if (type == WEECHAT_RELAY_OBJ_TYPE_INTEGER)
+            {
+                if ((number < INT_MIN) || (number > INT_MAX))
+                    return 0;
+                key->value_integer = (int)number;
+            }
+            else if (type == WEECHAT_RELAY_OBJ_TYPE_LONG)
+                key->value_long = number;
+            else
+                key->value_time = (time_t)number;
+            return 1;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            error = NULL;
+            pointer = strtoul (name, &error, 16);
+            if (!error || error[0])
+                return 0;
+            key->value_pointer = (const void *)pointer;
+            return 1;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Searches a key in a hashtable, starting with the index cached for the
+ * step ("cached_index"), then with the hash index of hashtable.
+ *
+ * Returns the value object, NULL if key is not found.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_query_hashtable_search (const struct t_weechat_relay_query_step *step,
+                                      int *cached_index,
+                                      struct t_weechat_relay_obj_hashtable *hashtable)
+{
+    struct t_weechat_relay_obj key;
+    int i;
+
+    i = *cached_index;
+    if ((i >= 0) && (i < hashtable->count)
+        && weechat_relay_query_key_match (hashtable->keys[i], step->name))
+    {
+        return hashtable->values[i];
+    }
+
+    if (!weechat_relay_query_key_to_obj (step->name, hashtable->type_keys,
+                                         &key))
+    {
+        return NULL;
+    }
+
+    i = weechat_relay_obj_hashtable_search (hashtable, &key);
+    if (i < 0)
+        return NULL;
+
+    *cached_index = i;
+
+    return hashtable->values[i];
+}
+
+/*
+ * Searches a key in a hdata, starting with the index cached for the step.
+ *
+ * Returns the index of key (column), -1 if key is not found.
+ */
+
+int
+weechat_relay_query_hdata_search_key (const struct t_weechat_relay_query_step *step,
+                                      int *cached_index,
+                                      struct t_weechat_relay_obj_hdata *hdata)
+{
+    int i;
+
+    i = *cached_index;
+    if ((i >= 0) && (i < hdata->num_keys)
+        && (strcmp (hdata->keys_names[i], step->name) == 0))
+    {
+        return i;
+    }
+
+    for (i = 0; i < hdata->num_keys; i++)
+    {
+        if (strcmp (hdata->keys_names[i], step->name) == 0)
+        {
+            *cached_index = i;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Searches a variable in an infolist item, starting with the index cached
+ * for the step.
+ *
+ * Returns the value object (for a columnar infolist, it can be stored in
+ * the query state), NULL if variable is not found.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_query_infolist_search_var (struct t_weechat_relay_query_state *state,
+                                         const struct t_weechat_relay_query_step *step,
+                                         int *cached_index,
+                                         struct t_weechat_relay_obj_infolist *infolist,
+                                         int row)
+{
+    struct t_weechat_relay_obj_infolist_item *item;
+    int i;
+
+    /* columnar infolist: search in schema */
+    if (!infolist->items)
+    {
+        i = *cached_index;
+        if ((i >= 0) && (i < infolist->schema->count)
+            && (strcmp (infolist->schema->names[i], step->name) == 0))
+        {
+            return weechat_relay_obj_infolist_column_view (
+                infolist, i, row, &state->value_native);
+        }
+        for (i = 0; i < infolist->schema->count; i++)
+        {
+            if (strcmp (infolist->schema->names[i], step->name) == 0)
+            {
+                *cached_index = i;
+                return weechat_relay_obj_infolist_column_view (
+                    infolist, i, row, &state->value_native);
+            }
+        }
+        return NULL;
+    }
+
+    item = infolist->items[row];
+
+    i = *cached_index;
+    if ((i >= 0) && (i < item->count)
+        && (strcmp (item->variables[i]->name, step->name) == 0))
+    {
+        return item->variables[i]->value;
+    }
+
+    for (i = 0; i < item->count; i++)
+    {
+        if (strcmp (item->variables[i]->name, step->name) == 0)
+        {
+            *cached_index = i;
+            return item->variables[i]->value;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns the number of children (objects, rows, items, elements) that
+ * can be selected with an index in the current position.
+ */
+
+int
+weechat_relay_query_count_children (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                    struct t_weechat_relay_obj *obj, int row)
+{
+    if (!obj)
+        return parsed_msg->num_objects;
+
+    switch (obj->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            return (row < 0) ?
+                obj->value_hdata.count : obj->value_hdata.num_keys;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            if (row < 0)
+                return obj->value_infolist.count;
+            return (obj->value_infolist.items) ?
+                obj->value_infolist.items[row]->count :
+                obj->value_infolist.schema->count;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            return (row < 0) ? obj->value_array.count : 0;
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            return (row < 0) ? obj->value_hashtable.count : 0;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Returns a value of a native array or column (parser flag
+ * WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS) as an object.
+ *
+ * The object returned is stored in the query state and is valid until next
+ * evaluation with this state.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_query_native_value (struct t_weechat_relay_query_state *state,
+                                  enum t_weechat_relay_obj_type type,
+                                  const void *values, int index)
+{
+    state->value_native.type = type;
+    if (type == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+        state->value_native.value_char = ((const char *)values)[index];
+    else
+        state->value_native.value_integer = ((const int *)values)[index];
+
+    return &state->value_native;
+}
+
+/*
+ * Returns the value of a key in a hdata row.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_query_hdata_value (struct t_weechat_relay_query_state *state,
+                                 struct t_weechat_relay_obj_hdata *hdata,
+                                 int row, int index)
+{
+    if (!hdata->values[row][index] && hdata->columns && hdata->columns[index])
+    {
+        return weechat_relay_query_native_value (state,
+                                                 hdata->keys_types[index],
+                                                 hdata->columns[index], row);
+    }
+
+    return hdata->values[row][index];
+}
+
+/*
+ * Returns an element of an array.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_query_array_value (struct t_weechat_relay_query_state *state,
+                                 struct t_weechat_relay_obj_array *array,
+                                 int index)
+{
+    if (!array->values && array->values_native)
+    {
+        return weechat_relay_query_native_value (state, array->type,
+                                                 array->values_native, index);
+    }
+
+    return array->values[index];
+}
+
+/*
+ * Returns the value of a variable in an infolist item.
+ *
+ * For a columnar infolist, the object returned can be stored in the query
+ * state and is then valid until next evaluation with this state.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_query_infolist_value (struct t_weechat_relay_query_state *state,
+                                    struct t_weechat_relay_obj_infolist *infolist,
+                                    int row, int index)
+{
+    if (!infolist->items)
+    {
+        return weechat_relay_obj_infolist_column_view (infolist, index, row,
+                                                       &state->value_native);
+    }
+
+    return infolist->items[row]->variables[index]->value;
+}
+
+/*
+ * Evaluates steps of a query, starting at step "num_step".
+ *
+ * The current position is an object ("obj", NULL for the list of objects in
+ * message) and a row ("row") which is >= 0 only if a row of hdata or an item
+ * of infolist is selected.
+ *
+ * Returns:
+ *   1: OK, continue evaluation
+ *   0: stop evaluation (requested by callback)
+ */
+
+int
+weechat_relay_query_eval (const struct t_weechat_relay_query *query,
+                          struct t_weechat_relay_query_state *state,
+                          int num_step,
+                          struct t_weechat_relay_parsed_msg *parsed_msg,
+                          struct t_weechat_relay_obj *obj, int row,
+                          int (*callback)(void *data,
+                                          struct t_weechat_relay_obj *obj),
+                          void *callback_data,
+                          int *count)
+{
+    const struct t_weechat_relay_query_step *ptr_step;
+    int i, num_children, index, no_cache, *cached_index;
+
+    /* end of path: the object is a result */
+    if (num_step >= query->num_steps)
+    {
+        if (!obj || (row >= 0))
+            return 1;
+        (*count)++;
+        return (callback) ? (callback) (callback_data, obj) : 1;
+    }
+
+    ptr_step = &query->steps[num_step];
+    no_cache = -1;
+    cached_index = (num_step < WEECHAT_RELAY_QUERY_STATE_MAX_STEPS) ?
+        &state->cached_index[num_step] : &no_cache;
+
+    /* implicit first object if path does not start with index or "*" */
+    if (!obj
+        && (ptr_step->type != WEECHAT_RELAY_QUERY_STEP_INDEX)
+        && (ptr_step->type != WEECHAT_RELAY_QUERY_STEP_ALL))
+    {
+        if (parsed_msg->num_objects <= 0)
+            return 1;
+        obj = parsed_msg->objects[0];
+        if (!obj)
+            return 1;
+    }
+
+    switch (ptr_step->type)
+    {
+        case WEECHAT_RELAY_QUERY_STEP_INDEX:
+        case WEECHAT_RELAY_QUERY_STEP_ALL:
+            num_children = weechat_relay_query_count_children (parsed_msg,
+                                                               obj, row);
+            for (i = 0; i < num_children; i++)
+            {
+                if (ptr_step->type == WEECHAT_RELAY_QUERY_STEP_INDEX)
+                {
+                    if (ptr_step->index >= num_children)
+                        break;
+                    index = ptr_step->index;
+                }
+                else
+                {
+                    index = i;
+                }
+                if (!obj)
+                {
+                    if (!weechat_relay_query_eval (
+                            query, state, num_step + 1, parsed_msg,
+                            parsed_msg->objects[index], -1,
+                            callback, callback_data, count))
+                        return 0;
+                }
+                else if (obj->type == WEECHAT_RELAY_OBJ_TYPE_HDATA)
+                {
+                    if (!weechat_relay_query_eval (
+                            query, state, num_step + 1, parsed_msg,
+                            (row < 0) ?
+                            obj : weechat_relay_query_hdata_value (
+                                state, &obj->value_hdata, row, index),
+                            (row < 0) ? index : -1,
+                            callback, callback_data, count))
+                        return 0;
+                }
+                else if (obj->type == WEECHAT_RELAY_OBJ_TYPE_INFOLIST)
+                {
+                    if (!weechat_relay_query_eval (
+                            query, state, num_step + 1, parsed_msg,
+                            (row < 0) ?
+                            obj : weechat_relay_query_infolist_value (
+                                state, &obj->value_infolist, row, index),
+                            (row < 0) ? index : -1,
+                            callback, callback_data, count))
+                        return 0;
+                }
+                else if (obj->type == WEECHAT_RELAY_OBJ_TYPE_ARRAY)
+                {
+                    if (!weechat_relay_query_eval (
+                            query, state, num_step + 1, parsed_msg,
+                            weechat_relay_query_array_value (
+                                state, &obj->value_array, index),
+                            -1,
+                            callback, callback_data, count))
+                        return 0;
+                }
+                else if (obj->type == WEECHAT_RELAY_OBJ_TYPE_HASHTABLE)
+                {
+                    if (!weechat_relay_query_eval (
+                            query, state, num_step + 1, parsed_msg,
+                            obj->value_hashtable.values[index], -1,
+                            callback, callback_data, count))
+                        return 0;
+                }
+                if (ptr_step->type == WEECHAT_RELAY_QUERY_STEP_INDEX)
+                    break;
+            }
+            break;
+        case WEECHAT_RELAY_QUERY_STEP_TYPE:
+            if ((row < 0) && (obj->type == ptr_step->obj_type))
+            {
+                return weechat_relay_query_eval (query, state, num_step + 1,
+                                                 parsed_msg, obj, -1,
+                                                 callback, callback_data,
+                                                 count);
+            }
+            break;
+        case WEECHAT_RELAY_QUERY_STEP_NAME:
+            if ((obj->type == WEECHAT_RELAY_OBJ_TYPE_HDATA) && (row >= 0))
+            {
+                index = weechat_relay_query_hdata_search_key (
+                    ptr_step, cached_index, &obj->value_hdata);
+                if (index >= 0)
+                {
+                    return weechat_relay_query_eval (
+                        query, state, num_step + 1, parsed_msg,
+                        weechat_relay_query_hdata_value (
+                            state, &obj->value_hdata, row, index),
+                        -1,
+                        callback, callback_data, count);
+                }
+            }
+            else if ((obj->type == WEECHAT_RELAY_OBJ_TYPE_INFOLIST)
+                     && (row >= 0))
+            {
+                obj = weechat_relay_query_infolist_search_var (
+                    state, ptr_step, cached_index, &obj->value_infolist, row);
+                if (obj)
+                {
+                    return weechat_relay_query_eval (
+                        query, state, num_step + 1, parsed_msg, obj, -1,
+                        callback, callback_data, count);
+                }
+            }
+            else if ((obj->type == WEECHAT_RELAY_OBJ_TYPE_HASHTABLE)
+                     && (row < 0))
+            {
+                obj = weechat_relay_query_hashtable_search (
+                    ptr_step, cached_index, &obj->value_hashtable);
+                if (obj)
+                {
+                    return weechat_relay_query_eval (
+                        query, state, num_step + 1, parsed_msg, obj, -1,
+                        callback, callback_data, count);
+                }
+            }
+            break;
+        case WEECHAT_RELAY_QUERY_STEP_KEY:
+            if ((obj->type == WEECHAT_RELAY_OBJ_TYPE_HASHTABLE) && (row < 0))
+            {
+                obj = weechat_relay_query_hashtable_search (
+                    ptr_step, cached_index, &obj->value_hashtable);
+                if (obj)
+                {
+                    return weechat_relay_query_eval (
+                        query, state, num_step + 1, parsed_msg, obj, -1,
+                        callback, callback_data, count);
+                }
+            }
+            break;
+        case WEECHAT_RELAY_QUERY_NUM_STEP_TYPES:
+            break;
+    }
+
+    return 1;
+}
+
+/*
+ * Executes a query on a parsed message: the callback is called for each
+ * object found, with the object as argument; if the callback returns 0,
+ * the execution stops.
+ *
+ * The state keeps the indexes found between executions (see
+ * weechat_relay_query_state_init); it can be NULL (nothing is cached, and
+ * objects for values of native arrays are valid only in the callback).
+ *
+ * The callback can be NULL (to count objects found).
+ *
+ * Returns the number of objects found.
+ */
+
+int
+weechat_relay_query_exec (const struct t_weechat_relay_query *query,
+                          struct t_weechat_relay_query_state *state,
+                          struct t_weechat_relay_parsed_msg *parsed_msg,
+                          int (*callback)(void *data,
+                                          struct t_weechat_relay_obj *obj),
+                          void *callback_data)
+{
+    struct t_weechat_relay_query_state state_local;
+    int count;
+
+    if (!query || !parsed_msg)
+        return 0;
+
+    if (!state)
+    {
+        weechat_relay_query_state_init (&state_local);
+        state = &state_local;
+    }
+
+    count = 0;
+
+    weechat_relay_query_eval (query, state, 0, parsed_msg, NULL, -1,
+                              callback, callback_data, &count);
+
+    return count;
+}
+
+/*
+ * Callback used to get first object found by a query.
+ */
+
+int
+weechat_relay_query_get_cb (void *data, struct t_weechat_relay_obj *obj)
+{
+    *((struct t_weechat_relay_obj **)data) = obj;
+
+    /* stop the execution of query */
+    return 0;
+}
+
+/*
+ * Gets first object found by a query in a parsed message.
+ *
+ * If the object is a value of a native array or column, it is stored in
+ * the state and the pointer returned is valid until next evaluation with
+ * this state.
+ *
+ * Returns pointer to object found, NULL if not found (or if state is NULL).
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_query_get (const struct t_weechat_relay_query *query,
+                         struct t_weechat_relay_query_state *state,
+                         struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_obj *obj;
+
+    if (!state)
+        return NULL;
+
+    obj = NULL;
+
+    weechat_relay_query_exec (query, state, parsed_msg,
+                              &weechat_relay_query_get_cb, &obj);
+
+    return obj;
+}
+
+/*
+ * Frees a query.
+ */
+
+void
+weechat_relay_query_free (struct t_weechat_relay_query *query)
+{
+    int i;
+
+    if (!query)
+        return;
+
+    if (query->path)
+        free (query->path);
+    for (i = 0; i < query->num_steps; i++)
+    {
+        if (query->steps[i].name)
+            free (query->steps[i].name);
+    }
+    if (query->steps)
+        free (query->steps);
+
+    free (query);
+}
@@ -0,0 +1,272 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Deferred destruction of parsed messages in a background thread */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "weechat-relay.h"
+#include "parse.h"
+#include "reclaim.h"
+
+
+/*
+ * Returns the number of bytes accounted for a parsed message: message
+ * received (if copied, not for a message parsed from segments) and
+ * decompressed data (objects are allocated from these bytes, so this is an
+ * estimate of memory used by the message).
+ */
+
+size_t
+weechat_relay_reclaim_msg_bytes (struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    return ((parsed_msg->message) ? parsed_msg->length : 0)
+        + ((parsed_msg->data_decompressed) ?
+           parsed_msg->length_data_decompressed : 0);
+}
+
+/*
+ * Frees messages queued in the reclaimer (callback of thread), until the
+ * reclaimer is stopped.
+ */
+
+void *
+weechat_relay_reclaim_thread (void *data)
+{
+    struct t_weechat_relay_reclaim *reclaim;
+    struct t_weechat_relay_parsed_msg *ptr_msg, *next_msg;
+    size_t bytes;
+    int stop;
+
+    reclaim = (struct t_weechat_relay_reclaim *)data;
+
+    while (1)
+    {
+        pthread_mutex_lock (&reclaim->mutex);
+        while (!__atomic_load_n (&reclaim->messages, __ATOMIC_ACQUIRE)
+               && !reclaim->stop)
+        {
+            pthread_cond_wait (&reclaim->cond_messages, &reclaim->mutex);
+        }
+        stop = reclaim->stop;
+        pthread_mutex_unlock (&reclaim->mutex);
+
+        /* take all queued messages at once */
+        ptr_msg = __atomic_exchange_n (&reclaim->messages, NULL,
+                                       __ATOMIC_ACQUIRE);
+        while (ptr_msg)
+        {
+            next_msg = ptr_msg->next_reclaim;
+            bytes = weechat_relay_reclaim_msg_bytes (ptr_msg);
+            weechat_relay_parse_msg_destroy (ptr_msg);
+            __atomic_sub_fetch (&reclaim->pending_bytes, bytes,
+                                __ATOMIC_RELAXED);
+            __atomic_add_fetch (&reclaim->freed_bytes, bytes,
+                                __ATOMIC_RELAXED);
+            __atomic_add_fetch (&reclaim->freed_msgs, 1, __ATOMIC_RELAXED);
+            __atomic_sub_fetch (&reclaim->pending_msgs, 1, __ATOMIC_RELEASE);
+            ptr_msg = next_msg;
+        }
+
+        pthread_mutex_lock (&reclaim->mutex);
+        pthread_cond_broadcast (&reclaim->cond_drained);
+        pthread_mutex_unlock (&reclaim->mutex);
+
+        if (stop && !__atomic_load_n (&reclaim->messages, __ATOMIC_ACQUIRE))
+            break;
+    }
+
+    return NULL;
+}
+
+/*
+ * Creates a reclaimer: a background thread which frees parsed messages
+ * released by weechat_relay_reclaim_release, out of the caller's thread.
+ *
+ * Note: the reclaimer must be freed by weechat_relay_reclaim_free.
+ *
+ * Returns pointer to reclaimer, NULL if error.
+ */
+
+struct t_weechat_relay_reclaim *
+weechat_relay_reclaim_new ()
+{
+    struct t_weechat_relay_reclaim *reclaim;
+
+    reclaim = calloc (1, sizeof (*reclaim));
+    if (!reclaim)
+        return NULL;
+
+    if (pthread_mutex_init (&reclaim->mutex, NULL) != 0)
+        goto error_mutex;
+    if (pthread_cond_init (&reclaim->cond_messages, NULL) != 0)
+        goto error_cond_messages;
+    if (pthread_cond_init (&reclaim->cond_drained, NULL) != 0)
+        goto error_cond_drained;
+    if (pthread_create (&reclaim->thread, NULL,
+                        &weechat_relay_reclaim_thread, reclaim) != 0)
+        goto error_thread;
+
+    return reclaim;
+
+error_thread:
+    pthread_cond_destroy (&reclaim->cond_drained);
+error_cond_drained:
+    pthread_cond_destroy (&reclaim->cond_messages);
+error_cond_messages:
+    pthread_mutex_destroy (&reclaim->mutex);
+error_mutex:
+    free (reclaim);
+    return NULL;
+}
+
+/*
+ * Releases a reference to a parsed message: if this is the last reference,
+ * the message is queued and freed by the background thread.
+ *
+ * This function is lock-free, except when the queue was empty: then the
+ * background thread is woken up.
+ *
+ * If reclaim is NULL, the message is released in the caller's thread
+ * (same as weechat_relay_parse_msg_release).
+ */
+
+void
+weechat_relay_reclaim_release (struct t_weechat_relay_reclaim *reclaim,
+                               struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_weechat_relay_parsed_msg *ptr_head;
+
+    if (!parsed_msg)
+        return;
+
+    if (!reclaim)
+    {
+        weechat_relay_parse_msg_release (parsed_msg);
+        return;
+    }
+
+    if (__atomic_sub_fetch (&parsed_msg->refcount, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+
+    __atomic_add_fetch (&reclaim->pending_msgs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch (&reclaim->pending_bytes,
+                        weechat_relay_reclaim_msg_bytes (parsed_msg),
+                        __ATOMIC_RELAXED);
+
+    ptr_head = __atomic_load_n (&reclaim->messages, __ATOMIC_RELAXED);
+    do
+    {
+        parsed_msg->next_reclaim = ptr_head;
+    }
+    while (!__atomic_compare_exchange_n (&reclaim->messages, &ptr_head,
+                                         parsed_msg, 1,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    if (!ptr_head)
+    {
+        pthread_mutex_lock (&reclaim->mutex);
+        pthread_cond_signal (&reclaim->cond_messages);
+        pthread_mutex_unlock (&reclaim->mutex);
+    }
+}
+
+/*
+ * Waits until all messages released so far have been freed by the
+ * background thread.
+ */
+
+void
+weechat_relay_reclaim_flush (struct t_weechat_relay_reclaim *reclaim)
+{
+    if (!reclaim)
+        return;
+
+    pthread_mutex_lock (&reclaim->mutex);
+    while (__atomic_load_n (&reclaim->pending_msgs, __ATOMIC_ACQUIRE) > 0)
+    {
+        pthread_cond_wait (&reclaim->cond_drained, &reclaim->mutex);
+    }
+    pthread_mutex_unlock (&reclaim->mutex);
+}
+
+/*
+ * Gets counters of a reclaimer: number of messages and bytes waiting to be
+ * freed, and number of messages and bytes already freed.
+ *
+ * Any pointer can be NULL if the counter is not needed.
+ */
+
+void
+weechat_relay_reclaim_get_counters (struct t_weechat_relay_reclaim *reclaim,
+                                    int *pending_msgs, size_t *pending_bytes,
+                                    long *freed_msgs, size_t *freed_bytes)
+{
+    if (pending_msgs)
+    {
+        *pending_msgs = (reclaim) ?
+            __atomic_load_n (&reclaim->pending_msgs, __ATOMIC_RELAXED) : 0;
+    }
+    if (pending_bytes)
+    {
+        *pending_bytes = (reclaim) ?
+            __atomic_load_n (&reclaim->pending_bytes, __ATOMIC_RELAXED) : 0;
+    }
+    if (freed_msgs)
+    {
+        *freed_msgs = (reclaim) ?
+            __atomic_load_n (&reclaim->freed_msgs, __ATOMIC_RELAXED) : 0;
+    }
+    if (freed_bytes)
+    {
+        *freed_bytes = (reclaim) ?
+            __atomic_load_n (&reclaim->freed_bytes, __ATOMIC_RELAXED) : 0;
+    }
+}
+
+/*
+ * Frees a reclaimer: messages still queued are freed, then the background
+ * thread is stopped.
+ *
+ * Messages must not be released with this reclaimer during or after the
+ * call to this function.
+ */
+
+void
+weechat_relay_reclaim_free (struct t_weechat_relay_reclaim *reclaim)
+{
+    if (!reclaim)
+        return;
+
+    pthread_mutex_lock (&reclaim->mutex);
+    reclaim->stop = 1;
+    pthread_cond_signal (&reclaim->cond_messages);
+    pthread_mutex_unlock (&reclaim->mutex);
+
+    pthread_join (reclaim->thread, NULL);
+
+    pthread_cond_destroy (&reclaim->cond_drained);
+    pthread_cond_destroy (&reclaim->cond_messages);
+    pthread_mutex_destroy (&reclaim->mutex);
+
+    free (reclaim);
+}
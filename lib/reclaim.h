@@ -0,0 +1,50 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_RECLAIM_H
+#define WEECHAT_RELAY_RECLAIM_H
+
+#include <pthread.h>
+
+struct t_weechat_relay_reclaim
+{
+    /* messages to free (lock-free stack, pushed by any thread) */
+    struct t_weechat_relay_parsed_msg *messages;
+
+    /* counters (updated atomically) */
+    int pending_msgs;                  /* messages not yet freed            */
+    size_t pending_bytes;              /* bytes of messages not yet freed   */
+    long freed_msgs;                   /* messages freed by the thread      */
+    size_t freed_bytes;                /* bytes freed by the thread         */
+
+    /* background thread */
+    pthread_t thread;                  /* thread freeing the messages       */
+    pthread_mutex_t mutex;             /* mutex for the conditions below    */
+    pthread_cond_t cond_messages;      /* signaled when messages are queued */
+    pthread_cond_t cond_drained;       /* signaled when messages are freed  */
+    int stop;                          /* 1 if thread must stop             */
+};
+
+extern size_t weechat_relay_reclaim_msg_bytes (
+    struct t_weechat_relay_parsed_msg *parsed_msg);
+extern void *weechat_relay_reclaim_thread (void *data);
+
+#endif /* WEECHAT_RELAY_RECLAIM_H */
@@ -24,11 +24,24 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
 #include <arpa/inet.h>
+#include <sys/uio.h>
 
 #include <gnutls/gnutls.h>
 
 #include "weechat-relay.h"
+#include "filter.h"
+#include "parse.h"
+#include "spill.h"
+
+/* max number of segments sent by a single call to writev */
+#ifdef IOV_MAX
+#define WEECHAT_RELAY_SESSION_IOV_MAX IOV_MAX
+#else
+#define WEECHAT_RELAY_SESSION_IOV_MAX 1024
+#endif /* IOV_MAX */
 
 
 /*
@@ -59,6 +72,22 @@ weechat_relay_session_init (int sock, void *gnutls_sess)
 
     session->buffer = NULL;
     session->buffer_size = 0;
+    session->buffer_alloc = 0;
+
+    session->parse_ctx = NULL;
+
+    session->filter = NULL;
+    session->filter_dropped = 0;
+
+    session->buffer_checked = 0;
+    session->spill_threshold = 0;
+    session->spill = NULL;
+    session->last_spill = NULL;
+    session->spill_size = 0;
+    session->max_message_size = 0;
+    session->max_buffer_size = 0;
+    session->reject_remaining = 0;
+    session->messages_rejected = 0;
 
     return session;
 }
@@ -91,6 +120,96 @@ weechat_relay_session_send (struct t_weechat_relay_session *session,
     return (num_sent >= 0) ? num_sent : -1;
 }
 
+/*
+ * Sends segments to WeeChat or client (for example a message built with
+ * weechat_relay_msg_chain_new), with writev if TLS is not used (without
+ * copying segments in a single buffer).
+ *
+ * Segments are sent by batches of at most IOV_MAX segments; after a short
+ * write, the sending goes on with the next bytes not sent (on a non-blocking
+ * socket, the number of bytes sent before the socket is full is returned).
+ *
+ * With TLS, the records are corked so that segments are sent in as few
+ * records as possible.
+ *
+ * Returns the number of bytes sent, -1 if error.
+ */
+
+ssize_t
+weechat_relay_session_send_iov (struct t_weechat_relay_session *session,
+                                const struct iovec *iov, int iovcnt)
+{
+    gnutls_session_t *ptr_gnutls_sess;
+    struct iovec iov_partial;
+    ssize_t num_sent, total;
+    size_t offset;
+    int i, count;
+
+    if (!session || !iov || (iovcnt <= 0))
+        return -1;
+
+    if (session->ssl)
+    {
+        ptr_gnutls_sess = (gnutls_session_t *)session->gnutls_sess;
+        gnutls_record_cork (*ptr_gnutls_sess);
+        for (i = 0; i < iovcnt; i++)
+        {
+            if (gnutls_record_send (*ptr_gnutls_sess, iov[i].iov_base,
+                                    iov[i].iov_len) < 0)
+            {
+                gnutls_record_uncork (*ptr_gnutls_sess, 0);
+                return -1;
+            }
+        }
+        num_sent = gnutls_record_uncork (*ptr_gnutls_sess,
+                                         GNUTLS_RECORD_WAIT);
+        return (num_sent >= 0) ? num_sent : -1;
+    }
+
+    total = 0;
+    i = 0;
+    offset = 0;
+    while (1)
+    {
+        /* skip segments sent (or empty) */
+        while ((i < iovcnt) && (offset >= iov[i].iov_len))
+        {
+            offset -= iov[i].iov_len;
+            i++;
+        }
+        if (i >= iovcnt)
+            break;
+        if (offset > 0)
+        {
+            /* segment partially sent: send the end of segment alone */
+            iov_partial.iov_base = (char *)iov[i].iov_base + offset;
+            iov_partial.iov_len = iov[i].iov_len - offset;
+            num_sent = writev (session->sock, &iov_partial, 1);
+        }
+        else
+        {
+            count = iovcnt - i;
+            if (count > WEECHAT_RELAY_SESSION_IOV_MAX)
+                count = WEECHAT_RELAY_SESSION_IOV_MAX;
+            num_sent = writev (session->sock, iov + i, count);
+        }
+        if (num_sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (((errno == EAGAIN) || (errno == EWOULDBLOCK)) && (total > 0))
+                break;
+            return -1;
+        }
+        if (num_sent == 0)
+            break;
+        total += num_sent;
+        offset += num_sent;
+    }
+
+    return total;
+}
+
 /*
  * Reads bytes from WeeChat or client.
  *
@@ -119,9 +238,238 @@ weechat_relay_session_recv (struct t_weechat_relay_session *session,
     return (num_recv >= 0) ? num_recv : -1;
 }
 
+/*
+ * Appends bytes at the end of session buffer (in memory).
+ *
+ * The size allocated is doubled when the buffer is full, so that a big
+ * message received by chunks is not reallocated for each chunk.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_session_buffer_append (struct t_weechat_relay_session *session,
+                                     const void *buffer, size_t size)
+{
+    void *new_buffer;
+    size_t new_alloc;
+
+    if (session->buffer_size + size > session->buffer_alloc)
+    {
+        new_alloc = (session->buffer_alloc > 0) ? session->buffer_alloc : size;
+        while (new_alloc < session->buffer_size + size)
+        {
+            new_alloc *= 2;
+        }
+        new_buffer = realloc (session->buffer, new_alloc);
+        if (!new_buffer)
+            return 0;
+        session->buffer = new_buffer;
+        session->buffer_alloc = new_alloc;
+    }
+
+    memcpy (session->buffer + session->buffer_size, buffer, size);
+    session->buffer_size += size;
+
+    return 1;
+}
+
+/*
+ * Truncates the session buffer to "size" bytes (memory is released).
+ */
+
+void
+weechat_relay_session_buffer_truncate (struct t_weechat_relay_session *session,
+                                       size_t size)
+{
+    void *new_buffer;
+
+    if (size >= session->buffer_size)
+        return;
+
+    if (size == 0)
+    {
+        free (session->buffer);
+        session->buffer = NULL;
+        session->buffer_size = 0;
+        session->buffer_alloc = 0;
+        return;
+    }
+
+    new_buffer = realloc (session->buffer, size);
+    if (new_buffer)
+    {
+        session->buffer = new_buffer;
+        session->buffer_alloc = size;
+    }
+    session->buffer_size = size;
+}
+
+/*
+ * Removes "size" bytes at position "pos" in session buffer.
+ */
+
+void
+weechat_relay_session_buffer_cut (struct t_weechat_relay_session *session,
+                                  size_t pos, size_t size)
+{
+    if (pos + size >= session->buffer_size)
+    {
+        weechat_relay_session_buffer_truncate (session, pos);
+        return;
+    }
+
+    memmove (session->buffer + pos, session->buffer + pos + size,
+             session->buffer_size - pos - size);
+    weechat_relay_session_buffer_truncate (session, session->buffer_size - size);
+}
+
+/*
+ * Adds a message received in a temporary file at the end of the queue of
+ * spills.
+ */
+
+void
+weechat_relay_session_spill_add (struct t_weechat_relay_session *session,
+                                 struct t_weechat_relay_spill *spill)
+{
+    spill->next_spill = NULL;
+    if (session->last_spill)
+    {
+        ((struct t_weechat_relay_spill *)session->last_spill)->next_spill =
+            spill;
+    }
+    else
+    {
+        session->spill = spill;
+    }
+    session->last_spill = spill;
+    session->spill_size += spill->size;
+}
+
+/*
+ * Removes a message received in a temporary file from the queue of spills
+ * and frees it.
+ */
+
+void
+weechat_relay_session_spill_remove (struct t_weechat_relay_session *session,
+                                    struct t_weechat_relay_spill *spill)
+{
+    struct t_weechat_relay_spill *ptr_spill, *prev_spill;
+
+    prev_spill = NULL;
+    for (ptr_spill = session->spill; ptr_spill;
+         ptr_spill = ptr_spill->next_spill)
+    {
+        if (ptr_spill == spill)
+            break;
+        prev_spill = ptr_spill;
+    }
+    if (!ptr_spill)
+        return;
+
+    if (prev_spill)
+        prev_spill->next_spill = spill->next_spill;
+    else
+        session->spill = spill->next_spill;
+    if (session->last_spill == spill)
+        session->last_spill = prev_spill;
+    session->spill_size -= spill->size;
+
+    weechat_relay_spill_free (spill);
+}
+
+/*
+ * Checks the size of new messages in session buffer (not checked yet):
+ * - a message bigger than the max message size, or which would exceed the
+ *   max buffer size (with the messages received before and not parsed yet,
+ *   in memory or in temporary files), is rejected: its bytes are removed
+ *   (if the message is incomplete, the next bytes received are discarded
+ *   too, until the end of message)
+ * - a message bigger than the spill threshold is moved to a temporary file
+ *   (if the message is incomplete, the next bytes received are written in
+ *   this file, until the end of message).
+ */
+
+void
+weechat_relay_session_buffer_check (struct t_weechat_relay_session *session)
+{
+    struct t_weechat_relay_spill *spill;
+    uint32_t msg_size;
+    size_t pos, available;
+    ssize_t num_written;
+
+    pos = session->buffer_checked;
+    while (session->buffer_size - pos >= 4)
+    {
+        memcpy (&msg_size, session->buffer + pos, 4);
+        msg_size = ntohl (msg_size);
+        if (msg_size < 5)
+        {
+            /* invalid size: remaining bytes are discarded by the parser */
+            pos = session->buffer_size;
+            break;
+        }
+        available = session->buffer_size - pos;
+        if (((session->max_message_size > 0)
+             && (msg_size > session->max_message_size))
+            || ((session->max_buffer_size > 0)
+                && (pos + session->spill_size + msg_size
+                    > session->max_buffer_size)))
+        {
+            session->messages_rejected++;
+            if (msg_size > available)
+            {
+                session->reject_remaining = msg_size - available;
+                weechat_relay_session_buffer_truncate (session, pos);
+                break;
+            }
+            weechat_relay_session_buffer_cut (session, pos, msg_size);
+            continue;
+        }
+        if ((session->spill_threshold > 0)
+            && (msg_size > session->spill_threshold))
+        {
+            spill = weechat_relay_spill_new (msg_size);
+            if (spill)
+            {
+                num_written = weechat_relay_spill_write (spill,
+                                                         session->buffer + pos,
+                                                         available);
+                if (num_written >= 0)
+                {
+                    spill->offset = pos;
+                    weechat_relay_session_spill_add (session, spill);
+                    weechat_relay_session_buffer_cut (session, pos,
+                                                      num_written);
+                    continue;
+                }
+                /* message is kept in memory */
+                weechat_relay_spill_free (spill);
+            }
+        }
+        if (msg_size > available)
+        {
+            /* incomplete message: checked again with next bytes */
+            break;
+        }
+        pos += msg_size;
+    }
+
+    session->buffer_checked = pos;
+}
+
 /*
  * Adds bytes to the session buffer.
  *
+ * A message bigger than the max message size (if set) is rejected: its
+ * bytes are discarded as they are received.
+ * A message bigger than the spill threshold (if set) is received in a
+ * temporary file instead of memory.
+ *
  * Returns:
  *   1: OK
  *   0: error
@@ -131,30 +479,109 @@ int
 weechat_relay_session_buffer_add_bytes (struct t_weechat_relay_session *session,
                                         const void *buffer, size_t size)
 {
-    void *new_buffer;
+    struct t_weechat_relay_spill *ptr_spill;
+    size_t count, written;
+    ssize_t num_written;
+    int rc;
 
     if (!session || !buffer || (size == 0))
         return 0;
 
-    if (session->buffer)
+    rc = 1;
+
+    while (size > 0)
     {
-        new_buffer = realloc (session->buffer, session->buffer_size + size);
-        if (!new_buffer)
-            return 0;
-        session->buffer = new_buffer;
-        memcpy (session->buffer + session->buffer_size, buffer, size);
-        session->buffer_size += size;
+        ptr_spill = session->last_spill;
+        if (session->reject_remaining > 0)
+        {
+            /* discard bytes of a rejected message */
+            count = (size < session->reject_remaining) ?
+                size : session->reject_remaining;
+            session->reject_remaining -= count;
+        }
+        else if (ptr_spill && !weechat_relay_spill_complete (ptr_spill))
+        {
+            /* write bytes in the temporary file */
+            written = ptr_spill->written;
+            num_written = weechat_relay_spill_write (ptr_spill, buffer, size);
+            if (num_written < 0)
+            {
+                /* write error: message is rejected */
+                count = ptr_spill->written - written;
+                session->messages_rejected++;
+                session->reject_remaining = ptr_spill->size - ptr_spill->written;
+                weechat_relay_session_spill_remove (session, ptr_spill);
+                rc = 0;
+            }
+            else
+            {
+                count = num_written;
+            }
+        }
+        else
+        {
+            /* add bytes in memory, a chunk at a time */
+            count = (size < WEECHAT_RELAY_SPILL_CHUNK_SIZE) ?
+                size : WEECHAT_RELAY_SPILL_CHUNK_SIZE;
+            if (!weechat_relay_session_buffer_append (session, buffer, count))
+                return 0;
+            weechat_relay_session_buffer_check (session);
+        }
+        buffer += count;
+        size -= count;
+    }
+
+    return rc;
+}
+
+/*
+ * Removes the first "size" bytes from the session buffer.
+ */
+
+void
+weechat_relay_session_buffer_remove (struct t_weechat_relay_session *session,
+                                     size_t size)
+{
+    struct t_weechat_relay_spill *ptr_spill;
+    void *new_buffer;
+
+    if (size == 0)
+        return;
+
+    if (size >= session->buffer_size)
+    {
+        free (session->buffer);
+        session->buffer = NULL;
+        session->buffer_size = 0;
+        session->buffer_alloc = 0;
     }
     else
     {
-        session->buffer = malloc (size);
-        if (!session->buffer)
-            return 0;
-        memcpy (session->buffer, buffer, size);
-        session->buffer_size = size;
+        memmove (session->buffer, session->buffer + size,
+                 session->buffer_size - size);
+        session->buffer_size -= size;
+        /* release memory of a big message parsed */
+        if ((session->buffer_alloc > WEECHAT_RELAY_SPILL_CHUNK_SIZE)
+            && (session->buffer_size < session->buffer_alloc / 4))
+        {
+            new_buffer = realloc (session->buffer, session->buffer_size);
+            if (new_buffer)
+            {
+                session->buffer = new_buffer;
+                session->buffer_alloc = session->buffer_size;
+            }
+        }
     }
 
-    return 1;
+    session->buffer_checked = (session->buffer_checked > size) ?
+        session->buffer_checked - size : 0;
+
+    /* the messages in temporary files are after the bytes removed */
+    for (ptr_spill = session->spill; ptr_spill;
+         ptr_spill = ptr_spill->next_spill)
+    {
+        ptr_spill->offset -= size;
+    }
 }
 
 /*
@@ -163,17 +590,22 @@ weechat_relay_session_buffer_add_bytes (struct t_weechat_relay_session *session,
  * If a complete message is not ready, *buffer is set to NULL and *size to 0.
  *
  * If a message is returned, it is removed from the session buffer.
+ * Messages dropped by the session filter are removed from the buffer and
+ * never returned.
  *
- * Note: *buffer returned must be freed after use.
+ * Note: *buffer returned must be freed after use; a message received in a
+ * temporary file (see weechat_relay_session_set_spill_threshold) is copied
+ * in memory: use weechat_relay_session_buffer_parse to parse it without
+ * copy.
  */
 
 void
 weechat_relay_session_buffer_pop (struct t_weechat_relay_session *session,
                                   void **buffer, size_t *size)
 {
+    struct t_weechat_relay_spill *ptr_spill;
+    const void *ptr_msg;
     uint32_t msg_size;
-    size_t new_size;
-    void *new_buffer;
 
     if (!session || !buffer || !size)
         return;
@@ -181,15 +613,62 @@ weechat_relay_session_buffer_pop (struct t_weechat_relay_session *session,
     *buffer = NULL;
     *size = 0;
 
-    if (!session->buffer || session->buffer_size < 5)
-        return;
-
-    memcpy (&msg_size, session->buffer, 4);
-    msg_size = ntohl (msg_size);
-    if (msg_size > session->buffer_size)
+    while (1)
     {
-        /* incomplete message, it will be processed later */
-        return;
+        ptr_spill = session->spill;
+        if (ptr_spill && (ptr_spill->offset == 0))
+        {
+            /* message received in temporary file */
+            if (!weechat_relay_spill_complete (ptr_spill))
+                return;
+            ptr_msg = weechat_relay_spill_map (ptr_spill);
+            if (ptr_msg
+                && (weechat_relay_session_filter_check (
+                        session, ptr_msg,
+                        ptr_spill->size) != WEECHAT_RELAY_FILTER_DROP))
+            {
+                *buffer = malloc (ptr_spill->size);
+                if (*buffer)
+                {
+                    memcpy (*buffer, ptr_msg, ptr_spill->size);
+                    *size = ptr_spill->size;
+                }
+            }
+            else if (ptr_msg)
+            {
+                session->filter_dropped++;
+            }
+            else
+            {
+                /* message can not be mapped in memory */
+                session->messages_rejected++;
+            }
+            weechat_relay_session_spill_remove (session, ptr_spill);
+            if (*buffer)
+                return;
+            continue;
+        }
+
+        if (!session->buffer || session->buffer_size < 5)
+            return;
+
+        memcpy (&msg_size, session->buffer, 4);
+        msg_size = ntohl (msg_size);
+        if (msg_size > session->buffer_size)
+        {
+            /* incomplete message, it will be processed later */
+            return;
+        }
+
+        if (weechat_relay_session_filter_check (
+                session, session->buffer, msg_size) != WEECHAT_RELAY_FILTER_DROP)
+        {
+            break;
+        }
+
+        /* message dropped by filter */
+        session->filter_dropped++;
+        weechat_relay_session_buffer_remove (session, msg_size);
     }
 
     *buffer = malloc (msg_size);
@@ -198,30 +677,414 @@ weechat_relay_session_buffer_pop (struct t_weechat_relay_session *session,
     memcpy (*buffer, session->buffer, msg_size);
     *size = msg_size;
 
-    if (msg_size == session->buffer_size)
+    weechat_relay_session_buffer_remove (session, msg_size);
+}
+
+/*
+ * Parses all complete messages in the session buffer (with flags, a
+ * combination of WEECHAT_RELAY_PARSE_FLAG_XXX), then removes them from the
+ * session buffer.
+ *
+ * The buffer is scanned once, the remaining bytes (incomplete message) are
+ * moved only once at the beginning of buffer, and the parse context (zstd
+ * decompression context) is shared by all messages and kept in the session
+ * for next calls.
+ *
+ * A message received in a temporary file (see
+ * weechat_relay_session_set_spill_threshold) is parsed through mmap, without
+ * copy in memory (only decompressed data, if any, is in memory).
+ *
+ * The variable "count" is set with the number of messages in the array
+ * returned; a message which can not be parsed is NULL in the array.
+ * If the size of a message is invalid (lower than 5 bytes), all remaining
+ * bytes are removed from the buffer and counted as one invalid message.
+ * Messages dropped by the session filter are removed from the buffer but
+ * are not in the array (their id is peeked, they are not parsed).
+ *
+ * Note: the messages returned must be freed with
+ * weechat_relay_parse_msg_free, and the array with free.
+ *
+ * Returns the array of parsed messages, NULL if there is no complete message
+ * in buffer (or if all messages were dropped by filter) or if error.
+ */
+
+struct t_weechat_relay_parsed_msg **
+weechat_relay_session_buffer_parse (struct t_weechat_relay_session *session,
+                                    int flags, int *count)
+{
+    struct t_weechat_relay_parsed_msg **messages;
+    struct t_weechat_relay_spill *ptr_spill;
+    struct iovec iov;
+    const void *ptr_msg;
+    uint32_t msg_size;
+    size_t pos, end;
+    int i, num_messages, num_parsed;
+
+    if (!count)
+        return NULL;
+
+    *count = 0;
+
+    if (!session || (!session->buffer && !session->spill))
+        return NULL;
+
+    /* count the complete messages */
+    num_messages = 0;
+    pos = 0;
+    ptr_spill = session->spill;
+    while (1)
     {
-        free (session->buffer);
-        session->buffer = NULL;
-        session->buffer_size = 0;
+        if (ptr_spill && (pos == ptr_spill->offset))
+        {
+            if (!weechat_relay_spill_complete (ptr_spill))
+                break;
+            ptr_spill = ptr_spill->next_spill;
+            num_messages++;
+            continue;
+        }
+        if (session->buffer_size - pos < 5)
+            break;
+        memcpy (&msg_size, session->buffer + pos, 4);
+        msg_size = ntohl (msg_size);
+        if (msg_size < 5)
+        {
+            end = (ptr_spill) ? ptr_spill->offset : session->buffer_size;
+            msg_size = end - pos;
+        }
+        else if (msg_size > session->buffer_size - pos)
+        {
+            break;
+        }
+        pos += msg_size;
+        num_messages++;
     }
-    else
+
+    if (num_messages == 0)
+        return NULL;
+
+    if (!session->parse_ctx)
+        session->parse_ctx = weechat_relay_parse_ctx_new ();
+
+    messages = malloc (num_messages * sizeof (*messages));
+    if (!messages)
+        return NULL;
+
+    /* parse the messages */
+    pos = 0;
+    num_parsed = 0;
+    for (i = 0; i < num_messages; i++)
     {
-        new_size = session->buffer_size - msg_size;
-        new_buffer = malloc (new_size);
-        if (new_buffer)
+        ptr_spill = session->spill;
+        if (ptr_spill && (pos == ptr_spill->offset))
+        {
+            /* message received in temporary file */
+            ptr_msg = weechat_relay_spill_map (ptr_spill);
+            if (!ptr_msg)
+            {
+                messages[num_parsed++] = NULL;
+            }
+            else if (weechat_relay_session_filter_check (
+                         session, ptr_msg,
+                         ptr_spill->size) == WEECHAT_RELAY_FILTER_DROP)
+            {
+                session->filter_dropped++;
+            }
+            else
+            {
+                iov.iov_base = (void *)ptr_msg;
+                iov.iov_len = ptr_spill->size;
+                messages[num_parsed++] = weechat_relay_parse_message_iov_ctx (
+                    session->parse_ctx, &iov, 1, flags);
+            }
+            weechat_relay_session_spill_remove (session, ptr_spill);
+            continue;
+        }
+        memcpy (&msg_size, session->buffer + pos, 4);
+        msg_size = ntohl (msg_size);
+        if (msg_size < 5)
         {
-            memcpy (new_buffer, session->buffer + msg_size, new_size);
-            free (session->buffer);
-            session->buffer = new_buffer;
-            session->buffer_size = new_size;
+            messages[num_parsed++] = NULL;
+            pos = (session->spill) ?
+                ((struct t_weechat_relay_spill *)session->spill)->offset :
+                session->buffer_size;
         }
         else
         {
-            free (session->buffer);
-            session->buffer = NULL;
-            session->buffer_size = 0;
+            if (weechat_relay_session_filter_check (
+                    session, session->buffer + pos,
+                    msg_size) == WEECHAT_RELAY_FILTER_DROP)
+            {
+                session->filter_dropped++;
+            }
+            else
+            {
+                messages[num_parsed++] = weechat_relay_parse_message_ctx (
+                    session->parse_ctx, session->buffer + pos, msg_size,
+                    flags);
+            }
+            pos += msg_size;
         }
     }
+
+    /* remove the messages from buffer */
+    weechat_relay_session_buffer_remove (session, pos);
+
+    if (num_parsed == 0)
+    {
+        free (messages);
+        return NULL;
+    }
+
+    *count = num_parsed;
+
+    return messages;
+}
+
+/*
+ * Parses all complete messages in the session buffer (with flags, a
+ * combination of WEECHAT_RELAY_PARSE_FLAG_XXX), calls the handler of each
+ * message in dispatcher, then releases the messages (a handler can retain
+ * a message to keep it after the call).
+ *
+ * Custom ids set in dispatcher are interned: the id of these messages is
+ * not allocated and the handler is found without string comparison.
+ *
+ * Returns the number of messages parsed, -1 if error.
+ */
+
+int
+weechat_relay_session_buffer_dispatch (struct t_weechat_relay_session *session,
+                                       struct t_weechat_relay_dispatch *dispatch,
+                                       int flags)
+{
+    struct t_weechat_relay_parsed_msg **messages;
+    int i, count;
+
+    if (!session || !dispatch)
+        return -1;
+
+    if (!session->parse_ctx)
+    {
+        session->parse_ctx = weechat_relay_parse_ctx_new ();
+        if (!session->parse_ctx)
+            return -1;
+    }
+
+    ((struct t_weechat_relay_parse_ctx *)session->parse_ctx)->dispatch = dispatch;
+    messages = weechat_relay_session_buffer_parse (session, flags, &count);
+    ((struct t_weechat_relay_parse_ctx *)session->parse_ctx)->dispatch = NULL;
+
+    if (!messages)
+        return 0;
+
+    for (i = 0; i < count; i++)
+    {
+        if (messages[i])
+        {
+            weechat_relay_dispatch_message (dispatch, messages[i]);
+            weechat_relay_parse_msg_release (messages[i]);
+        }
+    }
+    free (messages);
+
+    return count;
+}
+
+/*
+ * Adds an id in the session filter, with the action to do on messages with
+ * this id (WEECHAT_RELAY_FILTER_ACCEPT or WEECHAT_RELAY_FILTER_DROP).
+ *
+ * If the id ends with "*", it is a prefix: for example "_nicklist*" matches
+ * ids "_nicklist" and "_nicklist_diff".
+ * Ids are checked in order of addition, the first one matching is used.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_session_filter_add (struct t_weechat_relay_session *session,
+                                  const char *id,
+                                  enum t_weechat_relay_filter_action action)
+{
+    if (!session || !id)
+        return 0;
+
+    if (!session->filter)
+    {
+        session->filter = weechat_relay_filter_new ();
+        if (!session->filter)
+            return 0;
+    }
+
+    return weechat_relay_filter_add (session->filter, id, action);
+}
+
+/*
+ * Removes an id from the session filter.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (id not found)
+ */
+
+int
+weechat_relay_session_filter_remove (struct t_weechat_relay_session *session,
+                                     const char *id)
+{
+    if (!session || !id)
+        return 0;
+
+    return weechat_relay_filter_remove (session->filter, id);
+}
+
+/*
+ * Sets the action to do on messages with an id not found in the session
+ * filter (by default WEECHAT_RELAY_FILTER_ACCEPT).
+ *
+ * For example to receive only some events: set default action to
+ * WEECHAT_RELAY_FILTER_DROP and add these ids with action
+ * WEECHAT_RELAY_FILTER_ACCEPT.
+ */
+
+void
+weechat_relay_session_filter_set_default (struct t_weechat_relay_session *session,
+                                          enum t_weechat_relay_filter_action action)
+{
+    if (!session
+        || ((int)action < 0) || (action >= WEECHAT_RELAY_NUM_FILTER_ACTIONS))
+    {
+        return;
+    }
+
+    if (!session->filter)
+    {
+        session->filter = weechat_relay_filter_new ();
+        if (!session->filter)
+            return;
+    }
+
+    ((struct t_weechat_relay_filter *)session->filter)->default_action = action;
+}
+
+/*
+ * Removes all ids from the session filter and restores the default action
+ * (all messages are accepted).
+ */
+
+void
+weechat_relay_session_filter_clear (struct t_weechat_relay_session *session)
+{
+    if (!session)
+        return;
+
+    weechat_relay_filter_free (session->filter);
+    session->filter = NULL;
+}
+
+/*
+ * Returns the action of session filter on a message (its id is peeked,
+ * the message is not parsed).
+ */
+
+enum t_weechat_relay_filter_action
+weechat_relay_session_filter_check (struct t_weechat_relay_session *session,
+                                    const void *buffer, size_t size)
+{
+    if (!session || !session->filter)
+        return WEECHAT_RELAY_FILTER_ACCEPT;
+
+    if (!session->parse_ctx)
+        session->parse_ctx = weechat_relay_parse_ctx_new ();
+
+    return weechat_relay_filter_check_message (session->filter,
+                                               session->parse_ctx,
+                                               buffer, size);
+}
+
+/*
+ * Sets the size above which a message received is stored in an anonymous
+ * temporary file (memfd on Linux) instead of memory (0 = never, default);
+ * it is then parsed through mmap by weechat_relay_session_buffer_parse.
+ *
+ * Big messages received before the first one is parsed are queued, each
+ * one in its own temporary file (see
+ * weechat_relay_session_set_max_buffer_size to bound the total size).
+ */
+
+void
+weechat_relay_session_set_spill_threshold (struct t_weechat_relay_session *session,
+                                           size_t threshold)
+{
+    if (!session)
+        return;
+
+    session->spill_threshold = threshold;
+}
+
+/*
+ * Sets the zstd dictionary used to decompress messages received (NULL = no
+ * dictionary, default); it must be the dictionary used by the peer to
+ * compress the messages (fixed per deployment or negotiated out of band).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_session_set_dict (struct t_weechat_relay_session *session,
+                                const void *dict, size_t size)
+{
+    if (!session)
+        return 0;
+
+    if (!session->parse_ctx)
+    {
+        session->parse_ctx = weechat_relay_parse_ctx_new ();
+        if (!session->parse_ctx)
+            return 0;
+    }
+
+    return weechat_relay_parse_ctx_set_dict (session->parse_ctx, dict, size);
+}
+
+/*
+ * Sets the max size of a message received (0 = no limit, default): a bigger
+ * message is rejected as soon as its size is received, its bytes are
+ * discarded and never stored (neither in memory nor in a temporary file).
+ *
+ * The number of messages rejected is in session->messages_rejected.
+ */
+
+void
+weechat_relay_session_set_max_message_size (struct t_weechat_relay_session *session,
+                                            size_t max_size)
+{
+    if (!session)
+        return;
+
+    session->max_message_size = max_size;
+}
+
+/*
+ * Sets the max number of bytes received and not parsed yet, in memory and
+ * in temporary files (0 = no limit, default): a message which would exceed
+ * this size is rejected as soon as its size is received, like a message
+ * bigger than the max message size.
+ *
+ * The number of messages rejected is in session->messages_rejected.
+ */
+
+void
+weechat_relay_session_set_max_buffer_size (struct t_weechat_relay_session *session,
+                                           size_t max_size)
+{
+    if (!session)
+        return;
+
+    session->max_buffer_size = max_size;
 }
 
 /*
@@ -237,5 +1100,12 @@ weechat_relay_session_free (struct t_weechat_relay_session *session)
     if (session->buffer)
         free (session->buffer);
 
+    weechat_relay_parse_ctx_free (session->parse_ctx);
+    weechat_relay_filter_free (session->filter);
+    while (session->spill)
+    {
+        weechat_relay_session_spill_remove (session, session->spill);
+    }
+
     free (session);
 }
@@ -0,0 +1,212 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Spill of big messages received: bytes are stored in an anonymous
+ * temporary file instead of memory, and the message is parsed through mmap.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include "weechat-relay.h"
+#include "spill.h"
+
+
+/*
+ * Opens an anonymous temporary file: a memfd on Linux, otherwise a file
+ * created in the temporary directory and immediately removed.
+ *
+ * Returns the file descriptor, -1 if error.
+ */
+
+int
+weechat_relay_spill_open ()
+{
+    char path[4096];
+    const char *tmpdir;
+    int fd;
+
+#ifdef MFD_CLOEXEC
+    fd = memfd_create ("weechat-relay-spill", MFD_CLOEXEC);
+    if (fd >= 0)
+        return fd;
+#endif /* MFD_CLOEXEC */
+
+    tmpdir = getenv ("TMPDIR");
+    if (!tmpdir || !tmpdir[0])
+        tmpdir = "/tmp";
+    if (snprintf (path, sizeof (path), "%s/weechat-relay-XXXXXX",
+                  tmpdir) >= (int)sizeof (path))
+    {
+        return -1;
+    }
+    fd = mkstemp (path);
+    if (fd < 0)
+        return -1;
+    unlink (path);
+
+    return fd;
+}
+
+/*
+ * Creates a spill for a message of "size" bytes.
+ *
+ * Returns pointer to spill, NULL if error.
+ */
+
+struct t_weechat_relay_spill *
+weechat_relay_spill_new (size_t size)
+{
+    struct t_weechat_relay_spill *new_spill;
+
+    if (size == 0)
+        return NULL;
+
+    new_spill = malloc (sizeof (*new_spill));
+    if (!new_spill)
+        return NULL;
+
+    new_spill->fd = weechat_relay_spill_open ();
+    if (new_spill->fd < 0)
+    {
+        free (new_spill);
+        return NULL;
+    }
+    new_spill->size = size;
+    new_spill->written = 0;
+    new_spill->map = NULL;
+    new_spill->offset = 0;
+    new_spill->next_spill = NULL;
+
+    return new_spill;
+}
+
+/*
+ * Writes bytes of message in spill, at most until the end of message (bytes
+ * after the message are not written).
+ *
+ * In case of error, spill->written is the number of bytes written before
+ * the error.
+ *
+ * Returns the number of bytes written, -1 if error.
+ */
+
+ssize_t
+weechat_relay_spill_write (struct t_weechat_relay_spill *spill,
+                           const void *buffer, size_t size)
+{
+    ssize_t num_written;
+    size_t count, total;
+
+    if (!spill || !buffer || spill->map)
+        return -1;
+
+    count = spill->size - spill->written;
+    if (count > size)
+        count = size;
+
+    total = 0;
+    while (total < count)
+    {
+        num_written = write (spill->fd, (const char *)buffer + total,
+                             count - total);
+        if (num_written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        total += num_written;
+        spill->written += num_written;
+    }
+
+    return total;
+}
+
+/*
+ * Checks if all bytes of message have been written in spill.
+ *
+ * Returns:
+ *   1: message is complete
+ *   0: message is not complete (or spill is NULL)
+ */
+
+int
+weechat_relay_spill_complete (struct t_weechat_relay_spill *spill)
+{
+    return (spill && (spill->written == spill->size)) ? 1 : 0;
+}
+
+/*
+ * Maps the message in memory (read-only); the message must be complete.
+ *
+ * The mapping is removed when the spill is freed.
+ *
+ * Returns pointer to the message, NULL if error.
+ */
+
+const void *
+weechat_relay_spill_map (struct t_weechat_relay_spill *spill)
+{
+    void *map;
+
+    if (!weechat_relay_spill_complete (spill))
+        return NULL;
+
+    if (spill->map)
+        return spill->map;
+
+    map = mmap (NULL, spill->size, PROT_READ, MAP_PRIVATE, spill->fd, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    spill->map = map;
+
+    return spill->map;
+}
+
+/*
+ * Frees a spill: removes the mapping and closes the file (its content is
+ * freed by the kernel).
+ */
+
+void
+weechat_relay_spill_free (struct t_weechat_relay_spill *spill)
+{
+    if (!spill)
+        return;
+
+    if (spill->map)
+        munmap (spill->map, spill->size);
+    close (spill->fd);
+
+    free (spill);
+}
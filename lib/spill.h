@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef WEECHAT_RELAY_SPILL_H
+#define WEECHAT_RELAY_SPILL_H
+
+#include <sys/types.h>
+
+/*
+ * max bytes added in session buffer (memory) before checking if the last
+ * message must be rejected or received in a temporary file
+ */
+#define WEECHAT_RELAY_SPILL_CHUNK_SIZE (64 * 1024)
+
+struct t_weechat_relay_spill
+{
+    int fd;                            /* temporary file (memfd or file     */
+                                       /* removed from disk)                */
+    size_t size;                       /* size of message                   */
+    size_t written;                    /* bytes written in file             */
+    void *map;                         /* file mapped in memory (or NULL)   */
+    size_t offset;                     /* position of message in session    */
+                                       /* buffer (before bytes after it)    */
+    struct t_weechat_relay_spill *next_spill; /* next message in queue     */
+};
+
+extern struct t_weechat_relay_spill *weechat_relay_spill_new (size_t size);
+extern ssize_t weechat_relay_spill_write (struct t_weechat_relay_spill *spill,
+                                          const void *buffer, size_t size);
+extern int weechat_relay_spill_complete (struct t_weechat_relay_spill *spill);
+extern const void *weechat_relay_spill_map (struct t_weechat_relay_spill *spill);
+extern void weechat_relay_spill_free (struct t_weechat_relay_spill *spill);
+
+#endif /* WEECHAT_RELAY_SPILL_H */
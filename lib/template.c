@@ -0,0 +1,468 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Templates of binary messages (WeeChat -> client) */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "weechat-relay.h"
+#include "message.h"
+#include "object.h"
+#include "template.h"
+
+
+/*
+ * Checks if a type can be used for a slot of template (only scalar types,
+ * which are written with a single value).
+ *
+ * Returns:
+ *   1: type OK
+ *   0: type not allowed in a slot
+ */
+
+int
+weechat_relay_msg_template_type_valid (enum t_weechat_relay_obj_type obj_type)
+{
+    return (obj_type == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+        || (obj_type == WEECHAT_RELAY_OBJ_TYPE_INTEGER)
+        || (obj_type == WEECHAT_RELAY_OBJ_TYPE_LONG)
+        || (obj_type == WEECHAT_RELAY_OBJ_TYPE_STRING)
+        || (obj_type == WEECHAT_RELAY_OBJ_TYPE_BUFFER)
+        || (obj_type == WEECHAT_RELAY_OBJ_TYPE_POINTER)
+        || (obj_type == WEECHAT_RELAY_OBJ_TYPE_TIME);
+}
+
+/*
+ * Returns the size of a value in a slot (without type), 0 if the type is
+ * not allowed in a slot.
+ */
+
+size_t
+weechat_relay_msg_template_size_value (const struct t_weechat_relay_value *value)
+{
+    switch (value->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            return 1;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            return 4;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            return 1 + weechat_relay_msg_length_long (value->value_long);
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            return weechat_relay_msg_size_string (value->value_string);
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            return 4 + ((value->value_buffer && (value->length > 0)) ?
+                        (size_t)value->length : 0);
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            return 1 + weechat_relay_msg_length_pointer (value->value_pointer);
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            return 1 + weechat_relay_msg_length_time (value->value_time);
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Writes a value of slot at the end of a message, without any check (the
+ * space must have been reserved).
+ */
+
+void
+weechat_relay_msg_template_put_value (struct t_weechat_relay_msg *msg,
+                                      const struct t_weechat_relay_value *value)
+{
+    struct t_weechat_relay_obj_buffer buffer;
+
+    switch (value->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            msg->data[msg->data_size++] = value->value_char;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            weechat_relay_msg_put_integer (msg, value->value_integer);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            weechat_relay_msg_put_long (msg, value->value_long);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            weechat_relay_msg_put_string (msg, value->value_string);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            buffer.buffer = value->value_buffer;
+            buffer.length = value->length;
+            weechat_relay_msg_put_buffer (msg, &buffer);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            weechat_relay_msg_put_pointer (msg, value->value_pointer);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            weechat_relay_msg_put_time (msg, value->value_time);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Creates a new message template.
+ *
+ * Returns pointer to new template, NULL if error.
+ */
+
+struct t_weechat_relay_msg_template *
+weechat_relay_msg_template_new (const char *id)
+{
+    struct t_weechat_relay_msg_template *new_template;
+
+    new_template = calloc (1, sizeof (*new_template));
+    if (!new_template)
+        return NULL;
+
+    new_template->msg = weechat_relay_msg_new (id);
+    if (!new_template->msg)
+    {
+        free (new_template);
+        return NULL;
+    }
+
+    return new_template;
+}
+
+/*
+ * Adds constant bytes to a template.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_template_add_bytes (struct t_weechat_relay_msg_template *tmpl,
+                                      const void *buffer, size_t size)
+{
+    if (!tmpl || !buffer || (size == 0))
+        return 0;
+
+    return weechat_relay_msg_append_bytes (tmpl->msg, buffer, size);
+}
+
+/*
+ * Adds a constant object type to a template.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_template_add_type (struct t_weechat_relay_msg_template *tmpl,
+                                     enum t_weechat_relay_obj_type obj_type)
+{
+    if (!tmpl)
+        return 0;
+
+    return weechat_relay_msg_append_type (tmpl->msg, obj_type);
+}
+
+/*
+ * Adds a constant integer to a template.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_template_add_integer (struct t_weechat_relay_msg_template *tmpl,
+                                        int value)
+{
+    if (!tmpl)
+        return 0;
+
+    return weechat_relay_msg_append_integer (tmpl->msg, value);
+}
+
+/*
+ * Adds a constant string to a template.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_template_add_string (struct t_weechat_relay_msg_template *tmpl,
+                                       const char *string)
+{
+    if (!tmpl)
+        return 0;
+
+    return weechat_relay_msg_append_string (tmpl->msg, string);
+}
+
+/*
+ * Adds a slot for a variable value (without its type) in a template.
+ *
+ * Returns index of slot (values given to weechat_relay_msg_template_fill are
+ * in the order of slots), -1 if error.
+ */
+
+int
+weechat_relay_msg_template_add_slot (struct t_weechat_relay_msg_template *tmpl,
+                                     enum t_weechat_relay_obj_type obj_type)
+{
+    struct t_weechat_relay_msg_template_slot *new_slots;
+    int new_alloc;
+
+    if (!tmpl || !weechat_relay_msg_template_type_valid (obj_type))
+        return -1;
+
+    if (tmpl->num_slots >= tmpl->slots_alloc)
+    {
+        new_alloc = (tmpl->slots_alloc > 0) ? tmpl->slots_alloc * 2 : 8;
+        new_slots = realloc (tmpl->slots, sizeof (*new_slots) * new_alloc);
+        if (!new_slots)
+            return -1;
+        tmpl->slots = new_slots;
+        tmpl->slots_alloc = new_alloc;
+    }
+
+    tmpl->slots[tmpl->num_slots].offset = tmpl->msg->data_size;
+    tmpl->slots[tmpl->num_slots].type = obj_type;
+
+    return tmpl->num_slots++;
+}
+
+/*
+ * Adds a hdata with constant hpath, keys and count to a template: type,
+ * hpath, keys and count are encoded once, and a slot is added for each
+ * pointer of path and each key of each object (in this order, object by
+ * object).
+ *
+ * Keys must have scalar types only (for example "buffer:ptr,date:tim").
+ *
+ * Returns index of first slot of hdata, -1 if error.
+ */
+
+int
+weechat_relay_msg_template_add_hdata (struct t_weechat_relay_msg_template *tmpl,
+                                      const char *hpath,
+                                      const char *keys,
+                                      int count)
+{
+    enum t_weechat_relay_obj_type *keys_types;
+    const char *ptr_key, *pos_colon, *pos_comma;
+    char str_type[4];
+    int i, j, num_hpaths, num_keys, first_slot, obj_type;
+
+    if (!tmpl || !hpath || !hpath[0] || !keys || !keys[0] || (count <= 0))
+        return -1;
+
+    num_hpaths = 1;
+    for (ptr_key = hpath; ptr_key[0]; ptr_key++)
+    {
+        if (ptr_key[0] == '/')
+            num_hpaths++;
+    }
+
+    num_keys = 1;
+    for (ptr_key = keys; ptr_key[0]; ptr_key++)
+    {
+        if (ptr_key[0] == ',')
+            num_keys++;
+    }
+    keys_types = malloc (sizeof (*keys_types) * num_keys);
+    if (!keys_types)
+        return -1;
+
+    /* type of each key ("name:type") */
+    ptr_key = keys;
+    for (i = 0; i < num_keys; i++)
+    {
+        pos_comma = strchr (ptr_key, ',');
+        if (!pos_comma)
+            pos_comma = ptr_key + strlen (ptr_key);
+        pos_colon = memchr (ptr_key, ':', pos_comma - ptr_key);
+        if (!pos_colon || (pos_comma - pos_colon - 1 != 3))
+            goto error;
+        memcpy (str_type, pos_colon + 1, 3);
+        str_type[3] = '\0';
+        obj_type = weechat_relay_obj_search_type (str_type);
+        if ((obj_type < 0) || !weechat_relay_msg_template_type_valid (obj_type))
+            goto error;
+        keys_types[i] = obj_type;
+        ptr_key = pos_comma + 1;
+    }
+
+    if (!weechat_relay_msg_append_type (tmpl->msg,
+                                        WEECHAT_RELAY_OBJ_TYPE_HDATA)
+        || !weechat_relay_msg_append_string (tmpl->msg, hpath)
+        || !weechat_relay_msg_append_string (tmpl->msg, keys)
+        || !weechat_relay_msg_append_integer (tmpl->msg, count))
+    {
+        goto error;
+    }
+
+    first_slot = tmpl->num_slots;
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < num_hpaths; j++)
+        {
+            if (weechat_relay_msg_template_add_slot (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_POINTER) < 0)
+            {
+                goto error;
+            }
+        }
+        for (j = 0; j < num_keys; j++)
+        {
+            if (weechat_relay_msg_template_add_slot (tmpl, keys_types[j]) < 0)
+                goto error;
+        }
+    }
+
+    free (keys_types);
+
+    return first_slot;
+
+error:
+    free (keys_types);
+    return -1;
+}
+
+/*
+ * Builds a message with a template in an existing message (its buffers are
+ * reused): constant bytes are copied and "values" (one per slot, with the
+ * type of slot) are written in slots.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_msg_template_fill (struct t_weechat_relay_msg_template *tmpl,
+                                 struct t_weechat_relay_msg *msg,
+                                 const struct t_weechat_relay_value *values,
+                                 int num_values)
+{
+    size_t size, pos, size_value;
+    int i;
+
+    if (!tmpl || !msg || (num_values != tmpl->num_slots)
+        || ((num_values > 0) && !values))
+    {
+        return 0;
+    }
+
+    size = tmpl->msg->data_size;
+    for (i = 0; i < num_values; i++)
+    {
+        if (values[i].type != tmpl->slots[i].type)
+            return 0;
+        size_value = weechat_relay_msg_template_size_value (&values[i]);
+        if (size_value == 0)
+            return 0;
+        size += size_value;
+    }
+
+    /* message compressed or being compressed: back to an empty message */
+    if ((msg->compression != WEECHAT_RELAY_COMPRESSION_OFF)
+        && !weechat_relay_msg_reset (msg, NULL))
+    {
+        return 0;
+    }
+
+    if (!msg->id || !tmpl->msg->id || (strcmp (msg->id, tmpl->msg->id) != 0))
+    {
+        if (msg->id)
+            free (msg->id);
+        msg->id = (tmpl->msg->id) ? strdup (tmpl->msg->id) : NULL;
+    }
+    msg->passthrough = 0;
+
+    msg->data_size = 0;
+    if (!weechat_relay_msg_reserve (msg, size))
+        return 0;
+
+    pos = 0;
+    for (i = 0; i < num_values; i++)
+    {
+        weechat_relay_msg_put_bytes (msg, tmpl->msg->data + pos,
+                                     tmpl->slots[i].offset - pos);
+        pos = tmpl->slots[i].offset;
+        weechat_relay_msg_template_put_value (msg, &values[i]);
+    }
+    weechat_relay_msg_put_bytes (msg, tmpl->msg->data + pos,
+                                 tmpl->msg->data_size - pos);
+
+    return weechat_relay_msg_update_size (msg);
+}
+
+/*
+ * Builds a new message with a template (see
+ * weechat_relay_msg_template_fill).
+ *
+ * Returns pointer to new message, NULL if error.
+ */
+
+struct t_weechat_relay_msg *
+weechat_relay_msg_template_new_msg (struct t_weechat_relay_msg_template *tmpl,
+                                    const struct t_weechat_relay_value *values,
+                                    int num_values)
+{
+    struct t_weechat_relay_msg *new_msg;
+
+    if (!tmpl)
+        return NULL;
+
+    new_msg = weechat_relay_msg_new (tmpl->msg->id);
+    if (!new_msg)
+        return NULL;
+
+    if (!weechat_relay_msg_template_fill (tmpl, new_msg, values, num_values))
+    {
+        weechat_relay_msg_free (new_msg);
+        return NULL;
+    }
+
+    return new_msg;
+}
+
+/*
+ * Frees a message template.
+ */
+
+void
+weechat_relay_msg_template_free (struct t_weechat_relay_msg_template *tmpl)
+{
+    if (!tmpl)
+        return;
+
+    weechat_relay_msg_free (tmpl->msg);
+    if (tmpl->slots)
+        free (tmpl->slots);
+
+    free (tmpl);
+}
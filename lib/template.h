@@ -0,0 +1,30 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_TEMPLATE_H
+#define WEECHAT_RELAY_TEMPLATE_H
+
+extern int weechat_relay_msg_template_type_valid (enum t_weechat_relay_obj_type obj_type);
+extern size_t weechat_relay_msg_template_size_value (const struct t_weechat_relay_value *value);
+extern void weechat_relay_msg_template_put_value (struct t_weechat_relay_msg *msg,
+                                                  const struct t_weechat_relay_value *value);
+
+#endif /* WEECHAT_RELAY_TEMPLATE_H */
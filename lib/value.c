@@ -0,0 +1,852 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/* Compact values (16 bytes), alternative to objects */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "weechat-relay.h"
+#include "object.h"
+#include "parse.h"
+#include "value.h"
+
+
+/*
+ * Duplicates a string (which can be NULL).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+weechat_relay_value_strdup (const char *string, char **dest)
+{
+    *dest = NULL;
+
+    if (!string)
+        return 1;
+
+    *dest = strdup (string);
+
+    return (*dest) ? 1 : 0;
+}
+
+/*
+ * Sets a string in a value (the string is duplicated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_value_set_string (struct t_weechat_relay_value *value,
+                                const char *string)
+{
+    if (!value)
+        return 0;
+
+    value->type = WEECHAT_RELAY_OBJ_TYPE_STRING;
+    value->length = (string) ? (int)strlen (string) : -1;
+
+    return weechat_relay_value_strdup (string, &value->value_string);
+}
+
+/*
+ * Allocates a hashtable payload, with keys and values in the same block.
+ *
+ * Returns pointer to hashtable, NULL if error.
+ */
+
+struct t_weechat_relay_value_hashtable *
+weechat_relay_value_hashtable_alloc (int count)
+{
+    struct t_weechat_relay_value_hashtable *hashtable;
+
+    if (count < 0)
+        return NULL;
+
+    hashtable = calloc (1, sizeof (*hashtable)
+                        + (2 * (size_t)count * sizeof (struct t_weechat_relay_value)));
+    if (!hashtable)
+        return NULL;
+
+    hashtable->count = count;
+    hashtable->keys = (struct t_weechat_relay_value *)(hashtable + 1);
+    hashtable->values = hashtable->keys + count;
+
+    return hashtable;
+}
+
+/*
+ * Allocates an array payload, with values in the same block.
+ *
+ * Returns pointer to array, NULL if error.
+ */
+
+struct t_weechat_relay_value_array *
+weechat_relay_value_array_alloc (int count)
+{
+    struct t_weechat_relay_value_array *array;
+
+    if (count < 0)
+        return NULL;
+
+    array = calloc (1, sizeof (*array)
+                    + ((size_t)count * sizeof (struct t_weechat_relay_value)));
+    if (!array)
+        return NULL;
+
+    array->count = count;
+    array->values = (struct t_weechat_relay_value *)(array + 1);
+
+    return array;
+}
+
+/*
+ * Sets a value with an element of a native array or column (char or
+ * integer).
+ */
+
+void
+weechat_relay_value_set_native (struct t_weechat_relay_value *value,
+                                enum t_weechat_relay_obj_type type,
+                                const void *values, int index)
+{
+    value->type = type;
+    if (type == WEECHAT_RELAY_OBJ_TYPE_CHAR)
+        value->value_char = ((const char *)values)[index];
+    else
+        value->value_integer = ((const int *)values)[index];
+}
+
+/*
+ * Sets a hdata value with a hdata object.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_value_from_obj_hdata (struct t_weechat_relay_value_hdata *hdata,
+                                    const struct t_weechat_relay_obj_hdata *obj_hdata)
+{
+    struct t_weechat_relay_value *ptr_value;
+    int i, j;
+
+    if (!weechat_relay_value_strdup (obj_hdata->hpath, &hdata->hpath)
+        || !weechat_relay_value_strdup (obj_hdata->keys, &hdata->keys))
+    {
+        return 0;
+    }
+
+    if ((obj_hdata->num_hpaths < 0) || (obj_hdata->num_keys < 0)
+        || (obj_hdata->count < 0))
+    {
+        return 0;
+    }
+
+    if (obj_hdata->num_keys > 0)
+    {
+        hdata->keys_names = calloc (obj_hdata->num_keys,
+                                    sizeof (*hdata->keys_names));
+        if (!hdata->keys_names)
+            return 0;
+        hdata->num_keys = obj_hdata->num_keys;
+        hdata->keys_types = malloc (obj_hdata->num_keys
+                                    * sizeof (*hdata->keys_types));
+        if (!hdata->keys_types)
+            return 0;
+        for (i = 0; i < obj_hdata->num_keys; i++)
+        {
+            if (!weechat_relay_value_strdup (obj_hdata->keys_names[i],
+                                             &hdata->keys_names[i]))
+                return 0;
+            hdata->keys_types[i] = obj_hdata->keys_types[i];
+        }
+    }
+    hdata->num_hpaths = obj_hdata->num_hpaths;
+
+    if (obj_hdata->count == 0)
+        return 1;
+
+    if (hdata->num_hpaths > 0)
+    {
+        hdata->ppath = calloc ((size_t)obj_hdata->count * hdata->num_hpaths,
+                               sizeof (*hdata->ppath));
+        if (!hdata->ppath)
+            return 0;
+    }
+    if (hdata->num_keys > 0)
+    {
+        hdata->values = calloc ((size_t)obj_hdata->count * hdata->num_keys,
+                                sizeof (*hdata->values));
+        if (!hdata->values)
+            return 0;
+    }
+    hdata->count = obj_hdata->count;
+
+    for (i = 0; i < obj_hdata->count; i++)
+    {
+        for (j = 0; j < hdata->num_hpaths; j++)
+        {
+            hdata->ppath[(i * hdata->num_hpaths) + j] =
+                obj_hdata->ppath[i][j]->value_pointer;
+        }
+        for (j = 0; j < hdata->num_keys; j++)
+        {
+            ptr_value = &hdata->values[(i * hdata->num_keys) + j];
+            if (obj_hdata->values[i][j])
+            {
+                if (!weechat_relay_value_from_obj (ptr_value,
+                                                   obj_hdata->values[i][j]))
+                    return 0;
+            }
+            else if (obj_hdata->columns && obj_hdata->columns[j])
+            {
+                weechat_relay_value_set_native (ptr_value,
+                                                obj_hdata->keys_types[j],
+                                                obj_hdata->columns[j], i);
+            }
+            else
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Sets an infolist value with an infolist object (classic or columnar).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_value_from_obj_infolist (struct t_weechat_relay_value_infolist *infolist,
+                                       const struct t_weechat_relay_obj_infolist *obj_infolist)
+{
+    struct t_weechat_relay_value_infolist_item *ptr_item;
+    struct t_weechat_relay_obj_infolist_var *ptr_var;
+    struct t_weechat_relay_obj obj_temp;
+    int i, j, count;
+
+    if (!weechat_relay_value_strdup (obj_infolist->name, &infolist->name))
+        return 0;
+
+    if (obj_infolist->count <= 0)
+        return (obj_infolist->count == 0) ? 1 : 0;
+
+    infolist->items = calloc (obj_infolist->count, sizeof (*infolist->items));
+    if (!infolist->items)
+        return 0;
+    infolist->count = obj_infolist->count;
+
+    for (i = 0; i < obj_infolist->count; i++)
+    {
+        ptr_item = &infolist->items[i];
+        count = (obj_infolist->items) ?
+            obj_infolist->items[i]->count : obj_infolist->schema->count;
+        if (count <= 0)
+            continue;
+        ptr_item->names = calloc (count, sizeof (*ptr_item->names));
+        if (!ptr_item->names)
+            return 0;
+        ptr_item->values = calloc (count, sizeof (*ptr_item->values));
+        if (!ptr_item->values)
+            return 0;
+        ptr_item->count = count;
+        for (j = 0; j < count; j++)
+        {
+            if (obj_infolist->items)
+            {
+                ptr_var = obj_infolist->items[i]->variables[j];
+                if (!weechat_relay_value_strdup (ptr_var->name,
+                                                 &ptr_item->names[j])
+                    || !weechat_relay_value_from_obj (&ptr_item->values[j],
+                                                      ptr_var->value))
+                {
+                    return 0;
+                }
+            }
+            else
+            {
+                if (!weechat_relay_value_strdup (obj_infolist->schema->names[j],
+                                                 &ptr_item->names[j])
+                    || !weechat_relay_value_from_obj (
+                        &ptr_item->values[j],
+                        weechat_relay_obj_infolist_column_view (
+                            obj_infolist, j, i, &obj_temp)))
+                {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Sets a value with an object (all representations of objects are
+ * supported: native arrays and columns, columnar infolists).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (the value is then cleared)
+ */
+
+int
+weechat_relay_value_from_obj (struct t_weechat_relay_value *value,
+                              const struct t_weechat_relay_obj *obj)
+{
+    int i;
+
+    if (!value)
+        return 0;
+
+    memset (value, 0, sizeof (*value));
+
+    if (!obj)
+        return 0;
+
+    value->type = obj->type;
+
+    switch (obj->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            value->value_char = obj->value_char;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            value->value_integer = obj->value_integer;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            value->value_long = obj->value_long;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            if (!weechat_relay_value_set_string (value, obj->value_string))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            if (obj->value_buffer.buffer && (obj->value_buffer.length > 0))
+            {
+                value->value_buffer = malloc (obj->value_buffer.length);
+                if (!value->value_buffer)
+                    goto error;
+                memcpy (value->value_buffer, obj->value_buffer.buffer,
+                        obj->value_buffer.length);
+                value->length = obj->value_buffer.length;
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            value->value_pointer = obj->value_pointer;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            value->value_time = obj->value_time;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            value->value_hashtable = weechat_relay_value_hashtable_alloc (
+                obj->value_hashtable.count);
+            if (!value->value_hashtable)
+                goto error;
+            value->value_hashtable->type_keys = obj->value_hashtable.type_keys;
+            value->value_hashtable->type_values = obj->value_hashtable.type_values;
+            for (i = 0; i < obj->value_hashtable.count; i++)
+            {
+                if (!weechat_relay_value_from_obj (
+                        &value->value_hashtable->keys[i],
+                        obj->value_hashtable.keys[i])
+                    || !weechat_relay_value_from_obj (
+                        &value->value_hashtable->values[i],
+                        obj->value_hashtable.values[i]))
+                {
+                    goto error;
+                }
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            value->value_hdata = calloc (1, sizeof (*value->value_hdata));
+            if (!value->value_hdata)
+                goto error;
+            if (!weechat_relay_value_from_obj_hdata (value->value_hdata,
+                                                     &obj->value_hdata))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFO:
+            value->value_info = calloc (1, sizeof (*value->value_info));
+            if (!value->value_info)
+                goto error;
+            if (!weechat_relay_value_strdup (obj->value_info.name,
+                                             &value->value_info->name)
+                || !weechat_relay_value_strdup (obj->value_info.value,
+                                                &value->value_info->value))
+            {
+                goto error;
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            value->value_infolist = calloc (1, sizeof (*value->value_infolist));
+            if (!value->value_infolist)
+                goto error;
+            if (!weechat_relay_value_from_obj_infolist (value->value_infolist,
+                                                        &obj->value_infolist))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            value->value_array = weechat_relay_value_array_alloc (
+                obj->value_array.count);
+            if (!value->value_array)
+                goto error;
+            value->value_array->type = obj->value_array.type;
+            for (i = 0; i < obj->value_array.count; i++)
+            {
+                if (obj->value_array.values)
+                {
+                    if (!weechat_relay_value_from_obj (
+                            &value->value_array->values[i],
+                            obj->value_array.values[i]))
+                        goto error;
+                }
+                else if (obj->value_array.values_native)
+                {
+                    weechat_relay_value_set_native (
+                        &value->value_array->values[i],
+                        obj->value_array.type,
+                        obj->value_array.values_native, i);
+                }
+                else
+                {
+                    goto error;
+                }
+            }
+            break;
+        case WEECHAT_RELAY_NUM_OBJ_TYPES:
+            goto error;
+    }
+
+    return 1;
+
+error:
+    weechat_relay_value_clear (value);
+    return 0;
+}
+
+/*
+ * Builds a hdata object with a hdata value.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_value_to_obj_hdata (struct t_weechat_relay_obj_hdata *obj_hdata,
+                                  const struct t_weechat_relay_value_hdata *hdata)
+{
+    int i, j;
+
+    if (!weechat_relay_value_strdup (hdata->hpath, &obj_hdata->hpath)
+        || !weechat_relay_value_strdup (hdata->keys, &obj_hdata->keys))
+    {
+        return 0;
+    }
+    if (obj_hdata->hpath
+        && !weechat_relay_parse_hdata_split_hpath (obj_hdata->hpath,
+                                                   &obj_hdata->hpaths,
+                                                   &obj_hdata->num_hpaths))
+    {
+        return 0;
+    }
+    if (obj_hdata->keys
+        && !weechat_relay_parse_hdata_split_keys (obj_hdata->keys,
+                                                  &obj_hdata->keys_names,
+                                                  &obj_hdata->keys_types,
+                                                  &obj_hdata->num_keys))
+    {
+        return 0;
+    }
+    if ((obj_hdata->num_hpaths != hdata->num_hpaths)
+        || (obj_hdata->num_keys != hdata->num_keys))
+    {
+        return 0;
+    }
+
+    if (hdata->count <= 0)
+        return 1;
+
+    obj_hdata->ppath = calloc (hdata->count, sizeof (*obj_hdata->ppath));
+    if (!obj_hdata->ppath)
+        return 0;
+    obj_hdata->values = calloc (hdata->count, sizeof (*obj_hdata->values));
+    if (!obj_hdata->values)
+        return 0;
+    obj_hdata->count = hdata->count;
+
+    for (i = 0; i < hdata->count; i++)
+    {
+        obj_hdata->ppath[i] = calloc (hdata->num_hpaths,
+                                      sizeof (*obj_hdata->ppath[i]));
+        if (!obj_hdata->ppath[i])
+            return 0;
+        for (j = 0; j < hdata->num_hpaths; j++)
+        {
+            obj_hdata->ppath[i][j] = weechat_relay_obj_alloc (
+                WEECHAT_RELAY_OBJ_TYPE_POINTER);
+            if (!obj_hdata->ppath[i][j])
+                return 0;
+            obj_hdata->ppath[i][j]->value_pointer =
+                hdata->ppath[(i * hdata->num_hpaths) + j];
+        }
+        obj_hdata->values[i] = calloc (hdata->num_keys,
+                                       sizeof (*obj_hdata->values[i]));
+        if (!obj_hdata->values[i])
+            return 0;
+        for (j = 0; j < hdata->num_keys; j++)
+        {
+            obj_hdata->values[i][j] = weechat_relay_value_to_obj (
+                &hdata->values[(i * hdata->num_keys) + j]);
+            if (!obj_hdata->values[i][j])
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Builds an infolist object with an infolist value.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weechat_relay_value_to_obj_infolist (struct t_weechat_relay_obj_infolist *obj_infolist,
+                                     const struct t_weechat_relay_value_infolist *infolist)
+{
+    struct t_weechat_relay_obj_infolist_item *ptr_item;
+    int i, j;
+
+    if (!weechat_relay_value_strdup (infolist->name, &obj_infolist->name))
+        return 0;
+
+    if (infolist->count <= 0)
+        return 1;
+
+    obj_infolist->items = calloc (infolist->count,
+                                  sizeof (*obj_infolist->items));
+    if (!obj_infolist->items)
+        return 0;
+    obj_infolist->count = infolist->count;
+
+    for (i = 0; i < infolist->count; i++)
+    {
+        ptr_item = calloc (1, sizeof (*ptr_item));
+        if (!ptr_item)
+            return 0;
+        obj_infolist->items[i] = ptr_item;
+        if (infolist->items[i].count <= 0)
+            continue;
+        ptr_item->variables = calloc (infolist->items[i].count,
+                                      sizeof (*ptr_item->variables));
+        if (!ptr_item->variables)
+            return 0;
+        ptr_item->count = infolist->items[i].count;
+        for (j = 0; j < infolist->items[i].count; j++)
+        {
+            ptr_item->variables[j] = calloc (1, sizeof (*ptr_item->variables[j]));
+            if (!ptr_item->variables[j])
+                return 0;
+            if (!weechat_relay_value_strdup (infolist->items[i].names[j],
+                                             &ptr_item->variables[j]->name))
+                return 0;
+            ptr_item->variables[j]->value = weechat_relay_value_to_obj (
+                &infolist->items[i].values[j]);
+            if (!ptr_item->variables[j]->value)
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Builds an object with a value (compatibility with functions using
+ * objects).
+ *
+ * Returns the new object, NULL if error.
+ */
+
+struct t_weechat_relay_obj *
+weechat_relay_value_to_obj (const struct t_weechat_relay_value *value)
+{
+    struct t_weechat_relay_obj *obj;
+    int i, count;
+
+    if (!value)
+        return NULL;
+
+    obj = weechat_relay_obj_alloc (value->type);
+    if (!obj)
+        return NULL;
+
+    switch (value->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_CHAR:
+            obj->value_char = value->value_char;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INTEGER:
+            obj->value_integer = value->value_integer;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_LONG:
+            obj->value_long = value->value_long;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            if (!weechat_relay_value_strdup (value->value_string,
+                                             &obj->value_string))
+                goto error;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            if (value->value_buffer && (value->length > 0))
+            {
+                obj->value_buffer.buffer = malloc (value->length);
+                if (!obj->value_buffer.buffer)
+                    goto error;
+                memcpy (obj->value_buffer.buffer, value->value_buffer,
+                        value->length);
+                obj->value_buffer.length = value->length;
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_POINTER:
+            obj->value_pointer = value->value_pointer;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_TIME:
+            obj->value_time = value->value_time;
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            if (!value->value_hashtable)
+                goto error;
+            count = value->value_hashtable->count;
+            obj->value_hashtable.type_keys = value->value_hashtable->type_keys;
+            obj->value_hashtable.type_values = value->value_hashtable->type_values;
+            obj->value_hashtable.keys = calloc (
+                (count > 0) ? count : 1, sizeof (*obj->value_hashtable.keys));
+            if (!obj->value_hashtable.keys)
+                goto error;
+            obj->value_hashtable.values = calloc (
+                (count > 0) ? count : 1, sizeof (*obj->value_hashtable.values));
+            if (!obj->value_hashtable.values)
+                goto error;
+            obj->value_hashtable.count = count;
+            for (i = 0; i < count; i++)
+            {
+                obj->value_hashtable.keys[i] = weechat_relay_value_to_obj (
+                    &value->value_hashtable->keys[i]);
+                obj->value_hashtable.values[i] = weechat_relay_value_to_obj (
+                    &value->value_hashtable->values[i]);
+                if (!obj->value_hashtable.keys[i]
+                    || !obj->value_hashtable.values[i])
+                {
+                    goto error;
+                }
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            if (!value->value_hdata
+                || !weechat_relay_value_to_obj_hdata (&obj->value_hdata,
+                                                      value->value_hdata))
+            {
+                goto error;
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFO:
+            if (!value->value_info
+                || !weechat_relay_value_strdup (value->value_info->name,
+                                                &obj->value_info.name)
+                || !weechat_relay_value_strdup (value->value_info->value,
+                                                &obj->value_info.value))
+            {
+                goto error;
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            if (!value->value_infolist
+                || !weechat_relay_value_to_obj_infolist (&obj->value_infolist,
+                                                         value->value_infolist))
+            {
+                goto error;
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            if (!value->value_array)
+                goto error;
+            count = value->value_array->count;
+            obj->value_array.type = value->value_array->type;
+            obj->value_array.values = calloc (
+                (count > 0) ? count : 1, sizeof (*obj->value_array.values));
+            if (!obj->value_array.values)
+                goto error;
+            obj->value_array.count = count;
+            for (i = 0; i < count; i++)
+            {
+                obj->value_array.values[i] = weechat_relay_value_to_obj (
+                    &value->value_array->values[i]);
+                if (!obj->value_array.values[i])
+                    goto error;
+            }
+            break;
+        case WEECHAT_RELAY_NUM_OBJ_TYPES:
+            goto error;
+    }
+
+    return obj;
+
+error:
+    weechat_relay_obj_free (obj);
+    return NULL;
+}
+
+/*
+ * Frees content of a value (the value itself is not freed, since values are
+ * usually stored in arrays).
+ */
+
+void
+weechat_relay_value_clear (struct t_weechat_relay_value *value)
+{
+    int i, j;
+
+    if (!value)
+        return;
+
+    switch (value->type)
+    {
+        case WEECHAT_RELAY_OBJ_TYPE_STRING:
+            if (value->value_string)
+                free (value->value_string);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_BUFFER:
+            if (value->value_buffer)
+                free (value->value_buffer);
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HASHTABLE:
+            if (value->value_hashtable)
+            {
+                for (i = 0; i < value->value_hashtable->count; i++)
+                {
+                    weechat_relay_value_clear (&value->value_hashtable->keys[i]);
+                    weechat_relay_value_clear (&value->value_hashtable->values[i]);
+                }
+                free (value->value_hashtable);
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_HDATA:
+            if (value->value_hdata)
+            {
+                if (value->value_hdata->hpath)
+                    free (value->value_hdata->hpath);
+                if (value->value_hdata->keys)
+                    free (value->value_hdata->keys);
+                if (value->value_hdata->keys_names)
+                {
+                    for (i = 0; i < value->value_hdata->num_keys; i++)
+                    {
+                        if (value->value_hdata->keys_names[i])
+                            free (value->value_hdata->keys_names[i]);
+                    }
+                    free (value->value_hdata->keys_names);
+                }
+                if (value->value_hdata->keys_types)
+                    free (value->value_hdata->keys_types);
+                if (value->value_hdata->ppath)
+                    free (value->value_hdata->ppath);
+                if (value->value_hdata->values)
+                {
+                    for (i = 0; i < value->value_hdata->count * value->value_hdata->num_keys; i++)
+                    {
+                        weechat_relay_value_clear (&value->value_hdata->values[i]);
+                    }
+                    free (value->value_hdata->values);
+                }
+                free (value->value_hdata);
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFO:
+            if (value->value_info)
+            {
+                if (value->value_info->name)
+                    free (value->value_info->name);
+                if (value->value_info->value)
+                    free (value->value_info->value);
+                free (value->value_info);
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_INFOLIST:
+            if (value->value_infolist)
+            {
+                if (value->value_infolist->name)
+                    free (value->value_infolist->name);
+                if (value->value_infolist->items)
+                {
+                    for (i = 0; i < value->value_infolist->count; i++)
+                    {
+                        for (j = 0; j < value->value_infolist->items[i].count; j++)
+                        {
+                            if (value->value_infolist->items[i].names[j])
+                                free (value->value_infolist->items[i].names[j]);
+                            weechat_relay_value_clear (&value->value_infolist->items[i].values[j]);
+                        }
+                        if (value->value_infolist->items[i].names)
+                            free (value->value_infolist->items[i].names);
+                        if (value->value_infolist->items[i].values)
+                            free (value->value_infolist->items[i].values);
+                    }
+                    free (value->value_infolist->items);
+                }
+                free (value->value_infolist);
+            }
+            break;
+        case WEECHAT_RELAY_OBJ_TYPE_ARRAY:
+            if (value->value_array)
+            {
+                for (i = 0; i < value->value_array->count; i++)
+                {
+                    weechat_relay_value_clear (&value->value_array->values[i]);
+                }
+                free (value->value_array);
+            }
+            break;
+        default:
+            break;
+    }
+
+    value->length = 0;
+    value->value_pointer = NULL;
+}
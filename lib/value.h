@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_VALUE_H
+#define WEECHAT_RELAY_VALUE_H
+
+extern int weechat_relay_value_strdup (const char *string, char **dest);
+extern int weechat_relay_value_set_string (struct t_weechat_relay_value *value,
+                                           const char *string);
+extern struct t_weechat_relay_value_hashtable *weechat_relay_value_hashtable_alloc (int count);
+extern struct t_weechat_relay_value_array *weechat_relay_value_array_alloc (int count);
+extern void weechat_relay_value_set_native (struct t_weechat_relay_value *value,
+                                            enum t_weechat_relay_obj_type type,
+                                            const void *values, int index);
+
+#endif /* WEECHAT_RELAY_VALUE_H */
@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 #include <time.h>
+#include <sys/uio.h>
 
 /* WeeChat Relay version */
 
@@ -49,6 +50,10 @@ enum t_weechat_relay_compression
 /* Messages */
 
 #define WEECHAT_RELAY_MSG_INITIAL_ALLOC 4096
+/* uncompressed bytes kept before compression (weechat_relay_msg_new_compress) */
+#define WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE (32 * 1024)
+/* default minimum size of message compressed with zstd worker threads */
+#define WEECHAT_RELAY_MSG_COMPRESS_WORKERS_MIN_SIZE (1024 * 1024)
 
 /* Object ids in binary messages */
 enum t_weechat_relay_obj_type
@@ -76,8 +81,65 @@ struct t_weechat_relay_msg
     char *data;                        /* binary buffer                     */
     size_t data_alloc;                 /* currently allocated size          */
     size_t data_size;                  /* current size of buffer            */
+    int passthrough;                   /* 1 if bytes of parsed objects are  */
+                                       /* copied (weechat_relay_msg_new_    */
+                                       /* parsed)                           */
+    enum t_weechat_relay_compression compression; /* compression while      */
+                                       /* building (weechat_relay_msg_new_  */
+                                       /* compress), data is then the bytes */
+                                       /* not yet compressed                */
+    void *compress_stream;             /* z_stream or ZSTD_CCtx (NULL after */
+                                       /* weechat_relay_msg_finalize)       */
+    char *compressed;                  /* compressed message (with size and */
+                                       /* compression flag)                 */
+    size_t compressed_alloc;           /* allocated size for compressed     */
+    size_t compressed_size;            /* size of compressed message        */
 };
 
+/*
+ * Structure to send a binary message in chunks (WeeChat -> client): data is
+ * appended in a chain of chunks (never reallocated) and large payloads can
+ * be added by reference; the message is sent with writev (segments "iov").
+ */
+#define WEECHAT_RELAY_MSG_CHAIN_CHUNK_SIZE (16 * 1024)
+#define WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE 1024
+
+struct t_weechat_relay_msg_chain
+{
+    char **chunks;                     /* chunks allocated                  */
+    int num_chunks;                    /* number of chunks                  */
+    size_t chunk_size;                 /* size of new chunks                */
+    size_t chunk_alloc;                /* allocated size of last chunk      */
+    size_t chunk_used;                 /* bytes used in last chunk          */
+    struct iovec *iov;                 /* segments of message: in chunks or */
+                                       /* data added by reference           */
+    int iovcnt;                        /* number of segments                */
+    int iov_alloc;                     /* number of segments allocated      */
+    size_t size;                       /* total size of message             */
+};
+
+/*
+ * Template of message (WeeChat -> client), for messages sent many times with
+ * the same shape: constant bytes (id, types, hpath, keys...) are encoded once
+ * and only the values of slots are written for each message.
+ */
+struct t_weechat_relay_msg_template_slot
+{
+    size_t offset;                     /* position of slot in constant data */
+    enum t_weechat_relay_obj_type type; /* type of value (scalar type)      */
+};
+
+struct t_weechat_relay_msg_template
+{
+    struct t_weechat_relay_msg *msg;   /* id and constant bytes             */
+    struct t_weechat_relay_msg_template_slot *slots; /* variable values     */
+    int num_slots;                     /* number of slots                   */
+    int slots_alloc;                   /* number of slots allocated         */
+};
+
+/* Compression context, reused to compress many messages (WeeChat -> client) */
+struct t_weechat_relay_msg_compress_ctx;
+
 /* Message objects: used to build messages and parse them */
 struct t_weechat_relay_obj;
 
@@ -87,6 +149,11 @@ struct t_weechat_relay_obj_buffer
     int length;
 };
 
+/*
+ * The index on keys is built by the parser (flag
+ * WEECHAT_RELAY_PARSE_FLAG_HASHTABLE_INDEX) or on first call to
+ * weechat_relay_obj_hashtable_get; it is not used to build messages.
+ */
 struct t_weechat_relay_obj_hashtable
 {
     enum t_weechat_relay_obj_type type_keys;
@@ -94,11 +161,15 @@ struct t_weechat_relay_obj_hashtable
     int count;
     struct t_weechat_relay_obj **keys;
     struct t_weechat_relay_obj **values;
+    int index_size;                    /* size of index (power of 2)        */
+    int *index;                        /* open addressing: entry + 1 in     */
+                                       /* each slot (0 = empty slot)        */
 };
 
 /*
- * When building a message, only fields hpath/keys/count/ppath/values are used,
- * when parsing a message, all fields are set by the parser.
+ * When building a message, only fields hpath/keys/count/ppath/values are used
+ * (and columns for values that are NULL), when parsing a message, all fields
+ * are set by the parser.
  */
 struct t_weechat_relay_obj_hdata
 {
@@ -117,6 +188,14 @@ struct t_weechat_relay_obj_hdata
     int count;
     struct t_weechat_relay_obj ***ppath;
     struct t_weechat_relay_obj ***values;
+
+    /*
+     * native columns (parser flag WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS):
+     * NULL or array of num_keys pointers; for a key of type "int" or "chr",
+     * columns[key] is an array of count int or char and values[row][key]
+     * is NULL
+     */
+    void **columns;
 };
 
 struct t_weechat_relay_obj_info
@@ -137,11 +216,34 @@ struct t_weechat_relay_obj_infolist_item
     struct t_weechat_relay_obj_infolist_var **variables;
 };
 
+struct t_weechat_relay_obj_infolist_schema
+{
+    int count;                         /* number of variables               */
+    char **names;                      /* names of variables                */
+    enum t_weechat_relay_obj_type *types; /* types of variables             */
+};
+
+/*
+ * Columnar infolist (parser flag WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS):
+ * if all items have the same variables (same names and types, same order)
+ * and all variables have a scalar type, "items" is NULL, names and types are
+ * stored once in "schema" and values in native "columns": columns[variable]
+ * is an array of count values, according to the type of variable: char,
+ * int, long, char *, struct t_weechat_relay_obj_buffer, const void * or
+ * time_t.
+ *
+ * Objects are built only when they are asked for (function
+ * weechat_relay_obj_infolist_get), and kept in "objects"
+ * (objects[variable * count + item], NULL if not built).
+ */
 struct t_weechat_relay_obj_infolist
 {
     char *name;
     int count;
     struct t_weechat_relay_obj_infolist_item **items;
+    struct t_weechat_relay_obj_infolist_schema *schema;
+    void **columns;
+    struct t_weechat_relay_obj **objects;
 };
 
 struct t_weechat_relay_obj_array
@@ -149,6 +251,8 @@ struct t_weechat_relay_obj_array
     enum t_weechat_relay_obj_type type;
     int count;
     struct t_weechat_relay_obj **values;
+    void *values_native;               /* array of count int or char,       */
+                                       /* used only if "values" is NULL     */
 };
 
 struct t_weechat_relay_obj
@@ -169,11 +273,143 @@ struct t_weechat_relay_obj
         struct t_weechat_relay_obj_infolist value_infolist;
         struct t_weechat_relay_obj_array value_array;
     };
+    const void *wire;                  /* value in message received (parser */
+                                       /* flag PASSTHROUGH), used only in   */
+                                       /* weechat_relay_msg_new_parsed      */
+    size_t wire_size;                  /* size of value in message received */
+    int dirty;                         /* object (or a child) modified:     */
+                                       /* built again instead of copied     */
+};
+
+/* Flags to parse messages */
+
+#define WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS (1 << 0) /* arrays and hdata */
+                                       /* columns of int/chr decoded to     */
+                                       /* native C arrays                   */
+#define WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS (1 << 1) /* infolists   */
+                                       /* with same variables in all items  */
+                                       /* stored by column                  */
+#define WEECHAT_RELAY_PARSE_FLAG_HASHTABLE_INDEX (1 << 2) /* hash index on  */
+                                       /* keys of hashtables                */
+#define WEECHAT_RELAY_PARSE_FLAG_VALUES (1 << 3) /* compact values instead  */
+                                       /* of objects (other flags ignored)  */
+#define WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH (1 << 4) /* objects keep their */
+                                       /* bytes received: copied when they  */
+                                       /* are added in a message, unless    */
+                                       /* marked dirty (a message parsed    */
+                                       /* from segments is copied first)    */
+
+/*
+ * Compact values: 16 bytes with scalars stored inline, containers are
+ * allocated separately (with their elements stored contiguously, not one
+ * allocation per element).
+ */
+struct t_weechat_relay_value;
+
+struct t_weechat_relay_value_hashtable
+{
+    enum t_weechat_relay_obj_type type_keys;
+    enum t_weechat_relay_obj_type type_values;
+    int count;
+    struct t_weechat_relay_value *keys;   /* count keys                     */
+    struct t_weechat_relay_value *values; /* count values                   */
+};
+
+struct t_weechat_relay_value_hdata
+{
+    char *hpath;
+    char *keys;
+    int num_hpaths;
+    int num_keys;
+    char **keys_names;
+    enum t_weechat_relay_obj_type *keys_types;
+    int count;
+    const void **ppath;                   /* count * num_hpaths pointers    */
+    struct t_weechat_relay_value *values; /* count * num_keys values        */
+};
+
+struct t_weechat_relay_value_info
+{
+    char *name;
+    char *value;
+};
+
+struct t_weechat_relay_value_infolist_item
+{
+    int count;
+    char **names;                         /* count names                    */
+    struct t_weechat_relay_value *values; /* count values                   */
+};
+
+struct t_weechat_relay_value_infolist
+{
+    char *name;
+    int count;
+    struct t_weechat_relay_value_infolist_item *items; /* count items       */
+};
+
+struct t_weechat_relay_value_array
+{
+    enum t_weechat_relay_obj_type type;
+    int count;
+    struct t_weechat_relay_value *values; /* count values                   */
+};
+
+struct t_weechat_relay_value
+{
+    enum t_weechat_relay_obj_type type;
+    int length;                        /* string: length (-1 if NULL),      */
+                                       /* buffer: length                    */
+    union
+    {
+        char value_char;
+        int value_integer;
+        long value_long;
+        char *value_string;
+        void *value_buffer;
+        const void *value_pointer;
+        time_t value_time;
+        struct t_weechat_relay_value_hashtable *value_hashtable;
+        struct t_weechat_relay_value_hdata *value_hdata;
+        struct t_weechat_relay_value_info *value_info;
+        struct t_weechat_relay_value_infolist *value_infolist;
+        struct t_weechat_relay_value_array *value_array;
+    };
+};
+
+/* WeeChat events: ids of messages sent by WeeChat (client side) */
+
+enum t_weechat_relay_event
+{
+    WEECHAT_RELAY_EVENT_NONE = 0,      /* not an event (custom id)          */
+    WEECHAT_RELAY_EVENT_BUFFER_OPENED,
+    WEECHAT_RELAY_EVENT_BUFFER_TYPE_CHANGED,
+    WEECHAT_RELAY_EVENT_BUFFER_MOVED,
+    WEECHAT_RELAY_EVENT_BUFFER_MERGED,
+    WEECHAT_RELAY_EVENT_BUFFER_UNMERGED,
+    WEECHAT_RELAY_EVENT_BUFFER_HIDDEN,
+    WEECHAT_RELAY_EVENT_BUFFER_UNHIDDEN,
+    WEECHAT_RELAY_EVENT_BUFFER_RENAMED,
+    WEECHAT_RELAY_EVENT_BUFFER_TITLE_CHANGED,
+    WEECHAT_RELAY_EVENT_BUFFER_LOCALVAR_ADDED,
+    WEECHAT_RELAY_EVENT_BUFFER_LOCALVAR_CHANGED,
+    WEECHAT_RELAY_EVENT_BUFFER_LOCALVAR_REMOVED,
+    WEECHAT_RELAY_EVENT_BUFFER_CLOSING,
+    WEECHAT_RELAY_EVENT_BUFFER_CLEARED,
+    WEECHAT_RELAY_EVENT_BUFFER_LINE_ADDED,
+    WEECHAT_RELAY_EVENT_NICKLIST,
+    WEECHAT_RELAY_EVENT_NICKLIST_DIFF,
+    WEECHAT_RELAY_EVENT_PONG,
+    WEECHAT_RELAY_EVENT_UPGRADE,
+    WEECHAT_RELAY_EVENT_UPGRADE_ENDED,
+    /* number of events */
+    WEECHAT_RELAY_NUM_EVENTS,
 };
 
 struct t_weechat_relay_parsed_msg
 {
-    void *message;                                /* message                */
+    void *message;                                /* message (NULL if       */
+                                                  /* parsed from segments)  */
     size_t length;                                /* message length         */
     size_t length_data;                           /* length - 5             */
     void *data_decompressed;                      /* decompressed data      */
@@ -181,18 +417,105 @@ struct t_weechat_relay_parsed_msg
     size_t length_data_decompressed;              /* decompressed length    */
 
     enum t_weechat_relay_compression compression; /* compression type       */
-    char *id;                                     /* message id             */
+    char *id;                                     /* message id (read-only) */
+    enum t_weechat_relay_event event;             /* WeeChat event: id is   */
+                                                  /* a static string        */
+    int id_custom;                                /* custom id interned in  */
+                                                  /* dispatcher: index + 1, */
+                                                  /* reference held on id   */
+                                                  /* (0 = id allocated)     */
 
     int num_objects;                              /* number of objects      */
     struct t_weechat_relay_obj **objects;         /* parsed objects         */
 
+    int num_values;                               /* number of values       */
+    struct t_weechat_relay_value *values;         /* parsed values (flag    */
+                                                  /* PARSE_FLAG_VALUES)     */
+
+    int refcount;                                 /* number of references   */
+                                                  /* (message is read-only  */
+                                                  /* after parse)           */
+    struct t_weechat_relay_parsed_msg *next_reclaim; /* next message to    */
+                                                  /* free (reclaimer)       */
+
     /* parser variables */
+    int flags;                         /* WEECHAT_RELAY_PARSE_FLAG_XXX      */
     const void *buffer;                /* pointer to data or data_decomp.   */
                                        /* (after the 5 first bytes)         */
     size_t size;                       /* size of buffer                    */
     size_t position;                   /* current position in buffer        */
+    struct iovec *iov;                 /* segments (message not compressed  */
+                                       /* and parsed from segments), used   */
+                                       /* instead of buffer (only during    */
+                                       /* parse, NULL after)                */
+    int iovcnt;                        /* number of segments                */
+    int iov_index;                     /* segment at current position       */
+    size_t iov_start;                  /* position of segment "iov_index"   */
 };
 
+/* Parse of messages in multiple steps (client side) */
+
+struct t_weechat_relay_parse_handle;
+
+/* Queries on parsed messages (client side) */
+
+enum t_weechat_relay_query_step_type
+{
+    WEECHAT_RELAY_QUERY_STEP_INDEX = 0, /* object, row, item or element     */
+    WEECHAT_RELAY_QUERY_STEP_ALL,      /* "*": all objects/rows/elements    */
+    WEECHAT_RELAY_QUERY_STEP_TYPE,     /* check of object type ("hda", ...) */
+    WEECHAT_RELAY_QUERY_STEP_NAME,     /* hdata key, infolist variable      */
+                                       /* or hashtable key                  */
+    WEECHAT_RELAY_QUERY_STEP_KEY,      /* "[key]": hashtable key            */
+    /* number of query step types */
+    WEECHAT_RELAY_QUERY_NUM_STEP_TYPES,
+};
+
+struct t_weechat_relay_query_step
+{
+    enum t_weechat_relay_query_step_type type; /* step type                 */
+    int index;                         /* index (for step "index")          */
+    enum t_weechat_relay_obj_type obj_type; /* type (for step "type")       */
+    char *name;                        /* name or key (steps "name"/"key")  */
+};
+
+struct t_weechat_relay_query
+{
+    char *path;                        /* path, for example: "0/hda/0/msg"  */
+    int num_steps;                     /* number of steps in path           */
+    struct t_weechat_relay_query_step *steps; /* compiled steps             */
+};
+
+/*
+ * State of query evaluation, owned by the caller (for example one per
+ * thread), so that a compiled query is never modified and can be evaluated
+ * by many threads at the same time.
+ */
+#define WEECHAT_RELAY_QUERY_STATE_MAX_STEPS 16
+
+struct t_weechat_relay_query_state
+{
+    int cached_index[WEECHAT_RELAY_QUERY_STATE_MAX_STEPS]; /* index found   */
+                                       /* by last evaluation of each step   */
+                                       /* (column, variable or htb entry)   */
+    struct t_weechat_relay_obj value_native; /* object returned for a value */
+                                       /* in a native array or column       */
+};
+
+/* Filters on message ids (client side) */
+
+enum t_weechat_relay_filter_action
+{
+    WEECHAT_RELAY_FILTER_ACCEPT = 0,   /* message is parsed                 */
+    WEECHAT_RELAY_FILTER_DROP,         /* message is dropped before parse   */
+    /* number of filter actions */
+    WEECHAT_RELAY_NUM_FILTER_ACTIONS,
+};
+
+/* Dispatch of parsed messages (client side) */
+
+struct t_weechat_relay_dispatch;
+
 /* Relay sessions (client -> WeeChat and WeeChat -> client) */
 
 struct t_weechat_relay_session
@@ -204,12 +527,97 @@ struct t_weechat_relay_session
     /* buffer for received data */
     void *buffer;                      /* buffer                            */
     size_t buffer_size;                /* size of buffer                    */
+    size_t buffer_alloc;               /* size allocated for buffer         */
+
+    void *parse_ctx;                   /* context to parse messages         */
+                                       /* (reused by each batch parse)      */
+
+    void *filter;                      /* filter on message ids             */
+    long filter_dropped;               /* number of messages dropped        */
+
+    /* big messages received (bounded memory) */
+    size_t buffer_checked;             /* position of first message in      */
+                                       /* buffer not checked (size)         */
+    size_t spill_threshold;            /* bigger messages are received in   */
+                                       /* a temporary file (0 = never)      */
+    void *spill;                       /* messages received in temporary    */
+                                       /* files (queue, first message)      */
+    void *last_spill;                  /* last message in temporary file    */
+    size_t spill_size;                 /* bytes of messages in temp. files  */
+    size_t max_message_size;           /* bigger messages are rejected      */
+                                       /* (0 = no limit)                    */
+    size_t max_buffer_size;            /* max bytes received and not parsed */
+                                       /* (memory + temporary files), next  */
+                                       /* messages are rejected (0 = none)  */
+    size_t reject_remaining;           /* bytes to discard (message         */
+                                       /* rejected)                         */
+    long messages_rejected;            /* number of messages rejected       */
+};
+
+/*
+ * Policy to compress messages (WeeChat -> client): codec and level are
+ * chosen for each message according to its size, the average ratio and
+ * speed of compression and a CPU budget; the settings can be changed at any
+ * time.
+ */
+#define WEECHAT_RELAY_POLICY_MIN_SIZE 256
+#define WEECHAT_RELAY_POLICY_BIG_SIZE (64 * 1024)
+#define WEECHAT_RELAY_POLICY_MAX_RATIO 0.9
+#define WEECHAT_RELAY_POLICY_PROBE_INTERVAL 64
+#define WEECHAT_RELAY_POLICY_CPU_BUDGET 100000
+
+struct t_weechat_relay_policy
+{
+    /* settings */
+    enum t_weechat_relay_compression compression; /* codec (zlib or zstd), */
+                                       /* OFF = never compress              */
+    int level;                         /* compression level                 */
+    int level_fast;                    /* level if CPU budget is short      */
+    int level_big;                     /* level for big messages            */
+    size_t min_size;                   /* smaller messages are not          */
+                                       /* compressed                        */
+    size_t big_size;                   /* min size of big messages          */
+    double max_ratio;                  /* messages are not compressed if    */
+                                       /* the average ratio (compressed     */
+                                       /* size / size) is higher            */
+    int probe_interval;                /* if ratio is too high, compress    */
+                                       /* one message out of this number    */
+                                       /* to measure the ratio again        */
+    long cpu_budget;                   /* max time spent compressing, in    */
+                                       /* microseconds per second (0 = no   */
+                                       /* limit)                            */
+
+    /* statistics */
+    double avg_ratio;                  /* moving average of ratio           */
+    double avg_speed;                  /* moving average of speed (bytes    */
+                                       /* compressed per microsecond)       */
+    long long budget_start;            /* start of current second (in       */
+                                       /* microseconds, monotonic clock)    */
+    long budget_used;                  /* microseconds spent compressing in */
+                                       /* current second                    */
+    int probe_countdown;               /* messages before next probe        */
+
+    /* counters of decisions */
+    long count_small;                  /* not compressed: too small         */
+    long count_ratio;                  /* not compressed: bad ratio         */
+    long count_budget;                 /* not compressed: no CPU budget     */
+    long count_level;                  /* compressed with "level"           */
+    long count_fast;                   /* compressed with "level_fast"      */
+    long count_big;                    /* compressed with "level_big"       */
+    long count_probe;                  /* compressed to measure the ratio   */
+    long count_bigger;                 /* compressed but sent uncompressed  */
+                                       /* (compressed message was bigger)   */
+    long long bytes_in;                /* bytes of messages                 */
+    long long bytes_out;               /* bytes sent (after compression)    */
+    long long time_compress;           /* time spent compressing (in        */
+                                       /* microseconds)                     */
 };
 
 /* Arrays */
 
 extern const char *weechat_relay_compression_string[WEECHAT_RELAY_NUM_COMPRESSIONS];
 extern const char *weechat_relay_obj_types_str[WEECHAT_RELAY_NUM_OBJ_TYPES];
+extern const char *weechat_relay_event_string[WEECHAT_RELAY_NUM_EVENTS];
 
 /* Relay session */
 
@@ -217,12 +625,40 @@ extern struct t_weechat_relay_session *weechat_relay_session_init (int sock,
                                                                    void *gnutls_session);
 extern ssize_t weechat_relay_session_send (struct t_weechat_relay_session *session,
                                            void *buffer, size_t size);
+extern ssize_t weechat_relay_session_send_iov (struct t_weechat_relay_session *session,
+                                               const struct iovec *iov,
+                                               int iovcnt);
 extern ssize_t weechat_relay_session_recv (struct t_weechat_relay_session *session,
                                            void *buffer, size_t size);
 extern int weechat_relay_session_buffer_add_bytes (struct t_weechat_relay_session *session,
                                                    const void *buffer, size_t size);
 extern void weechat_relay_session_buffer_pop (struct t_weechat_relay_session *session,
                                               void **buffer, size_t *size);
+extern struct t_weechat_relay_parsed_msg **weechat_relay_session_buffer_parse (struct t_weechat_relay_session *session,
+                                                                               int flags,
+                                                                               int *count);
+extern int weechat_relay_session_filter_add (struct t_weechat_relay_session *session,
+                                             const char *id,
+                                             enum t_weechat_relay_filter_action action);
+extern int weechat_relay_session_filter_remove (struct t_weechat_relay_session *session,
+                                                const char *id);
+extern void weechat_relay_session_filter_set_default (struct t_weechat_relay_session *session,
+                                                      enum t_weechat_relay_filter_action action);
+extern void weechat_relay_session_filter_clear (struct t_weechat_relay_session *session);
+extern enum t_weechat_relay_filter_action weechat_relay_session_filter_check (struct t_weechat_relay_session *session,
+                                                                              const void *buffer,
+                                                                              size_t size);
+extern int weechat_relay_session_buffer_dispatch (struct t_weechat_relay_session *session,
+                                                  struct t_weechat_relay_dispatch *dispatch,
+                                                  int flags);
+extern void weechat_relay_session_set_spill_threshold (struct t_weechat_relay_session *session,
+                                                      size_t threshold);
+extern int weechat_relay_session_set_dict (struct t_weechat_relay_session *session,
+                                           const void *dict, size_t size);
+extern void weechat_relay_session_set_max_message_size (struct t_weechat_relay_session *session,
+                                                       size_t max_size);
+extern void weechat_relay_session_set_max_buffer_size (struct t_weechat_relay_session *session,
+                                                      size_t max_size);
 extern void weechat_relay_session_free (struct t_weechat_relay_session *session);
 
 /* Relay commands (client -> WeeChat) */
@@ -282,9 +718,19 @@ extern ssize_t weechat_relay_cmd_quit (struct t_weechat_relay_session *session,
 /* Relay messages (WeeChat -> client) */
 
 extern struct t_weechat_relay_msg *weechat_relay_msg_new (const char *id);
+extern struct t_weechat_relay_msg *weechat_relay_msg_new_compress (const char *id,
+                                                                   enum t_weechat_relay_compression compression,
+                                                                   int compression_level);
 extern int weechat_relay_msg_set_bytes (struct t_weechat_relay_msg *msg,
                                         size_t position, const void *buffer,
                                         size_t size);
+extern int weechat_relay_msg_reserve (struct t_weechat_relay_msg *msg,
+                                      size_t size);
+extern int weechat_relay_msg_finalize (struct t_weechat_relay_msg *msg);
+extern void weechat_relay_msg_put_bytes (struct t_weechat_relay_msg *msg,
+                                         const void *buffer, size_t size);
+extern void weechat_relay_msg_put_integer (struct t_weechat_relay_msg *msg,
+                                           int value);
 extern int weechat_relay_msg_add_bytes (struct t_weechat_relay_msg *msg,
                                         const void *buffer, size_t size);
 extern int weechat_relay_msg_add_type (struct t_weechat_relay_msg *msg,
@@ -317,18 +763,214 @@ extern int weechat_relay_msg_add_object_value (struct t_weechat_relay_msg *msg,
                                                struct t_weechat_relay_obj *obj);
 extern int weechat_relay_msg_add_object (struct t_weechat_relay_msg *msg,
                                          struct t_weechat_relay_obj *obj);
+extern int weechat_relay_msg_add_value_content (struct t_weechat_relay_msg *msg,
+                                                const struct t_weechat_relay_value *value);
+extern int weechat_relay_msg_add_value (struct t_weechat_relay_msg *msg,
+                                        const struct t_weechat_relay_value *value);
 extern void *weechat_relay_msg_compress_zlib (struct t_weechat_relay_msg *msg,
                                               int compression_level,
                                               size_t *size);
 extern void *weechat_relay_msg_compress_zstd (struct t_weechat_relay_msg *msg,
                                               int compression_level,
                                               size_t *size);
+extern int weechat_relay_msg_compress (struct t_weechat_relay_msg *msg,
+                                       struct t_weechat_relay_msg_compress_ctx *ctx,
+                                       enum t_weechat_relay_compression compression,
+                                       int compression_level);
+extern struct t_weechat_relay_msg_compress_ctx *weechat_relay_msg_compress_ctx_new ();
+extern void *weechat_relay_msg_compress_zlib_ctx (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                                  struct t_weechat_relay_msg *msg,
+                                                  int compression_level,
+                                                  size_t *size);
+extern void *weechat_relay_msg_compress_zstd_ctx (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                                  struct t_weechat_relay_msg *msg,
+                                                  int compression_level,
+                                                  size_t *size);
+extern int weechat_relay_msg_compress_ctx_set_dict (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                                   const void *dict, size_t size);
+extern int weechat_relay_msg_compress_ctx_set_workers (struct t_weechat_relay_msg_compress_ctx *ctx,
+                                                      int workers,
+                                                      size_t min_size);
+extern void weechat_relay_msg_compress_ctx_free (struct t_weechat_relay_msg_compress_ctx *ctx);
+extern void *weechat_relay_msg_train_dict (const void *frames, size_t size,
+                                           size_t dict_max_size,
+                                           size_t *dict_size);
+extern struct t_weechat_relay_msg *weechat_relay_msg_new_parsed (struct t_weechat_relay_parsed_msg *parsed_msg);
+extern int weechat_relay_msg_reset (struct t_weechat_relay_msg *msg,
+                                    const char *id);
 extern void weechat_relay_msg_free (struct t_weechat_relay_msg *msg);
 
+/* Relay messages in chunks (WeeChat -> client) */
+
+extern struct t_weechat_relay_msg_chain *weechat_relay_msg_chain_new (const char *id,
+                                                                      size_t chunk_size);
+extern char *weechat_relay_msg_chain_reserve (struct t_weechat_relay_msg_chain *chain,
+                                              size_t size);
+extern int weechat_relay_msg_chain_add_bytes (struct t_weechat_relay_msg_chain *chain,
+                                              const void *buffer, size_t size);
+extern int weechat_relay_msg_chain_add_ref (struct t_weechat_relay_msg_chain *chain,
+                                            const void *buffer, size_t size);
+extern int weechat_relay_msg_chain_add_type (struct t_weechat_relay_msg_chain *chain,
+                                             enum t_weechat_relay_obj_type obj_type);
+extern int weechat_relay_msg_chain_add_char (struct t_weechat_relay_msg_chain *chain,
+                                             char c);
+extern int weechat_relay_msg_chain_add_integer (struct t_weechat_relay_msg_chain *chain,
+                                                int value);
+extern int weechat_relay_msg_chain_add_long (struct t_weechat_relay_msg_chain *chain,
+                                             long value);
+extern int weechat_relay_msg_chain_add_string (struct t_weechat_relay_msg_chain *chain,
+                                               const char *string);
+extern int weechat_relay_msg_chain_add_string_ref (struct t_weechat_relay_msg_chain *chain,
+                                                   const char *string);
+extern int weechat_relay_msg_chain_add_buffer_ref (struct t_weechat_relay_msg_chain *chain,
+                                                   const void *buffer, int length);
+extern int weechat_relay_msg_chain_add_pointer (struct t_weechat_relay_msg_chain *chain,
+                                                const void *pointer);
+extern int weechat_relay_msg_chain_add_time (struct t_weechat_relay_msg_chain *chain,
+                                             time_t time);
+extern int weechat_relay_msg_chain_add_object (struct t_weechat_relay_msg_chain *chain,
+                                               struct t_weechat_relay_obj *obj);
+extern struct iovec *weechat_relay_msg_chain_iovec (struct t_weechat_relay_msg_chain *chain,
+                                                    int *iovcnt);
+extern void weechat_relay_msg_chain_free (struct t_weechat_relay_msg_chain *chain);
+
+/* Relay message templates (WeeChat -> client) */
+
+extern struct t_weechat_relay_msg_template *weechat_relay_msg_template_new (const char *id);
+extern int weechat_relay_msg_template_add_bytes (struct t_weechat_relay_msg_template *tmpl,
+                                                 const void *buffer,
+                                                 size_t size);
+extern int weechat_relay_msg_template_add_type (struct t_weechat_relay_msg_template *tmpl,
+                                                enum t_weechat_relay_obj_type obj_type);
+extern int weechat_relay_msg_template_add_integer (struct t_weechat_relay_msg_template *tmpl,
+                                                   int value);
+extern int weechat_relay_msg_template_add_string (struct t_weechat_relay_msg_template *tmpl,
+                                                  const char *string);
+extern int weechat_relay_msg_template_add_slot (struct t_weechat_relay_msg_template *tmpl,
+                                                enum t_weechat_relay_obj_type obj_type);
+extern int weechat_relay_msg_template_add_hdata (struct t_weechat_relay_msg_template *tmpl,
+                                                 const char *hpath,
+                                                 const char *keys,
+                                                 int count);
+extern int weechat_relay_msg_template_fill (struct t_weechat_relay_msg_template *tmpl,
+                                            struct t_weechat_relay_msg *msg,
+                                            const struct t_weechat_relay_value *values,
+                                            int num_values);
+extern struct t_weechat_relay_msg *weechat_relay_msg_template_new_msg (struct t_weechat_relay_msg_template *tmpl,
+                                                                       const struct t_weechat_relay_value *values,
+                                                                       int num_values);
+extern void weechat_relay_msg_template_free (struct t_weechat_relay_msg_template *tmpl);
+
+/* Objects in parsed messages (client side) */
+
+extern struct t_weechat_relay_obj *weechat_relay_obj_infolist_get (struct t_weechat_relay_obj_infolist *infolist,
+                                                                   int item,
+                                                                   const char *name);
+extern struct t_weechat_relay_obj *weechat_relay_obj_hashtable_get (struct t_weechat_relay_obj_hashtable *hashtable,
+                                                                    const struct t_weechat_relay_obj *key);
+extern struct t_weechat_relay_obj *weechat_relay_obj_hashtable_get_string (struct t_weechat_relay_obj_hashtable *hashtable,
+                                                                           const char *key);
+
+/* Compact values */
+
+extern int weechat_relay_value_from_obj (struct t_weechat_relay_value *value,
+                                         const struct t_weechat_relay_obj *obj);
+extern struct t_weechat_relay_obj *weechat_relay_value_to_obj (const struct t_weechat_relay_value *value);
+extern void weechat_relay_value_clear (struct t_weechat_relay_value *value);
+
 /* Functions to parse binary messages sent by WeeChat (client side) */
 
+extern int weechat_relay_parse_peek_id (const void *buffer, size_t size,
+                                        char *id, size_t id_size);
 extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_message (const void *buffer,
                                                                        size_t size);
+extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_message_flags (const void *buffer,
+                                                                             size_t size,
+                                                                             int flags);
+extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_message_iov (const struct iovec *iov,
+                                                                           int iovcnt,
+                                                                           int flags);
+extern struct t_weechat_relay_parse_handle *weechat_relay_parse_handle_new (const void *buffer,
+                                                                           size_t size,
+                                                                           int flags);
+extern int weechat_relay_parse_handle_step (struct t_weechat_relay_parse_handle *handle,
+                                            int max_objects,
+                                            long max_usec);
+extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_handle_finish (struct t_weechat_relay_parse_handle *handle);
+extern void weechat_relay_parse_handle_free (struct t_weechat_relay_parse_handle *handle);
+extern struct t_weechat_relay_parsed_msg *weechat_relay_parse_msg_retain (struct t_weechat_relay_parsed_msg *parsed_msg);
+extern void weechat_relay_parse_msg_release (struct t_weechat_relay_parsed_msg *parsed_msg);
 extern void weechat_relay_parse_msg_free (struct t_weechat_relay_parsed_msg *parsed_msg);
+extern int weechat_relay_parse_msg_set_dirty (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                              struct t_weechat_relay_obj *obj);
+
+/* Dispatch of parsed messages (client side) */
+
+extern enum t_weechat_relay_event weechat_relay_dispatch_search_event (const char *id,
+                                                                      int length);
+extern struct t_weechat_relay_dispatch *weechat_relay_dispatch_new ();
+extern int weechat_relay_dispatch_set_event (struct t_weechat_relay_dispatch *dispatch,
+                                             enum t_weechat_relay_event event,
+                                             void (*callback)(void *data,
+                                                              struct t_weechat_relay_parsed_msg *parsed_msg),
+                                             void *callback_data);
+extern int weechat_relay_dispatch_set_id (struct t_weechat_relay_dispatch *dispatch,
+                                          const char *id,
+                                          void (*callback)(void *data,
+                                                           struct t_weechat_relay_parsed_msg *parsed_msg),
+                                          void *callback_data);
+extern void weechat_relay_dispatch_set_default (struct t_weechat_relay_dispatch *dispatch,
+                                                void (*callback)(void *data,
+                                                                 struct t_weechat_relay_parsed_msg *parsed_msg),
+                                                void *callback_data);
+extern int weechat_relay_dispatch_message (struct t_weechat_relay_dispatch *dispatch,
+                                           struct t_weechat_relay_parsed_msg *parsed_msg);
+extern void weechat_relay_dispatch_free (struct t_weechat_relay_dispatch *dispatch);
+
+/* Policy to compress messages (WeeChat -> client) */
+
+extern struct t_weechat_relay_policy *weechat_relay_policy_new (enum t_weechat_relay_compression compression);
+extern enum t_weechat_relay_compression weechat_relay_policy_choose (struct t_weechat_relay_policy *policy,
+                                                                     size_t size,
+                                                                     int *level);
+extern void weechat_relay_policy_update (struct t_weechat_relay_policy *policy,
+                                         size_t size,
+                                         size_t compressed_size,
+                                         long time_compress);
+extern const void *weechat_relay_policy_compress (struct t_weechat_relay_policy *policy,
+                                                  struct t_weechat_relay_msg_compress_ctx *ctx,
+                                                  struct t_weechat_relay_msg *msg,
+                                                  size_t *size);
+extern void weechat_relay_policy_free (struct t_weechat_relay_policy *policy);
+
+/* Deferred destruction of parsed messages (client side) */
+
+struct t_weechat_relay_reclaim;
+
+extern struct t_weechat_relay_reclaim *weechat_relay_reclaim_new ();
+extern void weechat_relay_reclaim_release (struct t_weechat_relay_reclaim *reclaim,
+                                           struct t_weechat_relay_parsed_msg *parsed_msg);
+extern void weechat_relay_reclaim_flush (struct t_weechat_relay_reclaim *reclaim);
+extern void weechat_relay_reclaim_get_counters (struct t_weechat_relay_reclaim *reclaim,
+                                                int *pending_msgs,
+                                                size_t *pending_bytes,
+                                                long *freed_msgs,
+                                                size_t *freed_bytes);
+extern void weechat_relay_reclaim_free (struct t_weechat_relay_reclaim *reclaim);
+
+/* Queries on parsed messages (client side) */
+
+extern struct t_weechat_relay_query *weechat_relay_query_compile (const char *path);
+extern void weechat_relay_query_state_init (struct t_weechat_relay_query_state *state);
+extern int weechat_relay_query_exec (const struct t_weechat_relay_query *query,
+                                     struct t_weechat_relay_query_state *state,
+                                     struct t_weechat_relay_parsed_msg *parsed_msg,
+                                     int (*callback)(void *data,
+                                                     struct t_weechat_relay_obj *obj),
+                                     void *callback_data);
+extern struct t_weechat_relay_obj *weechat_relay_query_get (const struct t_weechat_relay_query *query,
+                                                            struct t_weechat_relay_query_state *state,
+                                                            struct t_weechat_relay_parsed_msg *parsed_msg);
+extern void weechat_relay_query_free (struct t_weechat_relay_query *query);
 
 #endif /* WEECHAT_RELAY_H */
@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 
 #include <gnutls/gnutls.h>
 #include <readline/readline.h>
@@ -54,6 +55,8 @@ const char *relay_cli_port = NULL;     /* pointer to port argument          */
 const char *relay_cli_commands[RELAY_CLI_MAX_COMMANDS];
                                        /* commands to send once connected   */
 int relay_cli_num_commands = 0;        /* number of commands to send        */
+const char *relay_cli_dict = NULL;     /* zstd dictionary file              */
+const char *relay_cli_train_dict = NULL; /* dictionary file to train        */
 
 /* other variables */
 int relay_cli_quit = 0;                /* 1 to exit program                 */
@@ -105,21 +108,30 @@ relay_cli_display_usage ()
     relay_cli_display_copyright ();
     printf ("\n");
     printf ("Usage: %s [option...] [hostname]\n", ptr_argv0);
+    printf ("       %s -T <file> frames...\n", ptr_argv0);
     printf ("\n");
     printf (
-        "  -4, --ipv4         force connection with IPv4 (default: auto)\n"
-        "  -6, --ipv6         force connection with IPv6 (default: auto)\n"
-        "  -c, --command      send commands once connected "
+        "  -4, --ipv4              force connection with IPv4 "
+        "(default: auto)\n"
+        "  -6, --ipv6              force connection with IPv6 "
+        "(default: auto)\n"
+        "  -c, --command           send commands once connected "
         "(up to " RELAY_CLI_MAX_COMMANDS_STR " commands are allowed)\n"
-        "  -d, --debug        debug mode: long objects view; "
+        "  -d, --debug             debug mode: long objects view; "
         "with two -d: display raw messages\n"
-        "  -h, --help         display help and exit\n"
-        "  -l, --license      display license and exit\n"
-        "  -p, --port <port>  the port to connect to "
+        "  -D, --dict <file>       zstd dictionary used to decompress "
+        "messages\n"
+        "  -h, --help              display help and exit\n"
+        "  -l, --license           display license and exit\n"
+        "  -p, --port <port>       the port to connect to "
         "(default: " RELAY_CLI_DEFAULT_PORT ")\n"
-        "  -s, --ssl          use SSL/TLS\n"
-        "  -v, --version      display version and exit\n"
-        "  hostname           hostname with running WeeChat\n");
+        "  -s, --ssl               use SSL/TLS\n"
+        "  -T, --train-dict <file> train a zstd dictionary with the "
+        "frames (files with\n"
+        "                          binary messages) and save it in file, "
+        "then exit\n"
+        "  -v, --version           display version and exit\n"
+        "  hostname                hostname with running WeeChat\n");
     printf ("\n");
 }
 
@@ -154,10 +166,12 @@ relay_cli_parse_args (int argc, char *argv[])
         { "ipv6",        no_argument,       NULL, '6' },
         { "command",     required_argument, NULL, 'c' },
         { "debug",       no_argument,       NULL, 'd' },
+        { "dict",        required_argument, NULL, 'D' },
         { "help",        no_argument,       NULL, 'h' },
         { "license",     no_argument,       NULL, 'l' },
         { "port",        required_argument, NULL, 'p' },
         { "ssl",         no_argument,       NULL, 's' },
+        { "train-dict",  required_argument, NULL, 'T' },
         { "version",     no_argument,       NULL, 'v' },
         { "version-git", no_argument,       NULL, 'V' },
         { NULL,       0,                 NULL, 0   },
@@ -177,11 +191,13 @@ relay_cli_parse_args (int argc, char *argv[])
         relay_cli_commands[i] = NULL;
     }
     relay_cli_num_commands = 0;
+    relay_cli_dict = NULL;
+    relay_cli_train_dict = NULL;
 
     long_index = 0;
 
     while ((rc == 1)
-           && (opt = getopt_long (argc, argv, "46c:dhlp:svV",
+           && (opt = getopt_long (argc, argv, "46c:dD:hlp:sT:vV",
                                long_options, &long_index)) != -1)
     {
         switch (opt)
@@ -206,6 +222,9 @@ relay_cli_parse_args (int argc, char *argv[])
             case 'd':
                 relay_cli_debug++;
                 break;
+            case 'D':
+                relay_cli_dict = optarg;
+                break;
             case 'h':
                 relay_cli_display_usage ();
                 rc = 0;
@@ -221,6 +240,9 @@ relay_cli_parse_args (int argc, char *argv[])
             case 's':
                 relay_cli_ssl = 1;
                 break;
+            case 'T':
+                relay_cli_train_dict = optarg;
+                break;
             case 'v':
                 printf ("%s\n",  WEECHAT_RELAY_VERSION);
                 rc = 0;
@@ -244,11 +266,12 @@ relay_cli_parse_args (int argc, char *argv[])
 
     if ((rc == 1) && (optind >= argc))
     {
-        relay_cli_display_arg_error ("missing hostname");
+        relay_cli_display_arg_error ((relay_cli_train_dict) ?
+                                     "missing frames" : "missing hostname");
         rc = -1;
     }
 
-    if (rc == 1)
+    if ((rc == 1) && !relay_cli_train_dict)
         relay_cli_hostname = argv[optind];
 
     return rc;
@@ -268,6 +291,29 @@ relay_cli_display_message (const void *buffer, size_t size)
     rl_forced_update_display ();
 }
 
+/*
+ * Displays an incoming parsed message ("time_diff" is the parse time, in
+ * microseconds).
+ */
+
+void
+relay_cli_display_parsed_message (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                  long long time_diff)
+{
+    if (parsed_msg)
+    {
+        printf ("\r--> %ld bytes received\n", parsed_msg->length);
+        if (relay_cli_debug >= 2)
+            display_hex_dump (parsed_msg->message, parsed_msg->length);
+    }
+    else
+    {
+        printf ("\r--> message received\n");
+    }
+    relay_message_display_parsed (parsed_msg, time_diff);
+    rl_forced_update_display ();
+}
+
 /*
  * Sends a command to WeeChat.
  *
@@ -346,8 +392,10 @@ relay_cli_recv_message ()
 {
     ssize_t num_recv;
     char buffer_recv[4096];
-    void *buffer;
-    size_t buffer_size;
+    struct t_weechat_relay_parsed_msg **messages;
+    struct timeval tv1, tv2;
+    long long time_diff;
+    int i, count;
 
     num_recv = weechat_relay_session_recv (relay_cli_session,
                                            buffer_recv, sizeof (buffer_recv));
@@ -371,15 +419,21 @@ relay_cli_recv_message ()
         /* add bytes to buffer */
         weechat_relay_session_buffer_add_bytes (relay_cli_session,
                                                 buffer_recv, num_recv);
-        /* pop messages and display them */
-        while (1)
+        /* parse all complete messages and display them */
+        gettimeofday (&tv1, NULL);
+        messages = weechat_relay_session_buffer_parse (relay_cli_session, 0,
+                                                       &count);
+        gettimeofday (&tv2, NULL);
+        if (messages)
         {
-            weechat_relay_session_buffer_pop (relay_cli_session,
-                                              &buffer, &buffer_size);
-            if (!buffer)
-                break;
-            relay_cli_display_message (buffer, buffer_size);
-            free (buffer);
+            /* parse time displayed is the average time in the batch */
+            time_diff = timeval_diff (&tv1, &tv2) / count;
+            for (i = 0; i < count; i++)
+            {
+                relay_cli_display_parsed_message (messages[i], time_diff);
+                weechat_relay_parse_msg_free (messages[i]);
+            }
+            free (messages);
         }
     }
 
@@ -410,6 +464,108 @@ relay_cli_line_handler (char *line)
         free (line);
 }
 
+/*
+ * Trains a zstd dictionary with the frames in files (binary messages, one
+ * after the other), and saves it in the file given with option -T.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+relay_cli_train_dict_files (int num_files, char *files[])
+{
+    char *frames, *frames2;
+    void *buffer, *dict;
+    size_t frames_size, size, dict_size;
+    int i, rc;
+
+    frames = NULL;
+    frames_size = 0;
+    dict = NULL;
+    rc = 0;
+
+    for (i = 0; i < num_files; i++)
+    {
+        buffer = file_read (files[i], &size);
+        if (!buffer)
+        {
+            fprintf (stderr, "ERROR: unable to read file \"%s\"\n", files[i]);
+            goto end;
+        }
+        frames2 = realloc (frames, frames_size + size + 1);
+        if (!frames2)
+        {
+            free (buffer);
+            goto end;
+        }
+        frames = frames2;
+        memcpy (frames + frames_size, buffer, size);
+        frames_size += size;
+        free (buffer);
+    }
+
+    dict = weechat_relay_msg_train_dict (frames, frames_size,
+                                         RELAY_CLI_DICT_MAX_SIZE, &dict_size);
+    if (!dict)
+    {
+        fprintf (stderr,
+                 "ERROR: unable to train dictionary (not enough frames?)\n");
+        goto end;
+    }
+
+    if (!file_write (relay_cli_train_dict, dict, dict_size))
+    {
+        fprintf (stderr, "ERROR: unable to write file \"%s\"\n",
+                 relay_cli_train_dict);
+        goto end;
+    }
+
+    printf ("Dictionary saved in \"%s\" (%ld bytes, %ld bytes of frames)\n",
+            relay_cli_train_dict, dict_size, frames_size);
+    rc = 1;
+
+end:
+    if (frames)
+        free (frames);
+    if (dict)
+        free (dict);
+    return rc;
+}
+
+/*
+ * Loads the zstd dictionary given with option -D in the relay session.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+relay_cli_load_dict ()
+{
+    void *dict;
+    size_t size;
+    int rc;
+
+    dict = file_read (relay_cli_dict, &size);
+    if (!dict)
+    {
+        fprintf (stderr, "ERROR: unable to read file \"%s\"\n",
+                 relay_cli_dict);
+        return 0;
+    }
+
+    rc = weechat_relay_session_set_dict (relay_cli_session, dict, size);
+    if (!rc)
+        fprintf (stderr, "ERROR: invalid dictionary \"%s\"\n", relay_cli_dict);
+
+    free (dict);
+
+    return rc;
+}
+
 /*
  * Main loop for command-line interface.
  *
@@ -448,6 +604,13 @@ relay_cli_main_loop ()
         return 0;
     }
 
+    if (relay_cli_dict && !relay_cli_load_dict ())
+    {
+        relay_network_disconnect ((relay_cli_ssl) ? &gnutls_sess : NULL);
+        weechat_relay_session_free (relay_cli_session);
+        return 0;
+    }
+
     rl_callback_handler_install ("weechat-relay> ", relay_cli_line_handler);
 
     stdin_fd = fileno (stdin);
@@ -520,6 +683,8 @@ relay_cli_main (int argc, char *argv[])
     rc = relay_cli_parse_args (argc, argv);
     if (rc < 1)
         rc = (rc == 0) ? 1 : 0;
+    else if (relay_cli_train_dict)
+        rc = relay_cli_train_dict_files (argc - optind, argv + optind);
     else
         rc = relay_cli_main_loop ();
 
@@ -41,6 +41,7 @@
 #define RELAY_CLI_DEFAULT_PORT     "9000"
 #define RELAY_CLI_MAX_COMMANDS     16
 #define RELAY_CLI_MAX_COMMANDS_STR "16"
+#define RELAY_CLI_DICT_MAX_SIZE    (112 * 1024)
 
 extern int relay_cli_debug;
 
@@ -341,32 +341,25 @@ relay_message_display_object (struct t_weechat_relay_obj *obj)
 }
 
 /*
- * Parses and displays a message.
+ * Displays a parsed message ("time_diff" is the parse time, in
+ * microseconds).
  */
 
 void
-relay_message_display (const void *buffer, size_t size)
+relay_message_display_parsed (struct t_weechat_relay_parsed_msg *parsed_msg,
+                              long long time_diff)
 {
-    struct t_weechat_relay_parsed_msg *parsed_msg;
     char *str_dump, str_format[32], str_spaces[1024];
-    struct timeval tv1, tv2;
-    long long time_diff;
     int i, ratio;
 
     parse_indent = 4;
 
-    gettimeofday (&tv1, NULL);
-
-    parsed_msg = weechat_relay_parse_message (buffer, size);
     if (!parsed_msg)
     {
         relay_message_printf ("ERROR: parse of message failed\n");
         return;
     }
 
-    gettimeofday (&tv2, NULL);
-    time_diff = timeval_diff (&tv1, &tv2);
-
     /* message info */
     if (parsed_msg->compression)
     {
@@ -425,6 +418,25 @@ relay_message_display (const void *buffer, size_t size)
             relay_message_display_object (parsed_msg->objects[i]);
         }
     }
+}
+
+/*
+ * Parses and displays a message.
+ */
+
+void
+relay_message_display (const void *buffer, size_t size)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct timeval tv1, tv2;
+
+    gettimeofday (&tv1, NULL);
+
+    parsed_msg = weechat_relay_parse_message (buffer, size);
+
+    gettimeofday (&tv2, NULL);
+
+    relay_message_display_parsed (parsed_msg, timeval_diff (&tv1, &tv2));
 
     weechat_relay_parse_msg_free (parsed_msg);
 }
@@ -22,6 +22,8 @@
 #ifndef RELAY_CLI_MESSAGE_H
 #define RELAY_CLI_MESSAGE_H
 
+extern void relay_message_display_parsed (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                          long long time_diff);
 extern void relay_message_display (const void *buffer, size_t size);
 
 #endif /* RELAY_CLI_MESSAGE_H */
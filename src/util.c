@@ -173,3 +173,93 @@ display_hex_dump (const void *buffer, size_t size)
         free (str_dump);
     }
 }
+
+/*
+ * Reads the whole content of a file.
+ *
+ * The variable "size" is set with the size of file (in bytes).
+ *
+ * Note: result must be freed after use.
+ *
+ * Returns pointer to content of file, NULL if error.
+ */
+
+void *
+file_read (const char *filename, size_t *size)
+{
+    FILE *file;
+    char *buffer, *buffer2;
+    size_t alloc, num_read;
+
+    if (!filename || !size)
+        return NULL;
+
+    *size = 0;
+
+    file = fopen (filename, "rb");
+    if (!file)
+        return NULL;
+
+    alloc = 64 * 1024;
+    buffer = malloc (alloc);
+    while (buffer)
+    {
+        num_read = fread (buffer + *size, 1, alloc - *size, file);
+        *size += num_read;
+        if (*size < alloc)
+            break;
+        alloc *= 2;
+        buffer2 = realloc (buffer, alloc);
+        if (!buffer2)
+        {
+            free (buffer);
+            buffer = NULL;
+        }
+        else
+        {
+            buffer = buffer2;
+        }
+    }
+
+    if (buffer && ferror (file))
+    {
+        free (buffer);
+        buffer = NULL;
+    }
+
+    fclose (file);
+
+    if (!buffer)
+        *size = 0;
+
+    return buffer;
+}
+
+/*
+ * Writes a buffer in a file (the file is created or truncated).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+file_write (const char *filename, const void *buffer, size_t size)
+{
+    FILE *file;
+    int rc;
+
+    if (!filename || !buffer)
+        return 0;
+
+    file = fopen (filename, "wb");
+    if (!file)
+        return 0;
+
+    rc = (fwrite (buffer, 1, size, file) == size);
+
+    if (fclose (file) != 0)
+        rc = 0;
+
+    return rc;
+}
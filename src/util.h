@@ -27,5 +27,8 @@ extern char *string_hex_dump (const char *data, size_t size,
                               int bytes_per_line,
                               const char *prefix, const char *suffix);
 extern void display_hex_dump (const void *buffer, size_t size);
+extern void *file_read (const char *filename, size_t *size);
+extern int file_write (const char *filename, const void *buffer,
+                       size_t size);
 
 #endif /* RELAY_CLI_UTIL_H */
@@ -30,11 +30,21 @@
 /* import tests from libs */
 
 /* library */
+IMPORT_TEST_GROUP(LibChain);
 IMPORT_TEST_GROUP(LibCommand);
+IMPORT_TEST_GROUP(LibDecode);
+IMPORT_TEST_GROUP(LibDispatch);
+IMPORT_TEST_GROUP(LibEncode);
+IMPORT_TEST_GROUP(LibFilter);
 IMPORT_TEST_GROUP(LibMessage);
 IMPORT_TEST_GROUP(LibObject);
 IMPORT_TEST_GROUP(LibParse);
+IMPORT_TEST_GROUP(LibPolicy);
+IMPORT_TEST_GROUP(LibQuery);
+IMPORT_TEST_GROUP(LibReclaim);
 IMPORT_TEST_GROUP(LibSession);
+IMPORT_TEST_GROUP(LibTemplate);
+IMPORT_TEST_GROUP(LibValue);
 
 /* cli */
 IMPORT_TEST_GROUP(SrcCli);
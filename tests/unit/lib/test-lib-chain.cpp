@@ -0,0 +1,426 @@
+/*
+ * test-lib-chain.cpp - test binary messages built in chunks
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include "tests/tests.h"
+#include "lib/weechat-relay.h"
+}
+
+TEST_GROUP(LibChain)
+{
+};
+
+/*
+ * Returns the segments of a message chain concatenated in a new buffer
+ * (to free after use).
+ */
+
+static char *
+chain_concat (struct t_weechat_relay_msg_chain *chain, size_t *size)
+{
+    struct iovec *iov;
+    char *buffer;
+    int i, iovcnt;
+
+    iov = weechat_relay_msg_chain_iovec (chain, &iovcnt);
+    if (!iov)
+        return NULL;
+
+    buffer = (char *)malloc (chain->size);
+    *size = 0;
+    for (i = 0; i < iovcnt; i++)
+    {
+        memcpy (buffer + *size, iov[i].iov_base, iov[i].iov_len);
+        *size += iov[i].iov_len;
+    }
+
+    return buffer;
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_chain_new
+ *   weechat_relay_msg_chain_iovec
+ *   weechat_relay_msg_chain_free
+ */
+
+TEST(LibChain, NewFree)
+{
+    struct t_weechat_relay_msg_chain *chain;
+    struct iovec *iov;
+    int iovcnt;
+    const char chain_empty[13] = {
+        0, 0, 0, 13,  /* length: 13 bytes */
+        0,  /* compression: off */
+        0, 0, 0, 4, 't', 'e', 's', 't',  /* id: "test" */
+    };
+    const char chain_null_id[9] = {
+        0, 0, 0, 9,  /* length: 9 bytes */
+        0,  /* compression: off */
+        (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,  /* id: NULL */
+    };
+
+    POINTERS_EQUAL(NULL, weechat_relay_msg_chain_iovec (NULL, &iovcnt));
+    weechat_relay_msg_chain_free (NULL);
+
+    chain = weechat_relay_msg_chain_new ("test", 0);
+    CHECK(chain);
+    LONGS_EQUAL(WEECHAT_RELAY_MSG_CHAIN_CHUNK_SIZE, chain->chunk_size);
+    LONGS_EQUAL(1, chain->num_chunks);
+    LONGS_EQUAL(13, chain->size);
+    POINTERS_EQUAL(NULL, weechat_relay_msg_chain_iovec (chain, NULL));
+    iov = weechat_relay_msg_chain_iovec (chain, &iovcnt);
+    CHECK(iov);
+    LONGS_EQUAL(1, iovcnt);
+    LONGS_EQUAL(13, iov[0].iov_len);
+    MEMCMP_EQUAL(chain_empty, iov[0].iov_base, 13);
+    weechat_relay_msg_chain_free (chain);
+
+    chain = weechat_relay_msg_chain_new (NULL, 64);
+    CHECK(chain);
+    LONGS_EQUAL(64, chain->chunk_size);
+    iov = weechat_relay_msg_chain_iovec (chain, &iovcnt);
+    LONGS_EQUAL(1, iovcnt);
+    LONGS_EQUAL(9, iov[0].iov_len);
+    MEMCMP_EQUAL(chain_null_id, iov[0].iov_base, 9);
+    weechat_relay_msg_chain_free (chain);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_chain_reserve
+ *   weechat_relay_msg_chain_add_bytes
+ *   weechat_relay_msg_chain_add_type
+ *   weechat_relay_msg_chain_add_char
+ *   weechat_relay_msg_chain_add_integer
+ *   weechat_relay_msg_chain_add_long
+ *   weechat_relay_msg_chain_add_string
+ *   weechat_relay_msg_chain_add_pointer
+ *   weechat_relay_msg_chain_add_time
+ */
+
+TEST(LibChain, Add)
+{
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_msg_chain *chain;
+    char *buffer, str_name[64];
+    size_t size;
+    int i;
+
+    chain = weechat_relay_msg_chain_new ("test", 0);
+    POINTERS_EQUAL(NULL, weechat_relay_msg_chain_reserve (NULL, 1));
+    POINTERS_EQUAL(NULL, weechat_relay_msg_chain_reserve (chain, 0));
+    LONGS_EQUAL(0, weechat_relay_msg_chain_add_bytes (chain, NULL, 1));
+    LONGS_EQUAL(13, chain->size);
+    weechat_relay_msg_chain_free (chain);
+
+    /* small chunks: many chunks, same bytes as a message */
+    msg = weechat_relay_msg_new ("test");
+    chain = weechat_relay_msg_chain_new ("test", 32);
+    for (i = 0; i < 100; i++)
+    {
+        snprintf (str_name, sizeof (str_name), "name_%d", i);
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_CHAR);
+        weechat_relay_msg_add_char (msg, 'A' + (i % 26));
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        weechat_relay_msg_add_integer (msg, -i);
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_LONG);
+        weechat_relay_msg_add_long (msg, LONG_MIN + i);
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+        weechat_relay_msg_add_string (msg, (i % 10 == 0) ? NULL : str_name);
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_POINTER);
+        weechat_relay_msg_add_pointer (msg, (void *)(0x1000L + i));
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_TIME);
+        weechat_relay_msg_add_time (msg, 1700000000 + i);
+        weechat_relay_msg_add_bytes (msg, "xyz", 3);
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_type (
+                        chain, WEECHAT_RELAY_OBJ_TYPE_CHAR));
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_char (chain,
+                                                         'A' + (i % 26)));
+        weechat_relay_msg_chain_add_type (chain,
+                                          WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_integer (chain, -i));
+        weechat_relay_msg_chain_add_type (chain, WEECHAT_RELAY_OBJ_TYPE_LONG);
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_long (chain,
+                                                         LONG_MIN + i));
+        weechat_relay_msg_chain_add_type (chain,
+                                          WEECHAT_RELAY_OBJ_TYPE_STRING);
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_string (
+                        chain, (i % 10 == 0) ? NULL : str_name));
+        weechat_relay_msg_chain_add_type (chain,
+                                          WEECHAT_RELAY_OBJ_TYPE_POINTER);
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_pointer (
+                        chain, (void *)(0x1000L + i)));
+        weechat_relay_msg_chain_add_type (chain, WEECHAT_RELAY_OBJ_TYPE_TIME);
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_time (chain,
+                                                         1700000000 + i));
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_bytes (chain, "xyz", 3));
+    }
+    CHECK(chain->num_chunks > 100);
+    LONGS_EQUAL(msg->data_size, chain->size);
+    buffer = chain_concat (chain, &size);
+    LONGS_EQUAL(msg->data_size, size);
+    MEMCMP_EQUAL(msg->data, buffer, size);
+    free (buffer);
+    weechat_relay_msg_chain_free (chain);
+    weechat_relay_msg_free (msg);
+
+    /* reserve bigger than a chunk: one chunk with the exact size */
+    chain = weechat_relay_msg_chain_new ("test", 32);
+    CHECK(weechat_relay_msg_chain_reserve (chain, 100));
+    LONGS_EQUAL(2, chain->num_chunks);
+    LONGS_EQUAL(100, chain->chunk_alloc);
+    LONGS_EQUAL(100, chain->chunk_used);
+    LONGS_EQUAL(2, chain->iovcnt);
+    LONGS_EQUAL(113, chain->size);
+    weechat_relay_msg_chain_free (chain);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_chain_add_ref
+ *   weechat_relay_msg_chain_add_string_ref
+ *   weechat_relay_msg_chain_add_buffer_ref
+ */
+
+TEST(LibChain, AddRef)
+{
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_msg_chain *chain;
+    struct t_weechat_relay_obj_buffer obj_buffer;
+    struct iovec *iov;
+    char *big_string, *buffer;
+    size_t size;
+    int iovcnt;
+
+    big_string = (char *)malloc (WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE + 1);
+    memset (big_string, 'a', WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE);
+    big_string[WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE] = '\0';
+
+    chain = weechat_relay_msg_chain_new ("test", 0);
+    LONGS_EQUAL(0, weechat_relay_msg_chain_add_ref (NULL, "abc", 3));
+    LONGS_EQUAL(0, weechat_relay_msg_chain_add_ref (chain, NULL, 3));
+    LONGS_EQUAL(0, weechat_relay_msg_chain_add_ref (chain, "abc", 0));
+    LONGS_EQUAL(1, chain->iovcnt);
+
+    msg = weechat_relay_msg_new ("test");
+
+    /* small string and buffer: copied in the chunk */
+    weechat_relay_msg_add_string (msg, "abc");
+    obj_buffer.buffer = (void *)"def";
+    obj_buffer.length = 3;
+    weechat_relay_msg_add_buffer (msg, &obj_buffer);
+    weechat_relay_msg_add_string (msg, NULL);
+    obj_buffer.buffer = NULL;
+    obj_buffer.length = 0;
+    weechat_relay_msg_add_buffer (msg, &obj_buffer);
+    weechat_relay_msg_add_string (msg, "");
+    LONGS_EQUAL(1, weechat_relay_msg_chain_add_string_ref (chain, "abc"));
+    LONGS_EQUAL(1, weechat_relay_msg_chain_add_buffer_ref (chain, "def", 3));
+    LONGS_EQUAL(1, weechat_relay_msg_chain_add_string_ref (chain, NULL));
+    LONGS_EQUAL(1, weechat_relay_msg_chain_add_buffer_ref (chain, NULL, 0));
+    LONGS_EQUAL(1, weechat_relay_msg_chain_add_string_ref (chain, ""));
+    LONGS_EQUAL(1, chain->iovcnt);
+
+    /* big string and buffer: added by reference (not copied) */
+    weechat_relay_msg_add_string (msg, big_string);
+    weechat_relay_msg_add_integer (msg, 123);
+    obj_buffer.buffer = big_string;
+    obj_buffer.length = WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE;
+    weechat_relay_msg_add_buffer (msg, &obj_buffer);
+    weechat_relay_msg_add_bytes (msg, "xyz", 3);
+    LONGS_EQUAL(1, weechat_relay_msg_chain_add_string_ref (chain,
+                                                           big_string));
+    LONGS_EQUAL(1, weechat_relay_msg_chain_add_integer (chain, 123));
+    LONGS_EQUAL(1, weechat_relay_msg_chain_add_buffer_ref (
+                    chain, big_string, WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE));
+    LONGS_EQUAL(1, weechat_relay_msg_chain_add_ref (chain, "xyz", 3));
+    LONGS_EQUAL(1, chain->num_chunks);
+
+    iov = weechat_relay_msg_chain_iovec (chain, &iovcnt);
+    LONGS_EQUAL(5, iovcnt);
+    POINTERS_EQUAL(big_string, iov[1].iov_base);
+    LONGS_EQUAL(WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE, iov[1].iov_len);
+    LONGS_EQUAL(8, iov[2].iov_len);
+    POINTERS_EQUAL(big_string, iov[3].iov_base);
+    LONGS_EQUAL(3, iov[4].iov_len);
+
+    LONGS_EQUAL(msg->data_size, chain->size);
+    buffer = chain_concat (chain, &size);
+    LONGS_EQUAL(msg->data_size, size);
+    MEMCMP_EQUAL(msg->data, buffer, size);
+    free (buffer);
+
+    weechat_relay_msg_chain_free (chain);
+    weechat_relay_msg_free (msg);
+    free (big_string);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_chain_add_object
+ *   weechat_relay_msg_chain_add_object_value
+ *   weechat_relay_msg_chain_add_hashtable
+ *   weechat_relay_msg_chain_add_hdata
+ *   weechat_relay_msg_chain_add_infolist
+ *   weechat_relay_msg_chain_add_array
+ */
+
+TEST(LibChain, AddObject)
+{
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_msg_chain *chain;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct iovec *iov;
+    char *buffer, *big_string, str_name[64];
+    size_t size;
+    int i, iovcnt, found;
+
+    LONGS_EQUAL(0, weechat_relay_msg_chain_add_object (NULL, NULL));
+
+    msg = weechat_relay_msg_new ("test");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_string (msg, "abc");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HDATA);
+    weechat_relay_msg_add_string (msg, "buffer/lines");
+    weechat_relay_msg_add_string (msg, "number:int,name:str,date:tim");
+    weechat_relay_msg_add_integer (msg, 100);
+    for (i = 0; i < 100; i++)
+    {
+        weechat_relay_msg_add_pointer (msg, (void *)(0x1000L + i));
+        weechat_relay_msg_add_pointer (msg, (void *)(0x2000L + i));
+        weechat_relay_msg_add_integer (msg, i);
+        snprintf (str_name, sizeof (str_name), "name_%d", i);
+        weechat_relay_msg_add_string (msg, str_name);
+        weechat_relay_msg_add_time (msg, 1700000000 + i);
+    }
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg, 42);
+
+    parsed_msg = weechat_relay_parse_message (msg->data, msg->data_size);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(3, parsed_msg->num_objects);
+
+    chain = weechat_relay_msg_chain_new ("test", 256);
+    LONGS_EQUAL(0, weechat_relay_msg_chain_add_object (chain, NULL));
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_object (
+                        chain, parsed_msg->objects[i]));
+    }
+    CHECK(chain->num_chunks > 1);
+    LONGS_EQUAL(msg->data_size, chain->size);
+    buffer = chain_concat (chain, &size);
+    LONGS_EQUAL(msg->data_size, size);
+    MEMCMP_EQUAL(msg->data, buffer, size);
+    free (buffer);
+    /* the hdata spans chunks: no chunk is bigger than the chunk size */
+    iov = weechat_relay_msg_chain_iovec (chain, &iovcnt);
+    for (i = 0; i < iovcnt; i++)
+    {
+        CHECK(iov[i].iov_len <= 256);
+    }
+    weechat_relay_msg_chain_free (chain);
+
+    weechat_relay_parse_msg_free (parsed_msg);
+    weechat_relay_msg_free (msg);
+
+    /* long strings added by reference, native integers in chunks */
+    big_string = (char *)malloc (WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE + 1);
+    memset (big_string, 'a', WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE);
+    big_string[WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE] = '\0';
+    msg = weechat_relay_msg_new ("test");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_integer (msg, 2);
+    weechat_relay_msg_add_string (msg, "short");
+    weechat_relay_msg_add_string (msg, "value");
+    weechat_relay_msg_add_string (msg, "long");
+    weechat_relay_msg_add_string (msg, big_string);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_ARRAY);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg, 1000);
+    for (i = 0; i < 1000; i++)
+    {
+        weechat_relay_msg_add_integer (msg, i * 7);
+    }
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INFOLIST);
+    weechat_relay_msg_add_string (msg, "buffer");
+    weechat_relay_msg_add_integer (msg, 100);
+    for (i = 0; i < 100; i++)
+    {
+        weechat_relay_msg_add_integer (msg, 1);
+        weechat_relay_msg_add_string (msg, "name");
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+        snprintf (str_name, sizeof (str_name), "name_%d", i);
+        weechat_relay_msg_add_string (msg, str_name);
+    }
+    parsed_msg = weechat_relay_parse_message_flags (
+        msg->data, msg->data_size,
+        WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS
+        | WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(3, parsed_msg->num_objects);
+    CHECK(parsed_msg->objects[1]->value_array.values_native);
+    CHECK(parsed_msg->objects[2]->value_infolist.columns);
+    chain = weechat_relay_msg_chain_new ("test", 256);
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        LONGS_EQUAL(1, weechat_relay_msg_chain_add_object (
+                        chain, parsed_msg->objects[i]));
+    }
+    LONGS_EQUAL(msg->data_size, chain->size);
+    buffer = chain_concat (chain, &size);
+    LONGS_EQUAL(msg->data_size, size);
+    MEMCMP_EQUAL(msg->data, buffer, size);
+    free (buffer);
+    iov = weechat_relay_msg_chain_iovec (chain, &iovcnt);
+    found = 0;
+    for (i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_base == parsed_msg->objects[0]->value_hashtable.values[1]->value_string)
+        {
+            LONGS_EQUAL(WEECHAT_RELAY_MSG_CHAIN_REF_MIN_SIZE, iov[i].iov_len);
+            found = 1;
+        }
+        else
+        {
+            CHECK(iov[i].iov_len <= 256);
+        }
+    }
+    LONGS_EQUAL(1, found);
+    weechat_relay_msg_chain_free (chain);
+
+    weechat_relay_parse_msg_free (parsed_msg);
+    weechat_relay_msg_free (msg);
+    free (big_string);
+}
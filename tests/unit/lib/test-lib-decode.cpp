@@ -0,0 +1,115 @@
+/*
+ * test-lib-decode.cpp - test decoding of arrays of fixed-size values
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include "string.h"
+#include "lib/decode.h"
+}
+
+#define DECODE_MAX_COUNT 67
+
+TEST_GROUP(LibDecode)
+{
+};
+
+/*
+ * Checks a function to decode integers with all counts from 0 to
+ * DECODE_MAX_COUNT, with and without alignment, and in place.
+ */
+
+static void
+check_decode_integers (void (*func)(int *dest, const void *src, int count))
+{
+    int src_aligned[DECODE_MAX_COUNT + 1];
+    int dest[DECODE_MAX_COUNT + 1], expected[DECODE_MAX_COUNT];
+    unsigned char *src;
+    int i, count, offset;
+
+    src = (unsigned char *)src_aligned;
+
+    for (i = 0; i < DECODE_MAX_COUNT; i++)
+    {
+        expected[i] = (int)(0x01020304u * (unsigned int)(i + 1)) ^ ((unsigned int)i << 28);
+    }
+
+    for (offset = 0; offset < 2; offset++)
+    {
+        for (count = 0; count <= DECODE_MAX_COUNT; count++)
+        {
+            for (i = 0; i < count; i++)
+            {
+                src[offset + (i * 4)] = ((unsigned int)expected[i] >> 24) & 0xFF;
+                src[offset + (i * 4) + 1] = ((unsigned int)expected[i] >> 16) & 0xFF;
+                src[offset + (i * 4) + 2] = ((unsigned int)expected[i] >> 8) & 0xFF;
+                src[offset + (i * 4) + 3] = (unsigned int)expected[i] & 0xFF;
+            }
+            dest[count] = 0x5A5A5A5A;
+            func (dest, src + offset, count);
+            if (count > 0)
+                MEMCMP_EQUAL(expected, dest, count * sizeof (int));
+            /* must not write after the last integer */
+            LONGS_EQUAL(0x5A5A5A5A, dest[count]);
+
+            /* in place */
+            if (offset == 0)
+            {
+                func (src_aligned, src, count);
+                if (count > 0)
+                    MEMCMP_EQUAL(expected, src, count * sizeof (int));
+            }
+        }
+    }
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_decode_integers_portable
+ *   weechat_relay_decode_integers_ssse3
+ *   weechat_relay_decode_integers_avx2
+ *   weechat_relay_decode_integers
+ */
+
+TEST(LibDecode, Integers)
+{
+    unsigned char src[4] = { 0x00, 0x00, 0x00, 0x01 };
+    int dest[1] = { 0 };
+
+    weechat_relay_decode_integers (NULL, src, 1);
+    weechat_relay_decode_integers (dest, NULL, 1);
+    weechat_relay_decode_integers (dest, src, 0);
+    weechat_relay_decode_integers (dest, src, -1);
+    LONGS_EQUAL(0, dest[0]);
+
+    check_decode_integers (&weechat_relay_decode_integers_portable);
+#ifdef WEECHAT_RELAY_DECODE_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("ssse3"))
+        check_decode_integers (&weechat_relay_decode_integers_ssse3);
+    if (__builtin_cpu_supports ("avx2"))
+        check_decode_integers (&weechat_relay_decode_integers_avx2);
+#endif
+    check_decode_integers (&weechat_relay_decode_integers);
+}
@@ -0,0 +1,282 @@
+/*
+ * test-lib-dispatch.cpp - test dispatch of parsed messages
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <string.h>
+#include "tests/tests.h"
+#include "lib/weechat-relay.h"
+#include "lib/dispatch.h"
+#include "lib/parse.h"
+}
+
+struct t_test_dispatch_calls
+{
+    int count;
+    struct t_weechat_relay_parsed_msg *last_msg;
+};
+
+void
+test_dispatch_cb (void *data, struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    struct t_test_dispatch_calls *calls;
+
+    calls = (struct t_test_dispatch_calls *)data;
+    calls->count++;
+    calls->last_msg = parsed_msg;
+}
+
+TEST_GROUP(LibDispatch)
+{
+};
+
+/*
+ * Tests functions:
+ *   weechat_relay_dispatch_search_event
+ */
+
+TEST(LibDispatch, SearchEvent)
+{
+    int i;
+
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE,
+                weechat_relay_dispatch_search_event (NULL, 0));
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE,
+                weechat_relay_dispatch_search_event ("", 0));
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE,
+                weechat_relay_dispatch_search_event ("_", 1));
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE,
+                weechat_relay_dispatch_search_event ("test", 4));
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE,
+                weechat_relay_dispatch_search_event ("_pon", 4));
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE,
+                weechat_relay_dispatch_search_event ("_pong2", 6));
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE,
+                weechat_relay_dispatch_search_event ("_buffer_opene", 13));
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE,
+                weechat_relay_dispatch_search_event ("_nicklist_DIFF", 14));
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE,
+                weechat_relay_dispatch_search_event ("_buffer_localvar_changed2",
+                                                     25));
+
+    /* all events (check of the perfect hash table) */
+    for (i = 1; i < WEECHAT_RELAY_NUM_EVENTS; i++)
+    {
+        LONGS_EQUAL(i, weechat_relay_dispatch_search_event (
+                        weechat_relay_event_string[i],
+                        strlen (weechat_relay_event_string[i])));
+    }
+
+    /* id not NUL-terminated */
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_PONG,
+                weechat_relay_dispatch_search_event ("_pong_xyz", 5));
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_UPGRADE,
+                weechat_relay_dispatch_search_event ("_upgrade_ended", 8));
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_dispatch_new
+ *   weechat_relay_dispatch_set_event
+ *   weechat_relay_dispatch_set_id
+ *   weechat_relay_dispatch_search_id
+ *   weechat_relay_dispatch_free
+ */
+
+TEST(LibDispatch, SetId)
+{
+    struct t_weechat_relay_dispatch *dispatch;
+    struct t_test_dispatch_calls calls;
+    char str_id[64];
+    int i;
+
+    dispatch = weechat_relay_dispatch_new ();
+    CHECK(dispatch);
+
+    LONGS_EQUAL(0, weechat_relay_dispatch_set_event (
+                    NULL, WEECHAT_RELAY_EVENT_PONG, &test_dispatch_cb, &calls));
+    LONGS_EQUAL(0, weechat_relay_dispatch_set_event (
+                    dispatch, WEECHAT_RELAY_EVENT_NONE,
+                    &test_dispatch_cb, &calls));
+    LONGS_EQUAL(0, weechat_relay_dispatch_set_event (
+                    dispatch, WEECHAT_RELAY_NUM_EVENTS,
+                    &test_dispatch_cb, &calls));
+    LONGS_EQUAL(1, weechat_relay_dispatch_set_event (
+                    dispatch, WEECHAT_RELAY_EVENT_PONG,
+                    &test_dispatch_cb, &calls));
+    POINTERS_EQUAL(&test_dispatch_cb,
+                   dispatch->events[WEECHAT_RELAY_EVENT_PONG].callback);
+    POINTERS_EQUAL(&calls,
+                   dispatch->events[WEECHAT_RELAY_EVENT_PONG].callback_data);
+
+    LONGS_EQUAL(0, weechat_relay_dispatch_set_id (NULL, NULL, NULL, NULL));
+    LONGS_EQUAL(0, weechat_relay_dispatch_set_id (dispatch, NULL, NULL, NULL));
+
+    /* WeeChat event */
+    LONGS_EQUAL(1, weechat_relay_dispatch_set_id (dispatch, "_nicklist",
+                                                  &test_dispatch_cb, &calls));
+    POINTERS_EQUAL(&test_dispatch_cb,
+                   dispatch->events[WEECHAT_RELAY_EVENT_NICKLIST].callback);
+    LONGS_EQUAL(0, dispatch->num_ids);
+
+    /* custom ids (index is resized) */
+    LONGS_EQUAL(-1, weechat_relay_dispatch_search_id (dispatch, "id0", 3));
+    for (i = 0; i < 100; i++)
+    {
+        snprintf (str_id, sizeof (str_id), "id%d", i);
+        LONGS_EQUAL(1, weechat_relay_dispatch_set_id (dispatch, str_id,
+                                                      &test_dispatch_cb,
+                                                      &calls));
+    }
+    LONGS_EQUAL(100, dispatch->num_ids);
+    CHECK(dispatch->index_size >= 200);
+    for (i = 0; i < 100; i++)
+    {
+        snprintf (str_id, sizeof (str_id), "id%d", i);
+        LONGS_EQUAL(i, weechat_relay_dispatch_search_id (dispatch, str_id,
+                                                         strlen (str_id)));
+    }
+    LONGS_EQUAL(-1, weechat_relay_dispatch_search_id (dispatch, "id100", 5));
+    LONGS_EQUAL(1, weechat_relay_dispatch_search_id (dispatch, "id1xyz", 3));
+
+    /* update handler of an existing id */
+    LONGS_EQUAL(1, weechat_relay_dispatch_set_id (dispatch, "id5", NULL,
+                                                  NULL));
+    LONGS_EQUAL(100, dispatch->num_ids);
+    POINTERS_EQUAL(NULL, dispatch->ids_handlers[5].callback);
+
+    weechat_relay_dispatch_free (dispatch);
+    weechat_relay_dispatch_free (NULL);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_dispatch_set_default
+ *   weechat_relay_dispatch_message
+ *   weechat_relay_parse_read_id
+ */
+
+TEST(LibDispatch, Message)
+{
+    struct t_weechat_relay_dispatch *dispatch;
+    struct t_weechat_relay_parse_ctx *ctx;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_msg *msg_pong, *msg_custom, *msg_other;
+    struct t_test_dispatch_calls calls_pong, calls_custom, calls_default;
+
+    memset (&calls_pong, 0, sizeof (calls_pong));
+    memset (&calls_custom, 0, sizeof (calls_custom));
+    memset (&calls_default, 0, sizeof (calls_default));
+
+    msg_pong = weechat_relay_msg_new ("_pong");
+    msg_custom = weechat_relay_msg_new ("hdata_buffers");
+    msg_other = weechat_relay_msg_new ("other");
+
+    dispatch = weechat_relay_dispatch_new ();
+    weechat_relay_dispatch_set_event (dispatch, WEECHAT_RELAY_EVENT_PONG,
+                                      &test_dispatch_cb, &calls_pong);
+    weechat_relay_dispatch_set_id (dispatch, "hdata_buffers",
+                                   &test_dispatch_cb, &calls_custom);
+
+    LONGS_EQUAL(0, weechat_relay_dispatch_message (NULL, NULL));
+    LONGS_EQUAL(0, weechat_relay_dispatch_message (dispatch, NULL));
+
+    /* WeeChat event: id is not allocated */
+    parsed_msg = weechat_relay_parse_message (msg_pong->data,
+                                              msg_pong->data_size);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_PONG, parsed_msg->event);
+    POINTERS_EQUAL(weechat_relay_event_string[WEECHAT_RELAY_EVENT_PONG],
+                   parsed_msg->id);
+    LONGS_EQUAL(1, weechat_relay_dispatch_message (dispatch, parsed_msg));
+    LONGS_EQUAL(1, calls_pong.count);
+    POINTERS_EQUAL(parsed_msg, calls_pong.last_msg);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* custom id, not interned (parsed without dispatcher) */
+    parsed_msg = weechat_relay_parse_message (msg_custom->data,
+                                              msg_custom->data_size);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(WEECHAT_RELAY_EVENT_NONE, parsed_msg->event);
+    LONGS_EQUAL(0, parsed_msg->id_custom);
+    STRCMP_EQUAL("hdata_buffers", parsed_msg->id);
+    LONGS_EQUAL(1, weechat_relay_dispatch_message (dispatch, parsed_msg));
+    LONGS_EQUAL(1, calls_custom.count);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* custom id, interned (parsed with dispatcher) */
+    ctx = weechat_relay_parse_ctx_new ();
+    ctx->dispatch = dispatch;
+    parsed_msg = weechat_relay_parse_message_ctx (ctx, msg_custom->data,
+                                                  msg_custom->data_size, 0);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->id_custom);
+    POINTERS_EQUAL(dispatch->ids[0], parsed_msg->id);
+    LONGS_EQUAL(1, weechat_relay_dispatch_message (dispatch, parsed_msg));
+    LONGS_EQUAL(2, calls_custom.count);
+    POINTERS_EQUAL(parsed_msg, calls_custom.last_msg);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* other id: no handler, then default handler */
+    parsed_msg = weechat_relay_parse_message_ctx (ctx, msg_other->data,
+                                                  msg_other->data_size, 0);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(0, parsed_msg->id_custom);
+    STRCMP_EQUAL("other", parsed_msg->id);
+    LONGS_EQUAL(0, weechat_relay_dispatch_message (dispatch, parsed_msg));
+    weechat_relay_dispatch_set_default (dispatch, &test_dispatch_cb,
+                                        &calls_default);
+    LONGS_EQUAL(1, weechat_relay_dispatch_message (dispatch, parsed_msg));
+    LONGS_EQUAL(1, calls_default.count);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* handler removed: default handler is called */
+    weechat_relay_dispatch_set_event (dispatch, WEECHAT_RELAY_EVENT_PONG,
+                                      NULL, NULL);
+    parsed_msg = weechat_relay_parse_message (msg_pong->data,
+                                              msg_pong->data_size);
+    LONGS_EQUAL(1, weechat_relay_dispatch_message (dispatch, parsed_msg));
+    LONGS_EQUAL(1, calls_pong.count);
+    LONGS_EQUAL(2, calls_default.count);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* message with interned id retained after the dispatcher is freed */
+    parsed_msg = weechat_relay_parse_message_ctx (ctx, msg_custom->data,
+                                                  msg_custom->data_size, 0);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->id_custom);
+    weechat_relay_parse_msg_retain (parsed_msg);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    weechat_relay_parse_ctx_free (ctx);
+    weechat_relay_dispatch_free (dispatch);
+
+    STRCMP_EQUAL("hdata_buffers", parsed_msg->id);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    weechat_relay_msg_free (msg_pong);
+    weechat_relay_msg_free (msg_custom);
+    weechat_relay_msg_free (msg_other);
+}
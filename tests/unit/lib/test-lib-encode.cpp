@@ -0,0 +1,307 @@
+/*
+ * test-lib-encode.cpp - test fast encoding of integers
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include "limits.h"
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "lib/weechat-relay.h"
+#include "lib/encode.h"
+}
+
+/* number of values encoded by the benchmark */
+#define ENCODE_BENCH_VALUES 1000000
+
+TEST_GROUP(LibEncode)
+{
+};
+
+/*
+ * Returns a pseudo-random 64-bit number (xorshift64).
+ */
+
+static uint64_t
+encode_random (uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/*
+ * Returns the current time, in nanoseconds (monotonic clock).
+ */
+
+static long long
+encode_time_nsec ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ((long long)ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+/*
+ * Checks encoding of a signed number in base 10: same chars as printf, no
+ * char written after the number.
+ */
+
+static void
+check_encode_decimal (long long value)
+{
+    char expected[64], result[64];
+    int length;
+
+    length = snprintf (expected, sizeof (expected), "%lld", value);
+    memset (result, 'X', sizeof (result));
+    LONGS_EQUAL(length, weechat_relay_encode_length_decimal (value));
+    LONGS_EQUAL(length, weechat_relay_encode_decimal (result, value));
+    MEMCMP_EQUAL(expected, result, length);
+    BYTES_EQUAL('X', result[length]);
+}
+
+/*
+ * Checks encoding of an unsigned number in base 16: same chars as printf,
+ * no char written after the number.
+ */
+
+static void
+check_encode_hex (unsigned long long value)
+{
+    char expected[64], result[64];
+    int length;
+
+    length = snprintf (expected, sizeof (expected), "%llx", value);
+    memset (result, 'X', sizeof (result));
+    LONGS_EQUAL(length, weechat_relay_encode_length_hex (value));
+    LONGS_EQUAL(length, weechat_relay_encode_hex (result, value));
+    MEMCMP_EQUAL(expected, result, length);
+    BYTES_EQUAL('X', result[length]);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_encode_digits_decimal
+ *   weechat_relay_encode_length_decimal
+ *   weechat_relay_encode_write_decimal
+ *   weechat_relay_encode_decimal
+ */
+
+TEST(LibEncode, Decimal)
+{
+    unsigned long long power;
+    uint64_t state;
+    long long value;
+    int i;
+
+    LONGS_EQUAL(1, weechat_relay_encode_digits_decimal (0));
+    LONGS_EQUAL(20, weechat_relay_encode_digits_decimal (UINT64_MAX));
+
+    /* all numbers from -1000000 to 1000000 */
+    for (value = -1000000; value <= 1000000; value++)
+    {
+        check_encode_decimal (value);
+    }
+
+    /* powers of 10 and their neighbours, positive and negative */
+    power = 1;
+    for (i = 0; i <= 18; i++)
+    {
+        check_encode_decimal ((long long)power - 1);
+        check_encode_decimal ((long long)power);
+        check_encode_decimal ((long long)power + 1);
+        check_encode_decimal (-(long long)power + 1);
+        check_encode_decimal (-(long long)power);
+        check_encode_decimal (-(long long)power - 1);
+        power *= 10;
+    }
+
+    /* powers of 2 and their neighbours */
+    for (i = 0; i < 63; i++)
+    {
+        check_encode_decimal ((1LL << i) - 1);
+        check_encode_decimal (1LL << i);
+        check_encode_decimal (-(1LL << i));
+    }
+
+    /* limits */
+    check_encode_decimal (LLONG_MAX);
+    check_encode_decimal (LLONG_MAX - 1);
+    check_encode_decimal (LLONG_MIN);
+    check_encode_decimal (LLONG_MIN + 1);
+    check_encode_decimal (LONG_MAX);
+    check_encode_decimal (LONG_MIN);
+
+    /* random numbers, with all sizes */
+    state = 0x123456789ABCDEFULL;
+    for (i = 0; i < 1000000; i++)
+    {
+        check_encode_decimal ((long long)(encode_random (&state)
+                                          >> (i % 64)));
+    }
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_encode_length_hex
+ *   weechat_relay_encode_hex
+ */
+
+TEST(LibEncode, Hex)
+{
+    uint64_t state;
+    unsigned long long value;
+    int i;
+
+    /* all numbers from 0 to 0xFFFFF */
+    for (value = 0; value <= 0xFFFFF; value++)
+    {
+        check_encode_hex (value);
+    }
+
+    /* powers of 2 and their neighbours */
+    for (i = 0; i < 64; i++)
+    {
+        check_encode_hex ((1ULL << i) - 1);
+        check_encode_hex (1ULL << i);
+        check_encode_hex ((1ULL << i) + 1);
+    }
+
+    /* limits */
+    check_encode_hex (ULLONG_MAX);
+    check_encode_hex (ULONG_MAX);
+    check_encode_hex (UINTPTR_MAX);
+
+    /* random numbers, with all sizes */
+    state = 0xFEDCBA987654321ULL;
+    for (i = 0; i < 1000000; i++)
+    {
+        check_encode_hex (encode_random (&state) >> (i % 64));
+    }
+}
+
+/*
+ * Benchmark of the encoders: snprintf (previous encoding of long integers,
+ * pointers and times) vs encoders, then message builder with hdata rows
+ * made of pointers and times.
+ *
+ * This test is ignored by default, run it with: tests -ri -g LibEncode
+ */
+
+IGNORE_TEST(LibEncode, Benchmark)
+{
+    struct t_weechat_relay_msg *msg;
+    char str[128], *output;
+    long long *values, time_start, time_snprintf, time_encode;
+    size_t size_snprintf, size_encode;
+    uint64_t state;
+    int i, length;
+
+    values = (long long *)malloc (ENCODE_BENCH_VALUES * sizeof (*values));
+    CHECK(values);
+    output = (char *)malloc (ENCODE_BENCH_VALUES * 2 * 64);
+    CHECK(output);
+    state = 0x0123456789ABCDEFULL;
+    for (i = 0; i < ENCODE_BENCH_VALUES; i++)
+    {
+        values[i] = (long long)(encode_random (&state) >> (i % 64));
+    }
+
+    /* decimal: snprintf then copy */
+    size_snprintf = 0;
+    time_start = encode_time_nsec ();
+    for (i = 0; i < ENCODE_BENCH_VALUES; i++)
+    {
+        length = snprintf (str, sizeof (str), "%lld", values[i]);
+        memcpy (output + size_snprintf, str, length);
+        size_snprintf += length;
+    }
+    time_snprintf = encode_time_nsec () - time_start;
+
+    /* decimal: encoder, directly in output */
+    size_encode = 0;
+    time_start = encode_time_nsec ();
+    for (i = 0; i < ENCODE_BENCH_VALUES; i++)
+    {
+        size_encode += weechat_relay_encode_decimal (output + size_encode,
+                                                     values[i]);
+    }
+    time_encode = encode_time_nsec () - time_start;
+    LONGS_EQUAL(size_snprintf, size_encode);
+    printf ("\ndecimal: snprintf: %.1f ns, encoder: %.1f ns (per value)\n",
+            (double)time_snprintf / ENCODE_BENCH_VALUES,
+            (double)time_encode / ENCODE_BENCH_VALUES);
+
+    /* hex: snprintf then copy */
+    size_snprintf = 0;
+    time_start = encode_time_nsec ();
+    for (i = 0; i < ENCODE_BENCH_VALUES; i++)
+    {
+        length = snprintf (str, sizeof (str), "%llx",
+                           (unsigned long long)values[i]);
+        memcpy (output + size_snprintf, str, length);
+        size_snprintf += length;
+    }
+    time_snprintf = encode_time_nsec () - time_start;
+
+    /* hex: encoder, directly in output */
+    size_encode = 0;
+    time_start = encode_time_nsec ();
+    for (i = 0; i < ENCODE_BENCH_VALUES; i++)
+    {
+        size_encode += weechat_relay_encode_hex (
+            output + size_encode, (unsigned long long)values[i]);
+    }
+    time_encode = encode_time_nsec () - time_start;
+    LONGS_EQUAL(size_snprintf, size_encode);
+    printf ("hex: snprintf: %.1f ns, encoder: %.1f ns (per value)\n",
+            (double)time_snprintf / ENCODE_BENCH_VALUES,
+            (double)time_encode / ENCODE_BENCH_VALUES);
+
+    /* message builder: hdata rows with two pointers and a time */
+    msg = weechat_relay_msg_new ("bench");
+    CHECK(msg);
+    time_start = encode_time_nsec ();
+    for (i = 0; i < ENCODE_BENCH_VALUES / 3; i++)
+    {
+        weechat_relay_msg_add_pointer (msg, (void *)(uintptr_t)values[3 * i]);
+        weechat_relay_msg_add_pointer (msg,
+                                       (void *)(uintptr_t)values[(3 * i) + 1]);
+        weechat_relay_msg_add_time (msg, (time_t)values[(3 * i) + 2]);
+    }
+    time_encode = encode_time_nsec () - time_start;
+    printf ("message builder: %.1f ns per row (%d rows, %ld bytes)\n",
+            (double)time_encode / (ENCODE_BENCH_VALUES / 3),
+            ENCODE_BENCH_VALUES / 3, (long)msg->data_size);
+    weechat_relay_msg_free (msg);
+
+    free (output);
+    free (values);
+}
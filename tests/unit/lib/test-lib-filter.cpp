@@ -0,0 +1,167 @@
+/*
+ * test-lib-filter.cpp - test filters on message ids
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <string.h>
+#include "tests/tests.h"
+#include "lib/weechat-relay.h"
+#include "lib/filter.h"
+#include "lib/parse.h"
+}
+
+TEST_GROUP(LibFilter)
+{
+};
+
+/*
+ * Tests functions:
+ *   weechat_relay_filter_new
+ *   weechat_relay_filter_search
+ *   weechat_relay_filter_add
+ *   weechat_relay_filter_remove
+ *   weechat_relay_filter_free
+ */
+
+TEST(LibFilter, AddRemove)
+{
+    struct t_weechat_relay_filter *filter;
+
+    filter = weechat_relay_filter_new ();
+    CHECK(filter);
+    LONGS_EQUAL(0, filter->num_ids);
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT, filter->default_action);
+
+    LONGS_EQUAL(-1, weechat_relay_filter_search (NULL, NULL));
+    LONGS_EQUAL(-1, weechat_relay_filter_search (filter, NULL));
+    LONGS_EQUAL(-1, weechat_relay_filter_search (filter, "test"));
+
+    LONGS_EQUAL(0, weechat_relay_filter_add (NULL, NULL,
+                                             WEECHAT_RELAY_FILTER_DROP));
+    LONGS_EQUAL(0, weechat_relay_filter_add (filter, NULL,
+                                             WEECHAT_RELAY_FILTER_DROP));
+    LONGS_EQUAL(0, weechat_relay_filter_add (
+                    filter, "test",
+                    WEECHAT_RELAY_NUM_FILTER_ACTIONS));
+
+    LONGS_EQUAL(1, weechat_relay_filter_add (filter, "_nicklist",
+                                             WEECHAT_RELAY_FILTER_DROP));
+    LONGS_EQUAL(1, weechat_relay_filter_add (filter, "_buffer_*",
+                                             WEECHAT_RELAY_FILTER_DROP));
+    LONGS_EQUAL(2, filter->num_ids);
+    LONGS_EQUAL(0, weechat_relay_filter_search (filter, "_nicklist"));
+    LONGS_EQUAL(1, weechat_relay_filter_search (filter, "_buffer_*"));
+    LONGS_EQUAL(-1, weechat_relay_filter_search (filter, "_buffer_opened"));
+
+    /* update action of an existing id */
+    LONGS_EQUAL(1, weechat_relay_filter_add (filter, "_nicklist",
+                                             WEECHAT_RELAY_FILTER_ACCEPT));
+    LONGS_EQUAL(2, filter->num_ids);
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT, filter->actions[0]);
+
+    LONGS_EQUAL(0, weechat_relay_filter_remove (NULL, NULL));
+    LONGS_EQUAL(0, weechat_relay_filter_remove (filter, NULL));
+    LONGS_EQUAL(0, weechat_relay_filter_remove (filter, "test"));
+    LONGS_EQUAL(1, weechat_relay_filter_remove (filter, "_nicklist"));
+    LONGS_EQUAL(1, filter->num_ids);
+    STRCMP_EQUAL("_buffer_*", filter->ids[0]);
+    LONGS_EQUAL(1, weechat_relay_filter_remove (filter, "_buffer_*"));
+    LONGS_EQUAL(0, filter->num_ids);
+
+    weechat_relay_filter_free (filter);
+    weechat_relay_filter_free (NULL);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_filter_match
+ *   weechat_relay_filter_check_message
+ */
+
+TEST(LibFilter, Match)
+{
+    struct t_weechat_relay_filter *filter;
+    struct t_weechat_relay_msg *msg;
+    void *msg_comp;
+    size_t size_comp;
+
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_filter_match (NULL, "test"));
+
+    filter = weechat_relay_filter_new ();
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_filter_match (filter, NULL));
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_filter_match (filter, "test"));
+
+    weechat_relay_filter_add (filter, "_buffer_line_added",
+                              WEECHAT_RELAY_FILTER_ACCEPT);
+    weechat_relay_filter_add (filter, "_buffer_*", WEECHAT_RELAY_FILTER_DROP);
+    weechat_relay_filter_add (filter, "_nicklist*", WEECHAT_RELAY_FILTER_DROP);
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_filter_match (filter, "_buffer_line_added"));
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_DROP,
+                weechat_relay_filter_match (filter, "_buffer_opened"));
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_DROP,
+                weechat_relay_filter_match (filter, "_nicklist"));
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_DROP,
+                weechat_relay_filter_match (filter, "_nicklist_diff"));
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_filter_match (filter, "_buffer"));
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_filter_match (filter, "test"));
+
+    filter->default_action = WEECHAT_RELAY_FILTER_DROP;
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_DROP,
+                weechat_relay_filter_match (filter, "test"));
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_filter_match (filter, "_buffer_line_added"));
+
+    /* check messages (id is peeked) */
+    MESSAGE_BUILD_FAKE(msg);
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_DROP,
+                weechat_relay_filter_check_message (filter, NULL,
+                                                    msg->data,
+                                                    msg->data_size));
+    msg_comp = weechat_relay_msg_compress_zstd (msg, 5, &size_comp);
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_DROP,
+                weechat_relay_filter_check_message (filter, NULL,
+                                                    msg_comp, size_comp));
+    free (msg_comp);
+    weechat_relay_filter_add (filter, "test", WEECHAT_RELAY_FILTER_ACCEPT);
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_filter_check_message (filter, NULL,
+                                                    msg->data,
+                                                    msg->data_size));
+
+    /* invalid message: accepted (error reported by the parser) */
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_filter_check_message (filter, NULL,
+                                                    msg->data,
+                                                    msg->data_size - 1));
+    weechat_relay_msg_free (msg);
+
+    weechat_relay_filter_free (filter);
+}
@@ -26,10 +26,14 @@
 extern "C"
 {
 #include <unistd.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <arpa/inet.h>
 #include "tests/tests.h"
 #include "lib/weechat-relay.h"
+#include "lib/message.h"
 }
 
 TEST_GROUP(LibMessage)
@@ -128,6 +132,64 @@ TEST(LibMessage, AddBytes)
     weechat_relay_msg_free (msg);
 }
 
+/*
+ * Tests functions:
+ *   weechat_relay_msg_reserve
+ *   weechat_relay_msg_finalize
+ *   weechat_relay_msg_put_bytes
+ *   weechat_relay_msg_put_integer
+ *   weechat_relay_msg_append_integer
+ */
+
+TEST(LibMessage, ReserveFinalize)
+{
+    struct t_weechat_relay_msg *msg;
+    uint32_t size32;
+    const char *str = "abc";
+
+    LONGS_EQUAL(0, weechat_relay_msg_reserve (NULL, 1));
+    LONGS_EQUAL(0, weechat_relay_msg_finalize (NULL));
+
+    msg = weechat_relay_msg_new ("test");
+    size32 = htonl (13);
+    MEMCMP_EQUAL(&size32, msg->data, 4);
+
+    /* enough space: no realloc */
+    LONGS_EQUAL(1, weechat_relay_msg_reserve (msg, 7));
+    LONGS_EQUAL(WEECHAT_RELAY_MSG_INITIAL_ALLOC, msg->data_alloc);
+    LONGS_EQUAL(13, msg->data_size);
+
+    /* bytes written without any check: size is not updated */
+    weechat_relay_msg_put_bytes (msg, str, 3);
+    weechat_relay_msg_put_integer (msg, 123456);
+    LONGS_EQUAL(20, msg->data_size);
+    MEMCMP_EQUAL(str, msg->data + 13, 3);
+    size32 = htonl (123456);
+    MEMCMP_EQUAL(&size32, msg->data + 16, 4);
+    LONGS_EQUAL(1, weechat_relay_msg_append_integer (msg, 1));
+    LONGS_EQUAL(24, msg->data_size);
+    size32 = htonl (13);
+    MEMCMP_EQUAL(&size32, msg->data, 4);
+
+    /* size written once */
+    LONGS_EQUAL(1, weechat_relay_msg_finalize (msg));
+    size32 = htonl (24);
+    MEMCMP_EQUAL(&size32, msg->data, 4);
+
+    /* not enough space: buffer is reallocated */
+    LONGS_EQUAL(1, weechat_relay_msg_reserve (msg,
+                                              WEECHAT_RELAY_MSG_INITIAL_ALLOC));
+    LONGS_EQUAL(WEECHAT_RELAY_MSG_INITIAL_ALLOC * 2, msg->data_alloc);
+    LONGS_EQUAL(24, msg->data_size);
+
+    /* function "add" updates the size */
+    LONGS_EQUAL(1, weechat_relay_msg_add_integer (msg, 2));
+    size32 = htonl (28);
+    MEMCMP_EQUAL(&size32, msg->data, 4);
+
+    weechat_relay_msg_free (msg);
+}
+
 /*
  * Tests functions:
  *   weechat_relay_msg_add_type
@@ -1067,6 +1129,178 @@ TEST(LibMessage, AddArray)
     weechat_relay_msg_free (msg);
 }
 
+/*
+ * Tests functions:
+ *   weechat_relay_msg_length_long
+ *   weechat_relay_msg_length_pointer
+ *   weechat_relay_msg_length_time
+ */
+
+TEST(LibMessage, Length)
+{
+    long values_long[] = { 0, 1, 9, 10, 99, 100, 123456789, -1, -9, -10,
+                           LONG_MAX, LONG_MIN, LONG_MIN + 1 };
+    unsigned long values_pointer[] = { 0, 1, 0xF, 0x10, 0xFF, 0x100,
+                                       0x12345678, ULONG_MAX };
+    time_t values_time[] = { 0, 9, 10, 1700000000, -1, -100 };
+    char str[128];
+    int i;
+
+    for (i = 0; i < (int)(sizeof (values_long) / sizeof (values_long[0])); i++)
+    {
+        LONGS_EQUAL(snprintf (str, sizeof (str), "%ld", values_long[i]),
+                    weechat_relay_msg_length_long (values_long[i]));
+    }
+    for (i = 0; i < (int)(sizeof (values_pointer) / sizeof (values_pointer[0])); i++)
+    {
+        LONGS_EQUAL(snprintf (str, sizeof (str), "%lx", values_pointer[i]),
+                    weechat_relay_msg_length_pointer ((void *)values_pointer[i]));
+    }
+    for (i = 0; i < (int)(sizeof (values_time) / sizeof (values_time[0])); i++)
+    {
+        LONGS_EQUAL(snprintf (str, sizeof (str), "%lld",
+                              (long long)values_time[i]),
+                    weechat_relay_msg_length_time (values_time[i]));
+    }
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_size_object
+ *   weechat_relay_msg_size_object_value
+ *   weechat_relay_msg_put_object
+ *   weechat_relay_msg_append_object
+ */
+
+TEST(LibMessage, SizeObject)
+{
+    struct t_weechat_relay_msg *msg, *msg2;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj obj;
+    size_t size, size_before;
+    char str_name[64];
+    int i;
+
+    msg = weechat_relay_msg_new ("test");
+
+    /* invalid objects: size 0 and nothing added */
+    LONGS_EQUAL(0, weechat_relay_msg_size_object (msg, NULL));
+    memset (&obj, 0, sizeof (obj));
+    obj.type = WEECHAT_RELAY_OBJ_TYPE_HASHTABLE;
+    obj.value_hashtable.type_keys = WEECHAT_RELAY_OBJ_TYPE_HDATA;
+    obj.value_hashtable.type_values = WEECHAT_RELAY_OBJ_TYPE_STRING;
+    LONGS_EQUAL(0, weechat_relay_msg_size_object (msg, &obj));
+    obj.type = WEECHAT_RELAY_OBJ_TYPE_HDATA;
+    LONGS_EQUAL(0, weechat_relay_msg_size_object (msg, &obj));
+    LONGS_EQUAL(0, weechat_relay_msg_add_object (msg, &obj));
+    LONGS_EQUAL(13, msg->data_size);
+
+    /* all types of objects, with a big hdata */
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_CHAR);
+    weechat_relay_msg_add_char (msg, 'A');
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_LONG);
+    weechat_relay_msg_add_long (msg, LONG_MIN);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_string (msg, NULL);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_POINTER);
+    weechat_relay_msg_add_pointer (msg, (void *)ULONG_MAX);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_TIME);
+    weechat_relay_msg_add_time (msg, 1700000000);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_BUFFER);
+    weechat_relay_msg_add_integer (msg, 2);
+    weechat_relay_msg_add_string (msg, "key1");
+    weechat_relay_msg_add_integer (msg, 3);
+    weechat_relay_msg_add_bytes (msg, "abc", 3);
+    weechat_relay_msg_add_string (msg, "key2");
+    weechat_relay_msg_add_integer (msg, -1);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HDATA);
+    weechat_relay_msg_add_string (msg, "buffer/lines");
+    weechat_relay_msg_add_string (msg, "number:int,name:str,date:tim");
+    weechat_relay_msg_add_integer (msg, 500);
+    for (i = 0; i < 500; i++)
+    {
+        weechat_relay_msg_add_pointer (msg, (void *)(0x1000L + i));
+        weechat_relay_msg_add_pointer (msg, (void *)(0x2000L + i));
+        weechat_relay_msg_add_integer (msg, i);
+        snprintf (str_name, sizeof (str_name), "name_%d", i);
+        weechat_relay_msg_add_string (msg, str_name);
+        weechat_relay_msg_add_time (msg, 1700000000 + i);
+    }
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INFO);
+    weechat_relay_msg_add_string (msg, "version");
+    weechat_relay_msg_add_string (msg, "4.0.0");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INFOLIST);
+    weechat_relay_msg_add_string (msg, "test");
+    weechat_relay_msg_add_integer (msg, 1);
+    weechat_relay_msg_add_integer (msg, 2);
+    weechat_relay_msg_add_string (msg, "name");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_string (msg, "");
+    weechat_relay_msg_add_string (msg, "number");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_LONG);
+    weechat_relay_msg_add_long (msg, -42);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_ARRAY);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg, 2);
+    weechat_relay_msg_add_integer (msg, 1);
+    weechat_relay_msg_add_integer (msg, -2);
+
+    parsed_msg = weechat_relay_parse_message (msg->data, msg->data_size);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(10, parsed_msg->num_objects);
+
+    /* size computed is the size written for each object */
+    msg2 = weechat_relay_msg_new ("test");
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        size = weechat_relay_msg_size_object (msg2, parsed_msg->objects[i]);
+        CHECK(size > 3);
+        LONGS_EQUAL(size - 3,
+                    weechat_relay_msg_size_object_value (
+                        msg2, parsed_msg->objects[i]));
+        size_before = msg2->data_size;
+        LONGS_EQUAL(1, weechat_relay_msg_add_object (msg2,
+                                                     parsed_msg->objects[i]));
+        LONGS_EQUAL(size, msg2->data_size - size_before);
+    }
+    LONGS_EQUAL(msg->data_size, msg2->data_size);
+    MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+
+    /* same with native arrays and columns */
+    weechat_relay_parse_msg_free (parsed_msg);
+    parsed_msg = weechat_relay_parse_message_flags (
+        msg->data, msg->data_size, WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS);
+    CHECK(parsed_msg);
+    msg2 = weechat_relay_msg_new ("test");
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        size = weechat_relay_msg_size_object (msg2, parsed_msg->objects[i]);
+        size_before = msg2->data_size;
+        LONGS_EQUAL(1, weechat_relay_msg_add_object (msg2,
+                                                     parsed_msg->objects[i]));
+        LONGS_EQUAL(size, msg2->data_size - size_before);
+    }
+    LONGS_EQUAL(msg->data_size, msg2->data_size);
+    MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+
+    /* hdata in an empty message: allocated once with the exact size */
+    msg2 = weechat_relay_msg_new ("test");
+    size = weechat_relay_msg_size_object (msg2, parsed_msg->objects[6]);
+    CHECK(size > WEECHAT_RELAY_MSG_INITIAL_ALLOC);
+    LONGS_EQUAL(1, weechat_relay_msg_add_object (msg2, parsed_msg->objects[6]));
+    LONGS_EQUAL(13 + size, msg2->data_size);
+    CHECK(msg2->data_alloc >= msg2->data_size);
+    CHECK(msg2->data_alloc < 2 * msg2->data_size);
+    weechat_relay_msg_free (msg2);
+
+    weechat_relay_parse_msg_free (parsed_msg);
+    weechat_relay_msg_free (msg);
+}
+
 /*
  * Tests functions:
  *   weechat_relay_msg_compress_zlib
@@ -1139,3 +1373,716 @@ TEST(LibMessage, CompressZstd)
 
     weechat_relay_msg_free (msg);
 }
+
+/*
+ * Adds strings and a big hdata in a message (to test compression while the
+ * message is built).
+ */
+
+static void
+message_add_objects (struct t_weechat_relay_msg *msg)
+{
+    char str_name[64];
+    int i;
+
+    for (i = 0; i < 2000; i++)
+    {
+        snprintf (str_name, sizeof (str_name), "message number %d", i);
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+        weechat_relay_msg_add_string (msg, str_name);
+    }
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HDATA);
+    weechat_relay_msg_add_string (msg, "buffer/lines");
+    weechat_relay_msg_add_string (msg, "number:int,name:str");
+    weechat_relay_msg_add_integer (msg, 3000);
+    for (i = 0; i < 3000; i++)
+    {
+        weechat_relay_msg_add_pointer (msg, (void *)(0x1000L + i));
+        weechat_relay_msg_add_pointer (msg, (void *)(0x2000L + i));
+        weechat_relay_msg_add_integer (msg, i);
+        snprintf (str_name, sizeof (str_name), "name_%d", i);
+        weechat_relay_msg_add_string (msg, str_name);
+    }
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_CHAR);
+    weechat_relay_msg_add_char (msg, 'A');
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_new_compress
+ *   weechat_relay_msg_finalize
+ */
+
+TEST(LibMessage, CompressStream)
+{
+    struct t_weechat_relay_msg *msg, *msg_ref;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    enum t_weechat_relay_compression compression;
+    uint32_t size32;
+    size_t size;
+
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_new_compress (
+                       "test", WEECHAT_RELAY_NUM_COMPRESSIONS, 1));
+
+    /* no compression: same as weechat_relay_msg_new */
+    msg = weechat_relay_msg_new_compress ("test",
+                                          WEECHAT_RELAY_COMPRESSION_OFF, 1);
+    CHECK(msg);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF, msg->compression);
+    POINTERS_EQUAL(NULL, msg->compress_stream);
+    LONGS_EQUAL(13, msg->data_size);
+    weechat_relay_msg_free (msg);
+
+    /* empty message (only id) */
+    msg = weechat_relay_msg_new_compress ("test",
+                                          WEECHAT_RELAY_COMPRESSION_ZSTD, 1);
+    CHECK(msg);
+    CHECK(msg->compress_stream);
+    LONGS_EQUAL(8, msg->data_size);
+    LONGS_EQUAL(1, weechat_relay_msg_finalize (msg));
+    POINTERS_EQUAL(NULL, msg->compress_stream);
+    parsed_msg = weechat_relay_parse_message (msg->data, msg->data_size);
+    CHECK(parsed_msg);
+    STRCMP_EQUAL("test", parsed_msg->id);
+    LONGS_EQUAL(0, parsed_msg->num_objects);
+    weechat_relay_parse_msg_free (parsed_msg);
+    weechat_relay_msg_free (msg);
+
+    msg_ref = weechat_relay_msg_new ("test");
+    message_add_objects (msg_ref);
+    CHECK(msg_ref->data_size > 2 * WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE);
+
+    for (compression = WEECHAT_RELAY_COMPRESSION_ZLIB;
+         compression < WEECHAT_RELAY_NUM_COMPRESSIONS;
+         compression = (enum t_weechat_relay_compression)(compression + 1))
+    {
+        msg = weechat_relay_msg_new_compress ("test", compression, 1);
+        CHECK(msg);
+        message_add_objects (msg);
+
+        /* uncompressed bytes are never more than a chunk */
+        CHECK(msg->data_size <= WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE);
+        LONGS_EQUAL(0, weechat_relay_msg_set_bytes (msg, 0, "a", 1));
+
+        LONGS_EQUAL(1, weechat_relay_msg_finalize (msg));
+        LONGS_EQUAL(1, weechat_relay_msg_finalize (msg));
+        POINTERS_EQUAL(NULL, msg->compress_stream);
+        POINTERS_EQUAL(NULL, msg->compressed);
+        CHECK(msg->data_size < msg_ref->data_size / 2);
+
+        /* nothing can be added after finalize */
+        size = msg->data_size;
+        LONGS_EQUAL(0, weechat_relay_msg_add_char (msg, 'B'));
+        LONGS_EQUAL(size, msg->data_size);
+
+        /* check header and decompressed data */
+        memcpy (&size32, msg->data, 4);
+        LONGS_EQUAL(msg->data_size, ntohl (size32));
+        LONGS_EQUAL(compression, msg->data[4]);
+        POINTERS_EQUAL(NULL,
+                       weechat_relay_msg_compress_zlib (msg, 1, &size));
+        POINTERS_EQUAL(NULL,
+                       weechat_relay_msg_compress_zstd (msg, 1, &size));
+        parsed_msg = weechat_relay_parse_message (msg->data, msg->data_size);
+        CHECK(parsed_msg);
+        LONGS_EQUAL(compression, parsed_msg->compression);
+        LONGS_EQUAL(msg_ref->data_size - 5,
+                    parsed_msg->length_data_decompressed);
+        MEMCMP_EQUAL(msg_ref->data + 5, parsed_msg->data_decompressed,
+                     msg_ref->data_size - 5);
+        LONGS_EQUAL(2002, parsed_msg->num_objects);
+        weechat_relay_parse_msg_free (parsed_msg);
+
+        weechat_relay_msg_free (msg);
+    }
+
+    /* message freed without finalize */
+    msg = weechat_relay_msg_new_compress ("test",
+                                          WEECHAT_RELAY_COMPRESSION_ZLIB, 1);
+    message_add_objects (msg);
+    weechat_relay_msg_free (msg);
+
+    weechat_relay_msg_free (msg_ref);
+}
+
+/*
+ * Builds a message with objects bigger than a compression chunk.
+ */
+
+static struct t_weechat_relay_msg *
+message_build_big_objects ()
+{
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_obj_buffer buffer;
+    char str_name[64], *string;
+    int i;
+
+    msg = weechat_relay_msg_new ("big");
+
+    string = (char *)malloc (100000 + 1);
+    memset (string, 'a', 100000);
+    string[100000] = '\0';
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_string (msg, string);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_BUFFER);
+    buffer.buffer = string;
+    buffer.length = 70000;
+    weechat_relay_msg_add_buffer (msg, &buffer);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_ARRAY);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_CHAR);
+    weechat_relay_msg_add_integer (msg, 40000);
+    weechat_relay_msg_add_bytes (msg, string, 40000);
+    free (string);
+
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_ARRAY);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg, 20000);
+    for (i = 0; i < 20000; i++)
+    {
+        weechat_relay_msg_add_integer (msg, i);
+    }
+
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HDATA);
+    weechat_relay_msg_add_string (msg, "buffer/lines");
+    weechat_relay_msg_add_string (msg, "number:int,name:str");
+    weechat_relay_msg_add_integer (msg, 3000);
+    for (i = 0; i < 3000; i++)
+    {
+        weechat_relay_msg_add_pointer (msg, (void *)(0x1000L + i));
+        weechat_relay_msg_add_pointer (msg, (void *)(0x2000L + i));
+        weechat_relay_msg_add_integer (msg, i);
+        snprintf (str_name, sizeof (str_name), "name_%d", i);
+        weechat_relay_msg_add_string (msg, str_name);
+    }
+
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_integer (msg, 3000);
+    for (i = 0; i < 3000; i++)
+    {
+        weechat_relay_msg_add_integer (msg, i);
+        snprintf (str_name, sizeof (str_name), "value_%d", i);
+        weechat_relay_msg_add_string (msg, str_name);
+    }
+
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INFOLIST);
+    weechat_relay_msg_add_string (msg, "buffer");
+    weechat_relay_msg_add_integer (msg, 2000);
+    for (i = 0; i < 2000; i++)
+    {
+        weechat_relay_msg_add_integer (msg, 2);
+        weechat_relay_msg_add_string (msg, "number");
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        weechat_relay_msg_add_integer (msg, i + 1);
+        weechat_relay_msg_add_string (msg, "name");
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+        snprintf (str_name, sizeof (str_name), "buffer_%d", i);
+        weechat_relay_msg_add_string (msg, str_name);
+    }
+
+    return msg;
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_stream_bytes
+ *   weechat_relay_msg_stream_hashtable
+ *   weechat_relay_msg_stream_hdata
+ *   weechat_relay_msg_stream_infolist
+ *   weechat_relay_msg_stream_array
+ *   weechat_relay_msg_stream_object_value
+ */
+
+TEST(LibMessage, CompressStreamBigObjects)
+{
+    struct t_weechat_relay_msg *msg, *msg_ref;
+    struct t_weechat_relay_parsed_msg *parsed_ref, *parsed_msg;
+    enum t_weechat_relay_compression compression;
+    int i, j, flags[3];
+
+    msg_ref = message_build_big_objects ();
+    CHECK(msg_ref->data_size > 10 * WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE);
+
+    flags[0] = 0;
+    flags[1] = WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS
+        | WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS;
+    flags[2] = WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH;
+
+    for (i = 0; i < 3; i++)
+    {
+        parsed_ref = weechat_relay_parse_message_flags (msg_ref->data,
+                                                        msg_ref->data_size,
+                                                        flags[i]);
+        CHECK(parsed_ref);
+        LONGS_EQUAL(7, parsed_ref->num_objects);
+
+        for (compression = WEECHAT_RELAY_COMPRESSION_ZLIB;
+             compression < WEECHAT_RELAY_NUM_COMPRESSIONS;
+             compression = (enum t_weechat_relay_compression)(compression + 1))
+        {
+            msg = weechat_relay_msg_new_compress ("big", compression, 1);
+            CHECK(msg);
+            msg->passthrough =
+                (flags[i] & WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH) ? 1 : 0;
+            for (j = 0; j < parsed_ref->num_objects; j++)
+            {
+                LONGS_EQUAL(1, weechat_relay_msg_add_object (
+                                msg, parsed_ref->objects[j]));
+                /* each object is written by chunks */
+                CHECK(msg->data_alloc <= WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE);
+                CHECK(msg->data_size <= WEECHAT_RELAY_MSG_COMPRESS_CHUNK_SIZE);
+            }
+            LONGS_EQUAL(1, weechat_relay_msg_finalize (msg));
+
+            parsed_msg = weechat_relay_parse_message (msg->data,
+                                                      msg->data_size);
+            CHECK(parsed_msg);
+            LONGS_EQUAL(msg_ref->data_size - 5,
+                        parsed_msg->length_data_decompressed);
+            MEMCMP_EQUAL(msg_ref->data + 5, parsed_msg->data_decompressed,
+                         msg_ref->data_size - 5);
+            weechat_relay_parse_msg_free (parsed_msg);
+
+            weechat_relay_msg_free (msg);
+        }
+
+        weechat_relay_parse_msg_free (parsed_ref);
+    }
+
+    weechat_relay_msg_free (msg_ref);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_compress_ctx_new
+ *   weechat_relay_msg_compress_zlib_ctx
+ *   weechat_relay_msg_compress_zstd_ctx
+ *   weechat_relay_msg_compress_ctx_free
+ */
+
+TEST(LibMessage, CompressCtx)
+{
+    struct t_weechat_relay_msg *msg, *msg_big;
+    struct t_weechat_relay_msg_compress_ctx *ctx;
+    void *buffer, *buffer_ctx;
+    size_t size, size_ctx;
+    int i, levels[4] = { 1, 9, 1, 0 };
+
+    ctx = weechat_relay_msg_compress_ctx_new ();
+    CHECK(ctx);
+
+    MESSAGE_BUILD_FAKE(msg);
+    msg_big = weechat_relay_msg_new ("test");
+    message_add_objects (msg_big);
+
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_compress_zlib_ctx (NULL, msg, 1, &size));
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_compress_zlib_ctx (ctx, NULL, 1, &size));
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_compress_zlib_ctx (ctx, msg, 1, NULL));
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_compress_zstd_ctx (NULL, msg, 1, &size));
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_compress_zstd_ctx (ctx, NULL, 1, &size));
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_compress_zstd_ctx (ctx, msg, 1, NULL));
+
+    /* same result as without context, with context reused */
+    for (i = 0; i < 4; i++)
+    {
+        buffer = weechat_relay_msg_compress_zlib (msg, levels[i], &size);
+        buffer_ctx = weechat_relay_msg_compress_zlib_ctx (ctx, msg,
+                                                          levels[i],
+                                                          &size_ctx);
+        CHECK(buffer_ctx);
+        LONGS_EQUAL(size, size_ctx);
+        MEMCMP_EQUAL(buffer, buffer_ctx, size);
+        free (buffer);
+
+        buffer = weechat_relay_msg_compress_zlib (msg_big, levels[i], &size);
+        buffer_ctx = weechat_relay_msg_compress_zlib_ctx (ctx, msg_big,
+                                                          levels[i],
+                                                          &size_ctx);
+        CHECK(buffer_ctx);
+        LONGS_EQUAL(size, size_ctx);
+        MEMCMP_EQUAL(buffer, buffer_ctx, size);
+        free (buffer);
+
+        buffer = weechat_relay_msg_compress_zstd (msg, levels[i] + 1, &size);
+        buffer_ctx = weechat_relay_msg_compress_zstd_ctx (ctx, msg,
+                                                          levels[i] + 1,
+                                                          &size_ctx);
+        CHECK(buffer_ctx);
+        LONGS_EQUAL(size, size_ctx);
+        MEMCMP_EQUAL(buffer, buffer_ctx, size);
+        free (buffer);
+
+        buffer = weechat_relay_msg_compress_zstd (msg_big, levels[i] + 1,
+                                                  &size);
+        buffer_ctx = weechat_relay_msg_compress_zstd_ctx (ctx, msg_big,
+                                                          levels[i] + 1,
+                                                          &size_ctx);
+        CHECK(buffer_ctx);
+        LONGS_EQUAL(size, size_ctx);
+        MEMCMP_EQUAL(buffer, buffer_ctx, size);
+        free (buffer);
+    }
+
+    weechat_relay_msg_free (msg_big);
+    weechat_relay_msg_free (msg);
+
+    weechat_relay_msg_compress_ctx_free (ctx);
+    weechat_relay_msg_compress_ctx_free (NULL);
+}
+
+/*
+ * Builds a small message, like a line added in a buffer.
+ */
+
+static struct t_weechat_relay_msg *
+message_build_line (int number)
+{
+    struct t_weechat_relay_msg *msg;
+    char str_message[128];
+
+    msg = weechat_relay_msg_new ("_buffer_line_added");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HDATA);
+    weechat_relay_msg_add_string (msg, "line_data");
+    weechat_relay_msg_add_string (
+        msg,
+        "buffer:ptr,date:tim,displayed:chr,highlight:chr,prefix:str,"
+        "message:str");
+    weechat_relay_msg_add_integer (msg, 1);
+    weechat_relay_msg_add_pointer (msg, (void *)(0x5000L + number));
+    weechat_relay_msg_add_pointer (msg, (void *)(0x12340000L + (number % 7)));
+    weechat_relay_msg_add_time (msg, 1700000000 + number);
+    weechat_relay_msg_add_char (msg, 1);
+    weechat_relay_msg_add_char (msg, (number % 13 == 0) ? 1 : 0);
+    snprintf (str_message, sizeof (str_message), "nick%d", number % 17);
+    weechat_relay_msg_add_string (msg, str_message);
+    snprintf (str_message, sizeof (str_message),
+              "hello, this is the message number %d", number);
+    weechat_relay_msg_add_string (msg, str_message);
+
+    return msg;
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_train_dict
+ *   weechat_relay_msg_compress_ctx_set_dict
+ *   weechat_relay_session_set_dict
+ */
+
+TEST(LibMessage, CompressDict)
+{
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_msg_compress_ctx *ctx;
+    struct t_weechat_relay_session *session;
+    struct t_weechat_relay_parsed_msg **messages, *parsed_msg;
+    char *frames;
+    void *dict, *buffer;
+    size_t frames_size, dict_size, size, size_dict;
+    int i, count;
+
+    /* corpus: 2000 messages, half of them compressed with zlib */
+    frames = NULL;
+    frames_size = 0;
+    for (i = 0; i < 2000; i++)
+    {
+        msg = message_build_line (i);
+        buffer = (i % 2 == 0) ?
+            weechat_relay_msg_compress_zlib (msg, 1, &size) : NULL;
+        if (!buffer)
+            size = msg->data_size;
+        frames = (char *)realloc (frames, frames_size + size);
+        memcpy (frames + frames_size, (buffer) ? buffer : msg->data, size);
+        frames_size += size;
+        free (buffer);
+        weechat_relay_msg_free (msg);
+    }
+
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_train_dict (NULL, 0, 4096, &dict_size));
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_train_dict (frames, frames_size, 0,
+                                                 &dict_size));
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_train_dict (frames, frames_size, 4096,
+                                                 NULL));
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_msg_train_dict ("\0\0\0\0\0", 5, 4096,
+                                                 &dict_size));
+    LONGS_EQUAL(0, dict_size);
+    dict = weechat_relay_msg_train_dict (frames, frames_size, 4096,
+                                         &dict_size);
+    CHECK(dict);
+    CHECK(dict_size > 0);
+    CHECK(dict_size <= 4096);
+    free (frames);
+
+    ctx = weechat_relay_msg_compress_ctx_new ();
+    LONGS_EQUAL(0, weechat_relay_msg_compress_ctx_set_dict (NULL, dict,
+                                                            dict_size));
+    LONGS_EQUAL(0, weechat_relay_msg_compress_ctx_set_dict (ctx, dict, 0));
+
+    /* a new message is much smaller with the dictionary */
+    msg = message_build_line (5000);
+    buffer = weechat_relay_msg_compress_zstd_ctx (ctx, msg, 3, &size);
+    CHECK(buffer);
+    LONGS_EQUAL(1, weechat_relay_msg_compress_ctx_set_dict (ctx, dict,
+                                                            dict_size));
+    buffer = weechat_relay_msg_compress_zstd_ctx (ctx, msg, 3, &size_dict);
+    CHECK(buffer);
+    CHECK(size_dict < size / 2);
+
+    /* the message can not be decompressed without the dictionary */
+    parsed_msg = weechat_relay_parse_message (buffer, size_dict);
+    POINTERS_EQUAL(NULL, parsed_msg);
+
+    /* decompression with the dictionary in session */
+    session = weechat_relay_session_init (0, NULL);
+    LONGS_EQUAL(0, weechat_relay_session_set_dict (NULL, dict, dict_size));
+    LONGS_EQUAL(0, weechat_relay_session_set_dict (session, dict, 0));
+    LONGS_EQUAL(1, weechat_relay_session_set_dict (session, dict, dict_size));
+    weechat_relay_session_buffer_add_bytes (session, buffer, size_dict);
+    buffer = weechat_relay_msg_compress_zstd_ctx (ctx, msg, 19, &size_dict);
+    CHECK(buffer);
+    weechat_relay_session_buffer_add_bytes (session, buffer, size_dict);
+    messages = weechat_relay_session_buffer_parse (session, 0, &count);
+    LONGS_EQUAL(2, count);
+    for (i = 0; i < count; i++)
+    {
+        CHECK(messages[i]);
+        LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD, messages[i]->compression);
+        LONGS_EQUAL(msg->data_size - 5, messages[i]->length_data_decompressed);
+        MEMCMP_EQUAL(msg->data + 5, messages[i]->data_decompressed,
+                     msg->data_size - 5);
+        weechat_relay_parse_msg_free (messages[i]);
+    }
+    free (messages);
+
+    /* dictionary removed */
+    LONGS_EQUAL(1, weechat_relay_session_set_dict (session, NULL, 0));
+    weechat_relay_session_buffer_add_bytes (session, buffer, size_dict);
+    messages = weechat_relay_session_buffer_parse (session, 0, &count);
+    LONGS_EQUAL(1, count);
+    POINTERS_EQUAL(NULL, messages[0]);
+    free (messages);
+    weechat_relay_session_free (session);
+
+    LONGS_EQUAL(1, weechat_relay_msg_compress_ctx_set_dict (ctx, NULL, 0));
+    buffer = weechat_relay_msg_compress_zstd_ctx (ctx, msg, 3, &size_dict);
+    LONGS_EQUAL(size, size_dict);
+
+    weechat_relay_msg_free (msg);
+    weechat_relay_msg_compress_ctx_free (ctx);
+    free (dict);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_compress_ctx_set_workers
+ *   weechat_relay_msg_compress_zstd_mt
+ */
+
+TEST(LibMessage, CompressWorkers)
+{
+    struct t_weechat_relay_msg *msg, *msg_line;
+    struct t_weechat_relay_msg_compress_ctx *ctx;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    void *buffer;
+    size_t size;
+    int i;
+
+    /* big message: 30000 lines (about 3 MB) */
+    msg = weechat_relay_msg_new ("_history");
+    for (i = 0; i < 30000; i++)
+    {
+        msg_line = message_build_line (i);
+        weechat_relay_msg_add_bytes (msg,
+                                     msg_line->data + 5 + 4 + 18,
+                                     msg_line->data_size - 5 - 4 - 18);
+        weechat_relay_msg_free (msg_line);
+    }
+    CHECK(msg->data_size > 2 * 1024 * 1024);
+
+    ctx = weechat_relay_msg_compress_ctx_new ();
+
+    LONGS_EQUAL(0, weechat_relay_msg_compress_ctx_set_workers (NULL, 2, 0));
+    LONGS_EQUAL(0, weechat_relay_msg_compress_ctx_set_workers (ctx, -1, 0));
+    LONGS_EQUAL(1, weechat_relay_msg_compress_ctx_set_workers (ctx, 4, 0));
+    LONGS_EQUAL(4, ctx->zstd_workers);
+    LONGS_EQUAL(WEECHAT_RELAY_MSG_COMPRESS_WORKERS_MIN_SIZE,
+                ctx->zstd_workers_min_size);
+
+    /* small message: worker threads are not used */
+    msg_line = message_build_line (1);
+    buffer = weechat_relay_msg_compress_zstd_ctx (ctx, msg_line, 3, &size);
+    CHECK(buffer);
+    POINTERS_EQUAL(NULL, ctx->zstd_cctx_mt);
+    weechat_relay_msg_free (msg_line);
+
+    /* big message: compressed with worker threads, in a single frame */
+    buffer = weechat_relay_msg_compress_zstd_ctx (ctx, msg, 3, &size);
+    CHECK(buffer);
+    CHECK(ctx->zstd_cctx_mt);
+    CHECK(size < msg->data_size / 4);
+    parsed_msg = weechat_relay_parse_message (buffer, size);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD, parsed_msg->compression);
+    LONGS_EQUAL(msg->data_size - 5, parsed_msg->length_data_decompressed);
+    MEMCMP_EQUAL(msg->data + 5, parsed_msg->data_decompressed,
+                 msg->data_size - 5);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* worker threads disabled */
+    LONGS_EQUAL(1, weechat_relay_msg_compress_ctx_set_workers (ctx, 0, 0));
+    POINTERS_EQUAL(NULL, ctx->zstd_cctx_mt);
+    buffer = weechat_relay_msg_compress_zstd_ctx (ctx, msg, 3, &size);
+    CHECK(buffer);
+    POINTERS_EQUAL(NULL, ctx->zstd_cctx_mt);
+
+    weechat_relay_msg_free (msg);
+    weechat_relay_msg_compress_ctx_free (ctx);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_compress
+ *   weechat_relay_msg_reset
+ */
+
+TEST(LibMessage, CompressInPlace)
+{
+    struct t_weechat_relay_msg *msg, *msg2;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_msg_compress_ctx *ctx;
+    void *buffer;
+    char *data, *data_uncompressed, *data_ctx;
+    size_t size, data_size;
+    int i, compression;
+
+    LONGS_EQUAL(0, weechat_relay_msg_compress (NULL, NULL,
+                                               WEECHAT_RELAY_COMPRESSION_ZLIB,
+                                               6));
+
+    ctx = weechat_relay_msg_compress_ctx_new ();
+    CHECK(ctx);
+
+    msg = weechat_relay_msg_new ("_nicklist");
+    LONGS_EQUAL(0, weechat_relay_msg_compress (msg, NULL,
+                                               WEECHAT_RELAY_NUM_COMPRESSIONS,
+                                               6));
+
+    /* no compression: message unchanged */
+    data = msg->data;
+    data_size = msg->data_size;
+    LONGS_EQUAL(1, weechat_relay_msg_compress (msg, NULL,
+                                               WEECHAT_RELAY_COMPRESSION_OFF,
+                                               6));
+    POINTERS_EQUAL(data, msg->data);
+    LONGS_EQUAL(data_size, msg->data_size);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF, msg->compression);
+
+    for (compression = WEECHAT_RELAY_COMPRESSION_ZLIB;
+         compression < WEECHAT_RELAY_NUM_COMPRESSIONS; compression++)
+    {
+        LONGS_EQUAL(1, weechat_relay_msg_reset (msg, "_nicklist"));
+        for (i = 0; i < 100; i++)
+        {
+            weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+            weechat_relay_msg_add_string (msg, "nick in the nicklist");
+        }
+
+        /* same bytes as the compression in a new buffer */
+        buffer = (compression == WEECHAT_RELAY_COMPRESSION_ZLIB) ?
+            weechat_relay_msg_compress_zlib (msg, 6, &size) :
+            weechat_relay_msg_compress_zstd (msg, 6, &size);
+        CHECK(buffer);
+        data_uncompressed = msg->data;
+        LONGS_EQUAL(1, weechat_relay_msg_compress (
+                        msg, NULL,
+                        (enum t_weechat_relay_compression)compression,
+                        6));
+        LONGS_EQUAL(compression, msg->compression);
+        LONGS_EQUAL(size, msg->data_size);
+        MEMCMP_EQUAL(buffer, msg->data, size);
+        POINTERS_EQUAL(data_uncompressed, msg->compressed);
+        free (buffer);
+
+        /* the message can not be compressed twice or modified */
+        LONGS_EQUAL(0, weechat_relay_msg_compress (
+                        msg, NULL,
+                        (enum t_weechat_relay_compression)compression,
+                        6));
+        LONGS_EQUAL(0, weechat_relay_msg_add_integer (msg, 1));
+        LONGS_EQUAL(size, msg->data_size);
+
+        parsed_msg = weechat_relay_parse_message (msg->data, msg->data_size);
+        CHECK(parsed_msg);
+        LONGS_EQUAL(compression, parsed_msg->compression);
+        STRCMP_EQUAL("_nicklist", parsed_msg->id);
+        LONGS_EQUAL(100, parsed_msg->num_objects);
+        weechat_relay_parse_msg_free (parsed_msg);
+
+        /* compression with a context: same bytes as the context functions */
+        LONGS_EQUAL(1, weechat_relay_msg_reset (msg, "_nicklist"));
+        for (i = 0; i < 100; i++)
+        {
+            weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+            weechat_relay_msg_add_string (msg, "nick in the nicklist");
+        }
+        buffer = (compression == WEECHAT_RELAY_COMPRESSION_ZLIB) ?
+            weechat_relay_msg_compress_zlib_ctx (ctx, msg, 6, &size) :
+            weechat_relay_msg_compress_zstd_ctx (ctx, msg, 6, &size);
+        CHECK(buffer);
+        data_ctx = (char *)malloc (size);
+        memcpy (data_ctx, buffer, size);
+        data_uncompressed = msg->data;
+        LONGS_EQUAL(1, weechat_relay_msg_compress (
+                        msg, ctx,
+                        (enum t_weechat_relay_compression)compression,
+                        6));
+        LONGS_EQUAL(compression, msg->compression);
+        LONGS_EQUAL(size, msg->data_size);
+        MEMCMP_EQUAL(data_ctx, msg->data, size);
+        POINTERS_EQUAL(data_uncompressed, msg->compressed);
+        free (data_ctx);
+    }
+
+    /* reset: uncompressed buffer is used again, with a new id */
+    data_uncompressed = msg->compressed;
+    LONGS_EQUAL(1, weechat_relay_msg_reset (msg, "id"));
+    POINTERS_EQUAL(data_uncompressed, msg->data);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF, msg->compression);
+    STRCMP_EQUAL("id", msg->id);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg, 123);
+    msg2 = weechat_relay_msg_new ("id");
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg2, 123);
+    LONGS_EQUAL(msg2->data_size, msg->data_size);
+    MEMCMP_EQUAL(msg2->data, msg->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+
+    /* reset of a message compressed while it is built */
+    msg2 = weechat_relay_msg_new_compress ("test",
+                                           WEECHAT_RELAY_COMPRESSION_ZSTD, 3);
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg2, 123);
+    LONGS_EQUAL(0, weechat_relay_msg_reset (NULL, "id"));
+    LONGS_EQUAL(1, weechat_relay_msg_reset (msg2, "id"));
+    POINTERS_EQUAL(NULL, msg2->compress_stream);
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg2, 123);
+    LONGS_EQUAL(msg->data_size, msg2->data_size);
+    MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+
+    weechat_relay_msg_free (msg);
+    weechat_relay_msg_compress_ctx_free (ctx);
+}
@@ -25,6 +25,7 @@
 
 extern "C"
 {
+#include "stdio.h"
 #include "string.h"
 #include "tests/tests.h"
 #include "lib/weechat-relay.h"
@@ -75,3 +76,170 @@ TEST(LibObject, AllocFree)
         weechat_relay_obj_free (obj);
     }
 }
+
+/*
+ * Tests functions:
+ *   weechat_relay_obj_hash_integer
+ *   weechat_relay_obj_hash_key
+ *   weechat_relay_obj_key_equal
+ */
+
+TEST(LibObject, HashKeyEqual)
+{
+    struct t_weechat_relay_obj key1, key2;
+    char str1[] = "abc", str2[] = "abc";
+
+    CHECK(weechat_relay_obj_hash_integer (1) != weechat_relay_obj_hash_integer (2));
+
+    LONGS_EQUAL(0, weechat_relay_obj_hash_key (NULL));
+    LONGS_EQUAL(0, weechat_relay_obj_key_equal (NULL, NULL));
+
+    key1.type = WEECHAT_RELAY_OBJ_TYPE_STRING;
+    key1.value_string = str1;
+    key2.type = WEECHAT_RELAY_OBJ_TYPE_STRING;
+    key2.value_string = str2;
+    CHECK(weechat_relay_obj_hash_key (&key1) == weechat_relay_obj_hash_key (&key2));
+    LONGS_EQUAL(1, weechat_relay_obj_key_equal (&key1, &key2));
+    key2.value_string = NULL;
+    LONGS_EQUAL(0, weechat_relay_obj_key_equal (&key1, &key2));
+    key1.value_string = NULL;
+    LONGS_EQUAL(1, weechat_relay_obj_key_equal (&key1, &key2));
+
+    key1.type = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+    key1.value_integer = 123;
+    key2.type = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+    key2.value_integer = 123;
+    CHECK(weechat_relay_obj_hash_key (&key1) == weechat_relay_obj_hash_key (&key2));
+    LONGS_EQUAL(1, weechat_relay_obj_key_equal (&key1, &key2));
+    key2.value_integer = 124;
+    LONGS_EQUAL(0, weechat_relay_obj_key_equal (&key1, &key2));
+
+    /* different types */
+    key2.type = WEECHAT_RELAY_OBJ_TYPE_LONG;
+    key2.value_long = 123;
+    LONGS_EQUAL(0, weechat_relay_obj_key_equal (&key1, &key2));
+
+    key1.type = WEECHAT_RELAY_OBJ_TYPE_POINTER;
+    key1.value_pointer = (const void *)0x1234;
+    key2.type = WEECHAT_RELAY_OBJ_TYPE_POINTER;
+    key2.value_pointer = (const void *)0x1234;
+    CHECK(weechat_relay_obj_hash_key (&key1) == weechat_relay_obj_hash_key (&key2));
+    LONGS_EQUAL(1, weechat_relay_obj_key_equal (&key1, &key2));
+
+    /* type not supported */
+    key1.type = WEECHAT_RELAY_OBJ_TYPE_BUFFER;
+    key2.type = WEECHAT_RELAY_OBJ_TYPE_BUFFER;
+    LONGS_EQUAL(0, weechat_relay_obj_hash_key (&key1));
+    LONGS_EQUAL(0, weechat_relay_obj_key_equal (&key1, &key2));
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_obj_hashtable_build_index
+ *   weechat_relay_obj_hashtable_search
+ *   weechat_relay_obj_hashtable_get
+ *   weechat_relay_obj_hashtable_get_string
+ */
+
+TEST(LibObject, HashtableIndex)
+{
+    struct t_weechat_relay_obj *obj, key;
+    struct t_weechat_relay_obj_hashtable *ptr_hashtable;
+    char str_key[64];
+    int i, count;
+
+    POINTERS_EQUAL(NULL, weechat_relay_obj_hashtable_get (NULL, NULL));
+    POINTERS_EQUAL(NULL, weechat_relay_obj_hashtable_get_string (NULL, "a"));
+    LONGS_EQUAL(0, weechat_relay_obj_hashtable_build_index (NULL));
+
+    /* small hashtable (linear search), then large (hash index) */
+    for (count = 4; count <= 1000; count += 996)
+    {
+        obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+        ptr_hashtable = &obj->value_hashtable;
+        ptr_hashtable->type_keys = WEECHAT_RELAY_OBJ_TYPE_STRING;
+        ptr_hashtable->type_values = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+        ptr_hashtable->count = count;
+        ptr_hashtable->keys = (struct t_weechat_relay_obj **)calloc (
+            count, sizeof (*ptr_hashtable->keys));
+        ptr_hashtable->values = (struct t_weechat_relay_obj **)calloc (
+            count, sizeof (*ptr_hashtable->values));
+        for (i = 0; i < count; i++)
+        {
+            snprintf (str_key, sizeof (str_key), "key%d", i % (count - 1));
+            ptr_hashtable->keys[i] = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_STRING);
+            ptr_hashtable->keys[i]->value_string = strdup (str_key);
+            ptr_hashtable->values[i] = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+            ptr_hashtable->values[i]->value_integer = i;
+        }
+
+        POINTERS_EQUAL(NULL, ptr_hashtable->index);
+        POINTERS_EQUAL(NULL, weechat_relay_obj_hashtable_get_string (ptr_hashtable, NULL));
+        POINTERS_EQUAL(NULL, weechat_relay_obj_hashtable_get_string (ptr_hashtable, "key"));
+        if (count < WEECHAT_RELAY_OBJ_HASHTABLE_INDEX_MIN_COUNT)
+        {
+            POINTERS_EQUAL(NULL, ptr_hashtable->index);
+        }
+        else
+        {
+            /* index built on first search */
+            CHECK(ptr_hashtable->index);
+            CHECK(ptr_hashtable->index_size >= count * 2);
+        }
+
+        for (i = 0; i < count - 1; i++)
+        {
+            snprintf (str_key, sizeof (str_key), "key%d", i);
+            LONGS_EQUAL(i, weechat_relay_obj_hashtable_get_string (ptr_hashtable, str_key)->value_integer);
+            LONGS_EQUAL(i, weechat_relay_obj_hashtable_search (ptr_hashtable, ptr_hashtable->keys[i]));
+        }
+
+        /* duplicate key: the first entry is returned */
+        LONGS_EQUAL(0, weechat_relay_obj_hashtable_search (ptr_hashtable, ptr_hashtable->keys[count - 1]));
+
+        /* wrong type of key */
+        key.type = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+        key.value_integer = 0;
+        POINTERS_EQUAL(NULL, weechat_relay_obj_hashtable_get (ptr_hashtable, &key));
+
+        weechat_relay_obj_free (obj);
+    }
+
+    /* hashtable with integer keys */
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    ptr_hashtable = &obj->value_hashtable;
+    ptr_hashtable->type_keys = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+    ptr_hashtable->type_values = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+    ptr_hashtable->count = 100;
+    ptr_hashtable->keys = (struct t_weechat_relay_obj **)calloc (
+        100, sizeof (*ptr_hashtable->keys));
+    ptr_hashtable->values = (struct t_weechat_relay_obj **)calloc (
+        100, sizeof (*ptr_hashtable->values));
+    for (i = 0; i < 100; i++)
+    {
+        ptr_hashtable->keys[i] = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        ptr_hashtable->keys[i]->value_integer = i * 1024;
+        ptr_hashtable->values[i] = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        ptr_hashtable->values[i]->value_integer = i;
+    }
+    LONGS_EQUAL(1, weechat_relay_obj_hashtable_build_index (ptr_hashtable));
+    CHECK(ptr_hashtable->index);
+    /* index already built */
+    LONGS_EQUAL(1, weechat_relay_obj_hashtable_build_index (ptr_hashtable));
+    key.type = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+    for (i = 0; i < 100; i++)
+    {
+        key.value_integer = i * 1024;
+        LONGS_EQUAL(i, weechat_relay_obj_hashtable_get (ptr_hashtable, &key)->value_integer);
+    }
+    key.value_integer = 1;
+    POINTERS_EQUAL(NULL, weechat_relay_obj_hashtable_get (ptr_hashtable, &key));
+    POINTERS_EQUAL(NULL, weechat_relay_obj_hashtable_get_string (ptr_hashtable, "0"));
+    weechat_relay_obj_free (obj);
+
+    /* type of keys not supported by index */
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    obj->value_hashtable.type_keys = WEECHAT_RELAY_OBJ_TYPE_BUFFER;
+    LONGS_EQUAL(0, weechat_relay_obj_hashtable_build_index (&obj->value_hashtable));
+    weechat_relay_obj_free (obj);
+}
@@ -25,6 +25,9 @@
 
 extern "C"
 {
+#include "arpa/inet.h"
+#include "pthread.h"
+#include "stdio.h"
 #include "string.h"
 #include "tests/tests.h"
 #include "lib/weechat-relay.h"
@@ -1582,6 +1585,102 @@ TEST(LibParse, DecompressZstd)
     weechat_relay_msg_free (msg);
 }
 
+/*
+ * Tests functions:
+ *   weechat_relay_parse_peek_id
+ *   weechat_relay_parse_peek_id_ctx
+ */
+
+TEST(LibParse, PeekId)
+{
+    unsigned char message_invalid_size[] = { MESSAGE_INVALID_SIZE };
+    unsigned char message_invalid_id[] = { MESSAGE_INVALID_ID };
+    unsigned char message_invalid_compressed_data[] = {
+        MESSAGE_INVALID_COMPRESSED_DATA };
+    unsigned char message_null_id[] = {
+        0x00, 0x00, 0x00, 0x09,                 /* length: 9      */
+        0x00,                                   /* no compression */
+        0xFF, 0xFF, 0xFF, 0xFF,                 /* id: NULL       */
+    };
+    struct t_weechat_relay_parse_ctx *ctx;
+    struct t_weechat_relay_msg *msg;
+    void *msg_comp;
+    size_t size_comp;
+    char id[64];
+
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (NULL, 0, NULL, 0));
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (message_invalid_size,
+                                                sizeof (message_invalid_size),
+                                                NULL, 0));
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (message_invalid_size,
+                                                sizeof (message_invalid_size),
+                                                id, 0));
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (message_invalid_size,
+                                                sizeof (message_invalid_size),
+                                                id, sizeof (id)));
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (message_invalid_id,
+                                                sizeof (message_invalid_id),
+                                                id, sizeof (id)));
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (
+                    message_invalid_compressed_data,
+                    sizeof (message_invalid_compressed_data),
+                    id, sizeof (id)));
+
+    /* NULL id */
+    strcpy (id, "x");
+    LONGS_EQUAL(1, weechat_relay_parse_peek_id (message_null_id,
+                                                sizeof (message_null_id),
+                                                id, sizeof (id)));
+    STRCMP_EQUAL("", id);
+
+    /* create a message for the following tests */
+    MESSAGE_BUILD_FAKE(msg);
+
+    /* message not compressed */
+    LONGS_EQUAL(1, weechat_relay_parse_peek_id (msg->data, msg->data_size,
+                                                id, sizeof (id)));
+    STRCMP_EQUAL("test", id);
+    LONGS_EQUAL(1, weechat_relay_parse_peek_id (msg->data, msg->data_size,
+                                                id, 5));
+    STRCMP_EQUAL("test", id);
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (msg->data, msg->data_size,
+                                                id, 4));
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (msg->data,
+                                                msg->data_size - 1,
+                                                id, sizeof (id)));
+
+    /* compressed message (zlib) */
+    msg_comp = weechat_relay_msg_compress_zlib (msg, 5, &size_comp);
+    id[0] = '\0';
+    LONGS_EQUAL(1, weechat_relay_parse_peek_id (msg_comp, size_comp,
+                                                id, sizeof (id)));
+    STRCMP_EQUAL("test", id);
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (msg_comp, size_comp, id, 4));
+    free (msg_comp);
+
+    /* compressed message (zstd), with and without parse context */
+    msg_comp = weechat_relay_msg_compress_zstd (msg, 5, &size_comp);
+    id[0] = '\0';
+    LONGS_EQUAL(1, weechat_relay_parse_peek_id (msg_comp, size_comp,
+                                                id, sizeof (id)));
+    STRCMP_EQUAL("test", id);
+    LONGS_EQUAL(0, weechat_relay_parse_peek_id (msg_comp, size_comp, id, 4));
+    ctx = weechat_relay_parse_ctx_new ();
+    id[0] = '\0';
+    LONGS_EQUAL(1, weechat_relay_parse_peek_id_ctx (ctx, msg_comp, size_comp,
+                                                    id, sizeof (id)));
+    STRCMP_EQUAL("test", id);
+    CHECK(ctx->zstd_dctx);
+    id[0] = '\0';
+    LONGS_EQUAL(1, weechat_relay_parse_peek_id_ctx (ctx, msg_comp, size_comp,
+                                                    id, sizeof (id)));
+    STRCMP_EQUAL("test", id);
+    weechat_relay_parse_ctx_free (ctx);
+    free (msg_comp);
+
+    weechat_relay_msg_free (msg);
+}
+
 /*
  * Tests functions:
  *   weechat_relay_parse_msg_alloc
@@ -1620,6 +1719,8 @@ TEST(LibParse, MsgAllocFree)
     MEMCMP_EQUAL(msg_string + 5, parsed_msg->buffer, sizeof (msg_string) - 5);
     LONGS_EQUAL(sizeof (msg_string) - 5, parsed_msg->size);
     LONGS_EQUAL(6, parsed_msg->position);
+    POINTERS_EQUAL((char *)parsed_msg->message + 5, parsed_msg->buffer);
+    LONGS_EQUAL(1, parsed_msg->refcount);
     weechat_relay_parse_msg_free (parsed_msg);
 
     weechat_relay_parse_msg_free (NULL);
@@ -1709,3 +1810,1383 @@ TEST(LibParse, Message)
 
     weechat_relay_msg_free (msg);
 }
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_message_flags
+ *   weechat_relay_parse_hdata_alloc_columns
+ *   weechat_relay_parse_array_native
+ */
+
+TEST(LibParse, MessageFlags)
+{
+    unsigned char message[] = {
+        0x00, 0x00, 0x00, 14 + 75 + 3 + 27 + 3 + 10,
+        0x00,
+        0x00, 0x00, 0x00, 0x02, 'i', 'd',
+        'h', 'd', 'a', OBJ_HDATA,
+        'a', 'r', 'r', 'i', 'n', 't',
+        0x00, 0x00, 0x00, 0x05,
+        0x00, 0x00, 0x00, 0x01,  /* 1          */
+        0xFF, 0xFF, 0xFF, 0xFF,  /* -1         */
+        0x12, 0x34, 0x56, 0x78,  /* 0x12345678 */
+        0x00, 0x00, 0x00, 0x00,  /* 0          */
+        0x00, 0x01, 0x86, 0xA0,  /* 100000     */
+        'a', 'r', 'r', 'c', 'h', 'r',
+        0x00, 0x00, 0x00, 0x03,
+        'a', 'b', 'c',
+    };
+    unsigned char message_truncated[] = {
+        0x00, 0x00, 0x00, 14 + 11,
+        0x00,
+        0x00, 0x00, 0x00, 0x02, 'i', 'd',
+        'a', 'r', 'r', 'i', 'n', 't',
+        0x00, 0x00, 0x00, 0x02,  /* count: 2 but only 1 integer */
+        0x00, 0x00, 0x00, 0x01,
+    };
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj *ptr_obj;
+    struct t_weechat_relay_msg *msg;
+    int *ptr_int, i;
+
+    /* without flags: objects for all values */
+    parsed_msg = weechat_relay_parse_message_flags (message, sizeof (message), 0);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(0, parsed_msg->flags);
+    LONGS_EQUAL(3, parsed_msg->num_objects);
+    POINTERS_EQUAL(NULL, parsed_msg->objects[0]->value_hdata.columns);
+    CHECK(parsed_msg->objects[0]->value_hdata.values[0][1]);
+    CHECK(parsed_msg->objects[1]->value_array.values);
+    POINTERS_EQUAL(NULL, parsed_msg->objects[1]->value_array.values_native);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* native arrays and columns */
+    parsed_msg = weechat_relay_parse_message_flags (
+        message, sizeof (message), WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS, parsed_msg->flags);
+    LONGS_EQUAL(3, parsed_msg->num_objects);
+
+    /* hdata: k1 (str) is an object, k2 (int) and k3 (chr) are columns */
+    ptr_obj = parsed_msg->objects[0];
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_HDATA, ptr_obj->type);
+    LONGS_EQUAL(2, ptr_obj->value_hdata.count);
+    CHECK(ptr_obj->value_hdata.columns);
+    POINTERS_EQUAL(NULL, ptr_obj->value_hdata.columns[0]);
+    CHECK(ptr_obj->value_hdata.columns[1]);
+    CHECK(ptr_obj->value_hdata.columns[2]);
+    for (i = 0; i < 2; i++)
+    {
+        CHECK(ptr_obj->value_hdata.values[i][0]);
+        POINTERS_EQUAL(NULL, ptr_obj->value_hdata.values[i][1]);
+        POINTERS_EQUAL(NULL, ptr_obj->value_hdata.values[i][2]);
+    }
+    STRCMP_EQUAL("ab", ptr_obj->value_hdata.values[0][0]->value_string);
+    STRCMP_EQUAL("xy", ptr_obj->value_hdata.values[1][0]->value_string);
+    LONGS_EQUAL(5, ((int *)ptr_obj->value_hdata.columns[1])[0]);
+    LONGS_EQUAL(9, ((int *)ptr_obj->value_hdata.columns[1])[1]);
+    LONGS_EQUAL('F', ((char *)ptr_obj->value_hdata.columns[2])[0]);
+    LONGS_EQUAL('X', ((char *)ptr_obj->value_hdata.columns[2])[1]);
+
+    /* array of integers */
+    ptr_obj = parsed_msg->objects[1];
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_ARRAY, ptr_obj->type);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_INTEGER, ptr_obj->value_array.type);
+    LONGS_EQUAL(5, ptr_obj->value_array.count);
+    POINTERS_EQUAL(NULL, ptr_obj->value_array.values);
+    ptr_int = (int *)ptr_obj->value_array.values_native;
+    CHECK(ptr_int);
+    LONGS_EQUAL(1, ptr_int[0]);
+    LONGS_EQUAL(-1, ptr_int[1]);
+    LONGS_EQUAL(0x12345678, ptr_int[2]);
+    LONGS_EQUAL(0, ptr_int[3]);
+    LONGS_EQUAL(100000, ptr_int[4]);
+
+    /* array of chars */
+    ptr_obj = parsed_msg->objects[2];
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_CHAR, ptr_obj->value_array.type);
+    LONGS_EQUAL(3, ptr_obj->value_array.count);
+    POINTERS_EQUAL(NULL, ptr_obj->value_array.values);
+    MEMCMP_EQUAL("abc", ptr_obj->value_array.values_native, 3);
+
+    /* build a message with native values: same bytes as original message */
+    msg = weechat_relay_msg_new ("id");
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        LONGS_EQUAL(1, weechat_relay_msg_add_object (msg, parsed_msg->objects[i]));
+    }
+    LONGS_EQUAL(sizeof (message), msg->data_size);
+    MEMCMP_EQUAL(message, msg->data, sizeof (message));
+    weechat_relay_msg_free (msg);
+
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* truncated array of integers */
+    parsed_msg = weechat_relay_parse_message_flags (
+        message_truncated, sizeof (message_truncated),
+        WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(0, parsed_msg->num_objects);
+    weechat_relay_parse_msg_free (parsed_msg);
+}
+
+#define MESSAGE_INFOLIST_COLUMNS(__last_var)                            \
+    0x00, 0x00, 0x00, 14 + 126,                                         \
+    0x00,                                                               \
+    0x00, 0x00, 0x00, 0x02, 'i', 'd',                                   \
+    'i', 'n', 'l',                                                      \
+    0x00, 0x00, 0x00, 0x04, 't', 'e', 's', 't',                         \
+    0x00, 0x00, 0x00, 0x03,                                             \
+    /* item 1 */                                                        \
+    0x00, 0x00, 0x00, 0x02,                                             \
+    0x00, 0x00, 0x00, 0x04, 'n', 'a', 'm', 'e', 's', 't', 'r',          \
+    0x00, 0x00, 0x00, 0x01, 'a',                                        \
+    0x00, 0x00, 0x00, 0x06, 'n', 'u', 'm', 'b', 'e', 'r', 'i', 'n', 't', \
+    0x00, 0x00, 0x00, 0x01,                                             \
+    /* item 2 */                                                        \
+    0x00, 0x00, 0x00, 0x02,                                             \
+    0x00, 0x00, 0x00, 0x04, 'n', 'a', 'm', 'e', 's', 't', 'r',          \
+    0x00, 0x00, 0x00, 0x02, 'b', 'c',                                   \
+    0x00, 0x00, 0x00, 0x06, 'n', 'u', 'm', 'b', 'e', 'r', 'i', 'n', 't', \
+    0x00, 0x00, 0x00, 0x02,                                             \
+    /* item 3 */                                                        \
+    0x00, 0x00, 0x00, 0x02,                                             \
+    0x00, 0x00, 0x00, 0x04, 'n', 'a', 'm', 'e', 's', 't', 'r',          \
+    0x00, 0x00, 0x00, 0x03, 'd', 'e', 'f',                              \
+    0x00, 0x00, 0x00, 0x06, 'n', 'u', 'm', 'b', 'e', __last_var,        \
+    'i', 'n', 't',                                                      \
+    0x00, 0x00, 0x00, 0x03
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_match_string
+ *   weechat_relay_parse_infolist_columns
+ *   weechat_relay_obj_infolist_get
+ */
+
+TEST(LibParse, ObjInfolistColumns)
+{
+    unsigned char message[] = { MESSAGE_INFOLIST_COLUMNS('r') };
+    unsigned char message_other_var[] = { MESSAGE_INFOLIST_COLUMNS('x') };
+    unsigned char message_infolist[] = { MESSAGE_INFOLIST };
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj_infolist *ptr_infolist;
+    struct t_weechat_relay_obj *ptr_obj;
+    struct t_weechat_relay_msg *msg;
+    int i;
+
+    /* same variables in all items: columnar infolist */
+    parsed_msg = weechat_relay_parse_message_flags (
+        message, sizeof (message),
+        WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_INFOLIST, parsed_msg->objects[0]->type);
+    ptr_infolist = &parsed_msg->objects[0]->value_infolist;
+    STRCMP_EQUAL("test", ptr_infolist->name);
+    LONGS_EQUAL(3, ptr_infolist->count);
+    POINTERS_EQUAL(NULL, ptr_infolist->items);
+    CHECK(ptr_infolist->schema);
+    LONGS_EQUAL(2, ptr_infolist->schema->count);
+    STRCMP_EQUAL("name", ptr_infolist->schema->names[0]);
+    STRCMP_EQUAL("number", ptr_infolist->schema->names[1]);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_STRING, ptr_infolist->schema->types[0]);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_INTEGER, ptr_infolist->schema->types[1]);
+    CHECK(ptr_infolist->columns);
+    STRCMP_EQUAL("a", ((char **)ptr_infolist->columns[0])[0]);
+    STRCMP_EQUAL("bc", ((char **)ptr_infolist->columns[0])[1]);
+    STRCMP_EQUAL("def", ((char **)ptr_infolist->columns[0])[2]);
+    for (i = 0; i < 3; i++)
+    {
+        LONGS_EQUAL(i + 1, ((int *)ptr_infolist->columns[1])[i]);
+    }
+    POINTERS_EQUAL(NULL, ptr_infolist->objects);
+
+    POINTERS_EQUAL(NULL, weechat_relay_obj_infolist_get (NULL, 0, "name"));
+    POINTERS_EQUAL(NULL, weechat_relay_obj_infolist_get (ptr_infolist, 0, NULL));
+    POINTERS_EQUAL(NULL, weechat_relay_obj_infolist_get (ptr_infolist, -1, "name"));
+    POINTERS_EQUAL(NULL, weechat_relay_obj_infolist_get (ptr_infolist, 3, "name"));
+    POINTERS_EQUAL(NULL, weechat_relay_obj_infolist_get (ptr_infolist, 0, "xxx"));
+    ptr_obj = weechat_relay_obj_infolist_get (ptr_infolist, 1, "name");
+    CHECK(ptr_obj);
+    STRCMP_EQUAL("bc", ptr_obj->value_string);
+    ptr_obj = weechat_relay_obj_infolist_get (ptr_infolist, 2, "number");
+    CHECK(ptr_obj);
+    LONGS_EQUAL(3, ptr_obj->value_integer);
+
+    /* objects are built on demand, then kept */
+    CHECK(ptr_infolist->objects);
+    POINTERS_EQUAL(ptr_obj, ptr_infolist->objects[(1 * 3) + 2]);
+    POINTERS_EQUAL(NULL, ptr_infolist->objects[(1 * 3) + 1]);
+    POINTERS_EQUAL(ptr_obj,
+                   weechat_relay_obj_infolist_get (ptr_infolist, 2, "number"));
+
+    /* build a message with the columnar infolist: same bytes */
+    msg = weechat_relay_msg_new ("id");
+    LONGS_EQUAL(1, weechat_relay_msg_add_object (msg, parsed_msg->objects[0]));
+    LONGS_EQUAL(sizeof (message), msg->data_size);
+    MEMCMP_EQUAL(message, msg->data, sizeof (message));
+    weechat_relay_msg_free (msg);
+
+    /* an object built and modified is used in message */
+    ptr_obj->value_integer = 4;
+    msg = weechat_relay_msg_new ("id");
+    LONGS_EQUAL(1, weechat_relay_msg_add_object (msg, parsed_msg->objects[0]));
+    LONGS_EQUAL(sizeof (message), msg->data_size);
+    LONGS_EQUAL(4, msg->data[sizeof (message) - 1]);
+    weechat_relay_msg_free (msg);
+
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* other variable name in last item: classic infolist */
+    parsed_msg = weechat_relay_parse_message_flags (
+        message_other_var, sizeof (message_other_var),
+        WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    ptr_infolist = &parsed_msg->objects[0]->value_infolist;
+    LONGS_EQUAL(3, ptr_infolist->count);
+    CHECK(ptr_infolist->items);
+    POINTERS_EQUAL(NULL, ptr_infolist->schema);
+    POINTERS_EQUAL(NULL, ptr_infolist->columns);
+    STRCMP_EQUAL("numbex", ptr_infolist->items[2]->variables[1]->name);
+    ptr_obj = weechat_relay_obj_infolist_get (ptr_infolist, 1, "number");
+    CHECK(ptr_obj);
+    LONGS_EQUAL(2, ptr_obj->value_integer);
+    POINTERS_EQUAL(NULL, weechat_relay_obj_infolist_get (ptr_infolist, 2, "number"));
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* different number of variables in items: classic infolist */
+    parsed_msg = weechat_relay_parse_message_flags (
+        message_infolist, sizeof (message_infolist),
+        WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    ptr_infolist = &parsed_msg->objects[0]->value_infolist;
+    CHECK(ptr_infolist->items);
+    POINTERS_EQUAL(NULL, ptr_infolist->schema);
+    ptr_obj = weechat_relay_obj_infolist_get (ptr_infolist, 1, "def");
+    CHECK(ptr_obj);
+    LONGS_EQUAL(4, ptr_obj->value_integer);
+    weechat_relay_parse_msg_free (parsed_msg);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_infolist_column_value
+ *   weechat_relay_obj_infolist_column_view
+ *   weechat_relay_obj_infolist_column_get
+ */
+
+TEST(LibParse, ObjInfolistColumnsTypes)
+{
+    unsigned char message[] = {
+        0x00, 0x00, 0x00, 0xA5,
+        0x00,
+        0x00, 0x00, 0x00, 0x02, 'i', 'd',
+        'i', 'n', 'l',
+        0x00, 0x00, 0x00, 0x01, 't',
+        0x00, 0x00, 0x00, 0x02,
+        /* item 1 */
+        0x00, 0x00, 0x00, 0x05,
+        0x00, 0x00, 0x00, 0x01, 'c', 'c', 'h', 'r', 'A',
+        0x00, 0x00, 0x00, 0x01, 'l', 'l', 'o', 'n', 3, '1', '2', '3',
+        0x00, 0x00, 0x00, 0x01, 'p', 'p', 't', 'r', 4, '1', 'a', '2', 'b',
+        0x00, 0x00, 0x00, 0x01, 't', 't', 'i', 'm',
+        10, '1', '7', '0', '0', '0', '0', '0', '0', '0', '0',
+        0x00, 0x00, 0x00, 0x01, 'b', 'b', 'u', 'f',
+        0x00, 0x00, 0x00, 0x02, 0x01, 0x02,
+        /* item 2 */
+        0x00, 0x00, 0x00, 0x05,
+        0x00, 0x00, 0x00, 0x01, 'c', 'c', 'h', 'r', 'B',
+        0x00, 0x00, 0x00, 0x01, 'l', 'l', 'o', 'n', 3, '-', '4', '5',
+        0x00, 0x00, 0x00, 0x01, 'p', 'p', 't', 'r', 4, 'f', 'f', 'f', 'f',
+        0x00, 0x00, 0x00, 0x01, 't', 't', 'i', 'm',
+        10, '1', '7', '0', '0', '0', '0', '0', '0', '0', '1',
+        0x00, 0x00, 0x00, 0x01, 'b', 'b', 'u', 'f',
+        0x00, 0x00, 0x00, 0x02, 0x03, 0x04,
+    };
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj_infolist *ptr_infolist;
+    struct t_weechat_relay_obj_buffer *ptr_buffer;
+    struct t_weechat_relay_obj *ptr_obj, obj_temp;
+    struct t_weechat_relay_msg *msg;
+
+    LONGS_EQUAL(0xA5, sizeof (message));
+
+    parsed_msg = weechat_relay_parse_message_flags (
+        message, sizeof (message),
+        WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    ptr_infolist = &parsed_msg->objects[0]->value_infolist;
+    POINTERS_EQUAL(NULL, ptr_infolist->items);
+    CHECK(ptr_infolist->schema);
+    LONGS_EQUAL(5, ptr_infolist->schema->count);
+
+    /* native columns */
+    LONGS_EQUAL('A', ((char *)ptr_infolist->columns[0])[0]);
+    LONGS_EQUAL('B', ((char *)ptr_infolist->columns[0])[1]);
+    LONGS_EQUAL(123, ((long *)ptr_infolist->columns[1])[0]);
+    LONGS_EQUAL(-45, ((long *)ptr_infolist->columns[1])[1]);
+    POINTERS_EQUAL((void *)0x1a2b, ((void **)ptr_infolist->columns[2])[0]);
+    POINTERS_EQUAL((void *)0xffff, ((void **)ptr_infolist->columns[2])[1]);
+    LONGS_EQUAL(1700000000, ((time_t *)ptr_infolist->columns[3])[0]);
+    LONGS_EQUAL(1700000001, ((time_t *)ptr_infolist->columns[3])[1]);
+    ptr_buffer = &((struct t_weechat_relay_obj_buffer *)ptr_infolist->columns[4])[1];
+    LONGS_EQUAL(2, ptr_buffer->length);
+    MEMCMP_EQUAL("\x03\x04", ptr_buffer->buffer, 2);
+
+    /* view: value not copied */
+    ptr_obj = weechat_relay_obj_infolist_column_view (ptr_infolist, 4, 1,
+                                                      &obj_temp);
+    POINTERS_EQUAL(&obj_temp, ptr_obj);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_BUFFER, obj_temp.type);
+    POINTERS_EQUAL(ptr_buffer->buffer, obj_temp.value_buffer.buffer);
+    POINTERS_EQUAL(NULL, ptr_infolist->objects);
+
+    /* object built: value copied, then returned by view */
+    ptr_obj = weechat_relay_obj_infolist_column_get (ptr_infolist, 4, 1);
+    CHECK(ptr_obj);
+    CHECK(ptr_obj->value_buffer.buffer != ptr_buffer->buffer);
+    MEMCMP_EQUAL("\x03\x04", ptr_obj->value_buffer.buffer, 2);
+    POINTERS_EQUAL(ptr_obj,
+                   weechat_relay_obj_infolist_column_view (ptr_infolist, 4, 1,
+                                                           &obj_temp));
+    ptr_obj = weechat_relay_obj_infolist_get (ptr_infolist, 1, "l");
+    CHECK(ptr_obj);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_LONG, ptr_obj->type);
+    LONGS_EQUAL(-45, ptr_obj->value_long);
+
+    /* build a message with the columnar infolist: same bytes */
+    msg = weechat_relay_msg_new ("id");
+    LONGS_EQUAL(1, weechat_relay_msg_add_object (msg, parsed_msg->objects[0]));
+    LONGS_EQUAL(sizeof (message), msg->data_size);
+    MEMCMP_EQUAL(message, msg->data, sizeof (message));
+    weechat_relay_msg_free (msg);
+
+    weechat_relay_parse_msg_free (parsed_msg);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_message_flags (hashtable index)
+ */
+
+TEST(LibParse, MessageHashtableIndex)
+{
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj *obj, *ptr_value;
+    char str_key[64];
+    int i;
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    obj->value_hashtable.type_keys = WEECHAT_RELAY_OBJ_TYPE_STRING;
+    obj->value_hashtable.type_values = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+    obj->value_hashtable.count = 16;
+    obj->value_hashtable.keys = (struct t_weechat_relay_obj **)calloc (
+        16, sizeof (*obj->value_hashtable.keys));
+    obj->value_hashtable.values = (struct t_weechat_relay_obj **)calloc (
+        16, sizeof (*obj->value_hashtable.values));
+    for (i = 0; i < 16; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "localvar_%d", i);
+        obj->value_hashtable.keys[i] = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_STRING);
+        obj->value_hashtable.keys[i]->value_string = strdup (str_key);
+        obj->value_hashtable.values[i] = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        obj->value_hashtable.values[i]->value_integer = i;
+    }
+    msg = weechat_relay_msg_new ("id");
+    LONGS_EQUAL(1, weechat_relay_msg_add_object (msg, obj));
+    weechat_relay_obj_free (obj);
+
+    /* without flag: index built on first lookup */
+    parsed_msg = weechat_relay_parse_message_flags (msg->data, msg->data_size, 0);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    POINTERS_EQUAL(NULL, parsed_msg->objects[0]->value_hashtable.index);
+    ptr_value = weechat_relay_obj_hashtable_get_string (
+        &parsed_msg->objects[0]->value_hashtable, "localvar_7");
+    CHECK(ptr_value);
+    LONGS_EQUAL(7, ptr_value->value_integer);
+    CHECK(parsed_msg->objects[0]->value_hashtable.index);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* with flag: index built by parser */
+    parsed_msg = weechat_relay_parse_message_flags (
+        msg->data, msg->data_size, WEECHAT_RELAY_PARSE_FLAG_HASHTABLE_INDEX);
+    CHECK(parsed_msg);
+    CHECK(parsed_msg->objects[0]->value_hashtable.index);
+    LONGS_EQUAL(32, parsed_msg->objects[0]->value_hashtable.index_size);
+    ptr_value = weechat_relay_obj_hashtable_get_string (
+        &parsed_msg->objects[0]->value_hashtable, "localvar_15");
+    CHECK(ptr_value);
+    LONGS_EQUAL(15, ptr_value->value_integer);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    weechat_relay_msg_free (msg);
+}
+
+/*
+ * Looks up all keys of the hashtable in the first object of a parsed
+ * message (callback of thread), then releases the message.
+ */
+
+static void *
+thread_lookup_hashtable (void *data)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj *ptr_value;
+    char str_key[64];
+    long errors;
+    int i;
+
+    parsed_msg = (struct t_weechat_relay_parsed_msg *)data;
+    errors = 0;
+    for (i = 0; i < 16; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "localvar_%d", i);
+        ptr_value = weechat_relay_obj_hashtable_get_string (
+            &parsed_msg->objects[0]->value_hashtable, str_key);
+        if (!ptr_value || (ptr_value->value_integer != i))
+            errors++;
+    }
+    weechat_relay_parse_msg_release (parsed_msg);
+
+    return (void *)errors;
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_msg_retain
+ *   weechat_relay_parse_msg_release
+ */
+
+TEST(LibParse, MsgRetainRelease)
+{
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj *obj;
+    pthread_t threads[4];
+    void *errors;
+    char str_key[64];
+    int i;
+
+    POINTERS_EQUAL(NULL, weechat_relay_parse_msg_retain (NULL));
+    weechat_relay_parse_msg_release (NULL);
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    obj->value_hashtable.type_keys = WEECHAT_RELAY_OBJ_TYPE_STRING;
+    obj->value_hashtable.type_values = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+    obj->value_hashtable.count = 16;
+    obj->value_hashtable.keys = (struct t_weechat_relay_obj **)calloc (
+        16, sizeof (*obj->value_hashtable.keys));
+    obj->value_hashtable.values = (struct t_weechat_relay_obj **)calloc (
+        16, sizeof (*obj->value_hashtable.values));
+    for (i = 0; i < 16; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "localvar_%d", i);
+        obj->value_hashtable.keys[i] = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_STRING);
+        obj->value_hashtable.keys[i]->value_string = strdup (str_key);
+        obj->value_hashtable.values[i] = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        obj->value_hashtable.values[i]->value_integer = i;
+    }
+    msg = weechat_relay_msg_new ("id");
+    LONGS_EQUAL(1, weechat_relay_msg_add_object (msg, obj));
+    weechat_relay_obj_free (obj);
+
+    parsed_msg = weechat_relay_parse_message (msg->data, msg->data_size);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->refcount);
+
+    /* the message does not depend on the buffer given to the parser */
+    memset (msg->data, 0, msg->data_size);
+    weechat_relay_msg_free (msg);
+
+    POINTERS_EQUAL(parsed_msg, weechat_relay_parse_msg_retain (parsed_msg));
+    LONGS_EQUAL(2, parsed_msg->refcount);
+    weechat_relay_parse_msg_release (parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->refcount);
+
+    /* share the message with threads (hash index built by first lookup) */
+    POINTERS_EQUAL(NULL, parsed_msg->objects[0]->value_hashtable.index);
+    for (i = 0; i < 4; i++)
+    {
+        LONGS_EQUAL(0, pthread_create (&threads[i], NULL,
+                                       &thread_lookup_hashtable,
+                                       weechat_relay_parse_msg_retain (parsed_msg)));
+    }
+    /* the owner can release its reference before the threads */
+    weechat_relay_parse_msg_release (parsed_msg);
+    for (i = 0; i < 4; i++)
+    {
+        LONGS_EQUAL(0, pthread_join (threads[i], &errors));
+        POINTERS_EQUAL(NULL, errors);
+    }
+}
+
+/*
+ * Parses a message split in segments of "segment_size" bytes (each segment
+ * is allocated and freed after parse, so that the parsed message can not
+ * depend on segments).
+ */
+
+static struct t_weechat_relay_parsed_msg *
+parse_message_segments (const void *buffer, size_t size, size_t segment_size,
+                        int flags)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct iovec *iov;
+    size_t offset;
+    int i, iovcnt;
+
+    iovcnt = (size + segment_size - 1) / segment_size;
+    iov = (struct iovec *)calloc (iovcnt, sizeof (*iov));
+    offset = 0;
+    for (i = 0; i < iovcnt; i++)
+    {
+        iov[i].iov_len = (size - offset < segment_size) ?
+            size - offset : segment_size;
+        iov[i].iov_base = malloc (iov[i].iov_len);
+        memcpy (iov[i].iov_base, (const char *)buffer + offset,
+                iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+
+    parsed_msg = weechat_relay_parse_message_iov (iov, iovcnt, flags);
+
+    for (i = 0; i < iovcnt; i++)
+    {
+        memset (iov[i].iov_base, 0, iov[i].iov_len);
+        free (iov[i].iov_base);
+    }
+    free (iov);
+
+    return parsed_msg;
+}
+
+/*
+ * Checks that a message parsed from segments of different sizes has the
+ * same objects as the message parsed from a contiguous buffer (objects
+ * are compared by building a message with them).
+ */
+
+static void
+check_message_segments (const void *buffer, size_t size, int flags)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg, *parsed_msg_iov;
+    struct t_weechat_relay_msg *msg, *msg_iov;
+    size_t segment_sizes[] = { 1, 2, 3, 7, 64, 1000, 100000 };
+    int i, j;
+
+    parsed_msg = weechat_relay_parse_message_flags (buffer, size, flags);
+    CHECK(parsed_msg);
+    msg = weechat_relay_msg_new (parsed_msg->id);
+    for (j = 0; j < parsed_msg->num_objects; j++)
+    {
+        LONGS_EQUAL(1, weechat_relay_msg_add_object (msg, parsed_msg->objects[j]));
+    }
+
+    for (i = 0; i < (int)(sizeof (segment_sizes) / sizeof (segment_sizes[0])); i++)
+    {
+        parsed_msg_iov = parse_message_segments (buffer, size,
+                                                 segment_sizes[i], flags);
+        CHECK(parsed_msg_iov);
+        POINTERS_EQUAL(NULL, parsed_msg_iov->message);
+        POINTERS_EQUAL(NULL, parsed_msg_iov->iov);
+        LONGS_EQUAL(parsed_msg->length, parsed_msg_iov->length);
+        LONGS_EQUAL(parsed_msg->compression, parsed_msg_iov->compression);
+        LONGS_EQUAL(parsed_msg->length_data_decompressed,
+                    parsed_msg_iov->length_data_decompressed);
+        STRCMP_EQUAL(parsed_msg->id, parsed_msg_iov->id);
+        LONGS_EQUAL(parsed_msg->num_objects, parsed_msg_iov->num_objects);
+        msg_iov = weechat_relay_msg_new (parsed_msg_iov->id);
+        for (j = 0; j < parsed_msg_iov->num_objects; j++)
+        {
+            LONGS_EQUAL(1, weechat_relay_msg_add_object (msg_iov,
+                                                         parsed_msg_iov->objects[j]));
+        }
+        LONGS_EQUAL(msg->data_size, msg_iov->data_size);
+        MEMCMP_EQUAL(msg->data, msg_iov->data, msg->data_size);
+        weechat_relay_msg_free (msg_iov);
+        weechat_relay_parse_msg_free (parsed_msg_iov);
+    }
+
+    weechat_relay_msg_free (msg);
+    weechat_relay_parse_msg_free (parsed_msg);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_iov_size
+ *   weechat_relay_parse_iov_seek
+ *   weechat_relay_parse_iov_copy
+ *   weechat_relay_parse_get_bytes
+ *   weechat_relay_parse_peek_bytes
+ *   weechat_relay_parse_decompress_zlib_iov
+ *   weechat_relay_parse_decompress_zstd_iov
+ *   weechat_relay_parse_msg_alloc_iov_ctx
+ *   weechat_relay_parse_message_iov_ctx
+ *   weechat_relay_parse_message_iov
+ */
+
+TEST(LibParse, MessageIov)
+{
+    unsigned char message_infolist[] = { MESSAGE_INFOLIST_COLUMNS('r') };
+    unsigned char message_invalid_size[] = { MESSAGE_INVALID_SIZE };
+    unsigned char message_invalid_compressed_data[] = {
+        MESSAGE_INVALID_COMPRESSED_DATA };
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj *obj, *ptr_obj;
+    struct iovec iov[4];
+    char data[16];
+    void *msg_comp;
+    size_t size_comp, start;
+    uint32_t msg_size;
+    int i, index;
+
+    /* segments */
+    iov[0].iov_base = (void *)"abc";
+    iov[0].iov_len = 3;
+    iov[1].iov_base = (void *)"";
+    iov[1].iov_len = 0;
+    iov[2].iov_base = (void *)"d";
+    iov[2].iov_len = 1;
+    iov[3].iov_base = (void *)"efgh";
+    iov[3].iov_len = 4;
+    LONGS_EQUAL(0, weechat_relay_parse_iov_size (NULL, 0));
+    LONGS_EQUAL(8, weechat_relay_parse_iov_size (iov, 4));
+    index = 0;
+    start = 0;
+    LONGS_EQUAL(1, weechat_relay_parse_iov_seek (iov, 4, &index, &start, 5));
+    LONGS_EQUAL(3, index);
+    LONGS_EQUAL(4, start);
+    LONGS_EQUAL(1, weechat_relay_parse_iov_seek (iov, 4, &index, &start, 3));
+    LONGS_EQUAL(2, index);
+    LONGS_EQUAL(3, start);
+    LONGS_EQUAL(0, weechat_relay_parse_iov_seek (iov, 4, &index, &start, 8));
+    memset (data, 0, sizeof (data));
+    LONGS_EQUAL(1, weechat_relay_parse_iov_copy (iov, 4, &index, &start, 1,
+                                                 data, 6));
+    STRCMP_EQUAL("bcdefg", data);
+    LONGS_EQUAL(0, weechat_relay_parse_iov_copy (iov, 4, &index, &start, 4,
+                                                 data, 5));
+
+    /* invalid messages */
+    POINTERS_EQUAL(NULL, weechat_relay_parse_message_iov (NULL, 0, 0));
+    POINTERS_EQUAL(NULL, weechat_relay_parse_message_iov (iov, 0, 0));
+    POINTERS_EQUAL(NULL,
+                   parse_message_segments (message_invalid_size,
+                                           sizeof (message_invalid_size),
+                                           3, 0));
+    POINTERS_EQUAL(NULL,
+                   parse_message_segments (message_invalid_compressed_data,
+                                           sizeof (message_invalid_compressed_data),
+                                           3, 0));
+
+    MESSAGE_BUILD_FAKE(msg);
+
+    /* message not compressed */
+    parsed_msg = parse_message_segments (msg->data, msg->data_size, 5, 0);
+    CHECK(parsed_msg);
+    POINTERS_EQUAL(NULL, parsed_msg->message);
+    LONGS_EQUAL(4186, parsed_msg->length);
+    LONGS_EQUAL(4181, parsed_msg->length_data);
+    POINTERS_EQUAL(NULL, parsed_msg->data_decompressed);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF, parsed_msg->compression);
+    STRCMP_EQUAL("test", parsed_msg->id);
+    LONGS_EQUAL(9, parsed_msg->num_objects);
+    CHECK_OBJS_FAKE_MSG;
+    weechat_relay_parse_msg_free (parsed_msg);
+    check_message_segments (msg->data, msg->data_size, 0);
+    check_message_segments (msg->data, msg->data_size,
+                            WEECHAT_RELAY_PARSE_FLAG_VALUES);
+
+    /* compressed message (zlib) */
+    msg_comp = weechat_relay_msg_compress_zlib (msg, 5, &size_comp);
+    parsed_msg = parse_message_segments (msg_comp, size_comp, 7, 0);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZLIB, parsed_msg->compression);
+    LONGS_EQUAL(4181, parsed_msg->length_data_decompressed);
+    STRCMP_EQUAL("test", parsed_msg->id);
+    LONGS_EQUAL(9, parsed_msg->num_objects);
+    CHECK_OBJS_FAKE_MSG;
+    weechat_relay_parse_msg_free (parsed_msg);
+    check_message_segments (msg_comp, size_comp, 0);
+    /* truncated compressed data */
+    msg_size = htonl ((uint32_t)(size_comp - 1));
+    memcpy (msg_comp, &msg_size, 4);
+    POINTERS_EQUAL(NULL, parse_message_segments (msg_comp, size_comp - 1, 7, 0));
+    free (msg_comp);
+
+    /* compressed message (zstd) */
+    msg_comp = weechat_relay_msg_compress_zstd (msg, 5, &size_comp);
+    parsed_msg = parse_message_segments (msg_comp, size_comp, 7, 0);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD, parsed_msg->compression);
+    LONGS_EQUAL(4181, parsed_msg->length_data_decompressed);
+    STRCMP_EQUAL("test", parsed_msg->id);
+    LONGS_EQUAL(9, parsed_msg->num_objects);
+    CHECK_OBJS_FAKE_MSG;
+    weechat_relay_parse_msg_free (parsed_msg);
+    check_message_segments (msg_comp, size_comp, 0);
+    /* truncated compressed data */
+    msg_size = htonl ((uint32_t)(size_comp - 1));
+    memcpy (msg_comp, &msg_size, 4);
+    POINTERS_EQUAL(NULL, parse_message_segments (msg_comp, size_comp - 1, 7, 0));
+    free (msg_comp);
+
+    weechat_relay_msg_free (msg);
+
+    /* native array split between segments */
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_ARRAY);
+    obj->value_array.type = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+    obj->value_array.count = 64;
+    obj->value_array.values = (struct t_weechat_relay_obj **)calloc (
+        64, sizeof (*obj->value_array.values));
+    for (i = 0; i < 64; i++)
+    {
+        obj->value_array.values[i] = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        obj->value_array.values[i]->value_integer = (i * 7919) - 100000;
+    }
+    msg = weechat_relay_msg_new ("some_custom_id");
+    LONGS_EQUAL(1, weechat_relay_msg_add_object (msg, obj));
+    weechat_relay_obj_free (obj);
+    parsed_msg = parse_message_segments (msg->data, msg->data_size, 3,
+                                         WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS);
+    CHECK(parsed_msg);
+    STRCMP_EQUAL("some_custom_id", parsed_msg->id);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    ptr_obj = parsed_msg->objects[0];
+    LONGS_EQUAL(64, ptr_obj->value_array.count);
+    POINTERS_EQUAL(NULL, ptr_obj->value_array.values);
+    CHECK(ptr_obj->value_array.values_native);
+    for (i = 0; i < 64; i++)
+    {
+        LONGS_EQUAL((i * 7919) - 100000,
+                    ((int *)ptr_obj->value_array.values_native)[i]);
+    }
+    weechat_relay_parse_msg_free (parsed_msg);
+    check_message_segments (msg->data, msg->data_size,
+                            WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS);
+    weechat_relay_msg_free (msg);
+
+    /* columnar infolist: variable names compared across segments */
+    parsed_msg = parse_message_segments (
+        message_infolist, sizeof (message_infolist), 1,
+        WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    CHECK(parsed_msg->objects[0]->value_infolist.schema);
+    STRCMP_EQUAL("def",
+                 ((char **)parsed_msg->objects[0]->value_infolist.columns[0])[2]);
+    weechat_relay_parse_msg_free (parsed_msg);
+    check_message_segments (message_infolist, sizeof (message_infolist),
+                            WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+}
+
+/*
+ * Builds a message with a big hdata (1000 rows) between two other objects.
+ */
+
+static struct t_weechat_relay_msg *
+build_message_big_hdata ()
+{
+    struct t_weechat_relay_msg *msg;
+    char str_name[64];
+    int i;
+
+    msg = weechat_relay_msg_new ("_buffer_line_added");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg, 123);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HDATA);
+    weechat_relay_msg_add_string (msg, "buffer/lines");
+    weechat_relay_msg_add_string (msg, "number:int,name:str,notify:chr");
+    weechat_relay_msg_add_integer (msg, 1000);
+    for (i = 0; i < 1000; i++)
+    {
+        weechat_relay_msg_add_pointer (msg, (void *)(0x1000L + i));
+        weechat_relay_msg_add_pointer (msg, (void *)(0x2000L + i));
+        weechat_relay_msg_add_integer (msg, i * 3);
+        snprintf (str_name, sizeof (str_name), "name_%d", i);
+        weechat_relay_msg_add_string (msg, str_name);
+        weechat_relay_msg_add_char (msg, 'a' + (i % 26));
+    }
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_CHAR);
+    weechat_relay_msg_add_char (msg, 'Z');
+
+    return msg;
+}
+
+/*
+ * Checks that objects of a parsed message are encoded with the same bytes
+ * as message "msg".
+ */
+
+static void
+check_message_same_bytes (struct t_weechat_relay_parsed_msg *parsed_msg,
+                          struct t_weechat_relay_msg *msg)
+{
+    struct t_weechat_relay_msg *msg2;
+    int i;
+
+    msg2 = weechat_relay_msg_new (parsed_msg->id);
+    for (i = 0; i < parsed_msg->num_objects; i++)
+    {
+        LONGS_EQUAL(1, weechat_relay_msg_add_object (msg2, parsed_msg->objects[i]));
+    }
+    LONGS_EQUAL(msg->data_size, msg2->data_size);
+    MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_handle_new
+ *   weechat_relay_parse_handle_step
+ *   weechat_relay_parse_handle_finish
+ *   weechat_relay_parse_handle_free
+ *   weechat_relay_parse_hdata_start
+ *   weechat_relay_parse_hdata_rows
+ *   weechat_relay_parse_hdata_end
+ */
+
+TEST(LibParse, Handle)
+{
+    unsigned char message_invalid_size[] = { MESSAGE_INVALID_SIZE };
+    unsigned char message_truncated[] = {
+        0x00, 0x00, 0x00, 11 + 4 + 5,
+        0x00,
+        0x00, 0x00, 0x00, 0x02, 'i', 'd',
+        'c', 'h', 'r', 'A',
+        'i', 'n', 't', 0x00, 0x00,  /* truncated integer */
+    };
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_parse_handle *handle;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj *ptr_obj;
+    int rc, steps, flags[2], i;
+
+    POINTERS_EQUAL(NULL, weechat_relay_parse_handle_new (NULL, 0, 0));
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_parse_handle_new (message_invalid_size,
+                                                   sizeof (message_invalid_size),
+                                                   0));
+    LONGS_EQUAL(-1, weechat_relay_parse_handle_step (NULL, 10, 0));
+    POINTERS_EQUAL(NULL, weechat_relay_parse_handle_finish (NULL));
+    weechat_relay_parse_handle_free (NULL);
+
+    msg = build_message_big_hdata ();
+
+    /* 100 objects (or hdata rows) per step */
+    handle = weechat_relay_parse_handle_new (msg->data, msg->data_size, 0);
+    CHECK(handle);
+    STRCMP_EQUAL("_buffer_line_added", handle->parsed_msg->id);
+    LONGS_EQUAL(0, handle->parsed_msg->num_objects);
+    steps = 0;
+    while ((rc = weechat_relay_parse_handle_step (handle, 100, 0)) == 1)
+    {
+        steps++;
+        /* integer + 99 rows, then 100 rows per step */
+        if (steps == 1)
+        {
+            LONGS_EQUAL(1, handle->parsed_msg->num_objects);
+            CHECK(handle->container);
+            LONGS_EQUAL(99, handle->container_index);
+        }
+    }
+    LONGS_EQUAL(0, rc);
+    LONGS_EQUAL(10, steps);
+    LONGS_EQUAL(0, weechat_relay_parse_handle_step (handle, 100, 0));
+    parsed_msg = weechat_relay_parse_handle_finish (handle);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(3, parsed_msg->num_objects);
+    ptr_obj = parsed_msg->objects[1];
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_HDATA, ptr_obj->type);
+    LONGS_EQUAL(1000, ptr_obj->value_hdata.count);
+    STRCMP_EQUAL("name_999", ptr_obj->value_hdata.values[999][1]->value_string);
+    LONGS_EQUAL('Z', parsed_msg->objects[2]->value_char);
+    check_message_same_bytes (parsed_msg, msg);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* steps limited by time, with and without native columns */
+    flags[0] = 0;
+    flags[1] = WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS;
+    for (i = 0; i < 2; i++)
+    {
+        handle = weechat_relay_parse_handle_new (msg->data, msg->data_size,
+                                                 flags[i]);
+        CHECK(handle);
+        steps = 0;
+        while (weechat_relay_parse_handle_step (handle, 0, 1) == 1)
+        {
+            steps++;
+        }
+        CHECK(steps >= 1);
+        parsed_msg = weechat_relay_parse_handle_finish (handle);
+        CHECK(parsed_msg);
+        LONGS_EQUAL(3, parsed_msg->num_objects);
+        if (flags[i] & WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS)
+        {
+            ptr_obj = parsed_msg->objects[1];
+            CHECK(ptr_obj->value_hdata.columns);
+            LONGS_EQUAL(2997, ((int *)ptr_obj->value_hdata.columns[0])[999]);
+        }
+        check_message_same_bytes (parsed_msg, msg);
+        weechat_relay_parse_msg_free (parsed_msg);
+    }
+
+    /* no limit: whole message parsed in one step */
+    handle = weechat_relay_parse_handle_new (msg->data, msg->data_size, 0);
+    LONGS_EQUAL(0, weechat_relay_parse_handle_step (handle, 0, 0));
+    parsed_msg = weechat_relay_parse_handle_finish (handle);
+    check_message_same_bytes (parsed_msg, msg);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* finish without steps */
+    handle = weechat_relay_parse_handle_new (msg->data, msg->data_size, 0);
+    parsed_msg = weechat_relay_parse_handle_finish (handle);
+    check_message_same_bytes (parsed_msg, msg);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* values: the hdata is read in one step */
+    handle = weechat_relay_parse_handle_new (msg->data, msg->data_size,
+                                             WEECHAT_RELAY_PARSE_FLAG_VALUES);
+    LONGS_EQUAL(1, weechat_relay_parse_handle_step (handle, 1, 0));
+    LONGS_EQUAL(1, weechat_relay_parse_handle_step (handle, 1, 0));
+    LONGS_EQUAL(2, handle->parsed_msg->num_values);
+    LONGS_EQUAL(0, weechat_relay_parse_handle_step (handle, 1, 0));
+    parsed_msg = weechat_relay_parse_handle_finish (handle);
+    LONGS_EQUAL(3, parsed_msg->num_values);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* abort the parse in the middle of the hdata */
+    handle = weechat_relay_parse_handle_new (msg->data, msg->data_size, 0);
+    LONGS_EQUAL(1, weechat_relay_parse_handle_step (handle, 500, 0));
+    CHECK(handle->container);
+    weechat_relay_parse_handle_free (handle);
+
+    weechat_relay_msg_free (msg);
+
+    /* truncated message: objects before the error are kept */
+    handle = weechat_relay_parse_handle_new (message_truncated,
+                                             sizeof (message_truncated), 0);
+    CHECK(handle);
+    LONGS_EQUAL(1, weechat_relay_parse_handle_step (handle, 1, 0));
+    LONGS_EQUAL(0, weechat_relay_parse_handle_step (handle, 1, 0));
+    parsed_msg = weechat_relay_parse_handle_finish (handle);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    LONGS_EQUAL('A', parsed_msg->objects[0]->value_char);
+    weechat_relay_parse_msg_free (parsed_msg);
+}
+
+/*
+ * Builds a message with a big hashtable, a big array and a big infolist
+ * (1000 elements each).
+ */
+
+static struct t_weechat_relay_msg *
+build_message_big_containers ()
+{
+    struct t_weechat_relay_msg *msg;
+    char str_value[64];
+    int i;
+
+    msg = weechat_relay_msg_new ("containers");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_integer (msg, 1000);
+    for (i = 0; i < 1000; i++)
+    {
+        weechat_relay_msg_add_integer (msg, i);
+        snprintf (str_value, sizeof (str_value), "value_%d", i);
+        weechat_relay_msg_add_string (msg, str_value);
+    }
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_ARRAY);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_integer (msg, 1000);
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (str_value, sizeof (str_value), "item_%d", i);
+        weechat_relay_msg_add_string (msg, str_value);
+    }
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INFOLIST);
+    weechat_relay_msg_add_string (msg, "buffer");
+    weechat_relay_msg_add_integer (msg, 1000);
+    for (i = 0; i < 1000; i++)
+    {
+        weechat_relay_msg_add_integer (msg, 2);
+        weechat_relay_msg_add_string (msg, "number");
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        weechat_relay_msg_add_integer (msg, i + 1);
+        weechat_relay_msg_add_string (msg, "name");
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+        snprintf (str_value, sizeof (str_value), "buffer_%d", i);
+        weechat_relay_msg_add_string (msg, str_value);
+    }
+
+    return msg;
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_handle_step (hashtable, array, infolist)
+ *   weechat_relay_parse_hashtable_start
+ *   weechat_relay_parse_hashtable_items
+ *   weechat_relay_parse_hashtable_end
+ *   weechat_relay_parse_array_start
+ *   weechat_relay_parse_array_items
+ *   weechat_relay_parse_array_end
+ *   weechat_relay_parse_infolist_start
+ *   weechat_relay_parse_infolist_items
+ *   weechat_relay_parse_infolist_columns_items
+ */
+
+TEST(LibParse, HandleContainers)
+{
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_parse_handle *handle;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_obj *ptr_obj, obj_key;
+    int flags[3], i, steps, max_steps_container;
+
+    msg = build_message_big_containers ();
+
+    flags[0] = 0;
+    flags[1] = WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS;
+    flags[2] = WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS;
+    for (i = 0; i < 3; i++)
+    {
+        handle = weechat_relay_parse_handle_new (msg->data, msg->data_size,
+                                                 flags[i]);
+        CHECK(handle);
+
+        /* first step: 100 entries of hashtable */
+        LONGS_EQUAL(1, weechat_relay_parse_handle_step (handle, 100, 0));
+        LONGS_EQUAL(0, handle->parsed_msg->num_objects);
+        CHECK(handle->container);
+        LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_HASHTABLE, handle->container->type);
+        LONGS_EQUAL(100, handle->container_index);
+
+        /* each container is read in multiple steps */
+        steps = 1;
+        max_steps_container = 0;
+        while (weechat_relay_parse_handle_step (handle, 100, 0) == 1)
+        {
+            steps++;
+            if (handle->container)
+                max_steps_container++;
+        }
+        CHECK(steps >= 30);
+        CHECK(max_steps_container >= 25);
+
+        parsed_msg = weechat_relay_parse_handle_finish (handle);
+        CHECK(parsed_msg);
+        LONGS_EQUAL(3, parsed_msg->num_objects);
+        obj_key.type = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+        obj_key.value_integer = 999;
+        ptr_obj = weechat_relay_obj_hashtable_get (
+            &parsed_msg->objects[0]->value_hashtable, &obj_key);
+        CHECK(ptr_obj);
+        STRCMP_EQUAL("value_999", ptr_obj->value_string);
+        ptr_obj = parsed_msg->objects[1];
+        LONGS_EQUAL(1000, ptr_obj->value_array.count);
+        STRCMP_EQUAL("item_999", ptr_obj->value_array.values[999]->value_string);
+        ptr_obj = parsed_msg->objects[2];
+        LONGS_EQUAL(1000, ptr_obj->value_infolist.count);
+        if (flags[i] & WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS)
+        {
+            CHECK(ptr_obj->value_infolist.columns);
+            STRCMP_EQUAL("buffer_999",
+                          ((char **)ptr_obj->value_infolist.columns[1])[999]);
+        }
+        else
+        {
+            STRCMP_EQUAL(
+                "buffer_999",
+                ptr_obj->value_infolist.items[999]->variables[1]->value->value_string);
+        }
+        check_message_same_bytes (parsed_msg, msg);
+        weechat_relay_parse_msg_free (parsed_msg);
+    }
+
+    /* abort the parse in the middle of each container */
+    for (i = 1; i < 24; i++)
+    {
+        handle = weechat_relay_parse_handle_new (msg->data, msg->data_size,
+                                                 WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+        LONGS_EQUAL(1, weechat_relay_parse_handle_step (handle, 123 * i, 0));
+        CHECK(handle->container);
+        weechat_relay_parse_handle_free (handle);
+    }
+
+    weechat_relay_msg_free (msg);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_handle_new (compressed message)
+ *   weechat_relay_parse_handle_step (compressed message)
+ *   weechat_relay_parse_handle_decompress
+ */
+
+TEST(LibParse, HandleCompressed)
+{
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_parse_handle *handle;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_msg *msg2;
+    void *compressed;
+    size_t size;
+    int i, j, steps, flags[2];
+
+    msg = build_message_big_containers ();
+    flags[0] = 0;
+    flags[1] = WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH
+        | WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS;
+
+    for (i = 0; i < 2; i++)
+    {
+        compressed = (i == 0) ?
+            weechat_relay_msg_compress_zlib (msg, 5, &size) :
+            weechat_relay_msg_compress_zstd (msg, 5, &size);
+        CHECK(compressed);
+        for (j = 0; j < 2; j++)
+        {
+            handle = weechat_relay_parse_handle_new (compressed, size,
+                                                     flags[j]);
+            CHECK(handle);
+            STRCMP_EQUAL("containers", handle->parsed_msg->id);
+
+            /* only the beginning of message is decompressed */
+            LONGS_EQUAL(1, weechat_relay_parse_handle_step (handle, 10, 0));
+            CHECK(handle->container);
+            CHECK(handle->parsed_msg->size
+                  < (size_t)msg->data_size - 5);
+
+            steps = 1;
+            while (weechat_relay_parse_handle_step (handle, 100, 0) == 1)
+            {
+                steps++;
+            }
+            CHECK(steps >= 30);
+            LONGS_EQUAL(msg->data_size - 5, handle->parsed_msg->size);
+            parsed_msg = weechat_relay_parse_handle_finish (handle);
+            CHECK(parsed_msg);
+            LONGS_EQUAL(3, parsed_msg->num_objects);
+            check_message_same_bytes (parsed_msg, msg);
+            if (flags[j] & WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH)
+            {
+                /* bytes kept after the moves of decompressed data */
+                CHECK(parsed_msg->objects[2]->wire);
+                msg2 = weechat_relay_msg_new_parsed (parsed_msg);
+                LONGS_EQUAL(msg->data_size, msg2->data_size);
+                MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+                weechat_relay_msg_free (msg2);
+            }
+            weechat_relay_parse_msg_free (parsed_msg);
+        }
+
+        free (compressed);
+    }
+
+    /*
+     * truncated compressed message (zlib): objects before the error are kept
+     * (with zstd, the single block of data can not be decompressed at all)
+     */
+    compressed = weechat_relay_msg_compress_zlib (msg, 5, &size);
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_parse_handle_new (compressed, size - 100, 0));
+    size -= 100;
+    ((unsigned char *)compressed)[0] = (size >> 24) & 0xFF;
+    ((unsigned char *)compressed)[1] = (size >> 16) & 0xFF;
+    ((unsigned char *)compressed)[2] = (size >> 8) & 0xFF;
+    ((unsigned char *)compressed)[3] = size & 0xFF;
+    handle = weechat_relay_parse_handle_new (compressed, size, 0);
+    CHECK(handle);
+    parsed_msg = weechat_relay_parse_handle_finish (handle);
+    CHECK(parsed_msg);
+    CHECK(parsed_msg->num_objects >= 1);
+    CHECK(parsed_msg->num_objects < 3);
+    weechat_relay_parse_msg_free (parsed_msg);
+    free (compressed);
+
+    weechat_relay_msg_free (msg);
+}
+
+/*
+ * Builds a message with an integer, a hashtable and an array of strings
+ * ("value" is the value of key "b" in hashtable).
+ */
+
+static struct t_weechat_relay_msg *
+build_message_passthrough (const char *value)
+{
+    struct t_weechat_relay_msg *msg;
+
+    msg = weechat_relay_msg_new ("test");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg, 123);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_integer (msg, 2);
+    weechat_relay_msg_add_string (msg, "a");
+    weechat_relay_msg_add_string (msg, "1");
+    weechat_relay_msg_add_string (msg, "b");
+    weechat_relay_msg_add_string (msg, value);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_ARRAY);
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_integer (msg, 2);
+    weechat_relay_msg_add_string (msg, "x");
+    weechat_relay_msg_add_string (msg, "y");
+
+    return msg;
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_set_wire
+ *   weechat_relay_parse_msg_set_dirty
+ *   weechat_relay_obj_set_dirty
+ *   weechat_relay_msg_new_parsed
+ *   weechat_relay_parse_iov_flatten
+ */
+
+TEST(LibParse, Passthrough)
+{
+    struct t_weechat_relay_msg *msg, *msg_modified, *msg2;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_parse_handle *handle;
+    struct t_weechat_relay_obj *ptr_obj, *obj_other;
+    void *compressed;
+    size_t size;
+
+    POINTERS_EQUAL(NULL, weechat_relay_msg_new_parsed (NULL));
+    LONGS_EQUAL(0, weechat_relay_parse_msg_set_dirty (NULL, NULL));
+
+    msg = build_message_passthrough ("22");
+    msg_modified = build_message_passthrough ("333");
+
+    /* objects keep their bytes: same message, even if values are changed */
+    parsed_msg = weechat_relay_parse_message_flags (
+        msg->data, msg->data_size, WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(3, parsed_msg->num_objects);
+    ptr_obj = parsed_msg->objects[0];
+    POINTERS_EQUAL((const char *)parsed_msg->buffer + 11, ptr_obj->wire);
+    LONGS_EQUAL(4, ptr_obj->wire_size);
+    ptr_obj = parsed_msg->objects[1]->value_hashtable.values[1];
+    CHECK(ptr_obj->wire);
+    LONGS_EQUAL(6, ptr_obj->wire_size);
+    parsed_msg->objects[0]->value_integer = 456;
+    msg2 = weechat_relay_msg_new_parsed (parsed_msg);
+    CHECK(msg2);
+    LONGS_EQUAL(msg->data_size, msg2->data_size);
+    MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* value changed in hashtable: only the hashtable is built again */
+    parsed_msg = weechat_relay_parse_message_flags (
+        msg->data, msg->data_size, WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH);
+    CHECK(parsed_msg);
+    ptr_obj = parsed_msg->objects[1]->value_hashtable.values[1];
+    free (ptr_obj->value_string);
+    ptr_obj->value_string = strdup ("333");
+    obj_other = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(0, weechat_relay_parse_msg_set_dirty (parsed_msg, obj_other));
+    weechat_relay_obj_free (obj_other);
+    /* message shared: objects can not be marked as modified */
+    weechat_relay_parse_msg_retain (parsed_msg);
+    LONGS_EQUAL(0, weechat_relay_parse_msg_set_dirty (parsed_msg, ptr_obj));
+    LONGS_EQUAL(0, ptr_obj->dirty);
+    weechat_relay_parse_msg_release (parsed_msg);
+    LONGS_EQUAL(1, weechat_relay_parse_msg_set_dirty (parsed_msg, ptr_obj));
+    LONGS_EQUAL(0, parsed_msg->objects[0]->dirty);
+    LONGS_EQUAL(1, parsed_msg->objects[1]->dirty);
+    LONGS_EQUAL(1, ptr_obj->dirty);
+    LONGS_EQUAL(0, parsed_msg->objects[1]->value_hashtable.keys[1]->dirty);
+    LONGS_EQUAL(0, parsed_msg->objects[2]->dirty);
+    msg2 = weechat_relay_msg_new_parsed (parsed_msg);
+    CHECK(msg2);
+    LONGS_EQUAL(msg_modified->data_size, msg2->data_size);
+    MEMCMP_EQUAL(msg_modified->data, msg2->data, msg_modified->data_size);
+    weechat_relay_msg_free (msg2);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* without flag: no bytes kept, objects are built again */
+    parsed_msg = weechat_relay_parse_message (msg->data, msg->data_size);
+    CHECK(parsed_msg);
+    POINTERS_EQUAL(NULL, parsed_msg->objects[1]->wire);
+    msg2 = weechat_relay_msg_new_parsed (parsed_msg);
+    MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /*
+     * message from segments, not compressed: segments are copied in the
+     * message, so the bytes are kept after the segments are freed
+     */
+    parsed_msg = parse_message_segments (msg->data, msg->data_size, 3,
+                                         WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH);
+    CHECK(parsed_msg);
+    CHECK(parsed_msg->message);
+    POINTERS_EQUAL(NULL, parsed_msg->iov);
+    MEMCMP_EQUAL(msg->data, parsed_msg->message, msg->data_size);
+    POINTERS_EQUAL((const char *)parsed_msg->message + 5 + 11,
+                   parsed_msg->objects[0]->wire);
+    CHECK(parsed_msg->objects[1]->wire);
+    parsed_msg->objects[0]->value_integer = 456;
+    msg2 = weechat_relay_msg_new_parsed (parsed_msg);
+    CHECK(msg2);
+    LONGS_EQUAL(msg->data_size, msg2->data_size);
+    MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* message from segments without flag: segments are not copied */
+    parsed_msg = parse_message_segments (msg->data, msg->data_size, 3, 0);
+    CHECK(parsed_msg);
+    POINTERS_EQUAL(NULL, parsed_msg->message);
+    POINTERS_EQUAL(NULL, parsed_msg->objects[1]->wire);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* compressed message: same message, not compressed */
+    compressed = weechat_relay_msg_compress_zlib (msg, 5, &size);
+    CHECK(compressed);
+    parsed_msg = weechat_relay_parse_message_flags (
+        compressed, size, WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH);
+    CHECK(parsed_msg);
+    CHECK(parsed_msg->objects[1]->wire);
+    msg2 = weechat_relay_msg_new_parsed (parsed_msg);
+    LONGS_EQUAL(msg->data_size, msg2->data_size);
+    MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+    weechat_relay_parse_msg_free (parsed_msg);
+    free (compressed);
+
+    /* parse in multiple steps: hdata keeps its bytes too */
+    weechat_relay_msg_free (msg);
+    msg = build_message_big_hdata ();
+    handle = weechat_relay_parse_handle_new (
+        msg->data, msg->data_size, WEECHAT_RELAY_PARSE_FLAG_PASSTHROUGH);
+    while (weechat_relay_parse_handle_step (handle, 100, 0) == 1)
+    {
+    }
+    parsed_msg = weechat_relay_parse_handle_finish (handle);
+    CHECK(parsed_msg);
+    CHECK(parsed_msg->objects[1]->wire);
+    msg2 = weechat_relay_msg_new_parsed (parsed_msg);
+    LONGS_EQUAL(msg->data_size, msg2->data_size);
+    MEMCMP_EQUAL(msg->data, msg2->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    weechat_relay_msg_free (msg);
+    weechat_relay_msg_free (msg_modified);
+}
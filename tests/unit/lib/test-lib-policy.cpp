@@ -0,0 +1,279 @@
+/*
+ * test-lib-policy.cpp - test policy to compress messages
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include "tests/tests.h"
+#include "lib/weechat-relay.h"
+#include "lib/policy.h"
+}
+
+TEST_GROUP(LibPolicy)
+{
+};
+
+/*
+ * Tests functions:
+ *   weechat_relay_policy_new
+ *   weechat_relay_policy_free
+ */
+
+TEST(LibPolicy, NewFree)
+{
+    struct t_weechat_relay_policy *policy;
+
+    POINTERS_EQUAL(NULL,
+                   weechat_relay_policy_new (WEECHAT_RELAY_NUM_COMPRESSIONS));
+
+    policy = weechat_relay_policy_new (WEECHAT_RELAY_COMPRESSION_ZSTD);
+    CHECK(policy);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD, policy->compression);
+    LONGS_EQUAL(3, policy->level);
+    LONGS_EQUAL(1, policy->level_fast);
+    LONGS_EQUAL(9, policy->level_big);
+    LONGS_EQUAL(WEECHAT_RELAY_POLICY_MIN_SIZE, policy->min_size);
+    LONGS_EQUAL(WEECHAT_RELAY_POLICY_BIG_SIZE, policy->big_size);
+    DOUBLES_EQUAL(WEECHAT_RELAY_POLICY_MAX_RATIO, policy->max_ratio, 0.001);
+    LONGS_EQUAL(WEECHAT_RELAY_POLICY_PROBE_INTERVAL, policy->probe_interval);
+    LONGS_EQUAL(WEECHAT_RELAY_POLICY_CPU_BUDGET, policy->cpu_budget);
+    LONGS_EQUAL(0, policy->count_level);
+    weechat_relay_policy_free (policy);
+
+    policy = weechat_relay_policy_new (WEECHAT_RELAY_COMPRESSION_ZLIB);
+    CHECK(policy);
+    LONGS_EQUAL(6, policy->level);
+    weechat_relay_policy_free (policy);
+
+    weechat_relay_policy_free (NULL);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_policy_choose_time
+ *   weechat_relay_policy_update
+ */
+
+TEST(LibPolicy, Choose)
+{
+    struct t_weechat_relay_policy *policy;
+    long long now;
+    int i, level;
+
+    now = 10000000;
+
+    policy = weechat_relay_policy_new (WEECHAT_RELAY_COMPRESSION_OFF);
+    level = -1;
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF,
+                weechat_relay_policy_choose_time (policy, 100000, now,
+                                                  &level));
+    LONGS_EQUAL(0, level);
+    weechat_relay_policy_free (policy);
+
+    policy = weechat_relay_policy_new (WEECHAT_RELAY_COMPRESSION_ZSTD);
+
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF,
+                weechat_relay_policy_choose_time (NULL, 1000, now, &level));
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF,
+                weechat_relay_policy_choose_time (policy, 1000, now, NULL));
+
+    /* small message */
+    level = -1;
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF,
+                weechat_relay_policy_choose_time (policy, 80, now, &level));
+    LONGS_EQUAL(0, level);
+    LONGS_EQUAL(1, policy->count_small);
+
+    /* normal and big messages */
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD,
+                weechat_relay_policy_choose_time (policy, 1000, now, &level));
+    LONGS_EQUAL(3, level);
+    LONGS_EQUAL(1, policy->count_level);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD,
+                weechat_relay_policy_choose_time (policy, 1024 * 1024, now,
+                                                  &level));
+    LONGS_EQUAL(9, level);
+    LONGS_EQUAL(1, policy->count_big);
+
+    /* statistics: first message, then moving averages */
+    weechat_relay_policy_update (policy, 1000, 250, 10);
+    DOUBLES_EQUAL(0.25, policy->avg_ratio, 0.0001);
+    DOUBLES_EQUAL(100, policy->avg_speed, 0.0001);
+    LONGS_EQUAL(10, policy->budget_used);
+    weechat_relay_policy_update (policy, 1000, 1000, 5);
+    DOUBLES_EQUAL(0.25 + 0.75 * WEECHAT_RELAY_POLICY_AVG_WEIGHT,
+                  policy->avg_ratio, 0.0001);
+    DOUBLES_EQUAL(100 + 100 * WEECHAT_RELAY_POLICY_AVG_WEIGHT,
+                  policy->avg_speed, 0.0001);
+    LONGS_EQUAL(15, policy->budget_used);
+    LONGS_EQUAL(15, policy->time_compress);
+
+    /* CPU budget: fast level if the budget left is short, then nothing */
+    policy->budget_used = policy->cpu_budget - 50;
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD,
+                weechat_relay_policy_choose_time (policy, 1000, now, &level));
+    LONGS_EQUAL(3, level);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD,
+                weechat_relay_policy_choose_time (policy, 100000, now,
+                                                  &level));
+    LONGS_EQUAL(1, level);
+    LONGS_EQUAL(1, policy->count_fast);
+    policy->budget_used = policy->cpu_budget;
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF,
+                weechat_relay_policy_choose_time (policy, 1000, now, &level));
+    LONGS_EQUAL(1, policy->count_budget);
+
+    /* budget is reset after one second */
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD,
+                weechat_relay_policy_choose_time (policy, 1000,
+                                                  now + 1000000, &level));
+    LONGS_EQUAL(0, policy->budget_used);
+    LONGS_EQUAL(now + 1000000, policy->budget_start);
+
+    /* no CPU limit */
+    policy->cpu_budget = 0;
+    policy->budget_used = 1000000;
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD,
+                weechat_relay_policy_choose_time (policy, 1000,
+                                                  now + 1000000, &level));
+    LONGS_EQUAL(3, level);
+
+    /* bad ratio: one probe with fast level every "probe_interval" messages */
+    policy->probe_interval = 4;
+    weechat_relay_policy_update (policy, 1000, 1010, 5);
+    policy->avg_ratio = 1.01;
+    weechat_relay_policy_update (policy, 1000, 1010, 5);
+    LONGS_EQUAL(4, policy->probe_countdown);
+    for (i = 0; i < 4; i++)
+    {
+        LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF,
+                    weechat_relay_policy_choose_time (policy, 1000,
+                                                      now + 1000000, &level));
+    }
+    LONGS_EQUAL(4, policy->count_ratio);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD,
+                weechat_relay_policy_choose_time (policy, 1000,
+                                                  now + 1000000, &level));
+    LONGS_EQUAL(1, level);
+    LONGS_EQUAL(1, policy->count_probe);
+
+    /* good ratio measured by the probe: compression again */
+    weechat_relay_policy_update (policy, 1000, 100, 5);
+    policy->avg_ratio = 0.1;
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD,
+                weechat_relay_policy_choose_time (policy, 1000,
+                                                  now + 1000000, &level));
+    LONGS_EQUAL(3, level);
+
+    weechat_relay_policy_free (policy);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_policy_compress
+ */
+
+TEST(LibPolicy, Compress)
+{
+    struct t_weechat_relay_policy *policy;
+    struct t_weechat_relay_msg_compress_ctx *ctx;
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    const void *buffer;
+    char str_line[128];
+    size_t size, size_small;
+    unsigned int seed;
+    int i;
+
+    policy = weechat_relay_policy_new (WEECHAT_RELAY_COMPRESSION_ZLIB);
+    ctx = weechat_relay_msg_compress_ctx_new ();
+
+    /* small message: not compressed */
+    msg = weechat_relay_msg_new ("_pong");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_string (msg, "abc");
+    POINTERS_EQUAL(NULL, weechat_relay_policy_compress (NULL, ctx, msg,
+                                                        &size));
+    POINTERS_EQUAL(NULL, weechat_relay_policy_compress (policy, NULL, msg,
+                                                        &size));
+    POINTERS_EQUAL(NULL, weechat_relay_policy_compress (policy, ctx, NULL,
+                                                        &size));
+    POINTERS_EQUAL(NULL, weechat_relay_policy_compress (policy, ctx, msg,
+                                                        NULL));
+    buffer = weechat_relay_policy_compress (policy, ctx, msg, &size);
+    POINTERS_EQUAL(msg->data, buffer);
+    LONGS_EQUAL(msg->data_size, size);
+    LONGS_EQUAL(1, policy->count_small);
+    LONGS_EQUAL(size, policy->bytes_in);
+    LONGS_EQUAL(size, policy->bytes_out);
+    size_small = size;
+    weechat_relay_msg_free (msg);
+
+    /* compressible message */
+    msg = weechat_relay_msg_new ("_nicklist");
+    for (i = 0; i < 200; i++)
+    {
+        snprintf (str_line, sizeof (str_line), "nick number %d", i);
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+        weechat_relay_msg_add_string (msg, str_line);
+    }
+    buffer = weechat_relay_policy_compress (policy, ctx, msg, &size);
+    CHECK(buffer);
+    CHECK(buffer != msg->data);
+    CHECK(size < msg->data_size / 2);
+    LONGS_EQUAL(1, policy->count_level);
+    CHECK(policy->avg_ratio > 0);
+    CHECK(policy->avg_ratio < 0.5);
+    CHECK(policy->avg_speed > 0);
+    CHECK(policy->time_compress > 0);
+    LONGS_EQUAL(size_small + msg->data_size, policy->bytes_in);
+    LONGS_EQUAL(size_small + size, policy->bytes_out);
+    parsed_msg = weechat_relay_parse_message (buffer, size);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZLIB, parsed_msg->compression);
+    LONGS_EQUAL(200, parsed_msg->num_objects);
+    weechat_relay_parse_msg_free (parsed_msg);
+    weechat_relay_msg_free (msg);
+
+    /* random bytes: compressed message is bigger, message is sent as-is */
+    msg = weechat_relay_msg_new ("random");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_integer (msg, 1000);
+    seed = 42;
+    for (i = 0; i < 1000; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        weechat_relay_msg_add_char (msg, (char)(seed >> 16));
+    }
+    buffer = weechat_relay_policy_compress (policy, ctx, msg, &size);
+    POINTERS_EQUAL(msg->data, buffer);
+    LONGS_EQUAL(msg->data_size, size);
+    LONGS_EQUAL(1, policy->count_bigger);
+    weechat_relay_msg_free (msg);
+
+    weechat_relay_msg_compress_ctx_free (ctx);
+    weechat_relay_policy_free (policy);
+}
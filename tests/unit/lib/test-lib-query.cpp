@@ -0,0 +1,447 @@
+/*
+ * test-lib-query.cpp - test queries on parsed messages
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include "string.h"
+#include "tests/tests.h"
+#include "lib/weechat-relay.h"
+#include "lib/object.h"
+#include "lib/query.h"
+}
+
+#define QUERY_CHECK_GET(__path, __type)                                 \
+    query = weechat_relay_query_compile (__path);                       \
+    CHECK(query);                                                       \
+    weechat_relay_query_state_init (&state);                            \
+    obj = weechat_relay_query_get (query, &state, parsed_msg);          \
+    CHECK(obj);                                                         \
+    LONGS_EQUAL(__type, obj->type);
+
+#define QUERY_CHECK_NOT_FOUND(__path)                                   \
+    query = weechat_relay_query_compile (__path);                       \
+    CHECK(query);                                                       \
+    weechat_relay_query_state_init (&state);                            \
+    POINTERS_EQUAL(NULL,                                                \
+                   weechat_relay_query_get (query, &state, parsed_msg)); \
+    LONGS_EQUAL(0, weechat_relay_query_exec (query, &state, parsed_msg, \
+                                             NULL, NULL));              \
+    weechat_relay_query_free (query);
+
+TEST_GROUP(LibQuery)
+{
+    static int callback_concat (void *data, struct t_weechat_relay_obj *obj)
+    {
+        strcat ((char *)data, obj->value_string);
+        return 1;
+    }
+};
+
+/*
+ * Tests functions:
+ *   weechat_relay_query_is_index
+ */
+
+TEST(LibQuery, IsIndex)
+{
+    LONGS_EQUAL(0, weechat_relay_query_is_index (NULL));
+    LONGS_EQUAL(0, weechat_relay_query_is_index (""));
+    LONGS_EQUAL(0, weechat_relay_query_is_index ("a"));
+    LONGS_EQUAL(0, weechat_relay_query_is_index ("-1"));
+    LONGS_EQUAL(0, weechat_relay_query_is_index ("1a"));
+
+    LONGS_EQUAL(1, weechat_relay_query_is_index ("0"));
+    LONGS_EQUAL(1, weechat_relay_query_is_index ("123"));
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_query_compile
+ *   weechat_relay_query_compile_step
+ *   weechat_relay_query_free
+ */
+
+TEST(LibQuery, CompileFree)
+{
+    struct t_weechat_relay_query *query;
+
+    weechat_relay_query_free (NULL);
+
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile (NULL));
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile (""));
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile ("/"));
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile ("0/"));
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile ("0//hda"));
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile ("htb[]"));
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile ("htb[nick"));
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile ("htb[nick]x"));
+
+    query = weechat_relay_query_compile ("0/hda/*/message");
+    CHECK(query);
+    STRCMP_EQUAL("0/hda/*/message", query->path);
+    LONGS_EQUAL(4, query->num_steps);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_INDEX, query->steps[0].type);
+    LONGS_EQUAL(0, query->steps[0].index);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_TYPE, query->steps[1].type);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_HDATA, query->steps[1].obj_type);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_ALL, query->steps[2].type);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_NAME, query->steps[3].type);
+    STRCMP_EQUAL("message", query->steps[3].name);
+    weechat_relay_query_free (query);
+
+    query = weechat_relay_query_compile ("htb[nick]");
+    CHECK(query);
+    LONGS_EQUAL(2, query->num_steps);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_TYPE, query->steps[0].type);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_HASHTABLE, query->steps[0].obj_type);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_KEY, query->steps[1].type);
+    STRCMP_EQUAL("nick", query->steps[1].name);
+    weechat_relay_query_free (query);
+
+    query = weechat_relay_query_compile ("12/[a/b");
+    POINTERS_EQUAL(NULL, query);
+
+    query = weechat_relay_query_compile ("12/[ab]");
+    CHECK(query);
+    LONGS_EQUAL(2, query->num_steps);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_INDEX, query->steps[0].type);
+    LONGS_EQUAL(12, query->steps[0].index);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_KEY, query->steps[1].type);
+    STRCMP_EQUAL("ab", query->steps[1].name);
+    weechat_relay_query_free (query);
+    /* "/" in a key */
+    query = weechat_relay_query_compile ("1/htb[irc/libera]/0");
+    CHECK(query);
+    LONGS_EQUAL(4, query->num_steps);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_INDEX, query->steps[0].type);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_TYPE, query->steps[1].type);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_KEY, query->steps[2].type);
+    STRCMP_EQUAL("irc/libera", query->steps[2].name);
+    LONGS_EQUAL(WEECHAT_RELAY_QUERY_STEP_INDEX, query->steps[3].type);
+    LONGS_EQUAL(0, query->steps[3].index);
+    weechat_relay_query_free (query);
+    query = weechat_relay_query_compile ("[a/b/c]");
+    CHECK(query);
+    LONGS_EQUAL(1, query->num_steps);
+    STRCMP_EQUAL("a/b/c", query->steps[0].name);
+    weechat_relay_query_free (query);
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile ("htb[a/b"));
+    POINTERS_EQUAL(NULL, weechat_relay_query_compile ("htb[a/b]/"));
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_query_key_match
+ */
+
+TEST(LibQuery, KeyMatch)
+{
+    struct t_weechat_relay_obj *obj;
+
+    LONGS_EQUAL(0, weechat_relay_query_key_match (NULL, "abc"));
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_STRING);
+    LONGS_EQUAL(0, weechat_relay_query_key_match (obj, "abc"));
+    obj->value_string = strdup ("abc");
+    LONGS_EQUAL(1, weechat_relay_query_key_match (obj, "abc"));
+    LONGS_EQUAL(0, weechat_relay_query_key_match (obj, "abcd"));
+    weechat_relay_obj_free (obj);
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    obj->value_integer = -123;
+    LONGS_EQUAL(1, weechat_relay_query_key_match (obj, "-123"));
+    LONGS_EQUAL(0, weechat_relay_query_key_match (obj, "123"));
+    LONGS_EQUAL(0, weechat_relay_query_key_match (obj, "-123a"));
+    weechat_relay_obj_free (obj);
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_POINTER);
+    obj->value_pointer = (void *)0x1a2b;
+    LONGS_EQUAL(1, weechat_relay_query_key_match (obj, "1a2b"));
+    LONGS_EQUAL(1, weechat_relay_query_key_match (obj, "0x1a2b"));
+    LONGS_EQUAL(0, weechat_relay_query_key_match (obj, "1a2c"));
+    weechat_relay_obj_free (obj);
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_TIME);
+    obj->value_time = 1640091762;
+    LONGS_EQUAL(1, weechat_relay_query_key_match (obj, "1640091762"));
+    LONGS_EQUAL(0, weechat_relay_query_key_match (obj, "1640091763"));
+    weechat_relay_obj_free (obj);
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_CHAR);
+    LONGS_EQUAL(0, weechat_relay_query_key_match (obj, "a"));
+    weechat_relay_obj_free (obj);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_query_exec
+ *   weechat_relay_query_get
+ */
+
+TEST(LibQuery, Exec)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_query *query;
+    struct t_weechat_relay_query_state state;
+    struct t_weechat_relay_obj *obj;
+    unsigned char msg[] = {
+        0x00, 0x00, 0x00, 14 + 75 + 3 + 32 + 3 + 62 + 3 + 21,
+        0x00,
+        0x00, 0x00, 0x00, 0x02, 'i', 'd',
+        'h', 'd', 'a', OBJ_HDATA,
+        'h', 't', 'b', OBJ_HASHTABLE,
+        'i', 'n', 'l', OBJ_INFOLIST
+        'a', 'r', 'r', OBJ_ARRAY
+    };
+    struct t_weechat_relay_msg *msg_htb;
+    char result[256];
+
+    parsed_msg = weechat_relay_parse_message (msg, sizeof (msg));
+    CHECK(parsed_msg);
+    LONGS_EQUAL(4, parsed_msg->num_objects);
+
+    LONGS_EQUAL(0, weechat_relay_query_exec (NULL, NULL, NULL, NULL, NULL));
+    POINTERS_EQUAL(NULL, weechat_relay_query_get (NULL, NULL, NULL));
+
+    /* objects in message */
+    QUERY_CHECK_GET("0", WEECHAT_RELAY_OBJ_TYPE_HDATA);
+    LONGS_EQUAL(1, weechat_relay_query_exec (query, &state, parsed_msg,
+                                             NULL, NULL));
+    POINTERS_EQUAL(NULL, weechat_relay_query_get (query, &state, NULL));
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("3/arr", WEECHAT_RELAY_OBJ_TYPE_ARRAY);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("*", WEECHAT_RELAY_OBJ_TYPE_HDATA);
+    LONGS_EQUAL(4, weechat_relay_query_exec (query, &state, parsed_msg,
+                                             NULL, NULL));
+    weechat_relay_query_free (query);
+    QUERY_CHECK_NOT_FOUND("4");
+    QUERY_CHECK_NOT_FOUND("0/htb");
+
+    /* hdata */
+    QUERY_CHECK_GET("0/hda/1/k1", WEECHAT_RELAY_OBJ_TYPE_STRING);
+    STRCMP_EQUAL("xy", obj->value_string);
+    LONGS_EQUAL(0, state.cached_index[3]);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("hda/0/k2", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(5, obj->value_integer);
+    LONGS_EQUAL(1, state.cached_index[2]);
+    /* evaluate again: cached index is used */
+    obj = weechat_relay_query_get (query, &state, parsed_msg);
+    LONGS_EQUAL(5, obj->value_integer);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("0/0/2", WEECHAT_RELAY_OBJ_TYPE_CHAR);
+    LONGS_EQUAL('F', obj->value_char);
+    weechat_relay_query_free (query);
+    query = weechat_relay_query_compile ("0/hda/*/k1");
+    result[0] = '\0';
+    LONGS_EQUAL(2, weechat_relay_query_exec (query, &state, parsed_msg,
+                                             &callback_concat, result));
+    STRCMP_EQUAL("abxy", result);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_NOT_FOUND("0/hda/2/k1");
+    QUERY_CHECK_NOT_FOUND("0/hda/0/k4");
+    QUERY_CHECK_NOT_FOUND("0/hda/0");
+    QUERY_CHECK_NOT_FOUND("0/hda/k1");
+
+    /* hashtable */
+    QUERY_CHECK_GET("1/htb[def]", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(2, obj->value_integer);
+    LONGS_EQUAL(1, state.cached_index[2]);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("1/abc", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(1, obj->value_integer);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("1/1", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(2, obj->value_integer);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_NOT_FOUND("1/htb[xyz]");
+    QUERY_CHECK_NOT_FOUND("htb[abc]");
+
+    /* infolist */
+    QUERY_CHECK_GET("2/inl/1/ghi", WEECHAT_RELAY_OBJ_TYPE_STRING);
+    POINTERS_EQUAL(NULL, obj->value_string);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("2/inl/0/abc", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(8, obj->value_integer);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("2/1/0", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(4, obj->value_integer);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_NOT_FOUND("2/inl/0/def");
+
+    /* array */
+    QUERY_CHECK_GET("3/arr/1", WEECHAT_RELAY_OBJ_TYPE_STRING);
+    STRCMP_EQUAL("def", obj->value_string);
+    weechat_relay_query_free (query);
+    query = weechat_relay_query_compile ("3/*/str");
+    result[0] = '\0';
+    LONGS_EQUAL(2, weechat_relay_query_exec (query, &state, parsed_msg,
+                                             &callback_concat, result));
+    STRCMP_EQUAL("abcdef", result);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_NOT_FOUND("3/arr/2");
+
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* hashtable with "/" in keys */
+    msg_htb = weechat_relay_msg_new ("id");
+    weechat_relay_msg_add_type (msg_htb, WEECHAT_RELAY_OBJ_TYPE_HASHTABLE);
+    weechat_relay_msg_add_type (msg_htb, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_type (msg_htb, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg_htb, 2);
+    weechat_relay_msg_add_string (msg_htb, "irc");
+    weechat_relay_msg_add_integer (msg_htb, 1);
+    weechat_relay_msg_add_string (msg_htb, "irc/libera");
+    weechat_relay_msg_add_integer (msg_htb, 2);
+    parsed_msg = weechat_relay_parse_message (msg_htb->data,
+                                              msg_htb->data_size);
+    CHECK(parsed_msg);
+    QUERY_CHECK_GET("htb[irc/libera]", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(2, obj->value_integer);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("0/[irc]", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(1, obj->value_integer);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_NOT_FOUND("htb[irc/oftc]");
+    weechat_relay_parse_msg_free (parsed_msg);
+    weechat_relay_msg_free (msg_htb);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_query_state_init
+ *   weechat_relay_query_exec (native arrays and columns)
+ */
+
+TEST(LibQuery, ExecNative)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_query *query;
+    struct t_weechat_relay_query_state state, state2;
+    struct t_weechat_relay_obj *obj, *obj2;
+    unsigned char msg[] = {
+        0x00, 0x00, 0x00, 14 + 75 + 3 + 15,
+        0x00,
+        0x00, 0x00, 0x00, 0x02, 'i', 'd',
+        'h', 'd', 'a', OBJ_HDATA,
+        'a', 'r', 'r', 'i', 'n', 't',
+        0x00, 0x00, 0x00, 0x02,
+        0x00, 0x00, 0x00, 0x07,
+        0xFF, 0xFF, 0xFF, 0xFE,
+    };
+
+    parsed_msg = weechat_relay_parse_message_flags (
+        msg, sizeof (msg), WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(2, parsed_msg->num_objects);
+
+    QUERY_CHECK_GET("0/hda/1/k2", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(9, obj->value_integer);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("0/0/2", WEECHAT_RELAY_OBJ_TYPE_CHAR);
+    LONGS_EQUAL('F', obj->value_char);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("0/1/k1", WEECHAT_RELAY_OBJ_TYPE_STRING);
+    STRCMP_EQUAL("xy", obj->value_string);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("1/arr/1", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(-2, obj->value_integer);
+    weechat_relay_query_free (query);
+    query = weechat_relay_query_compile ("1/*/int");
+    LONGS_EQUAL(2, weechat_relay_query_exec (query, &state, parsed_msg,
+                                             NULL, NULL));
+    weechat_relay_query_free (query);
+    QUERY_CHECK_NOT_FOUND("1/2");
+
+    /* same compiled query evaluated with two states */
+    query = weechat_relay_query_compile ("1/arr/0");
+    weechat_relay_query_state_init (&state);
+    weechat_relay_query_state_init (&state2);
+    obj = weechat_relay_query_get (query, &state, parsed_msg);
+    obj2 = weechat_relay_query_get (query, &state2, parsed_msg);
+    POINTERS_EQUAL(&state.value_native, obj);
+    POINTERS_EQUAL(&state2.value_native, obj2);
+    LONGS_EQUAL(7, obj->value_integer);
+    LONGS_EQUAL(7, obj2->value_integer);
+    POINTERS_EQUAL(NULL, weechat_relay_query_get (query, NULL, parsed_msg));
+    LONGS_EQUAL(1, weechat_relay_query_exec (query, NULL, parsed_msg,
+                                             NULL, NULL));
+    weechat_relay_query_free (query);
+
+    weechat_relay_parse_msg_free (parsed_msg);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_query_exec (columnar infolist)
+ */
+
+TEST(LibQuery, ExecColumnarInfolist)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_query *query;
+    struct t_weechat_relay_query_state state;
+    struct t_weechat_relay_obj *obj;
+    unsigned char msg[] = {
+        0x00, 0x00, 0x00, 14 + 48,
+        0x00,
+        0x00, 0x00, 0x00, 0x02, 'i', 'd',
+        'i', 'n', 'l',
+        0x00, 0x00, 0x00, 0x04, 't', 'e', 's', 't',
+        0x00, 0x00, 0x00, 0x02,
+        0x00, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x03, 'a', 'b', 'c', 'i', 'n', 't',
+        0x00, 0x00, 0x00, 0x08,
+        0x00, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x03, 'a', 'b', 'c', 'i', 'n', 't',
+        0x00, 0x00, 0x00, 0x09,
+    };
+
+    parsed_msg = weechat_relay_parse_message_flags (
+        msg, sizeof (msg), WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    POINTERS_EQUAL(NULL, parsed_msg->objects[0]->value_infolist.items);
+
+    QUERY_CHECK_GET("inl/1/abc", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(9, obj->value_integer);
+    LONGS_EQUAL(0, state.cached_index[2]);
+    weechat_relay_query_free (query);
+    QUERY_CHECK_GET("0/0/0", WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    LONGS_EQUAL(8, obj->value_integer);
+    weechat_relay_query_free (query);
+    query = weechat_relay_query_compile ("inl/*/*");
+    LONGS_EQUAL(2, weechat_relay_query_exec (query, &state, parsed_msg,
+                                             NULL, NULL));
+    weechat_relay_query_free (query);
+    QUERY_CHECK_NOT_FOUND("inl/0/def");
+    QUERY_CHECK_NOT_FOUND("inl/0/1");
+
+    /* values were read in native columns: no object built */
+    POINTERS_EQUAL(NULL, parsed_msg->objects[0]->value_infolist.objects);
+
+    weechat_relay_parse_msg_free (parsed_msg);
+}
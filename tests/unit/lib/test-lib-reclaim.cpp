@@ -0,0 +1,121 @@
+/*
+ * test-lib-value.cpp - test compact values
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include "tests/tests.h"
+#include "lib/weechat-relay.h"
+#include "lib/parse.h"
+}
+
+TEST_GROUP(LibReclaim)
+{
+};
+
+/*
+ * Tests functions:
+ *   weechat_relay_reclaim_new
+ *   weechat_relay_reclaim_release
+ *   weechat_relay_reclaim_flush
+ *   weechat_relay_reclaim_get_counters
+ *   weechat_relay_reclaim_free
+ */
+
+TEST(LibReclaim, Release)
+{
+    unsigned char message[] = { MESSAGE_HDATA };
+    struct t_weechat_relay_reclaim *reclaim;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    int i, pending_msgs;
+    size_t pending_bytes, freed_bytes;
+    long freed_msgs;
+
+    /* without reclaimer: message is freed immediately */
+    weechat_relay_reclaim_flush (NULL);
+    weechat_relay_reclaim_free (NULL);
+    weechat_relay_reclaim_release (NULL, NULL);
+    parsed_msg = weechat_relay_parse_message (message, sizeof (message));
+    CHECK(parsed_msg);
+    weechat_relay_reclaim_release (NULL, parsed_msg);
+    weechat_relay_reclaim_get_counters (NULL, &pending_msgs, &pending_bytes,
+                                        &freed_msgs, &freed_bytes);
+    LONGS_EQUAL(0, pending_msgs);
+    LONGS_EQUAL(0, pending_bytes);
+    LONGS_EQUAL(0, freed_msgs);
+    LONGS_EQUAL(0, freed_bytes);
+
+    reclaim = weechat_relay_reclaim_new ();
+    CHECK(reclaim);
+
+    weechat_relay_reclaim_release (reclaim, NULL);
+
+    /* message still referenced: not queued */
+    parsed_msg = weechat_relay_parse_message (message, sizeof (message));
+    CHECK(parsed_msg);
+    weechat_relay_parse_msg_retain (parsed_msg);
+    weechat_relay_reclaim_release (reclaim, parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->refcount);
+    weechat_relay_reclaim_flush (reclaim);
+    weechat_relay_reclaim_get_counters (reclaim, NULL, NULL, &freed_msgs, NULL);
+    LONGS_EQUAL(0, freed_msgs);
+
+    /* last reference: freed by the thread */
+    weechat_relay_reclaim_release (reclaim, parsed_msg);
+    weechat_relay_reclaim_flush (reclaim);
+    weechat_relay_reclaim_get_counters (reclaim, &pending_msgs, &pending_bytes,
+                                        &freed_msgs, &freed_bytes);
+    LONGS_EQUAL(0, pending_msgs);
+    LONGS_EQUAL(0, pending_bytes);
+    LONGS_EQUAL(1, freed_msgs);
+    LONGS_EQUAL(sizeof (message), freed_bytes);
+
+    /* many messages */
+    for (i = 0; i < 1000; i++)
+    {
+        parsed_msg = weechat_relay_parse_message (message, sizeof (message));
+        CHECK(parsed_msg);
+        weechat_relay_reclaim_release (reclaim, parsed_msg);
+    }
+    weechat_relay_reclaim_get_counters (reclaim, &pending_msgs, &pending_bytes,
+                                        &freed_msgs, &freed_bytes);
+    LONGS_EQUAL(1001, pending_msgs + freed_msgs);
+    LONGS_EQUAL(1001 * sizeof (message), pending_bytes + freed_bytes);
+    weechat_relay_reclaim_flush (reclaim);
+    weechat_relay_reclaim_get_counters (reclaim, &pending_msgs, &pending_bytes,
+                                        &freed_msgs, &freed_bytes);
+    LONGS_EQUAL(0, pending_msgs);
+    LONGS_EQUAL(0, pending_bytes);
+    LONGS_EQUAL(1001, freed_msgs);
+    LONGS_EQUAL(1001 * sizeof (message), freed_bytes);
+
+    /* messages still queued are freed with the reclaimer */
+    for (i = 0; i < 100; i++)
+    {
+        parsed_msg = weechat_relay_parse_message (message, sizeof (message));
+        CHECK(parsed_msg);
+        weechat_relay_reclaim_release (reclaim, parsed_msg);
+    }
+    weechat_relay_reclaim_free (reclaim);
+}
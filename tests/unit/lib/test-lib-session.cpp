@@ -26,8 +26,15 @@
 extern "C"
 {
 #include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/uio.h>
+#include "tests/tests.h"
 #include "lib/weechat-relay.h"
+#include "lib/parse.h"
+#include "lib/spill.h"
 }
 
 TEST_GROUP(LibSession)
@@ -109,6 +116,144 @@ TEST(LibSession, SendRecv)
     MEMCMP_EQUAL(buffer, read_buffer, 3);
 }
 
+/*
+ * Tests functions:
+ *   weechat_relay_session_send_iov
+ */
+
+TEST(LibSession, SendIov)
+{
+    struct t_weechat_relay_msg_chain *chain;
+    struct iovec iov[2], *ptr_iov;
+    ssize_t num_read;
+    char read_buffer[4096], big_buffer[2048];
+    int iovcnt;
+
+    iov[0].iov_base = (void *)"abc";
+    iov[0].iov_len = 3;
+    iov[1].iov_base = (void *)"defg";
+    iov[1].iov_len = 4;
+
+    LONGS_EQUAL(-1, weechat_relay_session_send_iov (NULL, NULL, 0));
+    LONGS_EQUAL(-1, weechat_relay_session_send_iov (relay_session, NULL, 1));
+    LONGS_EQUAL(-1, weechat_relay_session_send_iov (relay_session, iov, 0));
+
+    LONGS_EQUAL(7, weechat_relay_session_send_iov (relay_session, iov, 2));
+    relay_session->sock = fd_pipe[0];
+    num_read = weechat_relay_session_recv (relay_session,
+                                           read_buffer, sizeof (read_buffer));
+    relay_session->sock = fd_pipe[1];
+    LONGS_EQUAL(7, num_read);
+    MEMCMP_EQUAL("abcdefg", read_buffer, 7);
+
+    /* message chain with a buffer added by reference */
+    memset (big_buffer, 'z', sizeof (big_buffer));
+    chain = weechat_relay_msg_chain_new ("test", 0);
+    weechat_relay_msg_chain_add_type (chain, WEECHAT_RELAY_OBJ_TYPE_BUFFER);
+    weechat_relay_msg_chain_add_buffer_ref (chain, big_buffer,
+                                            sizeof (big_buffer));
+    weechat_relay_msg_chain_add_type (chain, WEECHAT_RELAY_OBJ_TYPE_CHAR);
+    weechat_relay_msg_chain_add_char (chain, 'A');
+    ptr_iov = weechat_relay_msg_chain_iovec (chain, &iovcnt);
+    LONGS_EQUAL(3, iovcnt);
+    LONGS_EQUAL(
+        chain->size,
+        weechat_relay_session_send_iov (relay_session, ptr_iov, iovcnt));
+    relay_session->sock = fd_pipe[0];
+    num_read = weechat_relay_session_recv (relay_session,
+                                           read_buffer, sizeof (read_buffer));
+    relay_session->sock = fd_pipe[1];
+    LONGS_EQUAL(13 + 3 + 4 + 2048 + 3 + 1, num_read);
+    MEMCMP_EQUAL("\x00\x00\x08\x18", read_buffer, 4);
+    MEMCMP_EQUAL(big_buffer, read_buffer + 20, sizeof (big_buffer));
+    MEMCMP_EQUAL("chrA", read_buffer + 20 + 2048, 4);
+    weechat_relay_msg_chain_free (chain);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_session_send_iov (many segments, short write)
+ */
+
+TEST(LibSession, SendIovBatches)
+{
+    struct iovec *iov;
+    ssize_t num_sent, num_read, total;
+    char *data, *read_buffer;
+    int i, iovcnt, size;
+
+#ifdef IOV_MAX
+    iovcnt = (2 * IOV_MAX) + 5;
+#else
+    iovcnt = (2 * 1024) + 5;
+#endif /* IOV_MAX */
+
+    /* more segments than IOV_MAX: sent by batches */
+    size = iovcnt * 8;
+    data = (char *)malloc (size);
+    read_buffer = (char *)malloc (size);
+    for (i = 0; i < size; i++)
+    {
+        data[i] = 'a' + (i % 26);
+    }
+    iov = (struct iovec *)malloc (iovcnt * sizeof (*iov));
+    for (i = 0; i < iovcnt; i++)
+    {
+        iov[i].iov_base = data + (i * 8);
+        iov[i].iov_len = 8;
+    }
+    LONGS_EQUAL(size,
+                weechat_relay_session_send_iov (relay_session, iov, iovcnt));
+    total = 0;
+    while (total < size)
+    {
+        num_read = read (fd_pipe[0], read_buffer + total, size - total);
+        CHECK(num_read > 0);
+        total += num_read;
+    }
+    MEMCMP_EQUAL(data, read_buffer, size);
+    free (iov);
+    free (data);
+    free (read_buffer);
+
+    /* short write (pipe full, non-blocking): bytes sent are returned */
+    size = 1024 * 1024;
+    data = (char *)malloc (size);
+    read_buffer = (char *)malloc (size);
+    for (i = 0; i < size; i++)
+    {
+        data[i] = 'a' + (i % 26);
+    }
+    iov = (struct iovec *)malloc (3 * sizeof (*iov));
+    iov[0].iov_base = data;
+    iov[0].iov_len = 1000;
+    iov[1].iov_base = data + 1000;
+    iov[1].iov_len = size - 2000;
+    iov[2].iov_base = data + size - 1000;
+    iov[2].iov_len = 1000;
+    fcntl (fd_pipe[1], F_SETFL, fcntl (fd_pipe[1], F_GETFL) | O_NONBLOCK);
+    fcntl (fd_pipe[0], F_SETFL, fcntl (fd_pipe[0], F_GETFL) | O_NONBLOCK);
+    num_sent = weechat_relay_session_send_iov (relay_session, iov, 3);
+    CHECK(num_sent > 1000);
+    CHECK(num_sent < size);
+    total = 0;
+    while ((num_read = read (fd_pipe[0], read_buffer + total,
+                             size - total)) > 0)
+    {
+        total += num_read;
+    }
+    LONGS_EQUAL(num_sent, total);
+    MEMCMP_EQUAL(data, read_buffer, total);
+    /* pipe empty and full again: nothing sent */
+    while (write (fd_pipe[1], data, 4096) > 0)
+    {
+    }
+    LONGS_EQUAL(-1, weechat_relay_session_send_iov (relay_session, iov, 3));
+    free (iov);
+    free (data);
+    free (read_buffer);
+}
+
 /*
  * Tests functions:
  *   weechat_relay_session_buffer_add_bytes
@@ -216,3 +361,616 @@ TEST(LibSession, BufferPop)
     LONGS_EQUAL(0, relay_session->buffer_size);
     free (buffer);
 }
+
+/*
+ * Tests functions:
+ *   weechat_relay_session_buffer_parse
+ */
+
+TEST(LibSession, BufferParse)
+{
+    unsigned char buffer1[] = {
+        0x00, 0x00, 0x00, 0x12,                 /* length: 18     */
+        0x00,                                   /* no compression */
+        0x00, 0x00, 0x00, 0x00,                 /* id: ""         */
+        's', 't', 'r',                          /* str            */
+        0x00, 0x00, 0x00, 0x02, 'a', 'b',       /* "ab"           */
+    };
+    unsigned char buffer_invalid[] = {
+        0x00, 0x00, 0x00, 0x06,                 /* length: 6      */
+        0x00,                                   /* no compression */
+        0x00,                                   /* invalid id     */
+    };
+    unsigned char buffer_invalid_size[] = {
+        0x00, 0x00, 0x00, 0x02,                 /* length: 2      */
+        0x00, 0x00, 0x00,
+    };
+    struct t_weechat_relay_parsed_msg **messages;
+    struct t_weechat_relay_msg *msg;
+    void *ptr_compressed;
+    size_t size;
+    int i, count;
+
+    count = -1;
+    POINTERS_EQUAL(NULL, weechat_relay_session_buffer_parse (NULL, 0, NULL));
+    POINTERS_EQUAL(NULL, weechat_relay_session_buffer_parse (NULL, 0, &count));
+    LONGS_EQUAL(0, count);
+    count = -1;
+    POINTERS_EQUAL(NULL, weechat_relay_session_buffer_parse (relay_session, 0,
+                                                             &count));
+    LONGS_EQUAL(0, count);
+
+    /* incomplete message */
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           buffer1, 7));
+    POINTERS_EQUAL(NULL, weechat_relay_session_buffer_parse (relay_session, 0,
+                                                             &count));
+    LONGS_EQUAL(0, count);
+    LONGS_EQUAL(7, relay_session->buffer_size);
+
+    /* 100 messages: 1 uncompressed, 98 with zstd, 1 invalid + 1 incomplete */
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           buffer1 + 7,
+                                                           sizeof (buffer1) - 7));
+    for (i = 0; i < 98; i++)
+    {
+        msg = weechat_relay_msg_new ("zstd");
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        weechat_relay_msg_add_integer (msg, i);
+        ptr_compressed = weechat_relay_msg_compress_zstd (msg, 3, &size);
+        CHECK(ptr_compressed);
+        LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                               ptr_compressed,
+                                                               size));
+        free (ptr_compressed);
+        weechat_relay_msg_free (msg);
+    }
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           buffer_invalid,
+                                                           sizeof (buffer_invalid)));
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           buffer1, 10));
+
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(100, count);
+    CHECK(relay_session->parse_ctx);
+    STRCMP_EQUAL("", messages[0]->id);
+    LONGS_EQUAL(1, messages[0]->num_objects);
+    STRCMP_EQUAL("ab", messages[0]->objects[0]->value_string);
+    for (i = 0; i < 98; i++)
+    {
+        CHECK(messages[i + 1]);
+        LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZSTD, messages[i + 1]->compression);
+        STRCMP_EQUAL("zstd", messages[i + 1]->id);
+        LONGS_EQUAL(1, messages[i + 1]->num_objects);
+        LONGS_EQUAL(i, messages[i + 1]->objects[0]->value_integer);
+    }
+    POINTERS_EQUAL(NULL, messages[99]);
+    for (i = 0; i < count; i++)
+    {
+        weechat_relay_parse_msg_free (messages[i]);
+    }
+    free (messages);
+
+    /* incomplete message kept in buffer */
+    LONGS_EQUAL(10, relay_session->buffer_size);
+    MEMCMP_EQUAL(buffer1, relay_session->buffer, 10);
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           buffer1 + 10,
+                                                           sizeof (buffer1) - 10));
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(1, count);
+    STRCMP_EQUAL("ab", messages[0]->objects[0]->value_string);
+    weechat_relay_parse_msg_free (messages[0]);
+    free (messages);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+    LONGS_EQUAL(0, relay_session->buffer_size);
+
+    /* invalid size: all remaining bytes are removed */
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           buffer_invalid_size,
+                                                           sizeof (buffer_invalid_size)));
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(1, count);
+    POINTERS_EQUAL(NULL, messages[0]);
+    free (messages);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+    LONGS_EQUAL(0, relay_session->buffer_size);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_session_filter_add
+ *   weechat_relay_session_filter_remove
+ *   weechat_relay_session_filter_set_default
+ *   weechat_relay_session_filter_clear
+ *   weechat_relay_session_filter_check
+ */
+
+TEST(LibSession, Filter)
+{
+    struct t_weechat_relay_parsed_msg **messages;
+    struct t_weechat_relay_msg *msg;
+    const char *ids[] = { "_buffer_opened", "_nicklist", "_buffer_line_added",
+                          "test", NULL };
+    void *ptr_compressed, *buffer;
+    size_t size;
+    int i, count;
+
+    LONGS_EQUAL(0, weechat_relay_session_filter_add (
+                    NULL, NULL, WEECHAT_RELAY_FILTER_DROP));
+    LONGS_EQUAL(0, weechat_relay_session_filter_add (
+                    relay_session, NULL, WEECHAT_RELAY_FILTER_DROP));
+    LONGS_EQUAL(0, weechat_relay_session_filter_remove (NULL, NULL));
+    LONGS_EQUAL(0, weechat_relay_session_filter_remove (relay_session,
+                                                        "test"));
+    weechat_relay_session_filter_set_default (NULL,
+                                              WEECHAT_RELAY_FILTER_DROP);
+    weechat_relay_session_filter_clear (NULL);
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_session_filter_check (NULL, NULL, 0));
+    POINTERS_EQUAL(NULL, relay_session->filter);
+
+    /* receive only "_buffer_line_added" and "test" */
+    weechat_relay_session_filter_set_default (relay_session,
+                                              WEECHAT_RELAY_FILTER_DROP);
+    CHECK(relay_session->filter);
+    LONGS_EQUAL(1, weechat_relay_session_filter_add (
+                    relay_session, "_buffer_line_added",
+                    WEECHAT_RELAY_FILTER_ACCEPT));
+    LONGS_EQUAL(1, weechat_relay_session_filter_add (
+                    relay_session, "te*", WEECHAT_RELAY_FILTER_ACCEPT));
+
+    /* add messages, compressed with zstd */
+    for (i = 0; ids[i]; i++)
+    {
+        msg = weechat_relay_msg_new (ids[i]);
+        weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+        weechat_relay_msg_add_integer (msg, i);
+        ptr_compressed = weechat_relay_msg_compress_zstd (msg, 3, &size);
+        CHECK(ptr_compressed);
+        LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                               ptr_compressed,
+                                                               size));
+        free (ptr_compressed);
+        weechat_relay_msg_free (msg);
+    }
+
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(2, count);
+    LONGS_EQUAL(2, relay_session->filter_dropped);
+    STRCMP_EQUAL("_buffer_line_added", messages[0]->id);
+    LONGS_EQUAL(2, messages[0]->objects[0]->value_integer);
+    STRCMP_EQUAL("test", messages[1]->id);
+    LONGS_EQUAL(3, messages[1]->objects[0]->value_integer);
+    weechat_relay_parse_msg_free (messages[0]);
+    weechat_relay_parse_msg_free (messages[1]);
+    free (messages);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+
+    /* all messages dropped */
+    LONGS_EQUAL(1, weechat_relay_session_filter_remove (relay_session,
+                                                        "te*"));
+    msg = weechat_relay_msg_new ("test");
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           msg->data,
+                                                           msg->data_size));
+    count = -1;
+    POINTERS_EQUAL(NULL, weechat_relay_session_buffer_parse (relay_session, 0,
+                                                             &count));
+    LONGS_EQUAL(0, count);
+    LONGS_EQUAL(3, relay_session->filter_dropped);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+
+    /* pop skips the messages dropped */
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           msg->data,
+                                                           msg->data_size));
+    weechat_relay_msg_free (msg);
+    msg = weechat_relay_msg_new ("_buffer_line_added");
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           msg->data,
+                                                           msg->data_size));
+    weechat_relay_session_buffer_pop (relay_session, &buffer, &size);
+    CHECK(buffer);
+    LONGS_EQUAL(msg->data_size, size);
+    MEMCMP_EQUAL(msg->data, buffer, size);
+    LONGS_EQUAL(4, relay_session->filter_dropped);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+    free (buffer);
+
+    /* no filter: all messages accepted */
+    weechat_relay_session_filter_clear (relay_session);
+    POINTERS_EQUAL(NULL, relay_session->filter);
+    LONGS_EQUAL(WEECHAT_RELAY_FILTER_ACCEPT,
+                weechat_relay_session_filter_check (relay_session,
+                                                    msg->data,
+                                                    msg->data_size));
+    weechat_relay_msg_free (msg);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_session_buffer_dispatch
+ */
+
+void
+test_session_dispatch_cb (void *data,
+                          struct t_weechat_relay_parsed_msg *parsed_msg)
+{
+    int *count;
+
+    count = (int *)data;
+    (*count)++;
+    LONGS_EQUAL(1, parsed_msg->refcount);
+}
+
+TEST(LibSession, BufferDispatch)
+{
+    struct t_weechat_relay_dispatch *dispatch;
+    struct t_weechat_relay_msg *msg;
+    const char *ids[] = { "_buffer_opened", "_nicklist", "hdata_buffers",
+                          "_buffer_opened", "other", NULL };
+    int i, count_opened, count_custom;
+
+    count_opened = 0;
+    count_custom = 0;
+
+    dispatch = weechat_relay_dispatch_new ();
+    weechat_relay_dispatch_set_event (dispatch,
+                                      WEECHAT_RELAY_EVENT_BUFFER_OPENED,
+                                      &test_session_dispatch_cb,
+                                      &count_opened);
+    weechat_relay_dispatch_set_id (dispatch, "hdata_buffers",
+                                   &test_session_dispatch_cb, &count_custom);
+
+    LONGS_EQUAL(-1, weechat_relay_session_buffer_dispatch (NULL, NULL, 0));
+    LONGS_EQUAL(-1, weechat_relay_session_buffer_dispatch (relay_session,
+                                                           NULL, 0));
+    LONGS_EQUAL(0, weechat_relay_session_buffer_dispatch (relay_session,
+                                                          dispatch, 0));
+
+    for (i = 0; ids[i]; i++)
+    {
+        msg = weechat_relay_msg_new (ids[i]);
+        LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                               msg->data,
+                                                               msg->data_size));
+        weechat_relay_msg_free (msg);
+    }
+
+    LONGS_EQUAL(5, weechat_relay_session_buffer_dispatch (relay_session,
+                                                          dispatch, 0));
+    LONGS_EQUAL(2, count_opened);
+    LONGS_EQUAL(1, count_custom);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+    POINTERS_EQUAL(NULL,
+                   ((struct t_weechat_relay_parse_ctx *)relay_session->parse_ctx)->dispatch);
+
+    weechat_relay_dispatch_free (dispatch);
+}
+
+/*
+ * Adds bytes to the session buffer by chunks of "chunk_size" bytes.
+ */
+
+static void
+add_bytes_chunks (struct t_weechat_relay_session *session,
+                  const void *buffer, size_t size, size_t chunk_size)
+{
+    size_t pos, count;
+
+    for (pos = 0; pos < size; pos += count)
+    {
+        count = (size - pos < chunk_size) ? size - pos : chunk_size;
+        LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (
+                        session, (const char *)buffer + pos, count));
+    }
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_session_set_spill_threshold
+ *   weechat_relay_session_set_max_message_size
+ *   weechat_relay_session_buffer_add_bytes (spill/reject)
+ *   weechat_relay_session_buffer_pop (spill)
+ *   weechat_relay_session_buffer_parse (spill)
+ */
+
+TEST(LibSession, Spill)
+{
+    unsigned char buffer1[] = {
+        0x00, 0x00, 0x00, 0x12,                 /* length: 18     */
+        0x00,                                   /* no compression */
+        0x00, 0x00, 0x00, 0x00,                 /* id: ""         */
+        's', 't', 'r',                          /* str            */
+        0x00, 0x00, 0x00, 0x02, 'a', 'b',       /* "ab"           */
+    };
+    struct t_weechat_relay_parsed_msg **messages;
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_spill *spill;
+    void *msg_comp, *buffer;
+    size_t size_comp, size;
+    int count;
+
+    weechat_relay_session_set_spill_threshold (NULL, 0);
+    weechat_relay_session_set_max_message_size (NULL, 0);
+
+    MESSAGE_BUILD_FAKE(msg);
+
+    /* spill module */
+    POINTERS_EQUAL(NULL, weechat_relay_spill_new (0));
+    spill = weechat_relay_spill_new (10);
+    CHECK(spill);
+    LONGS_EQUAL(0, weechat_relay_spill_complete (spill));
+    POINTERS_EQUAL(NULL, weechat_relay_spill_map (spill));
+    LONGS_EQUAL(4, weechat_relay_spill_write (spill, "abcd", 4));
+    LONGS_EQUAL(6, weechat_relay_spill_write (spill, "efghijklmn", 10));
+    LONGS_EQUAL(1, weechat_relay_spill_complete (spill));
+    MEMCMP_EQUAL("abcdefghij", weechat_relay_spill_map (spill), 10);
+    LONGS_EQUAL(-1, weechat_relay_spill_write (spill, "x", 1));
+    weechat_relay_spill_free (spill);
+    weechat_relay_spill_free (NULL);
+
+    /* big message between two small messages: received in temporary file */
+    weechat_relay_session_set_spill_threshold (relay_session, 1000);
+    LONGS_EQUAL(1000, relay_session->spill_threshold);
+    add_bytes_chunks (relay_session, buffer1, sizeof (buffer1), 100);
+    add_bytes_chunks (relay_session, msg->data, 500, 100);
+    CHECK(relay_session->spill);
+    LONGS_EQUAL(sizeof (buffer1), ((struct t_weechat_relay_spill *)relay_session->spill)->offset);
+    LONGS_EQUAL(sizeof (buffer1), relay_session->buffer_size);
+    /* message before the big one is parsed, the big one is incomplete */
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(1, count);
+    STRCMP_EQUAL("ab", messages[0]->objects[0]->value_string);
+    weechat_relay_parse_msg_free (messages[0]);
+    free (messages);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+    LONGS_EQUAL(0, ((struct t_weechat_relay_spill *)relay_session->spill)->offset);
+    add_bytes_chunks (relay_session, msg->data + 500, msg->data_size - 500,
+                      100);
+    add_bytes_chunks (relay_session, buffer1, sizeof (buffer1), 7);
+    LONGS_EQUAL(1, weechat_relay_spill_complete (
+                    (struct t_weechat_relay_spill *)relay_session->spill));
+    LONGS_EQUAL(sizeof (buffer1), relay_session->buffer_size);
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(2, count);
+    STRCMP_EQUAL("test", messages[0]->id);
+    POINTERS_EQUAL(NULL, messages[0]->message);
+    LONGS_EQUAL(9, messages[0]->num_objects);
+    STRCMP_EQUAL(LOREM_IPSUM_4096, messages[0]->objects[6]->value_string);
+    STRCMP_EQUAL("ab", messages[1]->objects[0]->value_string);
+    weechat_relay_parse_msg_free (messages[0]);
+    weechat_relay_parse_msg_free (messages[1]);
+    free (messages);
+    POINTERS_EQUAL(NULL, relay_session->spill);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+    LONGS_EQUAL(0, relay_session->buffer_size);
+
+    /* big message in one call (compressed, threshold lower than its size) */
+    msg_comp = weechat_relay_msg_compress_zlib (msg, 5, &size_comp);
+    weechat_relay_session_set_spill_threshold (relay_session, 100);
+    CHECK(size_comp > 100);
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           msg_comp,
+                                                           size_comp));
+    CHECK(relay_session->spill);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(1, count);
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_ZLIB, messages[0]->compression);
+    LONGS_EQUAL(9, messages[0]->num_objects);
+    weechat_relay_parse_msg_free (messages[0]);
+    free (messages);
+
+    /* pop a message received in temporary file: copied in memory */
+    add_bytes_chunks (relay_session, buffer1, sizeof (buffer1), 100);
+    add_bytes_chunks (relay_session, msg_comp, size_comp, 1000);
+    weechat_relay_session_buffer_pop (relay_session, &buffer, &size);
+    LONGS_EQUAL(sizeof (buffer1), size);
+    MEMCMP_EQUAL(buffer1, buffer, size);
+    free (buffer);
+    LONGS_EQUAL(0, ((struct t_weechat_relay_spill *)relay_session->spill)->offset);
+    weechat_relay_session_buffer_pop (relay_session, &buffer, &size);
+    LONGS_EQUAL(size_comp, size);
+    MEMCMP_EQUAL(msg_comp, buffer, size);
+    free (buffer);
+    POINTERS_EQUAL(NULL, relay_session->spill);
+    weechat_relay_session_buffer_pop (relay_session, &buffer, &size);
+    POINTERS_EQUAL(NULL, buffer);
+
+    /* message received in temporary file dropped by filter */
+    weechat_relay_session_filter_add (relay_session, "test",
+                                      WEECHAT_RELAY_FILTER_DROP);
+    add_bytes_chunks (relay_session, msg_comp, size_comp, 1000);
+    add_bytes_chunks (relay_session, buffer1, sizeof (buffer1), 100);
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(1, count);
+    STRCMP_EQUAL("", messages[0]->id);
+    LONGS_EQUAL(1, relay_session->filter_dropped);
+    weechat_relay_parse_msg_free (messages[0]);
+    free (messages);
+    weechat_relay_session_filter_clear (relay_session);
+    free (msg_comp);
+
+    /* message bigger than max size: rejected, bytes never stored */
+    weechat_relay_session_set_spill_threshold (relay_session, 0);
+    weechat_relay_session_set_max_message_size (relay_session, 1000);
+    LONGS_EQUAL(1000, relay_session->max_message_size);
+    add_bytes_chunks (relay_session, buffer1, sizeof (buffer1), 100);
+    add_bytes_chunks (relay_session, msg->data, 200, 100);
+    LONGS_EQUAL(1, relay_session->messages_rejected);
+    LONGS_EQUAL(msg->data_size - 200, relay_session->reject_remaining);
+    LONGS_EQUAL(sizeof (buffer1), relay_session->buffer_size);
+    add_bytes_chunks (relay_session, msg->data + 200, msg->data_size - 200,
+                      100);
+    LONGS_EQUAL(0, relay_session->reject_remaining);
+    LONGS_EQUAL(sizeof (buffer1), relay_session->buffer_size);
+    /* end of rejected message and next message in the same call */
+    add_bytes_chunks (relay_session, msg->data, 200, 200);
+    memcpy (msg->data + msg->data_size - sizeof (buffer1), buffer1,
+            sizeof (buffer1));
+    add_bytes_chunks (relay_session, msg->data + 200, msg->data_size - 200,
+                      5000);
+    LONGS_EQUAL(2, relay_session->messages_rejected);
+    LONGS_EQUAL(0, relay_session->reject_remaining);
+    LONGS_EQUAL(sizeof (buffer1), relay_session->buffer_size);
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(1, count);
+    STRCMP_EQUAL("ab", messages[0]->objects[0]->value_string);
+    weechat_relay_parse_msg_free (messages[0]);
+    free (messages);
+
+    weechat_relay_msg_free (msg);
+
+    /* complete message bigger than max size between two small messages */
+    MESSAGE_BUILD_FAKE(msg);
+    size = sizeof (buffer1) + msg->data_size + sizeof (buffer1);
+    buffer = malloc (size);
+    memcpy (buffer, buffer1, sizeof (buffer1));
+    memcpy ((char *)buffer + sizeof (buffer1), msg->data, msg->data_size);
+    memcpy ((char *)buffer + sizeof (buffer1) + msg->data_size, buffer1,
+            sizeof (buffer1));
+    LONGS_EQUAL(1, weechat_relay_session_buffer_add_bytes (relay_session,
+                                                           buffer, size));
+    LONGS_EQUAL(3, relay_session->messages_rejected);
+    LONGS_EQUAL(2 * sizeof (buffer1), relay_session->buffer_size);
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(2, count);
+    weechat_relay_parse_msg_free (messages[0]);
+    weechat_relay_parse_msg_free (messages[1]);
+    free (messages);
+    free (buffer);
+    weechat_relay_msg_free (msg);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_session_set_max_buffer_size
+ *   weechat_relay_session_buffer_add_bytes (queue of spills)
+ *   weechat_relay_session_buffer_append
+ */
+
+TEST(LibSession, SpillQueue)
+{
+    unsigned char buffer1[] = {
+        0x00, 0x00, 0x00, 0x12,                 /* length: 18     */
+        0x00,                                   /* no compression */
+        0x00, 0x00, 0x00, 0x00,                 /* id: ""         */
+        's', 't', 'r',                          /* str            */
+        0x00, 0x00, 0x00, 0x02, 'a', 'b',       /* "ab"           */
+    };
+    struct t_weechat_relay_parsed_msg **messages;
+    struct t_weechat_relay_msg *msg;
+    struct t_weechat_relay_spill *ptr_spill;
+    void *buffer;
+    size_t size, alloc;
+    int count, num_reallocs;
+
+    weechat_relay_session_set_max_buffer_size (NULL, 0);
+
+    MESSAGE_BUILD_FAKE(msg);
+
+    /* two big messages not parsed: both received in temporary files */
+    weechat_relay_session_set_spill_threshold (relay_session, 1000);
+    add_bytes_chunks (relay_session, msg->data, msg->data_size, 1000);
+    add_bytes_chunks (relay_session, buffer1, sizeof (buffer1), 100);
+    add_bytes_chunks (relay_session, msg->data, msg->data_size, 1000);
+    ptr_spill = (struct t_weechat_relay_spill *)relay_session->spill;
+    CHECK(ptr_spill);
+    CHECK(ptr_spill->next_spill);
+    POINTERS_EQUAL(ptr_spill->next_spill, relay_session->last_spill);
+    LONGS_EQUAL(0, ptr_spill->offset);
+    LONGS_EQUAL(sizeof (buffer1), ptr_spill->next_spill->offset);
+    LONGS_EQUAL(2 * msg->data_size, relay_session->spill_size);
+    LONGS_EQUAL(sizeof (buffer1), relay_session->buffer_size);
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(3, count);
+    STRCMP_EQUAL("test", messages[0]->id);
+    STRCMP_EQUAL("ab", messages[1]->objects[0]->value_string);
+    STRCMP_EQUAL("test", messages[2]->id);
+    STRCMP_EQUAL(LOREM_IPSUM_4096, messages[2]->objects[6]->value_string);
+    weechat_relay_parse_msg_free (messages[0]);
+    weechat_relay_parse_msg_free (messages[1]);
+    weechat_relay_parse_msg_free (messages[2]);
+    free (messages);
+    POINTERS_EQUAL(NULL, relay_session->spill);
+    POINTERS_EQUAL(NULL, relay_session->last_spill);
+    LONGS_EQUAL(0, relay_session->spill_size);
+    POINTERS_EQUAL(NULL, relay_session->buffer);
+
+    /* second big message popped after the first one */
+    add_bytes_chunks (relay_session, msg->data, msg->data_size, 100);
+    add_bytes_chunks (relay_session, msg->data, msg->data_size, 100);
+    weechat_relay_session_buffer_pop (relay_session, &buffer, &size);
+    LONGS_EQUAL(msg->data_size, size);
+    free (buffer);
+    CHECK(relay_session->spill);
+    POINTERS_EQUAL(relay_session->spill, relay_session->last_spill);
+    weechat_relay_session_buffer_pop (relay_session, &buffer, &size);
+    LONGS_EQUAL(msg->data_size, size);
+    MEMCMP_EQUAL(msg->data, buffer, size);
+    free (buffer);
+    POINTERS_EQUAL(NULL, relay_session->spill);
+
+    /* max buffer size: memory + temporary files */
+    weechat_relay_session_set_max_buffer_size (relay_session,
+                                               msg->data_size + 100);
+    LONGS_EQUAL(msg->data_size + 100, relay_session->max_buffer_size);
+    add_bytes_chunks (relay_session, msg->data, msg->data_size, 1000);
+    add_bytes_chunks (relay_session, buffer1, sizeof (buffer1), 100);
+    add_bytes_chunks (relay_session, msg->data, msg->data_size, 1000);
+    add_bytes_chunks (relay_session, buffer1, sizeof (buffer1), 100);
+    LONGS_EQUAL(1, relay_session->messages_rejected);
+    POINTERS_EQUAL(relay_session->spill, relay_session->last_spill);
+    LONGS_EQUAL(msg->data_size, relay_session->spill_size);
+    LONGS_EQUAL(2 * sizeof (buffer1), relay_session->buffer_size);
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    CHECK(messages);
+    LONGS_EQUAL(3, count);
+    weechat_relay_parse_msg_free (messages[0]);
+    weechat_relay_parse_msg_free (messages[1]);
+    weechat_relay_parse_msg_free (messages[2]);
+    free (messages);
+    weechat_relay_session_set_max_buffer_size (relay_session, 0);
+    weechat_relay_session_set_spill_threshold (relay_session, 0);
+
+    weechat_relay_msg_free (msg);
+
+    /* big message in memory: buffer grows geometrically */
+    MESSAGE_BUILD_FAKE(msg);
+    alloc = 0;
+    num_reallocs = 0;
+    for (size = 0; size < msg->data_size; size += 10)
+    {
+        weechat_relay_session_buffer_add_bytes (
+            relay_session, msg->data + size,
+            (msg->data_size - size < 10) ? msg->data_size - size : 10);
+        if (relay_session->buffer_alloc != alloc)
+        {
+            alloc = relay_session->buffer_alloc;
+            num_reallocs++;
+        }
+    }
+    CHECK(num_reallocs < 16);
+    CHECK(relay_session->buffer_alloc >= relay_session->buffer_size);
+    messages = weechat_relay_session_buffer_parse (relay_session, 0, &count);
+    LONGS_EQUAL(1, count);
+    weechat_relay_parse_msg_free (messages[0]);
+    free (messages);
+    LONGS_EQUAL(0, relay_session->buffer_alloc);
+
+    weechat_relay_msg_free (msg);
+}
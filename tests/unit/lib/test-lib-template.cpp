@@ -0,0 +1,325 @@
+/*
+ * test-lib-template.cpp - test message templates
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include "tests/tests.h"
+#include "lib/weechat-relay.h"
+#include "lib/template.h"
+}
+
+#define TEMPLATE_KEYS "buffer:ptr,date:tim,displayed:chr,highlight:chr," \
+    "prefix:str,message:str"
+
+TEST_GROUP(LibTemplate)
+{
+};
+
+/*
+ * Builds a message "_buffer_line_added" with a hdata (one line), object by
+ * object.
+ */
+
+struct t_weechat_relay_msg *
+template_build_line (int number, const char *message)
+{
+    struct t_weechat_relay_msg *msg;
+
+    msg = weechat_relay_msg_new ("_buffer_line_added");
+    weechat_relay_msg_add_type (msg, WEECHAT_RELAY_OBJ_TYPE_HDATA);
+    weechat_relay_msg_add_string (msg, "line_data");
+    weechat_relay_msg_add_string (msg, TEMPLATE_KEYS);
+    weechat_relay_msg_add_integer (msg, 1);
+    weechat_relay_msg_add_pointer (msg, (void *)(0x5000L + number));
+    weechat_relay_msg_add_pointer (msg, (void *)(0x12340000L + number));
+    weechat_relay_msg_add_time (msg, 1700000000 + number);
+    weechat_relay_msg_add_char (msg, 1);
+    weechat_relay_msg_add_char (msg, (number % 2 == 0) ? 1 : 0);
+    weechat_relay_msg_add_string (msg, NULL);
+    weechat_relay_msg_add_string (msg, message);
+
+    return msg;
+}
+
+/*
+ * Sets values for the template of message "_buffer_line_added".
+ */
+
+void
+template_set_line (struct t_weechat_relay_value *values, int number,
+                   const char *message)
+{
+    memset (values, 0, sizeof (*values) * 7);
+    values[0].type = WEECHAT_RELAY_OBJ_TYPE_POINTER;
+    values[0].value_pointer = (void *)(0x5000L + number);
+    values[1].type = WEECHAT_RELAY_OBJ_TYPE_POINTER;
+    values[1].value_pointer = (void *)(0x12340000L + number);
+    values[2].type = WEECHAT_RELAY_OBJ_TYPE_TIME;
+    values[2].value_time = 1700000000 + number;
+    values[3].type = WEECHAT_RELAY_OBJ_TYPE_CHAR;
+    values[3].value_char = 1;
+    values[4].type = WEECHAT_RELAY_OBJ_TYPE_CHAR;
+    values[4].value_char = (number % 2 == 0) ? 1 : 0;
+    values[5].type = WEECHAT_RELAY_OBJ_TYPE_STRING;
+    values[5].value_string = NULL;
+    values[6].type = WEECHAT_RELAY_OBJ_TYPE_STRING;
+    values[6].value_string = (char *)message;
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_template_type_valid
+ */
+
+TEST(LibTemplate, TypeValid)
+{
+    LONGS_EQUAL(1, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_CHAR));
+    LONGS_EQUAL(1, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_INTEGER));
+    LONGS_EQUAL(1, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_LONG));
+    LONGS_EQUAL(1, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_STRING));
+    LONGS_EQUAL(1, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_BUFFER));
+    LONGS_EQUAL(1, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_POINTER));
+    LONGS_EQUAL(1, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_TIME));
+    LONGS_EQUAL(0, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_HASHTABLE));
+    LONGS_EQUAL(0, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_HDATA));
+    LONGS_EQUAL(0, weechat_relay_msg_template_type_valid (WEECHAT_RELAY_OBJ_TYPE_ARRAY));
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_template_new
+ *   weechat_relay_msg_template_add_bytes
+ *   weechat_relay_msg_template_add_type
+ *   weechat_relay_msg_template_add_integer
+ *   weechat_relay_msg_template_add_string
+ *   weechat_relay_msg_template_add_slot
+ *   weechat_relay_msg_template_new_msg
+ *   weechat_relay_msg_template_free
+ */
+
+TEST(LibTemplate, Slots)
+{
+    struct t_weechat_relay_msg_template *tmpl;
+    struct t_weechat_relay_msg *msg, *msg2;
+    struct t_weechat_relay_value values[4];
+
+    LONGS_EQUAL(0, weechat_relay_msg_template_add_bytes (NULL, "abc", 3));
+    LONGS_EQUAL(0, weechat_relay_msg_template_add_type (
+                    NULL, WEECHAT_RELAY_OBJ_TYPE_INTEGER));
+    LONGS_EQUAL(0, weechat_relay_msg_template_add_integer (NULL, 1));
+    LONGS_EQUAL(0, weechat_relay_msg_template_add_string (NULL, "abc"));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_slot (
+                    NULL, WEECHAT_RELAY_OBJ_TYPE_INTEGER));
+    POINTERS_EQUAL(NULL, weechat_relay_msg_template_new_msg (NULL, NULL, 0));
+
+    tmpl = weechat_relay_msg_template_new ("test");
+    CHECK(tmpl);
+    LONGS_EQUAL(0, tmpl->num_slots);
+
+    /* message without slots */
+    msg = weechat_relay_msg_template_new_msg (tmpl, NULL, 0);
+    CHECK(msg);
+    STRCMP_EQUAL("test", msg->id);
+    LONGS_EQUAL(13, msg->data_size);
+    MEMCMP_EQUAL("\x00\x00\x00\x0d\x00\x00\x00\x00\x04test", msg->data, 13);
+    weechat_relay_msg_free (msg);
+
+    LONGS_EQUAL(0, weechat_relay_msg_template_add_bytes (tmpl, NULL, 3));
+    LONGS_EQUAL(0, weechat_relay_msg_template_add_bytes (tmpl, "abc", 0));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_slot (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_HASHTABLE));
+
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_type (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_INTEGER));
+    LONGS_EQUAL(0, weechat_relay_msg_template_add_slot (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_INTEGER));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_type (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_STRING));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_string (tmpl, "abc"));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_type (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_LONG));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_slot (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_LONG));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_type (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_BUFFER));
+    LONGS_EQUAL(2, weechat_relay_msg_template_add_slot (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_BUFFER));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_type (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_INTEGER));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_integer (tmpl, 42));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_type (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_TIME));
+    LONGS_EQUAL(3, weechat_relay_msg_template_add_slot (
+                    tmpl, WEECHAT_RELAY_OBJ_TYPE_TIME));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_bytes (tmpl, "chr", 3));
+    LONGS_EQUAL(1, weechat_relay_msg_template_add_bytes (tmpl, "A", 1));
+    LONGS_EQUAL(4, tmpl->num_slots);
+
+    memset (values, 0, sizeof (values));
+    values[0].type = WEECHAT_RELAY_OBJ_TYPE_INTEGER;
+    values[0].value_integer = 123456;
+    values[1].type = WEECHAT_RELAY_OBJ_TYPE_LONG;
+    values[1].value_long = -98765432L;
+    values[2].type = WEECHAT_RELAY_OBJ_TYPE_BUFFER;
+    values[2].value_buffer = (void *)"xyz";
+    values[2].length = 3;
+    values[3].type = WEECHAT_RELAY_OBJ_TYPE_TIME;
+    values[3].value_time = 1700000000;
+
+    /* wrong number of values or wrong type */
+    POINTERS_EQUAL(NULL, weechat_relay_msg_template_new_msg (tmpl, NULL, 4));
+    POINTERS_EQUAL(NULL, weechat_relay_msg_template_new_msg (tmpl, values, 3));
+    values[3].type = WEECHAT_RELAY_OBJ_TYPE_LONG;
+    POINTERS_EQUAL(NULL, weechat_relay_msg_template_new_msg (tmpl, values, 4));
+    values[3].type = WEECHAT_RELAY_OBJ_TYPE_TIME;
+
+    msg = weechat_relay_msg_template_new_msg (tmpl, values, 4);
+    CHECK(msg);
+
+    msg2 = weechat_relay_msg_new ("test");
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg2, 123456);
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_STRING);
+    weechat_relay_msg_add_string (msg2, "abc");
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_LONG);
+    weechat_relay_msg_add_long (msg2, -98765432L);
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_BUFFER);
+    weechat_relay_msg_add_bytes (msg2, "\x00\x00\x00\x03xyz", 7);
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    weechat_relay_msg_add_integer (msg2, 42);
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_TIME);
+    weechat_relay_msg_add_time (msg2, 1700000000);
+    weechat_relay_msg_add_type (msg2, WEECHAT_RELAY_OBJ_TYPE_CHAR);
+    weechat_relay_msg_add_char (msg2, 'A');
+
+    LONGS_EQUAL(msg2->data_size, msg->data_size);
+    MEMCMP_EQUAL(msg2->data, msg->data, msg->data_size);
+
+    weechat_relay_msg_free (msg);
+    weechat_relay_msg_free (msg2);
+    weechat_relay_msg_template_free (tmpl);
+
+    weechat_relay_msg_template_free (NULL);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_msg_template_add_hdata
+ *   weechat_relay_msg_template_fill
+ */
+
+TEST(LibTemplate, Hdata)
+{
+    struct t_weechat_relay_msg_template *tmpl;
+    struct t_weechat_relay_msg *msg, *msg2;
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_value values[7];
+    char str_message[128];
+    int i;
+
+    tmpl = weechat_relay_msg_template_new ("_buffer_line_added");
+
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_hdata (
+                    NULL, "line_data", TEMPLATE_KEYS, 1));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_hdata (
+                    tmpl, NULL, TEMPLATE_KEYS, 1));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_hdata (
+                    tmpl, "", TEMPLATE_KEYS, 1));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_hdata (
+                    tmpl, "line_data", NULL, 1));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_hdata (
+                    tmpl, "line_data", TEMPLATE_KEYS, 0));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_hdata (
+                    tmpl, "line_data", "buffer", 1));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_hdata (
+                    tmpl, "line_data", "buffer:xxx", 1));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_hdata (
+                    tmpl, "line_data", "buffer:ptr,", 1));
+    LONGS_EQUAL(-1, weechat_relay_msg_template_add_hdata (
+                    tmpl, "line_data", "buffer:ptr,tags:arr", 1));
+    LONGS_EQUAL(0, tmpl->num_slots);
+
+    LONGS_EQUAL(0, weechat_relay_msg_template_add_hdata (
+                    tmpl, "line_data", TEMPLATE_KEYS, 1));
+    LONGS_EQUAL(7, tmpl->num_slots);
+
+    /* one message reused for many lines */
+    msg = weechat_relay_msg_new (NULL);
+    for (i = 0; i < 5; i++)
+    {
+        snprintf (str_message, sizeof (str_message),
+                  "this is the message number %d", i * 1000);
+        template_set_line (values, i, str_message);
+        LONGS_EQUAL(0, weechat_relay_msg_template_fill (NULL, msg, values, 7));
+        LONGS_EQUAL(0, weechat_relay_msg_template_fill (tmpl, NULL, values,
+                                                        7));
+        LONGS_EQUAL(1, weechat_relay_msg_template_fill (tmpl, msg, values, 7));
+        STRCMP_EQUAL("_buffer_line_added", msg->id);
+        msg2 = template_build_line (i, str_message);
+        LONGS_EQUAL(msg2->data_size, msg->data_size);
+        MEMCMP_EQUAL(msg2->data, msg->data, msg->data_size);
+        weechat_relay_msg_free (msg2);
+    }
+
+    parsed_msg = weechat_relay_parse_message (msg->data, msg->data_size);
+    CHECK(parsed_msg);
+    STRCMP_EQUAL("_buffer_line_added", parsed_msg->id);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_HDATA, parsed_msg->objects[0]->type);
+    LONGS_EQUAL(1, parsed_msg->objects[0]->value_hdata.num_hpaths);
+    LONGS_EQUAL(6, parsed_msg->objects[0]->value_hdata.num_keys);
+    LONGS_EQUAL(1, parsed_msg->objects[0]->value_hdata.count);
+    STRCMP_EQUAL("this is the message number 4000",
+                 parsed_msg->objects[0]->value_hdata.values[0][5]->value_string);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* message compressed in place: reset before filling */
+    LONGS_EQUAL(1, weechat_relay_msg_compress (msg, NULL,
+                                               WEECHAT_RELAY_COMPRESSION_ZLIB,
+                                               6));
+    template_set_line (values, 1, "hello");
+    LONGS_EQUAL(1, weechat_relay_msg_template_fill (tmpl, msg, values, 7));
+    LONGS_EQUAL(WEECHAT_RELAY_COMPRESSION_OFF, msg->compression);
+    msg2 = template_build_line (1, "hello");
+    LONGS_EQUAL(msg2->data_size, msg->data_size);
+    MEMCMP_EQUAL(msg2->data, msg->data, msg->data_size);
+    weechat_relay_msg_free (msg2);
+
+    weechat_relay_msg_free (msg);
+
+    /* hdata with 2 objects */
+    weechat_relay_msg_template_free (tmpl);
+    tmpl = weechat_relay_msg_template_new ("nicks");
+    LONGS_EQUAL(0, weechat_relay_msg_template_add_hdata (
+                    tmpl, "buffer/nick", "name:str,level:int", 2));
+    LONGS_EQUAL(8, tmpl->num_slots);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_POINTER, tmpl->slots[4].type);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_POINTER, tmpl->slots[5].type);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_STRING, tmpl->slots[6].type);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_INTEGER, tmpl->slots[7].type);
+    weechat_relay_msg_template_free (tmpl);
+}
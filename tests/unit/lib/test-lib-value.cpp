@@ -0,0 +1,304 @@
+/*
+ * test-lib-value.cpp - test compact values
+ *
+ * SPDX-FileCopyrightText: 2019-2025 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of WeeChat Relay.
+ *
+ * WeeChat Relay is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat Relay is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat Relay.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include "stdlib.h"
+#include "string.h"
+#include <arpa/inet.h>
+#include "tests/tests.h"
+#include "lib/weechat-relay.h"
+#include "lib/object.h"
+#include "lib/parse.h"
+#include "lib/value.h"
+}
+
+TEST_GROUP(LibValue)
+{
+};
+
+/*
+ * Parses a message with a single object, with and without compact values,
+ * and checks that the message built with the values (and with the objects
+ * converted from/to values) has the same bytes as the original message.
+ */
+
+static void
+check_value_message (const unsigned char *message, size_t size, int flags)
+{
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_value value;
+    struct t_weechat_relay_obj *obj;
+    struct t_weechat_relay_msg *msg;
+
+    /* parse to values, then build message with values */
+    parsed_msg = weechat_relay_parse_message_flags (
+        message, size, flags | WEECHAT_RELAY_PARSE_FLAG_VALUES);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(0, parsed_msg->num_objects);
+    POINTERS_EQUAL(NULL, parsed_msg->objects);
+    LONGS_EQUAL(1, parsed_msg->num_values);
+    msg = weechat_relay_msg_new ("id");
+    LONGS_EQUAL(1, weechat_relay_msg_add_value (msg, &parsed_msg->values[0]));
+    LONGS_EQUAL(size, msg->data_size);
+    MEMCMP_EQUAL(message, msg->data, size);
+    weechat_relay_msg_free (msg);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* parse to objects, then convert object -> value -> object */
+    parsed_msg = weechat_relay_parse_message_flags (message, size, flags);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(1, parsed_msg->num_objects);
+    LONGS_EQUAL(1, weechat_relay_value_from_obj (&value,
+                                                 parsed_msg->objects[0]));
+    LONGS_EQUAL(parsed_msg->objects[0]->type, value.type);
+    msg = weechat_relay_msg_new ("id");
+    LONGS_EQUAL(1, weechat_relay_msg_add_value (msg, &value));
+    LONGS_EQUAL(size, msg->data_size);
+    MEMCMP_EQUAL(message, msg->data, size);
+    weechat_relay_msg_free (msg);
+    obj = weechat_relay_value_to_obj (&value);
+    CHECK(obj);
+    msg = weechat_relay_msg_new ("id");
+    LONGS_EQUAL(1, weechat_relay_msg_add_object (msg, obj));
+    LONGS_EQUAL(size, msg->data_size);
+    MEMCMP_EQUAL(message, msg->data, size);
+    weechat_relay_msg_free (msg);
+    weechat_relay_obj_free (obj);
+    weechat_relay_value_clear (&value);
+    weechat_relay_parse_msg_free (parsed_msg);
+}
+
+/*
+ * Tests size of struct t_weechat_relay_value.
+ */
+
+TEST(LibValue, Size)
+{
+    LONGS_EQUAL(16, sizeof (struct t_weechat_relay_value));
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_value_from_obj
+ *   weechat_relay_value_to_obj
+ *   weechat_relay_value_clear
+ *   weechat_relay_msg_add_value
+ *   weechat_relay_msg_add_value_content
+ *   weechat_relay_parse_read_value
+ */
+
+TEST(LibValue, Convert)
+{
+    unsigned char message_char[] = { MESSAGE_CHAR };
+    unsigned char message_integer[] = { MESSAGE_INTEGER_2 };
+    unsigned char message_long[] = { MESSAGE_LONG_2 };
+    unsigned char message_string[] = { MESSAGE_STRING };
+    unsigned char message_string_null[] = { MESSAGE_STRING_NULL };
+    unsigned char message_string_empty[] = { MESSAGE_STRING_EMPTY };
+    unsigned char message_buffer[] = { MESSAGE_BUFFER };
+    unsigned char message_buffer_null[] = { MESSAGE_BUFFER_NULL };
+    unsigned char message_pointer[] = { MESSAGE_POINTER };
+    unsigned char message_time[] = { MESSAGE_TIME };
+    unsigned char message_hashtable[] = { MESSAGE_HASHTABLE };
+    unsigned char message_hdata[] = { MESSAGE_HDATA };
+    unsigned char message_info[] = { MESSAGE_INFO };
+    unsigned char message_infolist[] = { MESSAGE_INFOLIST };
+    unsigned char message_array[] = { MESSAGE_ARRAY };
+    struct t_weechat_relay_value value;
+    struct t_weechat_relay_obj *obj;
+
+    LONGS_EQUAL(0, weechat_relay_value_from_obj (NULL, NULL));
+    LONGS_EQUAL(0, weechat_relay_value_from_obj (&value, NULL));
+    POINTERS_EQUAL(NULL, weechat_relay_value_to_obj (NULL));
+    weechat_relay_value_clear (NULL);
+
+    obj = weechat_relay_obj_alloc (WEECHAT_RELAY_OBJ_TYPE_INTEGER);
+    obj->value_integer = -42;
+    LONGS_EQUAL(1, weechat_relay_value_from_obj (&value, obj));
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_INTEGER, value.type);
+    LONGS_EQUAL(-42, value.value_integer);
+    weechat_relay_obj_free (obj);
+
+    check_value_message (message_char, sizeof (message_char), 0);
+    check_value_message (message_integer, sizeof (message_integer), 0);
+    check_value_message (message_long, sizeof (message_long), 0);
+    check_value_message (message_string, sizeof (message_string), 0);
+    check_value_message (message_string_null, sizeof (message_string_null), 0);
+    check_value_message (message_string_empty, sizeof (message_string_empty), 0);
+    check_value_message (message_buffer, sizeof (message_buffer), 0);
+    check_value_message (message_buffer_null, sizeof (message_buffer_null), 0);
+    check_value_message (message_pointer, sizeof (message_pointer), 0);
+    check_value_message (message_time, sizeof (message_time), 0);
+    check_value_message (message_hashtable, sizeof (message_hashtable), 0);
+    check_value_message (message_hdata, sizeof (message_hdata), 0);
+    check_value_message (message_info, sizeof (message_info), 0);
+    check_value_message (message_infolist, sizeof (message_infolist), 0);
+    check_value_message (message_array, sizeof (message_array), 0);
+
+    /* objects parsed with native arrays, columns and index */
+    check_value_message (message_hdata, sizeof (message_hdata),
+                         WEECHAT_RELAY_PARSE_FLAG_NATIVE_ARRAYS);
+    check_value_message (message_infolist, sizeof (message_infolist),
+                         WEECHAT_RELAY_PARSE_FLAG_COLUMNAR_INFOLISTS);
+    check_value_message (message_hashtable, sizeof (message_hashtable),
+                         WEECHAT_RELAY_PARSE_FLAG_HASHTABLE_INDEX);
+}
+
+/*
+ * Tests functions:
+ *   weechat_relay_parse_read_value
+ *   weechat_relay_parse_message_flags (with compact values)
+ */
+
+TEST(LibValue, ParseMessage)
+{
+    unsigned char message[] = {
+        0x00, 0x00, 0x00, 11 + 7 + 78 + 30,
+        0x00,
+        0x00, 0x00, 0x00, 0x02, 'i', 'd',
+        'i', 'n', 't', OBJ_INTEGER,
+        'h', 'd', 'a', OBJ_HDATA,
+        'a', 'r', 'r',
+        'i', 'n', 't',
+        0x00, 0x00, 0x00, 0x05,
+        0x00, 0x00, 0x00, 0x01,
+        0xFF, 0xFF, 0xFF, 0xFF,
+        0x12, 0x34, 0x56, 0x78,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x05,
+    };
+    unsigned char message_hdata_invalid_count[] = { MESSAGE_HDATA_INVALID_COUNT };
+    unsigned char message_infolist_invalid_count[] = { MESSAGE_INFOLIST_INVALID_COUNT };
+    unsigned char message_array_invalid_count[] = { MESSAGE_ARRAY_INVALID_COUNT };
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+    struct t_weechat_relay_value_hdata *ptr_hdata;
+    struct t_weechat_relay_value_array *ptr_array;
+    struct t_weechat_relay_value value;
+    struct t_weechat_relay_msg *msg;
+    char *buffer;
+    size_t size;
+    uint32_t length32;
+    int i;
+
+    parsed_msg = weechat_relay_parse_message_flags (
+        message, sizeof (message), WEECHAT_RELAY_PARSE_FLAG_VALUES);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(3, parsed_msg->num_values);
+
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_INTEGER, parsed_msg->values[0].type);
+    LONGS_EQUAL(123456, parsed_msg->values[0].value_integer);
+
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_HDATA, parsed_msg->values[1].type);
+    ptr_hdata = parsed_msg->values[1].value_hdata;
+    STRCMP_EQUAL("p1/p2", ptr_hdata->hpath);
+    LONGS_EQUAL(2, ptr_hdata->num_hpaths);
+    LONGS_EQUAL(3, ptr_hdata->num_keys);
+    STRCMP_EQUAL("k2", ptr_hdata->keys_names[1]);
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_CHAR, ptr_hdata->keys_types[2]);
+    LONGS_EQUAL(2, ptr_hdata->count);
+    POINTERS_EQUAL(0x123, ptr_hdata->ppath[0]);
+    POINTERS_EQUAL(0xdef, ptr_hdata->ppath[3]);
+    STRCMP_EQUAL("ab", ptr_hdata->values[0].value_string);
+    LONGS_EQUAL(2, ptr_hdata->values[0].length);
+    LONGS_EQUAL(5, ptr_hdata->values[1].value_integer);
+    LONGS_EQUAL('X', ptr_hdata->values[5].value_char);
+
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_ARRAY, parsed_msg->values[2].type);
+    ptr_array = parsed_msg->values[2].value_array;
+    LONGS_EQUAL(WEECHAT_RELAY_OBJ_TYPE_INTEGER, ptr_array->type);
+    LONGS_EQUAL(5, ptr_array->count);
+    LONGS_EQUAL(1, ptr_array->values[0].value_integer);
+    LONGS_EQUAL(-1, ptr_array->values[1].value_integer);
+    LONGS_EQUAL(0x12345678, ptr_array->values[2].value_integer);
+    LONGS_EQUAL(5, ptr_array->values[4].value_integer);
+
+    msg = weechat_relay_msg_new ("id");
+    for (i = 0; i < parsed_msg->num_values; i++)
+    {
+        LONGS_EQUAL(1, weechat_relay_msg_add_value (msg, &parsed_msg->values[i]));
+    }
+    LONGS_EQUAL(sizeof (message), msg->data_size);
+    MEMCMP_EQUAL(message, msg->data, sizeof (message));
+    weechat_relay_msg_free (msg);
+
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /* invalid counts */
+    parsed_msg = weechat_relay_parse_message_flags (
+        message_hdata_invalid_count, sizeof (message_hdata_invalid_count),
+        WEECHAT_RELAY_PARSE_FLAG_VALUES);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(0, parsed_msg->num_values);
+    weechat_relay_parse_msg_free (parsed_msg);
+    parsed_msg = weechat_relay_parse_message_flags (
+        message_infolist_invalid_count, sizeof (message_infolist_invalid_count),
+        WEECHAT_RELAY_PARSE_FLAG_VALUES);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(0, parsed_msg->num_values);
+    weechat_relay_parse_msg_free (parsed_msg);
+    parsed_msg = weechat_relay_parse_message_flags (
+        message_array_invalid_count, sizeof (message_array_invalid_count),
+        WEECHAT_RELAY_PARSE_FLAG_VALUES);
+    CHECK(parsed_msg);
+    LONGS_EQUAL(0, parsed_msg->num_values);
+    weechat_relay_parse_msg_free (parsed_msg);
+
+    /*
+     * hdata with 1000 keys and a count equal to the bytes remaining: the
+     * values (count * keys) are rejected before being allocated
+     */
+    size = 4 + 1 + 4 + (1000 * 6) - 1 + 4 + 4000;
+    buffer = (char *)malloc (size);
+    memset (buffer, 0x01, size);
+    length32 = htonl (1);
+    memcpy (buffer, &length32, 4);
+    buffer[4] = 'p';
+    length32 = htonl ((1000 * 6) - 1);
+    memcpy (buffer + 5, &length32, 4);
+    for (i = 0; i < 1000; i++)
+    {
+        memcpy (buffer + 9 + (i * 6), "k:chr,", (i < 999) ? 6 : 5);
+    }
+    length32 = htonl (4000);
+    memcpy (buffer + 9 + (1000 * 6) - 1, &length32, 4);
+    parsed_msg = weechat_relay_parse_msg_alloc (message, sizeof (message));
+    CHECK(parsed_msg);
+    parsed_msg->buffer = buffer;
+    parsed_msg->size = size;
+    parsed_msg->position = 0;
+    memset (&value, 0, sizeof (value));
+    value.type = WEECHAT_RELAY_OBJ_TYPE_HDATA;
+    value.value_hdata = (struct t_weechat_relay_value_hdata *)calloc (
+        1, sizeof (*value.value_hdata));
+    LONGS_EQUAL(0, weechat_relay_parse_read_value_hdata (parsed_msg,
+                                                         value.value_hdata));
+    LONGS_EQUAL(1000, value.value_hdata->num_keys);
+    LONGS_EQUAL(0, value.value_hdata->count);
+    POINTERS_EQUAL(NULL, value.value_hdata->values);
+    weechat_relay_value_clear (&value);
+    weechat_relay_parse_msg_free (parsed_msg);
+    free (buffer);
+}
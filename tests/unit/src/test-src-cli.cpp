@@ -47,6 +47,8 @@ extern void relay_cli_display_usage ();
 extern void relay_cli_display_arg_error (const char *error);
 extern int relay_cli_parse_args (int argc, char *argv[]);
 extern void relay_cli_display_message (const void *buffer, size_t size);
+extern void relay_cli_display_parsed_message (struct t_weechat_relay_parsed_msg *parsed_msg,
+                                              long long time_diff);
 extern ssize_t relay_cli_send_command (const char *command);
 extern int relay_cli_check_pending ();
 extern ssize_t relay_cli_recv_message ();
@@ -539,6 +541,24 @@ TEST(SrcCli, DisplayMessage)
     relay_cli_display_message (msg_string, sizeof (msg_string));
 }
 
+/*
+ * Tests functions:
+ *   relay_cli_display_parsed_message
+ */
+
+TEST(SrcCli, DisplayParsedMessage)
+{
+    unsigned char msg_string[] = { MESSAGE_STRING };
+    struct t_weechat_relay_parsed_msg *parsed_msg;
+
+    relay_cli_display_parsed_message (NULL, 0);
+
+    parsed_msg = weechat_relay_parse_message (msg_string, sizeof (msg_string));
+    CHECK(parsed_msg);
+    relay_cli_display_parsed_message (parsed_msg, 10);
+    weechat_relay_parse_msg_free (parsed_msg);
+}
+
 /*
  * Tests functions:
  *   relay_cli_send_command
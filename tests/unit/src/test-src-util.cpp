@@ -25,7 +25,9 @@
 
 extern "C"
 {
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "src/util.h"
 }
 
@@ -124,3 +126,50 @@ TEST(SrcUtil, DisplayHexDump)
     display_hex_dump (string, 0);
     display_hex_dump (string, strlen (string));
 }
+
+/*
+ * Tests functions:
+ *   file_read
+ *   file_write
+ */
+
+TEST(SrcUtil, FileReadWrite)
+{
+    char filename[] = "/tmp/test-src-util-XXXXXX", *buffer, *content;
+    size_t size;
+    int fd, i;
+
+    fd = mkstemp (filename);
+    CHECK(fd >= 0);
+    close (fd);
+
+    POINTERS_EQUAL(NULL, file_read (NULL, &size));
+    POINTERS_EQUAL(NULL, file_read (filename, NULL));
+    POINTERS_EQUAL(NULL, file_read ("/tmp/does/not/exist", &size));
+    LONGS_EQUAL(0, size);
+    LONGS_EQUAL(0, file_write (NULL, "abc", 3));
+    LONGS_EQUAL(0, file_write (filename, NULL, 3));
+
+    /* empty file */
+    LONGS_EQUAL(1, file_write (filename, "", 0));
+    buffer = (char *)file_read (filename, &size);
+    CHECK(buffer);
+    LONGS_EQUAL(0, size);
+    free (buffer);
+
+    /* file bigger than the initial buffer to read it */
+    content = (char *)malloc (200 * 1024);
+    for (i = 0; i < 200 * 1024; i++)
+    {
+        content[i] = (char)(i % 251);
+    }
+    LONGS_EQUAL(1, file_write (filename, content, 200 * 1024));
+    buffer = (char *)file_read (filename, &size);
+    CHECK(buffer);
+    LONGS_EQUAL(200 * 1024, size);
+    MEMCMP_EQUAL(content, buffer, size);
+    free (buffer);
+    free (content);
+
+    unlink (filename);
+}